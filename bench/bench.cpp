@@ -0,0 +1,821 @@
+/*
+ * nrvna ai - Micro-benchmarks and load generator (nrvna_bench)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/flow.hpp"
+#include "nrvna/logger.hpp"
+#include "nrvna/meta.hpp"
+#include "nrvna/scanner.hpp"
+#include "nrvna/work.hpp"
+#include "artifacts.hpp"
+#include "job_index.hpp"
+#include "tts_spectral.hpp"
+#include "vector_store.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace nrvnaai;
+
+namespace {
+
+constexpr const char* VERSION = "0.1.0";
+
+void printUsage(const char* progName) {
+    std::cout << "nrvna-ai Benchmarks v" << VERSION << "\n\n";
+    std::cout << "Usage: " << progName << " vocoder [--codes N] [--iters N]\n";
+    std::cout << "       " << progName << " micro [--jobs N] [--iters N] [--dim N] [--out FILE]\n";
+    std::cout << "       " << progName << " search [--jobs N] [--iters N] [--dim N] [--out FILE]\n";
+    std::cout << "       " << progName << " load <workspace> [options] [--out FILE]\n";
+    std::cout << "       " << progName << " --help | --version\n\n";
+    std::cout << "Subcommands:\n";
+    std::cout << "  vocoder       ISTFT: FFT engine vs reference DFT (correctness + speed)\n";
+    std::cout << "  micro         Non-model hot paths on a scratch workspace: submit, scan,\n";
+    std::cout << "                list, meta.json parse, embedding write, irfft\n";
+    std::cout << "  search        Top-10 query over a scratch vector store per row type\n";
+    std::cout << "                (f32, f16, i8): latency, rows/s and recall against f32\n";
+    std::cout << "  load          Drive a workspace served by nrvnad and report submit->done\n";
+    std::cout << "                latency percentiles, jobs/s and tokens/s\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --codes N     vocoder: audio codes per run (default: 600, ~8s of audio)\n";
+    std::cout << "  --iters N     Timed repetitions, median reported (default: 20)\n";
+    std::cout << "  --jobs N      Jobs to create or submit (default: micro 10000, load 200),\n";
+    std::cout << "                search: stored rows (default: 200000)\n";
+    std::cout << "  --dim N       Embedding length (default: micro 4096, search 384)\n";
+    std::cout << "  --out FILE    Write results as JSON (load default: bench-results.json)\n\n";
+    std::cout << "Load options:\n";
+    std::cout << "  --rate R               Poisson arrivals, jobs/s (default: 0 = one burst)\n";
+    std::cout << "  --mix T=W,...          Job mix by weight over text, embed, vision, tts\n";
+    std::cout << "                         (default: text=100)\n";
+    std::cout << "  --prompt-words MIN:MAX Uniform prompt length in words (default: 16:256)\n";
+    std::cout << "  --image PATH           Image for vision jobs (required if vision is mixed in)\n";
+    std::cout << "  --timeout S            Give up on unfinished jobs after S seconds (default: 600)\n";
+    std::cout << "  --seed N               Prompt and arrival seed (default: 42)\n";
+    std::cout << "  --daemon MODEL         Start nrvnad on the workspace for the run, stop it after\n";
+    std::cout << "  --workers N            Worker threads for --daemon (default: 4)\n";
+    std::cout << "  --nrvnad PATH          nrvnad binary for --daemon (default: nrvnad on PATH)\n";
+    std::cout << "  --mmproj PATH          Passed to nrvnad with --daemon\n";
+    std::cout << "  --vocoder PATH         Passed to nrvnad with --daemon\n\n";
+    std::cout << "Without --daemon, load expects nrvnad to be serving the workspace already and\n";
+    std::cout << "reads the worker count from its metrics file. One warm-up job per mode runs\n";
+    std::cout << "before the clock starts. Latency is completed_at - submitted_at from meta.json.\n";
+}
+
+struct Options {
+    int codes = 600;
+    int iters = 20;
+    int jobs = -1;              // per-subcommand default
+    int dim = -1;               // per-subcommand default
+    std::string out;
+
+    std::filesystem::path workspace;
+    double rate = 0.0;
+    std::string mix = "text=100";
+    int minWords = 16;
+    int maxWords = 256;
+    std::filesystem::path image;
+    double timeout_s = 600.0;
+    unsigned seed = 42;
+    std::string daemonModel;
+    int workers = 4;
+    std::string nrvnad = "nrvnad";
+    std::string mmproj;
+    std::string vocoder;
+};
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Median wall time of `iters` calls (at least one)
+template <typename Fn>
+double medianMs(int iters, Fn&& fn) {
+    std::vector<double> runs;
+    for (int i = 0; i < std::max(1, iters); ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        runs.push_back(msSince(start));
+    }
+    std::sort(runs.begin(), runs.end());
+    return runs[runs.size() / 2];
+}
+
+struct Summary {
+    std::size_t n = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Nearest-rank percentiles
+Summary summarize(std::vector<double> values) {
+    Summary s;
+    s.n = values.size();
+    if (values.empty()) return s;
+    std::sort(values.begin(), values.end());
+    auto rank = [&](double p) {
+        const auto k = static_cast<std::size_t>(std::ceil(p * static_cast<double>(values.size())));
+        return values[std::min(values.size() - 1, k > 0 ? k - 1 : 0)];
+    };
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    s.mean = sum / static_cast<double>(values.size());
+    s.p50 = rank(0.50);
+    s.p90 = rank(0.90);
+    s.p99 = rank(0.99);
+    s.max = values.back();
+    return s;
+}
+
+std::string summaryJson(const Summary& s) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"n\": %zu, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+                  s.n, s.mean, s.p50, s.p90, s.p99, s.max);
+    return buf;
+}
+
+bool writeResults(const std::string& path, const std::string& json) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: cannot write " << path << "\n";
+        return false;
+    }
+    file << json;
+    file.flush();
+    if (!file.good()) {
+        std::cerr << "Error: cannot write " << path << "\n";
+        return false;
+    }
+    std::cout << "results: " << path << "\n";
+    return true;
+}
+
+int benchVocoder(int codes, int iters) {
+    const int n_fft = 1280;
+    const int n_hop = 320;
+    const int n_embd = n_fft + 2;
+    const int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    // Log-magnitudes and phases in the range the WavTokenizer head produces
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> logMag(-6.0f, 3.0f);
+    std::uniform_real_distribution<float> phase(-3.14159f, 3.14159f);
+    std::vector<float> embd(static_cast<std::size_t>(codes) * n_embd);
+    for (int l = 0; l < codes; ++l) {
+        float* row = embd.data() + static_cast<std::size_t>(l) * n_embd;
+        for (int k = 0; k < n_embd / 2; ++k) {
+            row[k] = logMag(rng);
+            row[k + n_embd / 2] = phase(rng);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto reference = embdToAudioReference(embd.data(), codes, n_embd, threads);
+    const double refMs = msSince(start);
+
+    Istft istft(n_fft, n_hop);
+    start = std::chrono::steady_clock::now();
+    auto fast = istft.synthesize(embd.data(), codes, n_embd);
+    const double coldMs = msSince(start);
+
+    std::vector<double> runs;
+    for (int i = 0; i < iters; ++i) {
+        start = std::chrono::steady_clock::now();
+        fast = istft.synthesize(embd.data(), codes, n_embd);
+        runs.push_back(msSince(start));
+    }
+    std::sort(runs.begin(), runs.end());
+    const double medianMs = runs.empty() ? coldMs : runs[runs.size() / 2];
+
+    double maxErr = 0.0, peak = 0.0;
+    if (fast.size() == reference.size()) {
+        for (std::size_t i = 0; i < fast.size(); ++i) {
+            maxErr = std::max(maxErr, static_cast<double>(std::fabs(fast[i] - reference[i])));
+            peak = std::max(peak, static_cast<double>(std::fabs(reference[i])));
+        }
+    }
+    const double relErr = peak > 0.0 ? maxErr / peak : maxErr;
+    const bool ok = fast.size() == reference.size() && relErr < 1e-3;
+
+    std::printf("vocoder: %d codes, %zu samples, %d threads\n", codes, reference.size(), threads);
+    std::printf("  reference   %10.2f ms\n", refMs);
+    std::printf("  fft (cold)  %10.2f ms\n", coldMs);
+    std::printf("  fft (p50)   %10.2f ms   %.1fx\n", medianMs, medianMs > 0.0 ? refMs / medianMs : 0.0);
+    std::printf("  max error   %10.3g (relative %.3g) %s\n", maxErr, relErr, ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+// --- micro ------------------------------------------------------------------
+
+int benchMicro(const Options& o) {
+    const int jobs = o.jobs > 0 ? o.jobs : 10000;
+    const int dim = o.dim > 0 ? o.dim : 4096;
+    const auto ws = std::filesystem::temp_directory_path() /
+                    ("nrvna_bench_" + std::to_string(static_cast<long>(getpid())));
+    std::error_code ec;
+    std::filesystem::remove_all(ws, ec);
+
+    std::vector<std::pair<std::string, double>> results;   // name, median ms
+    auto report = [&](const char* name, double ms, double perOps) {
+        results.emplace_back(name, ms);
+        if (perOps > 0.0) {
+            std::printf("  %-24s %10.3f ms   %8.2f us/op\n", name, ms, ms * 1000.0 / perOps);
+        } else {
+            std::printf("  %-24s %10.3f ms\n", name, ms);
+        }
+    };
+
+    std::printf("micro: %d jobs, %d iters, dim %d\n", jobs, o.iters, dim);
+    try {
+        Work work(ws);
+        std::vector<SubmitRequest> requests(static_cast<std::size_t>(jobs));
+        for (int i = 0; i < jobs; ++i) {
+            requests[static_cast<std::size_t>(i)].prompt = "benchmark prompt " + std::to_string(i);
+        }
+        auto start = std::chrono::steady_clock::now();
+        const auto submitted = work.submitBatch(requests);
+        report("submit_batch", msSince(start), jobs);
+        if (std::any_of(submitted.begin(), submitted.end(), [](const SubmitResult& r) { return !r.ok; })) {
+            std::cerr << "Error: scratch submission failed in " << ws << "\n";
+            std::filesystem::remove_all(ws, ec);
+            return 1;
+        }
+
+        Scanner scanner(ws);
+        std::size_t found = 0;
+        report("scanner_scan", medianMs(o.iters, [&] { found = scanner.scan().size(); }), jobs);
+        if (found != static_cast<std::size_t>(jobs)) {
+            std::cerr << "Warning: scan found " << found << " of " << jobs << " jobs\n";
+        }
+
+        const auto ready = ws / "input" / "ready";
+        std::size_t parsed = 0;
+        start = std::chrono::steady_clock::now();
+        for (const auto& r : submitted) {
+            if (readMetaJson(ready / r.id)) ++parsed;
+        }
+        report("read_meta_json", msSince(start), static_cast<double>(parsed));
+
+        // Finished jobs: list() walks output/ until the daemon's index exists
+        for (const auto& r : submitted) {
+            std::filesystem::rename(ready / r.id, ws / "output" / r.id);
+        }
+        Flow flow(ws);
+        report("flow_list_dir_walk", medianMs(o.iters, [&] { (void)flow.list(10); }), 0.0);
+        {
+            JobIndex index(ws);
+            (void)index.rebuild();
+            report("flow_list_index", medianMs(o.iters, [&] { (void)flow.list(10); }), 0.0);
+        }
+
+        // Processor::finalizeEmbedding minus the journal append: artifacts
+        // written in processing/<job>, then the directory renamed to output/
+        std::mt19937 rng(o.seed);
+        std::normal_distribution<float> dist(0.0f, 0.05f);
+        std::vector<float> vec(static_cast<std::size_t>(dim));
+        for (auto& v : vec) v = dist(rng);
+        const std::vector<const std::vector<float>*> rows = {&vec};
+        int seq = 0;
+        auto finalize = [&](bool json, bool f32) {
+            const std::string id = "embed_" + std::to_string(seq++);
+            const auto dir = ws / "processing" / id;
+            std::filesystem::create_directory(dir);
+            if (f32) (void)writeEmbeddingF32(dir, rows);
+            if (json) (void)writeEmbeddingJson(dir, rows, false);
+            std::filesystem::rename(dir, ws / "output" / id);
+        };
+        report("finalize_embedding_json", medianMs(o.iters, [&] { finalize(true, false); }), 0.0);
+        report("finalize_embedding_f32", medianMs(o.iters, [&] { finalize(false, true); }), 0.0);
+
+        // One vocoder frame at the WavTokenizer size
+        RealIfft ifft(1280);
+        auto scratch = ifft.makeScratch();
+        std::vector<float> cplx(static_cast<std::size_t>(ifft.size() + 2));
+        std::vector<float> frame(static_cast<std::size_t>(ifft.size()));
+        for (auto& v : cplx) v = dist(rng);
+        const int frames = 1000;
+        report("irfft_1280_x1000",
+               medianMs(o.iters, [&] {
+                   for (int f = 0; f < frames; ++f) ifft.run(cplx.data(), frame.data(), scratch);
+               }),
+               frames);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::filesystem::remove_all(ws, ec);
+        return 1;
+    }
+    std::filesystem::remove_all(ws, ec);
+
+    if (!o.out.empty()) {
+        std::ostringstream json;
+        json << "{\n  \"benchmark\": \"micro\",\n  \"version\": \"" << VERSION << "\",\n";
+        json << "  \"jobs\": " << jobs << ",\n  \"iters\": " << o.iters << ",\n  \"dim\": " << dim << ",\n";
+        json << "  \"median_ms\": {";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            char buf[96];
+            std::snprintf(buf, sizeof(buf), "%s\n    \"%s\": %.4f", i > 0 ? "," : "",
+                          results[i].first.c_str(), results[i].second);
+            json << buf;
+        }
+        json << "\n  }\n}\n";
+        if (!writeResults(o.out, json.str())) return 1;
+    }
+    return 0;
+}
+
+// --- search -----------------------------------------------------------------
+
+int benchSearch(const Options& o) {
+    const std::size_t rows = static_cast<std::size_t>(o.jobs > 0 ? o.jobs : 200000);
+    const std::size_t dim = static_cast<std::size_t>(o.dim > 0 ? o.dim : 384);
+    const std::size_t k = 10;
+    const std::size_t rowsPerJob = 1000;     // appended like multi-input jobs
+    const auto ws = std::filesystem::temp_directory_path() /
+                    ("nrvna_bench_" + std::to_string(static_cast<long>(getpid())));
+    std::error_code ec;
+
+    // Unit vectors, as the runners write them
+    std::mt19937 rng(o.seed);
+    std::normal_distribution<float> dist(0.0f, 1.0f);
+    std::vector<std::vector<float>> vectors(rows, std::vector<float>(dim));
+    for (auto& vec : vectors) {
+        double norm = 0.0;
+        for (auto& v : vec) {
+            v = dist(rng);
+            norm += static_cast<double>(v) * v;
+        }
+        for (auto& v : vec) v = static_cast<float>(v / std::sqrt(norm));
+    }
+    std::vector<float> query(dim);
+    for (auto& v : query) v = dist(rng);
+
+    std::printf("search: %zu rows, dim %zu, top %zu, %d iters, %u threads\n", rows, dim, k, o.iters,
+                std::max(1u, std::thread::hardware_concurrency()));
+    struct Result {
+        const char* type;
+        double ms;
+        double recall;
+    };
+    std::vector<Result> results;
+    std::vector<SearchHit> exact;
+    try {
+        for (VectorType type : {VectorType::F32, VectorType::F16, VectorType::I8}) {
+            std::filesystem::remove_all(ws, ec);
+            VectorStore store(ws, type);
+            for (std::size_t j = 0; j < rows; j += rowsPerJob) {
+                std::vector<const std::vector<float>*> job;
+                for (std::size_t i = j; i < std::min(rows, j + rowsPerJob); ++i) job.push_back(&vectors[i]);
+                if (!store.append("bench", "1_1_" + std::to_string(j), job)) {
+                    std::cerr << "Error: vector store append failed in " << ws << "\n";
+                    std::filesystem::remove_all(ws, ec);
+                    return 1;
+                }
+            }
+            const auto paths = VectorIndex::list(ws);
+            auto index = paths.empty() ? nullptr : VectorIndex::open(paths.front());
+            if (!index || index->count() != rows) {
+                std::cerr << "Error: vector store did not reopen with " << rows << " rows\n";
+                std::filesystem::remove_all(ws, ec);
+                return 1;
+            }
+
+            std::vector<SearchHit> hits = index->search(query.data(), k);   // first touch
+            const double ms = medianMs(o.iters, [&] { hits = index->search(query.data(), k); });
+            if (type == VectorType::F32) exact = hits;
+            std::size_t same = 0;
+            for (const auto& hit : hits) {
+                same += std::any_of(exact.begin(), exact.end(), [&](const SearchHit& e) {
+                    return e.id == hit.id && e.row == hit.row;
+                });
+            }
+            const double recall = exact.empty() ? 0.0 : static_cast<double>(same) / exact.size();
+            results.push_back({vectorTypeName(type), ms, recall});
+            std::printf("  search_%-17s %10.3f ms   %8.1f Mrows/s   recall@%zu %.2f\n", vectorTypeName(type), ms,
+                        ms > 0.0 ? rows / ms / 1000.0 : 0.0, k, recall);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        std::filesystem::remove_all(ws, ec);
+        return 1;
+    }
+    std::filesystem::remove_all(ws, ec);
+
+    if (!o.out.empty()) {
+        std::ostringstream json;
+        json << "{\n  \"benchmark\": \"search\",\n  \"version\": \"" << VERSION << "\",\n";
+        json << "  \"rows\": " << rows << ",\n  \"dim\": " << dim << ",\n  \"k\": " << k
+             << ",\n  \"iters\": " << o.iters << ",\n";
+        json << "  \"results\": {";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            char buf[128];
+            std::snprintf(buf, sizeof(buf), "%s\n    \"%s\": {\"median_ms\": %.4f, \"recall\": %.2f}",
+                          i > 0 ? "," : "", results[i].type, results[i].ms, results[i].recall);
+            json << buf;
+        }
+        json << "\n  }\n}\n";
+        if (!writeResults(o.out, json.str())) return 1;
+    }
+    return 0;
+}
+
+// --- load -------------------------------------------------------------------
+
+constexpr const char* kWords[] = {
+    "the", "queue", "model", "river", "light", "system", "quiet", "answer", "build", "window",
+    "number", "simple", "across", "garden", "signal", "between", "morning", "paper", "stone", "travel",
+    "memory", "thread", "open", "small", "yellow", "engine", "follow", "market", "winter", "question",
+    "careful", "history", "machine", "north", "table", "listen", "bridge", "silver", "record", "planet",
+    "explain", "how", "why", "what", "describe", "summarize", "compare", "list", "three", "reasons"};
+
+struct MixEntry {
+    JobType type;
+    double weight;
+};
+
+bool parseMix(const std::string& spec, std::vector<MixEntry>& mix) {
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        const auto eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        const std::string name = item.substr(0, eq);
+        const double weight = std::atof(item.c_str() + eq + 1);
+        JobType type;
+        if (name == "text") type = JobType::Text;
+        else if (name == "embed") type = JobType::Embed;
+        else if (name == "vision") type = JobType::Vision;
+        else if (name == "tts") type = JobType::Tts;
+        else return false;
+        if (weight < 0.0) return false;
+        if (weight > 0.0) mix.push_back({type, weight});
+    }
+    return !mix.empty();
+}
+
+std::string makePrompt(std::mt19937& rng, int words) {
+    const std::size_t vocab = sizeof(kWords) / sizeof(kWords[0]);
+    std::uniform_int_distribution<std::size_t> pick(0, vocab - 1);
+    std::string prompt;
+    for (int i = 0; i < words; ++i) {
+        if (i > 0) prompt += ' ';
+        prompt += kWords[pick(rng)];
+    }
+    return prompt;
+}
+
+// nrvna_workers from the daemon's metrics file, -1 if there is none
+int readWorkerCount(const std::filesystem::path& workspace) {
+    std::ifstream file(workspace / "metrics");
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.rfind("nrvna_workers ", 0) == 0) return std::atoi(line.c_str() + 14);
+    }
+    return -1;
+}
+
+pid_t spawnDaemon(const Options& o) {
+    std::vector<std::string> args = {o.nrvnad, o.daemonModel, o.workspace.string(),
+                                     "-w", std::to_string(o.workers)};
+    if (!o.mmproj.empty()) { args.push_back("--mmproj"); args.push_back(o.mmproj); }
+    if (!o.vocoder.empty()) { args.push_back("--vocoder"); args.push_back(o.vocoder); }
+    const auto logPath = (o.workspace / "bench-nrvnad.log").string();
+
+    const pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    const int fd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+    std::vector<char*> argv;
+    for (auto& a : args) argv.push_back(a.data());
+    argv.push_back(nullptr);
+    execvp(argv[0], argv.data());
+    std::perror("execvp");
+    _exit(127);
+}
+
+void stopDaemon(pid_t pid) {
+    if (pid <= 0) return;
+    kill(pid, SIGTERM);
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+// Wait for a terminal status in one-second slices so a daemon that died
+// (bad model path, crash) ends the wait instead of the full timeout
+Status waitJob(const Flow& flow, const JobId& id, std::chrono::steady_clock::time_point deadline, pid_t daemon) {
+    for (;;) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return flow.status(id);
+        const auto slice = std::min<std::chrono::steady_clock::duration>(deadline - now, std::chrono::seconds(1));
+        const Status s = flow.waitFor(id, std::chrono::duration_cast<std::chrono::milliseconds>(slice));
+        if (s == Status::Done || s == Status::Failed || s == Status::Missing) return s;
+        if (daemon > 0 && waitpid(daemon, nullptr, WNOHANG) == daemon) return flow.status(id);
+    }
+}
+
+struct ModeTotals {
+    std::size_t submitted = 0;
+    std::size_t done = 0;
+    std::size_t failed = 0;
+    std::vector<double> latency_ms;
+    long long generated_tokens = 0;
+};
+
+int benchLoad(const Options& o) {
+    if (o.workspace.empty()) {
+        std::cerr << "Error: load requires a workspace\n";
+        return 1;
+    }
+    std::vector<MixEntry> mix;
+    if (!parseMix(o.mix, mix)) {
+        std::cerr << "Error: invalid --mix '" << o.mix << "' (expected e.g. text=70,embed=30)\n";
+        return 1;
+    }
+    const bool wantsVision = std::any_of(mix.begin(), mix.end(),
+                                         [](const MixEntry& m) { return m.type == JobType::Vision; });
+    if (wantsVision && o.image.empty()) {
+        std::cerr << "Error: vision in --mix needs --image\n";
+        return 1;
+    }
+    const int jobs = o.jobs > 0 ? o.jobs : 200;
+
+    Work work(o.workspace);
+    Flow flow(o.workspace);
+    pid_t daemon = -1;
+    if (!o.daemonModel.empty()) {
+        daemon = spawnDaemon(o);
+        if (daemon < 0) {
+            std::cerr << "Error: cannot start " << o.nrvnad << "\n";
+            return 1;
+        }
+    }
+
+    auto makeRequest = [&](JobType type, std::mt19937& rng) {
+        SubmitRequest req;
+        req.type = type;
+        std::uniform_int_distribution<int> words(o.minWords, o.maxWords);
+        // Speech is synthesized per word; keep tts prompts sentence-sized
+        const int n = type == JobType::Tts ? std::min(words(rng), 24) : words(rng);
+        req.prompt = makePrompt(rng, n);
+        if (type == JobType::Vision) req.imagePaths.push_back(o.image);
+        return req;
+    };
+
+    std::mt19937 rng(o.seed);
+    const auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(o.timeout_s));
+
+    // Warm-up: model load, first-touch allocations and per-mode runner setup
+    // stay out of the measured window
+    for (const auto& m : mix) {
+        const auto warm = work.submit(makeRequest(m.type, rng).prompt, m.type,
+                                      m.type == JobType::Vision ? std::vector<std::filesystem::path>{o.image}
+                                                                : std::vector<std::filesystem::path>{});
+        const Status s = warm ? waitJob(flow, warm.id, std::chrono::steady_clock::now() + timeout, daemon)
+                              : Status::Missing;
+        if (s != Status::Done) {
+            std::cerr << "Error: warm-up " << jobTypeToString(m.type) << " job "
+                      << (warm ? warm.id + " did not finish" : "was not accepted: " + warm.message) << "\n";
+            if (daemon > 0) std::cerr << "See " << (o.workspace / "bench-nrvnad.log").string() << "\n";
+            stopDaemon(daemon);
+            return 1;
+        }
+    }
+
+    std::vector<double> weights;
+    for (const auto& m : mix) weights.push_back(m.weight);
+    std::discrete_distribution<std::size_t> pickMode(weights.begin(), weights.end());
+    std::vector<SubmitRequest> requests;
+    requests.reserve(static_cast<std::size_t>(jobs));
+    for (int i = 0; i < jobs; ++i) {
+        requests.push_back(makeRequest(mix[pickMode(rng)].type, rng));
+    }
+
+    char arrival[48] = "burst";
+    if (o.rate > 0.0) std::snprintf(arrival, sizeof(arrival), "%g jobs/s", o.rate);
+    std::printf("load: %d jobs, %s, mix %s, prompts %d-%d words\n", jobs, arrival,
+                o.mix.c_str(), o.minWords, o.maxWords);
+
+    std::vector<SubmitResult> submitted;
+    const auto start = std::chrono::steady_clock::now();
+    if (o.rate <= 0.0) {
+        submitted = work.submitBatch(requests);
+    } else {
+        std::exponential_distribution<double> gap(o.rate);
+        double at = 0.0;
+        for (const auto& req : requests) {
+            at += gap(rng);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                      std::chrono::duration<double>(at)));
+            submitted.push_back(work.submit(req.prompt, req.type, req.imagePaths, req.opts));
+        }
+    }
+    const double submitSeconds = msSince(start) / 1000.0;
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (const auto& r : submitted) {
+        if (r.ok) (void)waitJob(flow, r.id, deadline, daemon);
+    }
+    stopDaemon(daemon);
+
+    // Everything below comes from meta.json, so latencies do not depend on
+    // the order the waits above happened to observe completions in
+    std::vector<ModeTotals> modes(4);
+    std::vector<double> latency, queueWait;
+    std::size_t rejected = 0, timedOut = 0;
+    long long generated = 0;
+    double decodeMs = 0.0;
+    double firstSubmit = -1.0, lastComplete = -1.0;
+    for (std::size_t i = 0; i < submitted.size(); ++i) {
+        const auto& r = submitted[i];
+        ModeTotals& mode = modes[static_cast<std::size_t>(requests[i].type) % modes.size()];
+        ++mode.submitted;
+        if (!r.ok) { ++rejected; continue; }
+        const auto meta = flow.meta(r.id);
+        if (!meta || meta->completed_at.empty()) { ++timedOut; continue; }
+        const auto sub = parseTimestamp(meta->submitted_at);
+        const auto done = parseTimestamp(meta->completed_at);
+        if (meta->status == "done") ++mode.done; else ++mode.failed;
+        if (sub && done) {
+            const double ms = (*done - *sub) * 1000.0;
+            latency.push_back(ms);
+            mode.latency_ms.push_back(ms);
+            firstSubmit = firstSubmit < 0.0 ? *sub : std::min(firstSubmit, *sub);
+            lastComplete = std::max(lastComplete, *done);
+        }
+        if (meta->queue_wait_ms >= 0.0) queueWait.push_back(meta->queue_wait_ms);
+        if (meta->status == "done") {
+            mode.generated_tokens += meta->generated_tokens;
+            generated += meta->generated_tokens;
+            if (meta->decode_ms > 0.0) decodeMs += meta->decode_ms;
+        }
+    }
+
+    std::size_t done = 0, failed = 0;
+    for (const auto& m : modes) { done += m.done; failed += m.failed; }
+    const double makespan = firstSubmit >= 0.0 ? lastComplete - firstSubmit : 0.0;
+    const double jobsPerS = makespan > 0.0 ? static_cast<double>(done + failed) / makespan : 0.0;
+    const double tokensPerS = makespan > 0.0 ? static_cast<double>(generated) / makespan : 0.0;
+    const double streamTokensPerS = decodeMs > 0.0 ? static_cast<double>(generated) * 1000.0 / decodeMs : 0.0;
+    const int workers = daemon > 0 ? o.workers : readWorkerCount(o.workspace);
+    const Summary lat = summarize(latency);
+    const Summary wait = summarize(queueWait);
+
+    std::printf("  done %zu  failed %zu  rejected %zu  unfinished %zu  workers %d\n",
+                done, failed, rejected, timedOut, workers);
+    std::printf("  submit      %10.3f s\n", submitSeconds);
+    std::printf("  makespan    %10.3f s   %.2f jobs/s   %.1f tokens/s (%.1f per stream)\n",
+                makespan, jobsPerS, tokensPerS, streamTokensPerS);
+    std::printf("  latency ms  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", lat.p50, lat.p90, lat.p99, lat.max);
+    std::printf("  queue ms    p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n", wait.p50, wait.p90, wait.p99, wait.max);
+
+    std::ostringstream json;
+    char buf[256];
+    json << "{\n  \"benchmark\": \"load\",\n  \"version\": \"" << VERSION << "\",\n";
+    json << "  \"workspace\": \"" << escapeJson(o.workspace.string()) << "\",\n";
+    json << "  \"mix\": \"" << escapeJson(o.mix) << "\",\n";
+    std::snprintf(buf, sizeof(buf),
+                  "  \"jobs\": %d,\n  \"rate\": %.3f,\n  \"prompt_words\": [%d, %d],\n  \"seed\": %u,\n",
+                  jobs, o.rate, o.minWords, o.maxWords, o.seed);
+    json << buf;
+    if (workers > 0) json << "  \"workers\": " << workers << ",\n";
+    else json << "  \"workers\": null,\n";
+    std::snprintf(buf, sizeof(buf),
+                  "  \"done\": %zu,\n  \"failed\": %zu,\n  \"rejected\": %zu,\n  \"unfinished\": %zu,\n",
+                  done, failed, rejected, timedOut);
+    json << buf;
+    std::snprintf(buf, sizeof(buf),
+                  "  \"submit_s\": %.3f,\n  \"makespan_s\": %.3f,\n  \"jobs_per_s\": %.3f,\n"
+                  "  \"tokens_per_s\": %.3f,\n  \"stream_tokens_per_s\": %.3f,\n  \"generated_tokens\": %lld,\n",
+                  submitSeconds, makespan, jobsPerS, tokensPerS, streamTokensPerS, generated);
+    json << buf;
+    json << "  \"latency_ms\": " << summaryJson(lat) << ",\n";
+    json << "  \"queue_wait_ms\": " << summaryJson(wait) << ",\n";
+    json << "  \"modes\": {";
+    bool first = true;
+    for (std::size_t t = 0; t < modes.size(); ++t) {
+        const auto& m = modes[t];
+        if (m.submitted == 0) continue;
+        json << (first ? "\n" : ",\n") << "    \"" << jobTypeToString(static_cast<JobType>(t)) << "\": ";
+        std::snprintf(buf, sizeof(buf), "{\"submitted\": %zu, \"done\": %zu, \"failed\": %zu, "
+                      "\"generated_tokens\": %lld, \"latency_ms\": ",
+                      m.submitted, m.done, m.failed, m.generated_tokens);
+        json << buf << summaryJson(summarize(m.latency_ms)) << "}";
+        first = false;
+    }
+    json << "\n  }\n}\n";
+    if (!writeResults(o.out.empty() ? "bench-results.json" : o.out, json.str())) return 1;
+    return done > 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Default to WARN so per-job submit logs stay out of the report;
+    // NRVNA_LOG_LEVEL overrides
+    if (!std::getenv("NRVNA_LOG_LEVEL"))
+        Logger::setLevel(LogLevel::WARN);
+
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const std::string command = argv[1];
+    if (command == "-h" || command == "--help") {
+        printUsage(argv[0]);
+        return 0;
+    }
+    if (command == "-v" || command == "--version") {
+        std::cout << VERSION << "\n";
+        return 0;
+    }
+
+    Options o;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--codes" && hasValue) {
+            o.codes = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--iters" && hasValue) {
+            o.iters = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--jobs" && hasValue) {
+            o.jobs = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--dim" && hasValue) {
+            o.dim = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--out" && hasValue) {
+            o.out = argv[++i];
+        } else if (arg == "--rate" && hasValue) {
+            o.rate = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--mix" && hasValue) {
+            o.mix = argv[++i];
+        } else if (arg == "--prompt-words" && hasValue) {
+            const std::string range = argv[++i];
+            const auto colon = range.find(':');
+            o.minWords = std::max(1, std::atoi(range.c_str()));
+            o.maxWords = colon == std::string::npos ? o.minWords
+                                                    : std::max(o.minWords, std::atoi(range.c_str() + colon + 1));
+        } else if (arg == "--image" && hasValue) {
+            o.image = argv[++i];
+        } else if (arg == "--timeout" && hasValue) {
+            o.timeout_s = std::max(1.0, std::atof(argv[++i]));
+        } else if (arg == "--seed" && hasValue) {
+            o.seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--daemon" && hasValue) {
+            o.daemonModel = argv[++i];
+        } else if (arg == "--workers" && hasValue) {
+            o.workers = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--nrvnad" && hasValue) {
+            o.nrvnad = argv[++i];
+        } else if (arg == "--mmproj" && hasValue) {
+            o.mmproj = argv[++i];
+        } else if (arg == "--vocoder" && hasValue) {
+            o.vocoder = argv[++i];
+        } else if (command == "load" && o.workspace.empty() && arg.rfind("--", 0) != 0) {
+            o.workspace = arg;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (command == "vocoder") {
+        return benchVocoder(o.codes, o.iters);
+    }
+    if (command == "micro") {
+        return benchMicro(o);
+    }
+    if (command == "search") {
+        return benchSearch(o);
+    }
+    if (command == "load") {
+        return benchLoad(o);
+    }
+
+    std::cerr << "Unknown subcommand: " << command << "\n";
+    printUsage(argv[0]);
+    return 1;
+}
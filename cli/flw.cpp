@@ -7,11 +7,9 @@
 #include "nrvna/flow.hpp"
 #include "nrvna/meta.hpp"
 #include "nrvna/logger.hpp"
-#include <fstream>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
-#include <thread>
-#include <chrono>
 #include <unistd.h>
 
 using namespace nrvnaai;
@@ -28,6 +26,9 @@ void printUsage(const char* progName) {
     std::cout << "Options:\n";
     std::cout << "  -w, --wait    Wait for job to complete before returning\n";
     std::cout << "  -W, --wait-idle Wait for workspace to be idle (all jobs done)\n";
+    std::cout << "  -f, --follow  Stream output while the job runs (needs NRVNA_STREAM=1 on nrvnad)\n";
+    std::cout << "  -s, --search  List finished embeddings most similar to the job's vector\n";
+    std::cout << "  -k <n>        Matches for --search (default: 10)\n";
     std::cout << "  --json        Output structured JSON\n";
     std::cout << "  -h, --help    Show this help message\n";
     std::cout << "  -v, --version Show version\n\n";
@@ -35,22 +36,19 @@ void printUsage(const char* progName) {
     std::cout << "  - No job_id: show workspace status (counts + recent jobs)\n";
     std::cout << "  - With job_id: retrieve that job's result\n";
     std::cout << "  - With -w and job_id: wait for job to complete, then print result\n";
-    std::cout << "  - Piped input: reads job_id from stdin (wrk ... | flw <ws> -w)\n\n";
+    std::cout << "  - Piped input: reads job_id from stdin (wrk ... | flw <ws> -w)\n";
+    std::cout << "  - With -s: top-k search of the vector store (NRVNA_VECTOR_STORE on nrvnad)\n\n";
     std::cout << "Environment Variables:\n";
     std::cout << "  NRVNA_LOG_LEVEL    Log level (ERROR, WARN, INFO, DEBUG, TRACE)\n\n";
     std::cout << "Examples:\n";
     std::cout << "  " << progName << " ./ws                      Show workspace status\n";
     std::cout << "  " << progName << " ./ws --json               Status as JSON\n";
     std::cout << "  " << progName << " ./ws -w <job_id>          Wait and print result\n";
+    std::cout << "  " << progName << " ./ws -f <job_id>          Stream tokens as they arrive\n";
+    std::cout << "  wrk ./ws --embed --query \"query\" | " << progName << " ./ws -w -s -k 5   Nearest embeddings\n";
     std::cout << "  wrk ./ws \"Hello\" | " << progName << " ./ws -w   Submit and collect\n";
 }
 
-std::string readFileRaw(const std::filesystem::path& path) {
-    std::ifstream file(path, std::ios::binary);
-    return std::string((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
-}
-
 const char* statusToString(Status status) {
     switch (status) {
         case Status::Queued: return "QUEUED";
@@ -100,7 +98,10 @@ int main(int argc, char* argv[]) {
     std::string jobId = "";
     bool wait = false;
     bool waitIdle = false;
+    bool follow = false;
     bool json = false;
+    bool search = false;
+    std::size_t topK = 10;
     
     // Parse args
     for (int i = 2; i < argc; i++) {
@@ -109,6 +110,19 @@ int main(int argc, char* argv[]) {
             wait = true;
         } else if (arg == "--wait-idle" || arg == "-W") {
             waitIdle = true;
+        } else if (arg == "-f" || arg == "--follow") {
+            follow = true;
+        } else if (arg == "-s" || arg == "--search") {
+            search = true;
+        } else if (arg == "-k" && i + 1 < argc) {
+            try {
+                const long k = std::stol(argv[++i]);
+                if (k <= 0) throw std::invalid_argument("k");
+                topK = static_cast<std::size_t>(k);
+            } catch (...) {
+                std::cerr << "Invalid -k value: " << argv[i] << std::endl;
+                return 1;
+            }
         } else if (arg == "--json") {
             json = true;
         } else {
@@ -132,11 +146,7 @@ int main(int argc, char* argv[]) {
 
         // Wait for workspace idle
         if (waitIdle) {
-            while (true) {
-                auto c = flow.counts();
-                if (c.queued == 0 && c.running == 0) break;
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            }
+            (void)flow.waitIdle();
             if (json) {
                 auto c = flow.counts();
                 std::cout << "{\"queued\":" << c.queued
@@ -151,7 +161,7 @@ int main(int argc, char* argv[]) {
         }
 
         // No job ID and no pipe: show workspace status
-        if (jobId.empty() && !wait) {
+        if (jobId.empty() && !wait && !follow && !search) {
             auto c = flow.counts();
             if (json) {
                 std::cout << "{\"queued\":" << c.queued
@@ -195,13 +205,71 @@ int main(int argc, char* argv[]) {
              }
         }
 
-        // Wait loop
-        if (wait) {
-            while (true) {
-                Status s = flow.status(jobId);
-                if (s == Status::Done || s == Status::Failed || s == Status::Missing) break;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Follow: stream result.partial, then exit like --wait would
+        if (follow && !json) {
+            Status s = flow.follow(jobId, [](const std::string& chunk) {
+                std::cout << chunk << std::flush;
+            });
+            if (s == Status::Done) {
+                std::cout << std::endl;
+                return 0;
+            }
+            if (s == Status::Failed) {
+                std::cerr << "Job failed: " << jobId << std::endl;
+                if (auto err = flow.error(jobId); err && !err->empty()) {
+                    std::cerr << "Error: " << *err << std::endl;
+                }
+                return 1;
+            }
+            std::cerr << "Job not found: " << jobId << std::endl;
+            return 1;
+        }
+
+        // Wait loop (--follow --json degrades to --wait)
+        if (wait || follow) {
+            (void)flow.waitFor(jobId);
+        }
+
+        // Nearest stored embeddings to this job's vector
+        if (search) {
+            const Status s = flow.status(jobId);
+            if (s == Status::Missing) {
+                std::cerr << "Job not found: " << jobId << std::endl;
+                return 1;
+            }
+            if (s != Status::Done) {
+                std::cerr << "Job not ready: " << jobId << " (status: " << statusToString(s) << ")" << std::endl;
+                return s == Status::Failed ? 1 : 2;
+            }
+            if (!flow.embedding(jobId)) {
+                std::cerr << "Not an embedding job: " << jobId << std::endl;
+                return 1;
+            }
+            const auto hits = flow.similar(jobId, topK);
+            if (json) {
+                std::ostringstream out;
+                out << "{\"id\":\"" << escapeJson(jobId) << "\",\"hits\":[";
+                for (std::size_t i = 0; i < hits.size(); ++i) {
+                    if (i > 0) out << ",";
+                    out << "{\"id\":\"" << escapeJson(hits[i].id) << "\",\"row\":" << hits[i].row
+                        << ",\"score\":" << hits[i].score << "}";
+                }
+                out << "]}\n";
+                std::cout << out.str();
+                return 0;
+            }
+            if (hits.empty()) {
+                std::cerr << "No stored embeddings to compare (is NRVNA_VECTOR_STORE set on nrvnad?)" << std::endl;
+                return 0;
+            }
+            for (const auto& hit : hits) {
+                char score[16];
+                std::snprintf(score, sizeof(score), "%.4f", hit.score);
+                std::cout << score << "  " << hit.id;
+                if (hit.row > 0) std::cout << " #" << hit.row;
+                std::cout << "\n";
             }
+            return 0;
         }
 
         if (!jobId.empty()) {
@@ -215,7 +283,6 @@ int main(int argc, char* argv[]) {
 
             if (json) {
                 auto meta = flow.meta(jobId);
-                auto outputDir = std::filesystem::path(workspace) / "output" / jobId;
                 std::ostringstream out;
                 out << "{";
                 out << "\"id\":\"" << escapeJson(jobId) << "\"";
@@ -245,15 +312,20 @@ int main(int argc, char* argv[]) {
                 }
 
                 if (job->status == Status::Done) {
-                    auto resultPath = outputDir / "result.txt";
-                    auto audioPath = outputDir / "audio.wav";
-                    auto embeddingPath = outputDir / "embedding.json";
-                    if (std::filesystem::exists(resultPath)) {
+                    // Same precedence as Flow::get(), which already resolved
+                    // the content for live and archived jobs alike
+                    auto has = [&](const char* name) {
+                        return meta && std::find(meta->artifacts.begin(), meta->artifacts.end(), name) !=
+                                       meta->artifacts.end();
+                    };
+                    if (has("result.txt") || !meta || meta->artifacts.empty()) {
                         out << ",\"result\":\"" << escapeJson(job->content) << "\"";
-                    } else if (std::filesystem::exists(audioPath)) {
-                        out << ",\"audio_path\":\"" << escapeJson(std::filesystem::absolute(audioPath).string()) << "\"";
-                    } else if (std::filesystem::exists(embeddingPath)) {
-                        out << ",\"embedding\":" << readFileRaw(embeddingPath);
+                    } else if (has("audio.wav")) {
+                        out << ",\"audio_path\":\"" << escapeJson(job->content) << "\"";
+                    } else if (has("embedding.json")) {
+                        out << ",\"embedding\":" << job->content;
+                    } else if (has("embedding.f32")) {
+                        out << ",\"embedding_path\":\"" << escapeJson(job->content) << "\"";
                     }
                 } else if (job->status == Status::Failed) {
                     out << ",\"error\":\"" << escapeJson(job->content) << "\"";
@@ -264,12 +336,8 @@ int main(int argc, char* argv[]) {
             }
 
             if (job->status == Status::Done) {
-                // Check for audio output — print path instead of binary content
-                auto audioPath = std::filesystem::path(workspace) / "output" / jobId / "audio.wav";
-                if (std::filesystem::exists(audioPath)) {
-                    std::cout << std::filesystem::absolute(audioPath).string() << std::endl;
-                    return 0;
-                }
+                // Audio and binary-only embeddings come back as a file path,
+                // extracted from the archive when the job was packed
                 std::cout << job->content << std::endl;
                 return 0;
             } else if (job->status == Status::Failed) {
@@ -9,6 +9,7 @@
 #include "nrvna/server.hpp"
 #include <algorithm>
 #include <chrono>
+#include <cerrno>
 #include <csignal>
 #include <cstdlib>
 #include <filesystem>
@@ -20,6 +21,7 @@
 #include <unordered_set>
 #include <unistd.h>
 #include <optional>
+#include <sys/types.h>
 
 using namespace nrvnaai;
 
@@ -33,6 +35,22 @@ void signalHandler(int signal) {
     g_shutdown_requested = 1;
 }
 
+// Pid named by .nrvnad.pid, if it holds one
+std::optional<pid_t> readPidFile(const std::filesystem::path & path) {
+    std::ifstream in(path);
+    long pid = 0;
+    if (!(in >> pid) || pid <= 0) {
+        return std::nullopt;
+    }
+    return static_cast<pid_t>(pid);
+}
+
+// Daemons sharing a workspace on one host share the pid file; EPERM still
+// means the process exists
+bool pidAlive(pid_t pid) {
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+
 std::string toLower(std::string value) {
     std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
         return static_cast<char>(std::tolower(c));
@@ -162,6 +180,37 @@ std::optional<std::filesystem::path> resolveVocoderPath(const std::filesystem::p
     return matches.front();
 }
 
+// A small model of the same family for speculative decoding: a GGUF next to
+// the model whose name has "draft" and the model's family prefix
+// (qwen2.5-7b-instruct.gguf -> qwen2.5-0.5b-draft.gguf)
+std::optional<std::filesystem::path> resolveDraftPath(const std::filesystem::path & modelPath) {
+    std::filesystem::path dir = modelPath.parent_path();
+    if (dir.empty() || !std::filesystem::exists(dir)) {
+        return std::nullopt;
+    }
+
+    std::string stem = toLower(modelPath.stem().string());
+    std::string family = stem.substr(0, stem.find('-'));
+    if (family.empty()) {
+        return std::nullopt;
+    }
+
+    std::vector<std::filesystem::path> matches;
+    for (const auto & entry : std::filesystem::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        if (entry.path().extension() != ".gguf") continue;
+        std::string filename = toLower(entry.path().filename().string());
+        if (filename == toLower(modelPath.filename().string())) continue;
+        if (containsToken(filename, "draft") && containsToken(filename, family)) {
+            matches.push_back(entry.path());
+        }
+    }
+
+    if (matches.empty()) return std::nullopt;
+    std::sort(matches.begin(), matches.end());
+    return matches.front();
+}
+
 void applyDefaultEnv(const char * key,
                      const std::string & value,
                      const std::unordered_set<std::string> & lockedKeys,
@@ -228,12 +277,14 @@ void printHelp() {
     std::cout << "OPTIONS\n\n";
     std::cout << "  --mmproj <path>     Vision projection model\n";
     std::cout << "  --vocoder <path>    TTS vocoder model\n";
+    std::cout << "  --draft <model>     Draft model for speculative text decoding\n";
     std::cout << "  -w, --workers <n>   Worker threads (default: 4)\n";
+    std::cout << "  --batch <n>         Batch up to n text jobs in one context (default: off)\n";
     std::cout << "  -v, --version       Show version\n";
     std::cout << "  -h, --help          Show this help\n\n";
     std::cout << "NOTES\n\n";
     std::cout << "  Models are .gguf files. Set NRVNA_MODELS_DIR or pass a full path.\n";
-    std::cout << "  MMProj and vocoder are auto-detected from the model directory.\n";
+    std::cout << "  MMProj, vocoder and draft are auto-detected from the model directory.\n";
 }
 
 int main(int argc, char * argv[]) {
@@ -255,6 +306,7 @@ int main(int argc, char * argv[]) {
     std::string workspace;
     std::string mmprojPath;
     std::string vocoderPath;
+    std::string draftPath;
     int workers = 4;
 
     std::vector<std::string> positionalArgs;
@@ -275,6 +327,23 @@ int main(int argc, char * argv[]) {
                 std::cerr << "Error: worker count must be between 1 and 64\n";
                 return 1;
             }
+        } else if (arg == "--batch") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --batch requires a value\n";
+                return 1;
+            }
+            int batchSeqs = 0;
+            try {
+                batchSeqs = std::stoi(argv[++i]);
+            } catch (...) {
+                std::cerr << "Error: Invalid batch size\n";
+                return 1;
+            }
+            if (batchSeqs < 1 || batchSeqs > 256) {
+                std::cerr << "Error: batch size must be between 1 and 256\n";
+                return 1;
+            }
+            setenv("NRVNA_BATCH_SEQS", std::to_string(batchSeqs).c_str(), 1);
         } else if (arg == "--mmproj") {
             if (i + 1 >= argc) {
                 std::cerr << "Error: --mmproj requires a path\n";
@@ -287,6 +356,12 @@ int main(int argc, char * argv[]) {
                 return 1;
             }
             vocoderPath = argv[++i];
+        } else if (arg == "--draft") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --draft requires a model\n";
+                return 1;
+            }
+            draftPath = argv[++i];
         } else if (!arg.empty() && arg[0] == '-') {
             std::cerr << "Error: unknown option: " << arg << "\n";
             return 1;
@@ -313,7 +388,7 @@ int main(int argc, char * argv[]) {
 
     if (workspace.empty()) {
         std::cerr << "Error: workspace required\n";
-        std::cerr << "Usage: nrvnad <model> <workspace> [--mmproj <path>] [--vocoder <path>] [-w <n>]\n";
+        std::cerr << "Usage: nrvnad <model> <workspace> [--mmproj <path>] [--vocoder <path>] [--draft <model>] [-w <n>]\n";
         return 1;
     }
 
@@ -346,6 +421,22 @@ int main(int argc, char * argv[]) {
         return 1;
     }
 
+    // An explicit NRVNA_DRAFT_MODEL (even empty) turns off auto-detection
+    if (!draftPath.empty()) {
+        if (auto resolved = resolveModelPath(draftPath)) {
+            draftPath = resolved->string();
+        }
+        if (!std::filesystem::exists(std::filesystem::path(draftPath))) {
+            std::cerr << "Error: Draft model not found: " << draftPath << "\n";
+            return 1;
+        }
+    } else if (const char * env = std::getenv("NRVNA_DRAFT_MODEL")) {
+        draftPath = env;
+    } else if (auto resolved = resolveDraftPath(std::filesystem::path(modelPath))) {
+        draftPath = resolved->string();
+    }
+    setenv("NRVNA_DRAFT_MODEL", draftPath.c_str(), 1);
+
     ModelInfo probeInfo = Runner::probeModelInfo(modelPath);
     if (!probeInfo.valid) {
         std::cerr << "Error: Failed to probe model metadata: " << modelPath << "\n";
@@ -372,6 +463,14 @@ int main(int argc, char * argv[]) {
     std::string modelName = std::filesystem::path(modelPath).filename().string();
     std::cout << "  Loading " << modelName << "\n" << std::flush;
 
+    // A pid file left by a crashed run would announce readiness too early;
+    // one naming a live daemon already serving this workspace stays
+    std::filesystem::path pidPath = std::filesystem::path(workspace) / ".nrvnad.pid";
+    if (auto pid = readPidFile(pidPath); !pid || !pidAlive(*pid)) {
+        std::error_code ec;
+        std::filesystem::remove(pidPath, ec);
+    }
+
     try {
         auto server = std::make_unique<Server>(modelPath, workspace, workers, mmprojPath, vocoderPath);
 
@@ -380,11 +479,20 @@ int main(int argc, char * argv[]) {
             return 1;
         }
 
-        std::filesystem::path pidPath = std::filesystem::path(workspace) / ".nrvnad.pid";
-        {
-            std::ofstream pf(pidPath);
-            if (pf) {
-                pf << getpid();
+        // Published only once start() returns, so its presence means a
+        // daemon takes jobs; written aside and renamed so it is never empty.
+        // A live peer's pid is left in place: either of us serves the workspace.
+        if (auto pid = readPidFile(pidPath); !pid || *pid == getpid() || !pidAlive(*pid)) {
+            auto tmpPath = pidPath;
+            tmpPath += ".tmp";
+            std::ofstream pf(tmpPath, std::ios::trunc);
+            if (pf << getpid() << "\n" && pf.flush()) {
+                pf.close();
+                std::error_code ec;
+                std::filesystem::rename(tmpPath, pidPath, ec);
+                if (ec) {
+                    LOG_WARN("Failed to publish " + pidPath.string() + ": " + ec.message());
+                }
             }
         }
 
@@ -392,6 +500,9 @@ int main(int argc, char * argv[]) {
         std::cout << "  \033[1mRUNNING\033[0m\n\n";
         std::cout << "    Model      " << modelName << "\n";
         std::cout << "    Workers    " << workers << "\n";
+        if (const char* batch = std::getenv("NRVNA_BATCH_SEQS"); batch && std::atoi(batch) > 1) {
+            std::cout << "    Batch      " << batch << " sequences\n";
+        }
         std::cout << "    Workspace  " << workspace << "\n";
         if (!mmprojPath.empty()) {
             std::cout << "    MMProj     " << mmprojPath << "\n";
@@ -399,6 +510,9 @@ int main(int argc, char * argv[]) {
         if (!vocoderPath.empty()) {
             std::cout << "    Vocoder    " << vocoderPath << "\n";
         }
+        if (!draftPath.empty()) {
+            std::cout << "    Draft      " << draftPath << "\n";
+        }
         std::cout << "\n";
         std::cout << "  \033[90m─────────────────────────────────────────────────────────────────\033[0m\n\n";
         std::cout << "  Submit:  ./wrk " << workspace << " \"prompt\"\n";
@@ -413,7 +527,7 @@ int main(int argc, char * argv[]) {
             std::cout << "\nShutdown requested, stopping server..." << std::endl;
         }
         LOG_DEBUG("Shutdown requested, stopping server...");
-        {
+        if (readPidFile(pidPath) == getpid()) {
             std::error_code ec;
             std::filesystem::remove(pidPath, ec);
         }
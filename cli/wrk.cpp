@@ -7,10 +7,14 @@
 #include "nrvna/work.hpp"
 #include "nrvna/flow.hpp"
 #include "nrvna/logger.hpp"
+#include <climits>
+#include <cmath>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
-#include <sstream>
 #include <iterator>
+#include <sstream>
+#include <unordered_map>
 #include <unistd.h>
 
 using namespace nrvnaai;
@@ -23,6 +27,7 @@ void printUsage(const char* progName) {
     std::cout << "       " << progName << " <workspace> <text> --embed\n";
     std::cout << "       " << progName << " <workspace> <text> --tts\n";
     std::cout << "       " << progName << " <workspace> -     (read prompt from stdin)\n";
+    std::cout << "       " << progName << " <workspace> --jsonl < jobs.jsonl\n";
     std::cout << "       " << progName << " --help | --version\n\n";
     std::cout << "Arguments:\n";
     std::cout << "  workspace     Directory for job storage\n";
@@ -31,10 +36,21 @@ void printUsage(const char* progName) {
     std::cout << "Options:\n";
     std::cout << "  --image <path>   Attach image (repeatable)\n";
     std::cout << "  --embed          Submit as embedding job (returns vector)\n";
+    std::cout << "  --lines          With --embed: one vector per input line (single job)\n";
+    std::cout << "  --query          With --embed: a search query, not added to the vector store\n";
     std::cout << "  --tts            Submit as text-to-speech job\n";
     std::cout << "  --mode <type>    Job mode: tts (text-to-speech)\n";
     std::cout << "  --parent <id>    Optional parent job ID\n";
     std::cout << "  --tag <tag>      Optional tag (repeatable)\n";
+    std::cout << "  --priority <n>   Scheduling priority, -10..10 (default: 0)\n";
+    std::cout << "  --model <name>   Run on another GGUF from the daemon's models dir\n";
+    std::cout << "  --think-budget <n>  Reasoning tokens before the model must answer (0 = no cap)\n";
+    std::cout << "  --jsonl          Submit one job per stdin line, prints one ID per job\n";
+    std::cout << "                   {\"prompt\", \"mode\", \"images\", \"parent\", \"tags\",\n";
+    std::cout << "                    \"priority\", \"model\", \"think_budget\", \"lines\",\n";
+    std::cout << "                    \"query\"};\n";
+    std::cout << "                   --parent/--tag/--priority/--model/--think-budget apply\n";
+    std::cout << "                   to lines that do not set them\n";
     std::cout << "  -h, --help       Show this help message\n";
     std::cout << "  -v, --version    Show version\n\n";
     std::cout << "Environment Variables:\n";
@@ -44,8 +60,348 @@ void printUsage(const char* progName) {
     std::cout << "  " << progName << " ./workspace Write a hello world program\n";
     std::cout << "  " << progName << " ./workspace \"Machine learning is...\" --embed\n";
     std::cout << "  echo \"Hello\" | " << progName << " ./workspace -\n";
+    std::cout << "  " << progName << " ./workspace - --embed --lines < chunks.txt\n";
+    std::cout << "  " << progName << " ./workspace --jsonl --tag bulk < prompts.jsonl\n";
+}
+
+namespace {
+
+constexpr std::size_t kJsonlBatch = 512;
+
+bool isValidTag(const std::string& tag) {
+    if (tag.empty() || tag.size() > 64) return false;
+    for (char c : tag) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (!std::isalnum(uc) && c != '-' && c != '_') return false;
+    }
+    return true;
 }
 
+// A JSON number that is a whole value in lo..hi; checked before any cast,
+// since converting NaN, inf or an out-of-range double to int is undefined
+bool isIntegerIn(double v, double lo, double hi) {
+    return std::isfinite(v) && v >= lo && v <= hi && v == std::trunc(v);
+}
+
+// Value of one top-level key in a JSONL job line. Only what a job needs:
+// strings, numbers, booleans, null and arrays of strings.
+struct JsonField {
+    enum class Kind { String, Number, Bool, Null, StringArray } kind = Kind::Null;
+    std::string str;
+    double num = 0.0;
+    bool flag = false;
+    std::vector<std::string> list;
+};
+
+class JsonLineParser {
+public:
+    explicit JsonLineParser(const std::string& text) : s_(text) {}
+
+    bool parse(std::unordered_map<std::string, JsonField>& out, std::string& error) {
+        if (!object(out)) {
+            error = error_.empty() ? "malformed JSON" : error_;
+            return false;
+        }
+        skipSpace();
+        if (pos_ != s_.size()) {
+            error = "trailing characters after object";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    const std::string& s_;
+    std::size_t pos_ = 0;
+    std::string error_;
+
+    void skipSpace() {
+        while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' || s_[pos_] == '\r' || s_[pos_] == '\n')) ++pos_;
+    }
+
+    bool expect(char c) {
+        skipSpace();
+        if (pos_ < s_.size() && s_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    static void appendUtf8(std::string& out, unsigned long cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned long& cp) {
+        if (pos_ + 4 > s_.size()) return false;
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = s_[pos_++];
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= static_cast<unsigned long>(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= static_cast<unsigned long>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= static_cast<unsigned long>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    bool string(std::string& out) {
+        if (!expect('"')) return false;
+        out.clear();
+        while (pos_ < s_.size()) {
+            const char c = s_[pos_++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= s_.size()) break;
+            const char e = s_[pos_++];
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned long cp = 0;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && s_.compare(pos_, 2, "\\u") == 0) {
+                        pos_ += 2;
+                        unsigned long low = 0;
+                        if (!hex4(low) || low < 0xDC00 || low >= 0xE000) return false;
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        error_ = "unterminated string";
+        return false;
+    }
+
+    bool value(JsonField& field) {
+        skipSpace();
+        if (pos_ >= s_.size()) return false;
+        const char c = s_[pos_];
+        if (c == '"') {
+            field.kind = JsonField::Kind::String;
+            return string(field.str);
+        }
+        if (c == '[') {
+            ++pos_;
+            field.kind = JsonField::Kind::StringArray;
+            if (expect(']')) return true;
+            do {
+                std::string item;
+                if (!string(item)) {
+                    error_ = "arrays may only contain strings";
+                    return false;
+                }
+                field.list.push_back(std::move(item));
+            } while (expect(','));
+            return expect(']');
+        }
+        for (const char* word : {"true", "false", "null"}) {
+            const std::size_t len = std::char_traits<char>::length(word);
+            if (s_.compare(pos_, len, word) == 0) {
+                pos_ += len;
+                field.kind = word[0] == 'n' ? JsonField::Kind::Null : JsonField::Kind::Bool;
+                field.flag = word[0] == 't';
+                return true;
+            }
+        }
+        const char* begin = s_.c_str() + pos_;
+        char* end = nullptr;
+        field.num = std::strtod(begin, &end);
+        if (end == begin) return false;
+        pos_ += static_cast<std::size_t>(end - begin);
+        field.kind = JsonField::Kind::Number;
+        return true;
+    }
+
+    bool object(std::unordered_map<std::string, JsonField>& out) {
+        if (!expect('{')) return false;
+        if (expect('}')) return true;
+        do {
+            std::string key;
+            JsonField field;
+            if (!string(key) || !expect(':') || !value(field)) return false;
+            out[key] = std::move(field);
+        } while (expect(','));
+        return expect('}');
+    }
+};
+
+// One JSONL line -> SubmitRequest, with the same rules as the command line
+bool parseJobLine(const std::string& line, const SubmitOptions& defaults, SubmitRequest& request, std::string& error) {
+    std::unordered_map<std::string, JsonField> fields;
+    if (!JsonLineParser(line).parse(fields, error)) return false;
+
+    using Kind = JsonField::Kind;
+    auto field = [&](const char* key, Kind kind) -> const JsonField* {
+        auto it = fields.find(key);
+        if (it == fields.end() || it->second.kind == Kind::Null) return nullptr;
+        if (it->second.kind != kind) {
+            error = std::string("wrong type for \"") + key + "\"";
+            return nullptr;
+        }
+        return &it->second;
+    };
+
+    request = SubmitRequest{};
+    request.opts = defaults;
+
+    if (auto f = field("prompt", Kind::String)) request.prompt = f->str;
+    if (auto f = field("images", Kind::StringArray)) {
+        request.imagePaths.assign(f->list.begin(), f->list.end());
+    }
+    if (auto f = field("parent", Kind::String)) {
+        if (!Flow::isValidJobId(f->str)) {
+            error = "invalid parent job ID";
+            return false;
+        }
+        request.opts.parent = f->str;
+    }
+    if (auto f = field("tags", Kind::StringArray)) {
+        // Like every other field, a line's tags replace the --tag defaults
+        request.opts.tags.clear();
+        for (const auto& tag : f->list) {
+            if (!isValidTag(tag)) {
+                error = "invalid tag '" + tag + "'";
+                return false;
+            }
+            request.opts.tags.push_back(tag);
+        }
+    }
+    if (auto f = field("priority", Kind::Number)) {
+        if (!isIntegerIn(f->num, -10, 10)) {
+            error = "priority must be an integer in -10..10";
+            return false;
+        }
+        request.opts.priority = static_cast<int>(f->num);
+    }
+    if (auto f = field("model", Kind::String)) request.opts.model = f->str;
+    if (auto f = field("think_budget", Kind::Number)) {
+        if (!isIntegerIn(f->num, 0, INT_MAX)) {
+            error = "think_budget must be a non-negative integer";
+            return false;
+        }
+        request.opts.think_budget = static_cast<int>(f->num);
+    }
+    if (auto f = field("lines", Kind::Bool)) request.opts.multi_input = f->flag;
+    if (auto f = field("query", Kind::Bool)) request.opts.query = f->flag;
+
+    std::string mode = "text";
+    if (auto f = field("mode", Kind::String)) mode = f->str;
+    if (!error.empty()) return false;
+
+    if (mode == "text" || mode == "vision") {
+        request.type = request.imagePaths.empty() ? JobType::Text : JobType::Vision;
+    } else if (mode == "embed") {
+        request.type = JobType::Embed;
+    } else if (mode == "tts") {
+        request.type = JobType::Tts;
+    } else {
+        error = "unknown mode '" + mode + "'";
+        return false;
+    }
+
+    if (mode == "vision" && request.imagePaths.empty()) {
+        error = "vision requires \"images\"";
+        return false;
+    }
+    if (request.type == JobType::Tts && !request.imagePaths.empty()) {
+        error = "tts and images are mutually exclusive";
+        return false;
+    }
+    if (request.opts.multi_input && (request.type != JobType::Embed || !request.imagePaths.empty())) {
+        error = "\"lines\" requires embed mode and no images";
+        return false;
+    }
+    if (request.opts.query && request.type != JobType::Embed) {
+        error = "\"query\" requires embed mode";
+        return false;
+    }
+    if (request.prompt.empty() && !(request.type == JobType::Embed && !request.imagePaths.empty())) {
+        error = "empty prompt";
+        return false;
+    }
+    return true;
+}
+
+// Stream stdin in batches so memory stays flat for any input size. IDs go to
+// stdout in input order; rejected lines are reported on stderr and skipped.
+int submitJsonl(const std::string& workspace, const SubmitOptions& defaults) {
+    Work work(workspace, true);
+
+    std::vector<SubmitRequest> batch;
+    std::vector<std::size_t> lineNumbers;
+    batch.reserve(kJsonlBatch);
+    lineNumbers.reserve(kJsonlBatch);
+    std::size_t lineNo = 0;
+    std::size_t failed = 0;
+
+    auto flush = [&] {
+        const auto results = work.submitBatch(batch);
+        std::string ids;
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].ok) {
+                ids += results[i].id;
+                ids += '\n';
+            } else {
+                std::cerr << "Error: line " << lineNumbers[i] << ": " << results[i].message << "\n";
+                ++failed;
+            }
+        }
+        std::cout << ids << std::flush;
+        batch.clear();
+        lineNumbers.clear();
+    };
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        ++lineNo;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        SubmitRequest request;
+        std::string error;
+        if (!parseJobLine(line, defaults, request, error)) {
+            std::cerr << "Error: line " << lineNo << ": " << error << "\n";
+            ++failed;
+            continue;
+        }
+        batch.push_back(std::move(request));
+        lineNumbers.push_back(lineNo);
+        if (batch.size() >= kJsonlBatch) flush();
+    }
+    if (!batch.empty()) flush();
+
+    return failed == 0 ? 0 : 1;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     // Default to WARN for clean piping; NRVNA_LOG_LEVEL overrides
     if (!std::getenv("NRVNA_LOG_LEVEL"))
@@ -75,15 +431,7 @@ int main(int argc, char* argv[]) {
     bool useEmbed = false;
     std::string mode;
     SubmitOptions submitOptions;
-
-    auto isValidTag = [](const std::string& tag) {
-        if (tag.empty() || tag.size() > 64) return false;
-        for (char c : tag) {
-            unsigned char uc = static_cast<unsigned char>(c);
-            if (!std::isalnum(uc) && c != '-' && c != '_') return false;
-        }
-        return true;
-    };
+    bool jsonl = false;
 
     // Check for stdin input
     bool readStdin = false;
@@ -122,8 +470,44 @@ int main(int argc, char* argv[]) {
                 return 1;
             }
             submitOptions.tags.push_back(tag);
+        } else if (arg == "--priority") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --priority requires a number\n";
+                return 1;
+            }
+            char* end = nullptr;
+            const long value = std::strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || value < -10 || value > 10) {
+                std::cerr << "Error: --priority must be an integer in -10..10\n";
+                return 1;
+            }
+            submitOptions.priority = static_cast<int>(value);
+        } else if (arg == "--model") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --model requires a name\n";
+                return 1;
+            }
+            submitOptions.model = argv[++i];
+        } else if (arg == "--think-budget") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --think-budget requires a number\n";
+                return 1;
+            }
+            char* end = nullptr;
+            const long value = std::strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || value < 0 || value > INT_MAX) {
+                std::cerr << "Error: --think-budget must be a non-negative integer\n";
+                return 1;
+            }
+            submitOptions.think_budget = static_cast<int>(value);
+        } else if (arg == "--jsonl") {
+            jsonl = true;
         } else if (arg == "--embed") {
             useEmbed = true;
+        } else if (arg == "--lines") {
+            submitOptions.multi_input = true;
+        } else if (arg == "--query") {
+            submitOptions.query = true;
         } else if (arg == "--tts") {
             mode = "tts";
         } else if (arg == "--mode") {
@@ -138,6 +522,19 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (jsonl) {
+        if (useEmbed || !mode.empty() || !imagePaths.empty() || submitOptions.multi_input || submitOptions.query) {
+            std::cerr << "Error: with --jsonl, set mode/images/lines/query per line\n";
+            return 1;
+        }
+        try {
+            return submitJsonl(workspace, submitOptions);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
     if (readStdin) {
         prompt.assign((std::istreambuf_iterator<char>(std::cin)),
                        std::istreambuf_iterator<char>());
@@ -159,11 +556,14 @@ int main(int argc, char* argv[]) {
                 ++i;
                 continue;
             }
-            if (arg == "--parent" || arg == "--tag" || arg == "--mode") {
+            if (arg == "--parent" || arg == "--tag" || arg == "--mode" || arg == "--priority" ||
+                arg == "--model" || arg == "--think-budget") {
                 ++i;
                 continue;
             }
             if (arg == "--embed") continue;
+            if (arg == "--lines") continue;
+            if (arg == "--query") continue;
             if (arg == "--tts") continue;
             if (!first) promptStream << " ";
             promptStream << argv[i];
@@ -187,6 +587,16 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    if (submitOptions.multi_input && (!useEmbed || !imagePaths.empty())) {
+        std::cerr << "Error: --lines requires --embed and no --image\n";
+        return 1;
+    }
+
+    if (submitOptions.query && !useEmbed) {
+        std::cerr << "Error: --query requires --embed\n";
+        return 1;
+    }
+
     if (mode == "tts" && !imagePaths.empty()) {
         std::cerr << "Error: --tts and --image are mutually exclusive\n";
         return 1;
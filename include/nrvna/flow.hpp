@@ -6,8 +6,11 @@
 
 #pragma once
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <chrono>
 
@@ -16,6 +19,9 @@
 
 namespace nrvnaai {
 
+class Archive;
+class VectorIndex;
+
 struct Job {
     JobId id;
     Status status;
@@ -23,6 +29,37 @@ struct Job {
     std::chrono::system_clock::time_point timestamp;
 };
 
+// Read-only vectors of a finished embed job. Zero-copy mmap of embedding.f32
+// when the job wrote one, otherwise parsed from embedding.json.
+class EmbeddingView {
+public:
+    EmbeddingView() = default;
+    ~EmbeddingView();
+
+    EmbeddingView(const EmbeddingView&) = delete;
+    EmbeddingView& operator=(const EmbeddingView&) = delete;
+    EmbeddingView(EmbeddingView&& other) noexcept;
+    EmbeddingView& operator=(EmbeddingView&& other) noexcept;
+
+    [[nodiscard]] const float* data() const noexcept { return data_; }
+    [[nodiscard]] const float* row(std::size_t i) const noexcept { return data_ + i * dim_; }
+    [[nodiscard]] std::size_t dim() const noexcept { return dim_; }
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+    [[nodiscard]] std::size_t size() const noexcept { return dim_ * count_; }
+    [[nodiscard]] bool mapped() const noexcept { return map_ != nullptr; }
+
+private:
+    friend class Flow;
+    void reset() noexcept;
+
+    const float* data_ = nullptr;
+    std::size_t dim_ = 0;
+    std::size_t count_ = 0;
+    void* map_ = nullptr;
+    std::size_t mapBytes_ = 0;
+    std::vector<float> owned_;
+};
+
 struct WorkspaceCounts {
     std::size_t queued = 0;
     std::size_t running = 0;
@@ -30,6 +67,10 @@ struct WorkspaceCounts {
     std::size_t failed = 0;
 };
 
+using ChunkFn = std::function<void(const std::string& chunk)>;
+
+// Finished jobs are read from output/ and failed/ first, then from the
+// segment archive nrvnad packs old jobs into (NRVNA_ARCHIVE_AGE_S).
 class Flow {
 public:
     explicit Flow(const std::filesystem::path& workspace) noexcept;
@@ -51,11 +92,43 @@ public:
     [[nodiscard]] std::optional<std::string> error(const JobId& id) const;
     [[nodiscard]] std::optional<std::string> prompt(const JobId& id) const;
     [[nodiscard]] std::optional<JobMeta> meta(const JobId& id) const noexcept;
+    [[nodiscard]] std::optional<EmbeddingView> embedding(const JobId& id) const noexcept;
+
+    // Best `k` stored embedding rows by cosine similarity to `query`, from the
+    // vector store nrvnad keeps with NRVNA_VECTOR_STORE. `model` (GGUF file
+    // name, extension optional) picks one model's store; empty searches every
+    // store of the query's dimension.
+    [[nodiscard]] std::vector<SearchHit> search(const std::vector<float>& query, std::size_t k,
+                                                const std::string& model = "") const noexcept;
+    // Rows nearest a finished embed job's first vector, the job's own excluded
+    [[nodiscard]] std::vector<SearchHit> similar(const JobId& id, std::size_t k) const noexcept;
+
+    // Tail a running job's result.partial until it leaves processing/, then
+    // return its final status. A job that finished before anything was
+    // streamed delivers its result as one chunk.
+    [[nodiscard]] Status follow(const JobId& id, const ChunkFn& onChunk,
+                                std::chrono::milliseconds poll = std::chrono::milliseconds(100)) const;
+
+    // Block until the job is done/failed/missing or `timeout` passes (negative:
+    // no limit) and return the status at that point. Woken by a watch on
+    // output/ and failed/; the status is re-checked every second regardless,
+    // since network filesystems do not deliver remote events.
+    [[nodiscard]] Status waitFor(const JobId& id,
+                                 std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) const noexcept;
+    // Block until nothing is queued or running. Returns false on timeout.
+    [[nodiscard]] bool waitIdle(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) const noexcept;
 
 private:
     std::filesystem::path workspace_;
-    
+    mutable std::shared_ptr<const Archive> archive_;  // opened on first use
+    // Vector stores by .vec path, reopened once they have grown
+    mutable std::unordered_map<std::string, std::shared_ptr<const VectorIndex>> vectors_;
+
     [[nodiscard]] std::string readResultContent(const JobId& id) const;
+    [[nodiscard]] const Archive& archive() const;
+    [[nodiscard]] std::optional<Job> archivedJob(const JobId& id) const;
+    [[nodiscard]] std::vector<SearchHit> searchStores(const float* query, std::size_t dim, std::size_t k,
+                                                      const std::string& model, const JobId& exclude) const;
 };
 
 }
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <string>
 
 namespace nrvnaai {
@@ -16,13 +18,26 @@ enum class LogLevel : uint8_t {
     TRACE = 4 
 };
 
+// Lines are formatted on the calling thread and handed to a background
+// writer through a lock-free ring; ERROR lines, a full ring and
+// NRVNA_LOG_SYNC=1 write through on the caller instead. The LOG_* macros
+// test the level (one relaxed atomic load) before building the message.
 class Logger {
 public:
     static void setLevel(LogLevel level) noexcept;
     static void initFromEnv() noexcept;
     [[nodiscard]] static LogLevel level() noexcept;
-    
+    [[nodiscard]] static bool enabled(LogLevel level) noexcept {
+        uint8_t current = level_.load(std::memory_order_relaxed);
+        if (current == kUnset) {
+            current = static_cast<uint8_t>(Logger::level());
+        }
+        return static_cast<uint8_t>(level) <= current;
+    }
+
     static void log(LogLevel level, const std::string& message) noexcept;
+    // Write out everything queued so far (also runs at exit)
+    static void flush() noexcept;
     
     static void error(const std::string& msg) noexcept { log(LogLevel::ERROR, msg); }
     static void warn(const std::string& msg) noexcept { log(LogLevel::WARN, msg); }
@@ -31,6 +46,9 @@ public:
     static void trace(const std::string& msg) noexcept { log(LogLevel::TRACE, msg); }
 
 private:
+    static constexpr uint8_t kUnset = 0xFF;   // NRVNA_LOG_LEVEL not read yet
+    static inline std::atomic<uint8_t> level_{kUnset};
+
     static LogLevel parseEnvLevel() noexcept;
     static const char* levelToString(LogLevel level) noexcept;
 };
@@ -41,9 +59,11 @@ std::string getThreadName(int worker_id);
 
 }
 
-// Convenience macros for common usage
-#define LOG_ERROR(msg) do { ::nrvnaai::Logger::error(msg); } while(0)
-#define LOG_WARN(msg)  do { ::nrvnaai::Logger::warn(msg); } while(0)
-#define LOG_INFO(msg)  do { ::nrvnaai::Logger::info(msg); } while(0)
-#define LOG_DEBUG(msg) do { ::nrvnaai::Logger::debug(msg); } while(0)
-#define LOG_TRACE(msg) do { ::nrvnaai::Logger::trace(msg); } while(0)
+// Convenience macros for common usage; msg is only evaluated when the level is on
+#define NRVNA_LOG_AT(lvl, fn, msg) \
+    do { if (::nrvnaai::Logger::enabled(::nrvnaai::LogLevel::lvl)) ::nrvnaai::Logger::fn(msg); } while(0)
+#define LOG_ERROR(msg) NRVNA_LOG_AT(ERROR, error, msg)
+#define LOG_WARN(msg)  NRVNA_LOG_AT(WARN, warn, msg)
+#define LOG_INFO(msg)  NRVNA_LOG_AT(INFO, info, msg)
+#define LOG_DEBUG(msg) NRVNA_LOG_AT(DEBUG, debug, msg)
+#define LOG_TRACE(msg) NRVNA_LOG_AT(TRACE, trace, msg)
@@ -19,18 +19,51 @@ struct JobMeta {
     std::string mode;           // "text", "embed", "vision", "tts"
     JobId parent;               // empty if none
     std::vector<std::string> tags;
+    bool multi_input = false;   // embed: one vector per prompt line
+    bool query = false;         // embed: search query, not added to the vector store
+    int priority = 0;           // scheduling priority, 0 = default lane
+    std::string model;          // models-dir GGUF name, empty = daemon's model
+    std::vector<std::string> image_hashes;  // FNV-1a of each images/ file, in order
+    int think_budget = -1;      // reasoning tokens per think block, 0 = no cap, -1 = daemon default
 
     // Completion phase (written by Processor)
     std::string completed_at;
     double duration_s = -1.0;   // negative = not yet completed
     std::vector<std::string> artifacts;
     std::string status;         // "done" or "failed"
+    std::optional<bool> context_reused;  // set when a runner reported stats
+    int prefix_cached_tokens = 0;        // 0 = no prefix cache hit
+    int session_restored_tokens = 0;     // 0 = parent session not used
+    int embedding_dim = 0;               // embed jobs: vector length
+    int embedding_count = 0;             // embed jobs: number of vectors
+    std::string embedding_dtype;         // "f32" when embedding.f32 was written
+    std::string embedding_model;         // embed jobs: VectorStore::label of the model that ran
+    bool cache_hit = false;              // artifacts served from the result cache
+
+    // Telemetry (written by Processor); negative or zero = not measured
+    double queue_wait_ms = -1.0;         // submitted_at to claim
+    double setup_ms = -1.0;              // tokenize, context, sampler
+    double prompt_eval_ms = -1.0;        // restore + prefill
+    double decode_ms = -1.0;             // generation after the first token
+    double ttft_ms = -1.0;               // runner start to first token
+    int prompt_tokens = 0;
+    int generated_tokens = 0;
+    double tokens_per_s = -1.0;          // generated_tokens over decode_ms
+    int draft_tokens = 0;                // speculative decoding: proposed by the draft
+    int draft_accepted = 0;              // ...and kept; written with draft_acceptance
+    int think_tokens = 0;                // generated inside reasoning blocks
+    bool think_capped = false;           // a block was closed by the think budget
 };
 
+std::string formatMetaJson(const JobMeta& meta);
+// tmp + rename, so readers never see a partial file
 bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta);
 std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir);
+std::optional<JobMeta> parseMetaJson(const std::string& content);
 
 std::string formatTimestamp();
+// Unix seconds of a formatTimestamp() string
+std::optional<double> parseTimestamp(const std::string& timestamp);
 std::string jobTypeToString(JobType type);
 std::string escapeJson(const std::string& s);
 
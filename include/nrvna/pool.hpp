@@ -4,20 +4,50 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <unordered_set>
 #include <thread>
 #include <vector>
 
 #include "nrvna/types.hpp"
+#include "nrvna/work.hpp"
 
 namespace nrvnaai {
 
-using JobProcessor = std::function<void(const JobId&, int workerId)>;
+// Returns true when the job finished inside the call, so its duration is a
+// service time (false for jobs handed off to the batch scheduler, or lost)
+using JobProcessor = std::function<bool(const JobId&, int workerId)>;
+using JobFilter = std::function<bool(const JobId&)>;
+// Runs first on each worker thread, e.g. to pin it to its CPUs
+using WorkerInit = std::function<void(int workerId)>;
+
+// Scheduling class of a queued job (job type + meta.json "priority" and "model")
+struct JobTraits {
+    JobType type = JobType::Text;
+    int priority = 0;           // higher runs sooner; clamped to +-kMaxPriority
+    std::string model;          // empty = daemon's model
+};
+using JobClassifier = std::function<JobTraits(const JobId&)>;
+// True when a job for this model can start without loading it first
+using ModelWarmth = std::function<bool(const std::string& model)>;
+
+// Per-lane counters for tuning, see Pool::laneStats()
+struct LaneStats {
+    JobType type = JobType::Text;
+    int priority = 0;
+    std::string model;
+    std::size_t queued = 0;
+    std::size_t served = 0;
+    double wait_ms = 0.0;       // EWMA of queue wait at dequeue
+    double service_ms = 0.0;    // EWMA of processing time for this job type
+};
 
 class Pool {
 public:
@@ -29,28 +59,71 @@ public:
     Pool(Pool&&) = delete;
     Pool& operator=(Pool&&) = delete;
 
+    static constexpr int kMaxPriority = 10;
+
+    // Classify jobs into lanes at submit time (call before start). Without a
+    // classifier every job lands in the text lane and the pool is a FIFO.
+    void setClassifier(JobClassifier classifier) { classifier_ = std::move(classifier); }
+    // Prefer lanes whose model is already loaded (call before start; runs under
+    // the queue lock, so it must be cheap). Without it every model is warm.
+    void setModelWarmth(ModelWarmth warmth) { warmth_ = std::move(warmth); }
+    void setWorkerInit(WorkerInit init) { workerInit_ = std::move(init); }
+
     [[nodiscard]] bool start(JobProcessor processor);
     void stop() noexcept;
     [[nodiscard]] bool submit(const JobId& jobId) noexcept;
+    // Remove up to `max` queued jobs accepted by `filter`, lane by lane and
+    // oldest first within a lane, so a worker can process them together with
+    // the job it already holds.
+    [[nodiscard]] std::vector<JobId> take(std::size_t max, const JobFilter& filter) noexcept;
     
     [[nodiscard]] bool isRunning() const noexcept { return running_.load(); }
     [[nodiscard]] std::size_t queueSize() const noexcept;
     [[nodiscard]] int workerCount() const noexcept { return workers_; }
+    [[nodiscard]] std::vector<LaneStats> laneStats() const;
 
 private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Queued {
+        JobId id;
+        Clock::time_point enqueued;
+    };
+    // One FIFO per (type, priority, model); lanes are created on first use
+    // and dropped after sitting empty for kLaneIdle, so their stats survive
+    // normal gaps in load but models that come and go do not pile up
+    struct Lane {
+        JobTraits traits;
+        std::deque<Queued> jobs;
+        std::size_t served = 0;
+        double waitEwmaMs = 0.0;
+        Clock::time_point lastUsed;
+    };
+
     void workerLoop(int workerId);
     bool isJobInQueue(const JobId& jobId) const;
+    Lane& laneFor(const JobTraits& traits);
+    // Highest response ratio next across lane heads; nullptr when empty
+    Lane* pickLaneLocked(Clock::time_point now);
+    // Erase lanes empty since before now - kLaneIdle; invalidates Lane pointers
+    void pruneIdleLanesLocked(Clock::time_point now);
+    void recordServiceLocked(JobType type, double ms);
     
     int workers_;
     JobProcessor processor_;
+    JobClassifier classifier_;
+    ModelWarmth warmth_;
+    WorkerInit workerInit_;
     
     std::atomic<bool> running_{false};
     std::atomic<bool> shutdown_{false};
     
     mutable std::mutex queueMutex_;
     std::condition_variable jobAvailable_;
-    std::queue<JobId> jobQueue_;
+    std::deque<Lane> lanes_;
+    std::size_t queued_ = 0;
     std::unordered_set<JobId> enqueuedJobs_;
+    std::array<double, 4> serviceEwmaMs_;   // indexed by JobType
     
     std::vector<std::thread> workerThreads_;
 };
@@ -4,8 +4,12 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <optional>
+#include <thread>
 #include <vector>
 
 #include "nrvna/types.hpp"
@@ -16,12 +20,31 @@ namespace nrvnaai {
 
 class Runner;
 class TtsRunner;
+class Scheduler;
+class JobIndex;
+class WavWriter;
+class Metrics;
+class ResultCache;
+class MemoryBudget;
+class LeaseTable;
+class VectorStore;
+class Archive;
+struct ThreadPlan;
+struct RunResult;
+struct RunOptions;
+struct EmbedResult;
+
+// Pulls up to `max` more queued jobs matching the filter (Pool::take)
+using JobSource = std::function<std::vector<JobId>(std::size_t max, const std::function<bool(const JobId&)>& filter)>;
+// Puts a pulled job back in the queue (Pool::submit)
+using JobReturn = std::function<void(const JobId&)>;
 
 enum class ProcessResult : uint8_t {
     Success,
     Failed,
     NotFound,
-    SystemError
+    SystemError,
+    Deferred        // handed to the batch scheduler, finalized asynchronously
 };
 
 class Processor {
@@ -29,47 +52,166 @@ public:
     explicit Processor(const std::filesystem::path& workspace,
                        const std::string& modelPath,
                        const std::string& mmprojPath = "",
-                       const std::string& vocoderPath = "");
+                       const std::string& vocoderPath = "",
+                       LeaseTable* leases = nullptr);
+    ~Processor();
     
     Processor(const Processor&) = delete;
     Processor& operator=(const Processor&) = delete;
     Processor(Processor&&) = delete;
     Processor& operator=(Processor&&) = delete;
 
-    // Pre-initialize runners for all worker threads (MUST be called before threads start)
+    // Another daemon serves this workspace too: stop writing the job index,
+    // which assumes a single writer (readers fall back to walking directories)
+    void shareWorkspace() noexcept;
+
+    // Pre-initialize runners for all worker threads (MUST be called before threads start).
+    // Also plans how the CPUs are shared between the workers (logged once).
+    // Unless NRVNA_WARMUP=0, worker 0 runs a warmup decode in the background
+    // while the remaining runners (and their projectors) are built.
     bool initializeRunners(int numWorkers);
+    // Wait for the warmup decode (call before workers start)
+    void finishWarmup() noexcept;
     bool initializeTtsRunners(int numWorkers);
+    // Route plain text jobs through one continuous-batching context (call after initializeRunners)
+    bool enableBatching(int maxSeqs);
+    // Save session.bin for text jobs and resume parent-linked jobs from it
+    void enableSessions(bool enabled) noexcept { sessions_ = enabled; }
+    // Let a worker drain queued text-embed jobs and decode them together;
+    // jobs the memory budget has no room for go back through `requeue`
+    void enableEmbedBatching(int maxSeqs, JobSource source, JobReturn requeue);
+    // Feed every finished job's meta.json into the daemon metrics (not owned)
+    void setMetrics(Metrics* metrics) noexcept { metrics_ = metrics; }
 
     [[nodiscard]] ProcessResult process(const JobId& jobId, int workerId) noexcept;
 
+    // Pin the calling worker thread to its planned CPUs (no-op when unpinned)
+    void bindWorkerThread(int workerId) const noexcept;
+
+    // True when jobs naming this model (meta.json "model") can start without a
+    // load: the daemon's own model, or one already resident in the registry.
+    // Only consults names resolved before, so it never touches the disk.
+    [[nodiscard]] bool modelResident(const std::string& name) const noexcept;
+
 private:
     std::filesystem::path workspace_;
     std::string modelPath_;
     std::string mmprojPath_;
     std::string vocoderPath_;
 
+    // CPU share of each worker, from initializeRunners()
+    std::unique_ptr<ThreadPlan> threadPlan_;
+
     // Per-thread Runner instances for Metal compatibility
     std::unordered_map<int, std::unique_ptr<Runner>> runners_;
     std::mutex runnersMutex_;
 
+    // First decode on worker 0, overlapping the rest of startup
+    std::thread warmupThread_;
+
+    // Optional admission by estimated context memory (NRVNA_MEM_BUDGET_MB)
+    std::unique_ptr<MemoryBudget> memoryBudget_;
+
     // Per-thread TTS Runner instances
     std::unordered_map<int, std::unique_ptr<TtsRunner>> ttsRunners_;
     std::mutex ttsRunnersMutex_;
+
+    // Optional continuous batching for text jobs
+    std::unique_ptr<Scheduler> scheduler_;
+    bool sessions_ = false;
+    bool streaming_ = false;    // NRVNA_STREAM: result.partial while generating
+    bool thinkingFile_ = false; // NRVNA_THINK_FILE: reasoning text to thinking.txt
+    int thinkBudget_ = 0;       // NRVNA_THINK_BUDGET: default for jobs that do not set one
+
+    // Optional multi-job embedding batches
+    int embedSeqs_ = 1;
+    JobSource jobSource_;
+    JobReturn jobReturn_;
+
+    // Finished-job journal under .nrvna/ (read by Flow::counts/list)
+    std::unique_ptr<JobIndex> index_;
+    // Reader of packed segments, for conversation parents that were archived
+    std::unique_ptr<Archive> archive_;
+
+    // Owner leases on claimed jobs (Server's), null when not sharing-aware
+    LeaseTable* leases_ = nullptr;
+
+    Metrics* metrics_ = nullptr;
+
+    // Optional cache of reproducible results (NRVNA_RESULT_CACHE=1); keys of
+    // jobs that missed wait here until completeJob() stores their artifacts
+    std::unique_ptr<ResultCache> resultCache_;
+    std::unordered_map<JobId, std::string> pendingCacheKeys_;
+    std::mutex pendingCacheMutex_;
+
+    // Per-job models: meta.json names resolved against NRVNA_MODELS_DIR and
+    // the default model's directory, remembered once found
+    std::vector<std::filesystem::path> modelDirs_;
+    std::unordered_map<std::string, std::string> modelPaths_;
+    mutable std::mutex modelPathsMutex_;
+
+    // Embedding artifacts (NRVNA_EMBED_FORMAT)
+    bool embedJson_ = true;
+    bool embedF32_ = false;
+
+    // Optional searchable copy of every finished embedding (NRVNA_VECTOR_STORE)
+    std::unique_ptr<VectorStore> vectorStore_;
     
+    struct EmbeddingShape;
+    // Write the completion half of meta.json (+ telemetry) and record metrics
+    void completeJob(const std::filesystem::path& jobPath, double elapsed_s,
+                     const std::vector<std::string>& artifacts, const std::string& status,
+                     const RunStats* stats = nullptr, const EmbeddingShape* shape = nullptr,
+                     bool cacheHit = false) noexcept;
+    // Finish the job from the result cache if `key` is stored; otherwise
+    // remember the key for completeJob()
+    [[nodiscard]] bool serveFromCache(const JobId& jobId, const std::string& key,
+                                      std::chrono::steady_clock::time_point startTime) noexcept;
+
     [[nodiscard]] bool moveReadyToProcessing(const JobId& jobId) noexcept;
+    // The job left processing/: journal it and drop its lease
+    void recordFinished(const JobId& jobId, Status status) noexcept;
     [[nodiscard]] bool finalizeSuccess(const JobId& jobId, const std::string& result) noexcept;
     [[nodiscard]] bool finalizeFailure(const JobId& jobId, const std::string& error) noexcept;
     
     [[nodiscard]] std::string readPrompt(const JobId& jobId) const noexcept;
     [[nodiscard]] std::string readJobType(const JobId& jobId) const noexcept;
     [[nodiscard]] std::vector<std::filesystem::path> readImages(const JobId& jobId) const noexcept;
+    [[nodiscard]] bool verifyImageRefs(const std::vector<std::filesystem::path>& imagePaths,
+                                       const std::vector<std::string>& hashes, std::string& error) const noexcept;
     [[nodiscard]] std::filesystem::path getJobPath(const char* phase, const JobId& jobId) const noexcept;
     [[nodiscard]] bool finalizeEmbedding(const JobId& jobId, const std::vector<float>& embedding) noexcept;
+    [[nodiscard]] bool finalizeEmbeddings(const JobId& jobId, const std::vector<std::vector<float>>& embeddings) noexcept;
+    [[nodiscard]] std::vector<std::string> embeddingArtifacts() const;
+    [[nodiscard]] std::string embedCacheKey(Runner& runner, const std::string& prompt,
+                                            const std::vector<std::string>& imageHashes, bool multi) const;
+    // Append a finished job's vectors to the store of its model (no-op when off)
+    void storeVectors(const JobId& jobId, const std::vector<const std::vector<float>*>& rows) noexcept;
+    [[nodiscard]] bool isBatchableEmbed(const JobId& jobId) const noexcept;
+    ProcessResult processEmbedBatch(const JobId& jobId, const std::string& prompt, Runner& runner, int workerId,
+                                    std::chrono::steady_clock::time_point startTime) noexcept;
+    ProcessResult processMultiEmbed(const JobId& jobId, const std::string& prompt, Runner& runner,
+                                    std::chrono::steady_clock::time_point startTime) noexcept;
+    ProcessResult completeEmbed(const JobId& jobId, const EmbedResult& result,
+                                std::chrono::steady_clock::time_point startTime) noexcept;
     [[nodiscard]] bool finalizeAudio(const JobId& jobId, const std::vector<float>& audio, int sampleRate) noexcept;
+    [[nodiscard]] bool finalizeAudioFile(const JobId& jobId, WavWriter& wav) noexcept;
+    // GGUF path for a job's model name: modelPath_ when empty, "" when unknown
+    [[nodiscard]] std::string resolveJobModel(const std::string& name) noexcept;
+    [[nodiscard]] RunOptions buildRunOptions(const JobId& jobId) const;
+    // A finished job's file from output/, else from the archive
+    [[nodiscard]] std::optional<std::string> readFinishedFile(const JobId& jobId, const char* name) const;
+    ProcessResult completeText(const JobId& jobId, const RunResult& result,
+                               std::chrono::steady_clock::time_point startTime) noexcept;
 
     // Metal-compatible per-thread Runner management
     std::unique_ptr<Runner>& getRunnerForWorker(int workerId);
     std::unique_ptr<TtsRunner>& getTtsRunnerForWorker(int workerId);
+    [[nodiscard]] WorkerThreads threadsForWorker(int workerId) const;
+    // Reserve the job's estimated context memory before it is claimed; false
+    // when nothing was reserved (no budget, TTS, job already gone)
+    bool admitJob(const JobId& jobId, int workerId) noexcept;
+    void releaseJob(int workerId) noexcept;
 };
 
 }
@@ -7,24 +7,32 @@
 #include <atomic>
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "nrvna/types.hpp"
+
 struct llama_model;
 struct llama_context;
 struct llama_context_params;
 struct llama_sampler;
 struct mtmd_context;
 struct mtmd_bitmap;
+struct mtmd_input_chunks;
 struct common_chat_templates;
+struct ggml_threadpool;
 
 namespace nrvnaai {
 
+struct ImageCacheJob;
+struct LoadedModel;
+
 struct ModelInfo {
     bool        valid = false;
-    std::string desc;                 // llama_model_desc() — display only, not for policy
+    std::string desc;                 // "<arch> <size label>" — display only, not for policy
     std::string arch;                 // general.architecture — "llama", "qwen2", "bert", etc.
     int         n_ctx_train = 0;      // training context length
     uint64_t    model_size_bytes = 0; // total parameter bytes
@@ -38,18 +46,39 @@ struct RunResult {
     bool ok = false;
     std::string output;
     std::string error;
+    RunStats stats;
+};
+
+// One earlier exchange of a parent/child job chain
+struct ChatTurn {
+    std::string user;
+    std::string assistant;
+};
+
+// Per-job options for text generation
+struct RunOptions {
+    std::vector<ChatTurn> history;          // earlier turns, oldest first; prompt is the next user turn
+    std::filesystem::path resume_session;   // parent session.bin to restore (empty = none)
+    std::filesystem::path save_session;     // write this job's session here (empty = don't)
+    std::filesystem::path stream_path;      // append generated pieces here (empty = no streaming)
+    std::vector<std::string> image_hashes;  // content hash per image (empty = no embedding cache)
+    std::filesystem::path thinking_path;    // append reasoning text here (empty = dropped)
+    int think_budget = 0;                   // reasoning tokens per block before it is closed (0 = no cap)
 };
 
 struct EmbedResult {
     bool ok = false;
     std::vector<float> embedding;
     std::string error;
+    RunStats stats;
 };
 
 class Runner final {
 public:
     explicit Runner(const std::string& modelPath);
-    explicit Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers = 1);
+    // `threads` is this worker's share of the CPU; default = llama.cpp's defaults
+    explicit Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers = 1,
+                    const WorkerThreads& threads = {});
     ~Runner();
 
     Runner(const Runner&) = delete;
@@ -58,15 +87,55 @@ public:
     Runner& operator=(Runner&&) = delete;
 
     [[nodiscard]] RunResult run(const std::string& prompt);
+    [[nodiscard]] RunResult run(const std::string& prompt, const RunOptions& options);
     [[nodiscard]] RunResult run(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths);
+    [[nodiscard]] RunResult run(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                                const RunOptions& options);
     [[nodiscard]] EmbedResult embed(const std::string& text);
-    [[nodiscard]] EmbedResult embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths);
+    // Packs texts as separate sequences into as few decodes as possible
+    // (up to maxSeqs per decode). One result per text, in order.
+    [[nodiscard]] std::vector<EmbedResult> embedBatch(const std::vector<std::string>& texts, int maxSeqs);
+    [[nodiscard]] EmbedResult embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                                          const std::vector<std::string>& imageHashes = {});
     [[nodiscard]] bool isMultimodal() const noexcept { return mtmd_ctx_ != nullptr; }
 
-    // Probe GGUF metadata without starting a server — loads model briefly, returns info
+    // Switch this worker to another GGUF, loading it through the shared model
+    // registry if it is not resident. Warm contexts are dropped on a switch.
+    // The projector and prefix cache belong to the model given at
+    // construction, so vision and prefix reuse only run on that one.
+    [[nodiscard]] bool useModel(const std::string& modelPath);
+    [[nodiscard]] const std::string& modelPath() const noexcept { return model_path_; }
+
+    // Memory admission (NRVNA_MEM_BUDGET_MB). Estimated bytes of KV cache and
+    // compute buffers this worker's contexts would hold after a job of
+    // `promptTokens` in `mode` ("text", "vision", "embed"), and hold now.
+    [[nodiscard]] std::size_t projectedBytes(const std::string& mode, int promptTokens, bool compactKv) const;
+    [[nodiscard]] std::size_t residentBytes() const noexcept;
+    // NRVNA_KV_QUANT=auto: contexts built from now on use a q8_0 KV cache
+    void setCompactKv(bool compact) noexcept { compact_kv_ = compact; }
+    [[nodiscard]] bool kvQuantAuto() const noexcept { return kv_auto_; }
+    // Free the warm contexts (idle worker giving memory back, model switch)
+    void releaseContexts() noexcept;
+    // One throwaway decode (BOS, EOS) through the generation context, so the
+    // first job does not pay for faulting in the weights. The context stays
+    // warm for that job. Encoder models are skipped.
+    bool warmup() noexcept;
+
+    // SHA-256 of everything that determines a job's output: model file,
+    // mode, formatted prompt (with history), image digests (pass SHA-256 of
+    // the files, see sha256File) and, for generation, the resolved sampling
+    // config. Empty when generation is not reproducible (temp > 0 with a
+    // random seed, NRVNA_SEED=-1).
+    [[nodiscard]] std::string resultKey(const std::string& mode, const std::string& prompt,
+                                        const std::vector<std::string>& imageHashes, const RunOptions& options);
+
+    // Probe GGUF metadata without starting a server — reads the file header, no tensors
     [[nodiscard]] static ModelInfo probeModelInfo(const std::string& modelPath);
 
 private:
+    // Batch scheduler drives the shared model with its own multi-sequence context
+    friend class Scheduler;
+
     struct SamplingConfig {
         int n_predict = 0;
         int max_ctx = 0;
@@ -79,40 +148,104 @@ private:
         uint32_t seed = 0;
     };
 
-    // Shared model (thread-safe), per-worker mtmd context (not thread-safe)
-    static std::shared_ptr<llama_model> shared_model_;
-    static std::string current_model_path_;
-    static std::mutex model_mutex_;
+    // Current model, held from the shared registry (thread-safe); per-worker
+    // mtmd context (not thread-safe). The raw fields below are views of
+    // loaded_, refreshed by adoptModel().
+    std::shared_ptr<const LoadedModel> loaded_;
+    std::shared_ptr<llama_model> shared_model_;
+    std::string model_path_;
+    std::string default_model_path_;
+
+    // Optional draft model for speculative decoding (NRVNA_DRAFT_MODEL);
+    // null when unset or incompatible with the current model
+    std::shared_ptr<llama_model> shared_draft_model_;
 
     // GGUF sampling defaults — resolved once at model load, used as fallbacks in env_*() calls.
     // If GGUF has no value, these hold the hardcoded defaults.
-    static float gguf_temp_;
-    static int   gguf_top_k_;
-    static float gguf_top_p_;
-    static float gguf_min_p_;
-    static float gguf_repeat_penalty_;
-    static int   gguf_repeat_last_n_;
+    float gguf_temp_           = 0.8f;
+    int   gguf_top_k_          = 40;
+    float gguf_top_p_          = 0.9f;
+    float gguf_min_p_          = 0.05f;
+    float gguf_repeat_penalty_ = 1.1f;
+    int   gguf_repeat_last_n_  = 64;
+
+    // Warm per-worker contexts, kept across jobs. Memory is cleared between jobs;
+    // the context is only rebuilt when a job needs more cells than it has.
+    struct WarmContext {
+        llama_context* ctx = nullptr;
+        uint32_t n_ctx = 0;
+        uint32_t n_seq_max = 1;
+        int type_k = -1;            // ggml_type of the KV cache
+        std::size_t bytes = 0;      // estimated KV + compute buffer size
+    };
+    WarmContext gen_ctx_;       // text + vision generation
+    WarmContext embed_ctx_;     // embeddings=true, mean pooling
+    WarmContext draft_ctx_;     // draft model, same size as gen_ctx_
+
+    // KV cache type (NRVNA_KV_QUANT): a fixed ggml_type (-1 = llama.cpp's
+    // f16), or auto = q8_0 only for jobs admitted under memory pressure
+    int kv_type_ = -1;
+    bool kv_auto_ = false;
+    bool compact_kv_ = false;
+    // Under a memory budget, generation contexts are sized to the job
+    // (rounded up to 1024 cells) instead of max_ctx
+    bool fit_contexts_ = false;
+
+    // Thread counts for every context; with pinned CPUs, persistent ggml
+    // threadpools bound to them are attached to each context this worker makes
+    WorkerThreads threads_;
+    ggml_threadpool* threadpool_ = nullptr;         // decode, one thread per core
+    ggml_threadpool* threadpool_batch_ = nullptr;   // prompt batches, every CPU
 
     // Per-instance mtmd context for thread-safe vision processing
     std::shared_ptr<mtmd_context> mtmd_owned_;
     std::string mmproj_path_;
 
     [[nodiscard]] bool initializeModel(const std::string& modelPath) noexcept;
+    void adoptModel(std::shared_ptr<const LoadedModel> loaded);
+    void createThreadpools();
+    void applyKvType(llama_context_params& params) const;
+    [[nodiscard]] int fittedContext(int promptTokens, int max_ctx) const;
     void cleanup() noexcept;
-    std::string formatPrompt(const std::string& content);
+    std::string formatPrompt(const std::string& content, const std::vector<ChatTurn>& history = {});
     std::string formatMultimodalPrompt(const std::string& prompt, size_t imageCount, const char* marker);
     SamplingConfig buildSamplingConfig() const;
-    void buildContextParams(int n_prompt, const SamplingConfig& config, llama_context_params& params) const;
+    void buildContextParams(const SamplingConfig& config, llama_context_params& params) const;
+    void buildEmbedContextParams(int n_tokens, llama_context_params& params, int n_seqs = 1) const;
+    llama_context* acquireContext(WarmContext& slot, const llama_context_params& params, bool& reused);
+    llama_context* acquireContext(WarmContext& slot, llama_model* model, const llama_context_params& params,
+                                  bool& reused);
     llama_sampler* buildSampler(const SamplingConfig& config) const;
-    RunResult runText(const std::string& prompt);
-    RunResult runVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths);
-    std::vector<mtmd_bitmap*> loadImages(const std::vector<std::filesystem::path>& imagePaths) const;
+    RunResult runText(const std::string& prompt, const RunOptions& options);
+    // Draft-and-verify generation after the prompt is in both contexts.
+    // `seq` holds every token in ctx's sequence 0 and grows with each
+    // accepted token; `last` is the sampled token not yet decoded. Returns
+    // tokens emitted.
+    int generateSpeculative(llama_context* ctx, llama_context* draft, llama_sampler* smpl,
+                            std::vector<int32_t>& seq, int32_t last, int n_predict,
+                            const std::function<bool(int32_t)>& emit, RunStats& stats);
+    RunResult runVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                        const RunOptions& options);
+    // Think budget spent: decode `text` (the open block's closing marker)
+    // after ctx's last token so generation moves on to the answer. Positions
+    // continue from *n_past when given (advanced), else from the sequence.
+    [[nodiscard]] bool closeThinking(llama_context* ctx, llama_sampler* smpl, const std::string& text,
+                                     int32_t* n_past, std::vector<int32_t>* history);
+    // Evaluate a tokenized multimodal prompt into ctx's sequence 0 (logits on
+    // the last token); only mtmd_encode_chunk is bounded across workers, and
+    // it is skipped for images whose embeddings are in the cache
+    [[nodiscard]] bool evalChunks(llama_context* ctx, const mtmd_input_chunks* chunks, int n_batch, int32_t& n_past,
+                                  ImageCacheJob& cache);
+    // When every image hits the embedding cache the files are not decoded;
+    // blank bitmaps of the cached size tokenize to the same chunks
+    std::vector<mtmd_bitmap*> loadImages(const std::vector<std::filesystem::path>& imagePaths,
+                                         const std::vector<std::string>& hashes, ImageCacheJob& cache) const;
     void freeBitmaps(std::vector<mtmd_bitmap*>& bitmaps) const noexcept;
 
     mtmd_context* mtmd_ctx_ = nullptr;
 
-    // Shared chat templates (initialized once at model load, like shared_model_)
-    static common_chat_templates* chat_templates_;
+    // Chat templates of the current model, owned by loaded_
+    common_chat_templates* chat_templates_ = nullptr;
 };
 
 }
@@ -4,15 +4,23 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "nrvna/types.hpp"
+
 struct llama_model;
+struct llama_context;
+struct llama_context_params;
 
 namespace nrvnaai {
 
+class Istft;
+
 enum class TtsVersion { V0_2, V0_3 };
 
 struct TtsResult {
@@ -20,11 +28,13 @@ struct TtsResult {
     std::vector<float> audio;
     int sample_rate = 24000;
     std::string error;
+    RunStats stats;
 };
 
 class TtsRunner final {
 public:
-    explicit TtsRunner(const std::string& modelPath, const std::string& vocoderPath);
+    explicit TtsRunner(const std::string& modelPath, const std::string& vocoderPath,
+                       const WorkerThreads& threads = {});
     ~TtsRunner();
 
     TtsRunner(const TtsRunner&) = delete;
@@ -32,9 +42,30 @@ public:
     TtsRunner(TtsRunner&&) = delete;
     TtsRunner& operator=(TtsRunner&&) = delete;
 
-    [[nodiscard]] TtsResult run(const std::string& text);
+    // PCM (24 kHz mono) delivered while later audio is still being generated
+    using AudioSink = std::function<void(const float* samples, std::size_t n)>;
+
+    // With a sink, audio goes to it chunk by chunk and TtsResult::audio stays empty
+    [[nodiscard]] TtsResult run(const std::string& text, const AudioSink& sink = {});
 
 private:
+    struct WarmContext {
+        llama_context* ctx = nullptr;
+        uint32_t n_ctx = 0;
+    };
+    // Per-worker contexts reused across jobs: text-to-codes and vocoder
+    WarmContext ttc_ctx_;
+    WarmContext voc_ctx_;
+    // This worker's CPU share (thread counts for both contexts)
+    WorkerThreads threads_;
+    // FFT tables and frame buffers for the vocoder ISTFT, reused across jobs
+    std::unique_ptr<Istft> istft_;
+
+    const float* encodeCodes(const int32_t* codes, int n_codes, bool& reused);
+
+    static llama_context* acquireContext(WarmContext& slot, const std::shared_ptr<llama_model>& model,
+                                         const llama_context_params& params, bool& reused);
+
     static std::shared_ptr<llama_model> shared_tts_model_;
     static std::shared_ptr<llama_model> shared_vocoder_;
     static std::string current_tts_model_path_;
@@ -4,29 +4,44 @@
  * SPDX-License-Identifier: MIT
  */
 #pragma once
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <vector>
 
 #include "nrvna/types.hpp"
 
 namespace nrvnaai {
 
+class DirWatcher;
+
 class Scanner {
 public:
     explicit Scanner(const std::filesystem::path& workspace) noexcept;
+    ~Scanner();
     
     Scanner(const Scanner&) = delete;
     Scanner& operator=(const Scanner&) = delete;
-    Scanner(Scanner&&) noexcept = default;
-    Scanner& operator=(Scanner&&) noexcept = default;
+    Scanner(Scanner&&) noexcept;
+    Scanner& operator=(Scanner&&) noexcept;
 
     [[nodiscard]] std::vector<JobId> scan() const noexcept;
     [[nodiscard]] bool hasNewJobs() const noexcept;
     [[nodiscard]] std::size_t readyJobCount() const noexcept;
 
+    // Event-driven discovery. watch() subscribes to input/ready/; returns false
+    // when no watcher backend is available (caller falls back to polling scan()).
+    [[nodiscard]] bool watch() noexcept;
+    [[nodiscard]] bool isWatching() const noexcept;
+    // Block up to `timeout` and return jobs that landed in ready/ since the last
+    // call. Only the new directories are validated. `rescan` is set when events
+    // may have been missed and the caller should run a full scan().
+    [[nodiscard]] std::vector<JobId> waitForJobs(std::chrono::milliseconds timeout, bool& rescan) noexcept;
+
 private:
     std::filesystem::path workspace_;
     std::filesystem::path readyPath_;
+    std::unique_ptr<DirWatcher> watcher_;
     
     [[nodiscard]] bool isValidJobDirectory(const std::filesystem::path& dir) const noexcept;
     [[nodiscard]] JobId extractJobId(const std::filesystem::path& dir) const noexcept;
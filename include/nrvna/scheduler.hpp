@@ -0,0 +1,120 @@
+/*
+ * nrvna ai - Asynchronous Inference Primitive
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nrvna/runner.hpp"
+#include "nrvna/types.hpp"
+
+struct llama_batch;
+
+namespace nrvnaai {
+
+class PartialWriter;
+class ThinkFilter;
+
+using Clock = std::chrono::steady_clock;
+using CompletionFn = std::function<void(const JobId&, const RunResult&, Clock::time_point startTime)>;
+
+// Continuous batching for text jobs. One thread owns a single multi-sequence
+// llama_context; each admitted job becomes a seq_id. Every step packs one decode
+// token per generating sequence plus as much pending prefill as fits in n_batch,
+// so prompt evaluation of new jobs overlaps with generation of running ones.
+// Finished sequences are retired on EOG / n_predict and reported via CompletionFn
+// on the scheduler thread.
+class Scheduler final {
+public:
+    // `threads` sizes the batched context (the whole machine by default)
+    Scheduler(const std::string& modelPath, int maxSeqs, const WorkerThreads& threads = {});
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler(Scheduler&&) = delete;
+    Scheduler& operator=(Scheduler&&) = delete;
+
+    [[nodiscard]] bool start(CompletionFn onComplete);
+    // Stops admission and drains in-flight sequences before returning.
+    void stop() noexcept;
+
+    // Blocks while all sequence slots are taken. Returns false if the scheduler
+    // is stopping or the prompt cannot be batched - caller runs the job itself.
+    [[nodiscard]] bool submit(const JobId& jobId, const std::string& prompt, const RunOptions& options,
+                              Clock::time_point startTime) noexcept;
+
+    [[nodiscard]] bool isRunning() const noexcept { return running_.load(); }
+    [[nodiscard]] int maxSeqs() const noexcept { return maxSeqs_; }
+
+private:
+    struct Sequence {
+        JobId id;
+        Clock::time_point start;
+        Clock::time_point admitted;      // got a seq_id (setup ends, prefill starts)
+        Clock::time_point first_token;   // first sample (prefill ends, TTFT)
+        bool sampled_any = false;
+        std::vector<int32_t> tokens;     // prompt tokens
+        std::size_t n_prefilled = 0;
+        int32_t seq_id = -1;
+        int32_t n_past = 0;
+        int n_predict = 0;
+        int generated = 0;
+        int reserved = 0;                // KV cells held in the shared context
+        int32_t next_token = -1;         // sampled, not yet decoded
+        int batch_idx = -1;              // logits row in the current batch
+        int store_at = 0;                // prefix boundary to snapshot (0 = none)
+        int prefix_cached = 0;           // prompt tokens restored from the prefix cache
+        int session_restored = 0;        // prompt tokens restored from the parent session
+        std::filesystem::path resume_session;
+        std::filesystem::path save_session;
+        std::vector<int32_t> sampled;    // generated tokens already decoded, for session.bin
+        std::unique_ptr<PartialWriter> stream;  // result.partial, when streaming
+        std::unique_ptr<ThinkFilter> think;     // splits reasoning off, feeds `stream` the answer
+        llama_sampler* smpl = nullptr;
+        std::size_t output_bytes = 0;
+    };
+
+    void loop();
+    void admit();
+    void restorePrefix(Sequence& seq);     // parent session first, then prefix cache
+    bool step();
+    void retire(Sequence& seq, bool ok, const std::string& error);
+
+    std::unique_ptr<Runner> runner_;
+    int maxSeqs_;
+    int nCtx_ = 0;
+    int nBatch_ = 0;
+    int reserved_ = 0;
+
+    llama_context* ctx_ = nullptr;
+    std::unique_ptr<llama_batch> batch_;
+    CompletionFn onComplete_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stopping_{false};
+
+    std::mutex mutex_;
+    std::condition_variable work_;       // scheduler thread: new pending job / stop
+    std::condition_variable slots_;      // submitters: a sequence slot freed
+    std::deque<std::unique_ptr<Sequence>> pending_;
+    int inflight_ = 0;                   // pending + active
+
+    std::vector<std::unique_ptr<Sequence>> active_;
+    std::vector<int32_t> freeSeqIds_;
+
+    std::thread thread_;
+};
+
+}
@@ -14,6 +14,8 @@ namespace nrvnaai {
 class Scanner;
 class Pool;
 class Processor;
+class Metrics;
+class LeaseTable;
 
 class Server final {
 public:
@@ -38,6 +40,10 @@ private:
     [[nodiscard]] bool createWorkspace() noexcept;
     [[nodiscard]] bool recoverOrphanedJobs() noexcept;
     void scanLoop();
+    // Packs old finished jobs (NRVNA_ARCHIVE_AGE_S); its own thread so a long
+    // pass never holds up scans, lease heartbeats or metrics
+    void archiveLoop(int ageSeconds);
+    void logLaneStats(std::size_t& lastServed) const;
 
     std::string modelPath_;
     std::string mmprojPath_;
@@ -51,8 +57,11 @@ private:
     std::unique_ptr<Scanner> scanner_;
     std::unique_ptr<Pool> pool_;
     std::unique_ptr<Processor> processor_;
+    std::unique_ptr<Metrics> metrics_;      // <workspace>/metrics, null when disabled
+    std::unique_ptr<LeaseTable> leases_;    // this daemon's node and job claims
     
     std::thread scannerThread_;
+    std::thread archiveThread_;
 };
 
 }
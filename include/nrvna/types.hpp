@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace nrvnaai {
 
@@ -10,4 +11,42 @@ enum class Status : std::uint8_t { Queued, Running, Done, Failed, Missing };
 // Opaque job identifier (string-based for now; can evolve to strong type).
 using JobId = std::string;
 
+// Per-job execution stats reported by runners and recorded in meta.json.
+struct RunStats {
+    bool context_reused = false;    // ran on a warm context, no llama_init_from_model
+    int prefix_cached_tokens = 0;   // prompt tokens restored from the prefix cache
+    int session_restored_tokens = 0; // prompt tokens restored from the parent's session.bin
+    bool session_saved = false;     // session.bin written for follow-up jobs
+
+    // Phase timings in milliseconds, negative when the phase did not run
+    double setup_ms = -1.0;         // tokenize, context acquire, sampler
+    double prompt_ms = -1.0;        // restore + prefill up to the first sampled token
+    double decode_ms = -1.0;        // token generation after the first token
+    double ttft_ms = -1.0;          // run start to first sampled token
+    int prompt_tokens = 0;
+    int generated_tokens = 0;
+    int draft_tokens = 0;           // speculative: tokens the draft model proposed
+    int draft_accepted = 0;         // of those, tokens the target sampled too
+    int think_tokens = 0;           // generated inside reasoning blocks
+    bool think_capped = false;      // a block was closed early by the think budget
+};
+
+// One stored embedding row returned by Flow::search, best score first.
+// Scores are dot products of L2-normalized vectors (cosine similarity).
+struct SearchHit {
+    JobId id;
+    std::uint32_t row = 0;          // input line of a multi-input job, 0 otherwise
+    float score = 0.0f;
+};
+
+// One worker's share of the CPU (see planThreads in thread_plan.hpp).
+// Zero counts leave llama.cpp's defaults; empty CPU lists mean not pinned.
+struct WorkerThreads {
+    int n_threads = 0;              // decode: one per physical core is the sweet spot
+    int n_threads_batch = 0;        // prefill, embeddings, image encode: every logical CPU
+    std::vector<int> cpus;          // logical CPUs this worker's threads may run on
+    std::vector<int> decode_cpus;   // first hardware thread of each core in cpus
+    int node = -1;                  // NUMA node of cpus, -1 = unknown or mixed
+};
+
 } // namespace nrvnaai
@@ -19,9 +19,29 @@ enum class JobType : uint8_t {
     Tts = 3
 };
 
+// How submit() places attached images into the job directory
+enum class ImageIngest : uint8_t {
+    Link = 0,   // reflink, else hardlink, else copy (default)
+    Copy,       // always a private copy; survives the source being edited
+    Ref         // symlink to the source; the daemon re-checks its hash and fails the job if it changed
+};
+
 struct SubmitOptions {
     JobId parent;
     std::vector<std::string> tags;
+    bool multi_input = false;   // embed only: each prompt line becomes its own vector
+    bool query = false;         // embed only: a search query, kept out of the vector store
+    int priority = 0;           // scheduling priority, -10..10 (higher runs sooner)
+    std::string model;          // GGUF name in the daemon's models dir (empty = daemon's model)
+    int think_budget = -1;      // reasoning tokens before a think block is closed (0 = no cap, -1 = daemon's)
+};
+
+// One job of a Work::submitBatch() call; fields mirror Work::submit()
+struct SubmitRequest {
+    std::string prompt;
+    JobType type = JobType::Text;
+    std::vector<std::filesystem::path> imagePaths;
+    SubmitOptions opts;
 };
 
 enum class SubmissionError : uint8_t {
@@ -54,23 +74,32 @@ public:
                                       const std::vector<std::filesystem::path>& imagePaths = {},
                                       const SubmitOptions& opts = {});
 
+    // Submit many jobs with one set of directory handles; results are in
+    // request order and a failed entry does not stop the rest
+    [[nodiscard]] std::vector<SubmitResult> submitBatch(const std::vector<SubmitRequest>& requests);
+
     void setMaxSize(std::size_t maxBytes) noexcept { maxBytes_ = maxBytes; }
     [[nodiscard]] std::size_t maxSize() const noexcept { return maxBytes_; }
 
+    // Defaults to NRVNA_IMAGE_INGEST (link | copy | ref), else Link
+    void setImageIngest(ImageIngest mode) noexcept { imageIngest_ = mode; }
+    [[nodiscard]] ImageIngest imageIngest() const noexcept { return imageIngest_; }
+
 private:
+    struct StagingDirs;
+
     std::filesystem::path workspace_;
     std::size_t maxBytes_ = 10'000'000; // 10MB
+    ImageIngest imageIngest_ = ImageIngest::Link;
 
     [[nodiscard]] bool createWorkspace(bool createIfMissing) noexcept;
     [[nodiscard]] static JobId generateId();
     [[nodiscard]] bool isValidPrompt(const std::string& prompt) const noexcept;
+    [[nodiscard]] SubmitResult validate(const SubmitRequest& request) const;
     
-    [[nodiscard]] bool createJobDirectory(const JobId& jobId) const noexcept;
-    [[nodiscard]] bool writePromptFile(const JobId& jobId, const std::string& prompt) const noexcept;
-    [[nodiscard]] bool writeImageFiles(const JobId& jobId, const std::vector<std::filesystem::path>& imagePaths) const noexcept;
-    [[nodiscard]] bool writeTypeFile(const JobId& jobId, JobType type) const noexcept;
-    [[nodiscard]] bool writeMetaFile(const JobId& jobId, JobType type, const SubmitOptions& opts) const noexcept;
-    [[nodiscard]] bool atomicPublish(const JobId& jobId) const noexcept;
+    [[nodiscard]] SubmitResult stageAndPublish(const SubmitRequest& request, const StagingDirs& dirs) const noexcept;
+    [[nodiscard]] bool writeImageFiles(const JobId& jobId, const std::vector<std::filesystem::path>& imagePaths,
+                                       std::vector<std::string>& hashes) const noexcept;
     void cleanupFailedJob(const JobId& jobId) const noexcept;
 };
 
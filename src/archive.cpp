@@ -0,0 +1,388 @@
+/*
+ * nrvna ai - Segment archive of finished jobs (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "archive.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace nrvnaai {
+
+namespace {
+
+constexpr const char* kMagic = "nrvna-archive";
+constexpr int kVersion = 1;
+constexpr std::uint64_t kAlign = 64;
+
+std::string segmentName(std::uint32_t segment, const char* ext) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "seg-%06u%s", segment, ext);
+    return buf;
+}
+
+// "seg-000042.idx" -> 42
+std::optional<std::uint32_t> segmentOf(const std::string& name) {
+    if (name.size() != 14 || name.compare(0, 4, "seg-") != 0 || name.compare(10, 4, ".idx") != 0) {
+        return std::nullopt;
+    }
+    std::uint32_t n = 0;
+    for (std::size_t i = 4; i < 10; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i]))) return std::nullopt;
+        n = n * 10 + static_cast<std::uint32_t>(name[i] - '0');
+    }
+    return n;
+}
+
+bool validJobId(const std::string& id) {
+    return !id.empty() && id.size() <= 128 &&
+           std::all_of(id.begin(), id.end(), [](unsigned char c) { return std::isdigit(c) != 0 || c == '_'; });
+}
+
+std::int64_t fileTimeMs(const std::filesystem::file_time_type& file_time) {
+    const auto delta = file_time - std::filesystem::file_time_type::clock::now();
+    const auto sys = std::chrono::system_clock::now() +
+                     std::chrono::duration_cast<std::chrono::system_clock::duration>(delta);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(sys.time_since_epoch()).count();
+}
+
+bool writeAll(int fd, const char* data, std::size_t n) {
+    while (n > 0) {
+        const ssize_t w = ::write(fd, data, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += w;
+        n -= static_cast<std::size_t>(w);
+    }
+    return true;
+}
+
+// Files worth keeping, relative to the job directory; images/ one level deep
+std::vector<std::string> jobFiles(const std::filesystem::path& dir) {
+    std::vector<std::string> names;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const std::string name = entry.path().filename().string();
+        if (entry.is_symlink()) continue;  // ref images belong to the submitter
+        if (entry.is_regular_file()) {
+            if (name == "session.bin" || name == "result.partial") continue;
+            names.push_back(name);
+        } else if (entry.is_directory() && name == "images") {
+            for (const auto& image : std::filesystem::directory_iterator(entry.path())) {
+                if (!image.is_symlink() && image.is_regular_file()) {
+                    names.push_back("images/" + image.path().filename().string());
+                }
+            }
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+} // namespace
+
+const ArchivedFile* ArchivedJob::file(const std::string& name) const noexcept {
+    for (const auto& f : files) {
+        if (f.name == name) return &f;
+    }
+    return nullptr;
+}
+
+Archive::Archive(const std::filesystem::path& workspace)
+    : workspace_(workspace), dir_(workspace / ".nrvna" / "archive") {
+}
+
+std::filesystem::path Archive::packPath(const ArchivedJob& job) const {
+    return dir_ / segmentName(job.segment, ".pack");
+}
+
+bool Archive::loadIndexLocked(const std::filesystem::path& idx, std::uint32_t segment) const {
+    std::ifstream in(idx, std::ios::binary);
+    std::string magic;
+    int version = 0;
+    if (!in || !(in >> magic >> version) || magic != kMagic || version != kVersion) {
+        LOG_WARN("Ignoring malformed archive index: " + idx.string());
+        return false;
+    }
+    std::string tag;
+    while (in >> tag) {
+        if (tag != "job") {
+            LOG_WARN("Ignoring the rest of archive index: " + idx.string());
+            break;
+        }
+        ArchivedJob job;
+        char status = 0;
+        std::size_t nfiles = 0;
+        if (!(in >> job.id >> status >> job.ts_ms >> nfiles) || !validJobId(job.id)) break;
+        job.status = status == 'F' ? Status::Failed : Status::Done;
+        job.segment = segment;
+        for (std::size_t i = 0; i < nfiles; ++i) {
+            ArchivedFile f;
+            if (!(in >> f.offset >> f.size)) break;
+            in.ignore(1);
+            std::getline(in, f.name);
+            job.files.push_back(std::move(f));
+        }
+        // A job packed twice (crash before its directory was removed): first wins
+        if (jobs_.count(job.id)) continue;
+        (job.status == Status::Done ? done_ : failed_)++;
+        jobs_.emplace(job.id, std::move(job));
+    }
+    segments_.insert(segment);
+    return true;
+}
+
+void Archive::refreshLocked() const {
+    std::error_code ec;
+    std::vector<std::pair<std::uint32_t, std::filesystem::path>> fresh;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        auto segment = segmentOf(entry.path().filename().string());
+        if (segment && !segments_.count(*segment)) fresh.emplace_back(*segment, entry.path());
+    }
+    std::sort(fresh.begin(), fresh.end());
+    for (const auto& [segment, path] : fresh) {
+        (void)loadIndexLocked(path, segment);
+    }
+}
+
+std::optional<ArchivedJob> Archive::find(const JobId& id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        refreshLocked();
+        it = jobs_.find(id);
+        if (it == jobs_.end()) return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<std::string> Archive::read(const ArchivedJob& job, const std::string& name) const {
+    const ArchivedFile* f = job.file(name);
+    if (!f) return std::nullopt;
+    std::ifstream in(packPath(job), std::ios::binary);
+    if (!in.seekg(static_cast<std::streamoff>(f->offset))) return std::nullopt;
+    std::string content(static_cast<std::size_t>(f->size), '\0');
+    if (!in.read(content.data(), static_cast<std::streamsize>(f->size))) {
+        LOG_WARN("Archive segment truncated: " + packPath(job).string());
+        return std::nullopt;
+    }
+    return content;
+}
+
+std::optional<std::filesystem::path> Archive::extract(const ArchivedJob& job, const std::string& name) const {
+    if (!job.file(name) || name.find('/') != std::string::npos) return std::nullopt;
+    const auto dest = dir_ / "extract" / job.id / name;
+    std::error_code ec;
+    if (std::filesystem::exists(dest, ec)) return dest;
+    auto content = read(job, name);
+    if (!content) return std::nullopt;
+
+    std::filesystem::create_directories(dest.parent_path(), ec);
+    auto tempPath = dest;
+    tempPath += ".tmp-" + std::to_string(::getpid());
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(content->data(), static_cast<std::streamsize>(content->size()));
+        if (!out.good()) {
+            std::filesystem::remove(tempPath, ec);
+            return std::nullopt;
+        }
+    }
+    std::filesystem::rename(tempPath, dest, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return std::nullopt;
+    }
+    return dest;
+}
+
+void Archive::totals(std::size_t& done, std::size_t& failed) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refreshLocked();
+    done = done_;
+    failed = failed_;
+}
+
+bool Archive::contains(const JobId& id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.count(id) > 0;
+}
+
+std::vector<ArchivedJob> Archive::recent(std::size_t max) const {
+    std::vector<ArchivedJob> jobs;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refreshLocked();
+        jobs.reserve(jobs_.size());
+        for (const auto& [id, job] : jobs_) {
+            jobs.push_back(ArchivedJob{id, job.status, job.ts_ms, job.segment, {}});
+        }
+    }
+    const auto keep = std::min(max, jobs.size());
+    std::partial_sort(jobs.begin(), jobs.begin() + static_cast<std::ptrdiff_t>(keep), jobs.end(),
+                      [](const ArchivedJob& a, const ArchivedJob& b) { return a.ts_ms > b.ts_ms; });
+    jobs.resize(keep);
+    return jobs;
+}
+
+int Archive::compact(std::chrono::seconds minAge, std::size_t maxJobs) noexcept {
+    int lockFd = -1;
+    int packFd = -1;
+    std::filesystem::path packTemp;
+    try {
+        std::filesystem::create_directories(dir_);
+        lockFd = ::open((dir_ / ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lockFd < 0) {
+            LOG_WARN("Cannot open archive lock: " + (dir_ / ".lock").string());
+            return -1;
+        }
+        if (::flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+            ::close(lockFd);
+            return 0;  // another daemon is compacting this workspace
+        }
+
+        const auto cutoff = std::filesystem::file_time_type::clock::now() - minAge;
+        std::vector<std::pair<std::filesystem::path, Status>> candidates;
+        for (const auto& [phase, status] : {std::pair{"output", Status::Done}, std::pair{"failed", Status::Failed}}) {
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(workspace_ / phase, ec)) {
+                if (candidates.size() >= maxJobs) break;
+                if (!entry.is_directory() || !validJobId(entry.path().filename().string())) continue;
+                std::error_code tc;
+                const auto written = std::filesystem::last_write_time(entry.path(), tc);
+                if (!tc && written < cutoff) candidates.emplace_back(entry.path(), status);
+            }
+        }
+        if (candidates.empty()) {
+            ::flock(lockFd, LOCK_UN);
+            ::close(lockFd);
+            return 0;
+        }
+
+        std::uint32_t segment = 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            refreshLocked();
+            if (!segments_.empty()) segment = *segments_.rbegin() + 1;
+        }
+        packTemp = dir_ / (segmentName(segment, ".pack") + ".tmp");
+        packFd = ::open(packTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (packFd < 0) {
+            throw std::runtime_error("cannot create " + packTemp.string());
+        }
+
+        std::ostringstream index;
+        index << kMagic << " " << kVersion << "\n";
+        std::vector<std::filesystem::path> packed;
+        std::size_t fresh = 0;
+        std::uint64_t offset = 0;
+        std::vector<char> buf(1 << 20);
+        static const char zeros[kAlign] = {};
+
+        for (const auto& [dir, status] : candidates) {
+            const JobId id = dir.filename().string();
+            if (find(id)) {
+                packed.push_back(dir);  // left behind by an interrupted pass
+                continue;
+            }
+            std::ostringstream entry;
+            std::size_t nfiles = 0;
+            bool ok = true;
+            for (const auto& name : jobFiles(dir)) {
+                const int in = ::open((dir / name).c_str(), O_RDONLY | O_CLOEXEC);
+                if (in < 0) {
+                    ok = false;
+                    break;
+                }
+                const std::uint64_t pad = (kAlign - offset % kAlign) % kAlign;
+                ok = writeAll(packFd, zeros, static_cast<std::size_t>(pad));
+                offset += pad;
+                std::uint64_t size = 0;
+                ssize_t n = 0;
+                while (ok && (n = ::read(in, buf.data(), buf.size())) > 0) {
+                    ok = writeAll(packFd, buf.data(), static_cast<std::size_t>(n));
+                    size += static_cast<std::uint64_t>(n);
+                }
+                ::close(in);
+                if (!ok || n < 0) {
+                    ok = false;
+                    break;
+                }
+                entry << offset << " " << size << " " << name << "\n";
+                offset += size;
+                ++nfiles;
+            }
+            if (!ok) {
+                // Its bytes stay in the pack unreferenced; the job stays live
+                LOG_WARN("Failed to archive job " + id + ", keeping its directory");
+                continue;
+            }
+            index << "job " << id << " " << (status == Status::Failed ? 'F' : 'D') << " "
+                  << fileTimeMs(std::filesystem::last_write_time(dir)) << " " << nfiles << "\n"
+                  << entry.str();
+            packed.push_back(dir);
+            ++fresh;
+        }
+
+        const bool synced = ::fsync(packFd) == 0;
+        ::close(packFd);
+        packFd = -1;
+        std::error_code ec;
+        if (fresh == 0) {
+            std::filesystem::remove(packTemp, ec);
+        } else {
+            if (!synced) {
+                throw std::runtime_error("fsync failed for " + packTemp.string());
+            }
+            std::filesystem::rename(packTemp, dir_ / segmentName(segment, ".pack"));
+
+            // Publishing the index makes the segment visible
+            const auto idxPath = dir_ / segmentName(segment, ".idx");
+            auto idxTemp = idxPath;
+            idxTemp += ".tmp";
+            const std::string text = index.str();
+            const int idxFd = ::open(idxTemp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            const bool written = idxFd >= 0 && writeAll(idxFd, text.data(), text.size()) && ::fsync(idxFd) == 0;
+            if (idxFd >= 0) ::close(idxFd);
+            if (!written) {
+                std::filesystem::remove(idxTemp, ec);
+                std::filesystem::remove(dir_ / segmentName(segment, ".pack"), ec);
+                throw std::runtime_error("cannot write " + idxPath.string());
+            }
+            std::filesystem::rename(idxTemp, idxPath);
+        }
+
+        for (const auto& dir : packed) {
+            std::filesystem::remove_all(dir, ec);
+        }
+        ::flock(lockFd, LOCK_UN);
+        ::close(lockFd);
+        if (fresh > 0) {
+            LOG_INFO("Archived " + std::to_string(fresh) + " job(s) into " + segmentName(segment, ".pack") +
+                     " (" + std::to_string(offset >> 10) + " KB)");
+        }
+        return static_cast<int>(packed.size());
+    } catch (const std::exception& e) {
+        LOG_WARN("Archive pass failed: " + std::string(e.what()));
+        if (packFd >= 0) ::close(packFd);
+        std::error_code ec;
+        if (!packTemp.empty()) std::filesystem::remove(packTemp, ec);
+        if (lockFd >= 0) {
+            ::flock(lockFd, LOCK_UN);
+            ::close(lockFd);
+        }
+        return -1;
+    }
+}
+
+} // namespace nrvnaai
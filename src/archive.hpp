@@ -0,0 +1,90 @@
+/*
+ * nrvna ai - Segment archive of finished jobs (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/types.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvnaai {
+
+struct ArchivedFile {
+    std::string name;               // relative to the job directory
+    std::uint64_t offset = 0;       // in the segment's pack file
+    std::uint64_t size = 0;
+};
+
+struct ArchivedJob {
+    JobId id;
+    Status status = Status::Missing;
+    std::int64_t ts_ms = 0;         // unix epoch, last write of the job directory
+    std::uint32_t segment = 0;
+    std::vector<ArchivedFile> files;
+
+    [[nodiscard]] const ArchivedFile* file(const std::string& name) const noexcept;
+};
+
+// Finished jobs packed out of output/ and failed/ into append-only segments
+// under <workspace>/.nrvna/archive/ (nrvnad, NRVNA_ARCHIVE_AGE_S). Each
+// compaction pass writes one segment: seg-<n>.pack holds the files of many
+// jobs back to back, 64-byte aligned so float artifacts map in place, and
+// seg-<n>.idx lists every job with its file offsets. The index is renamed
+// into place last, so a segment without one does not exist for readers, and
+// job directories are removed only after it is published. Segments are
+// never rewritten. session.bin and result.partial are not kept.
+//
+// idx:  nrvna-archive 1 / job <id> <D|F> <ts_ms> <nfiles> / <offset> <size> <name>...
+class Archive {
+public:
+    explicit Archive(const std::filesystem::path& workspace);
+
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    // Reader side. Indexes load on first use; a miss reloads when new
+    // segments have been published since.
+    [[nodiscard]] std::optional<ArchivedJob> find(const JobId& id) const;
+    [[nodiscard]] std::optional<std::string> read(const ArchivedJob& job, const std::string& name) const;
+    [[nodiscard]] std::filesystem::path packPath(const ArchivedJob& job) const;
+    // Copy one artifact out to .nrvna/archive/extract/<id>/ for callers that
+    // need a file path (audio.wav); reused once extracted
+    [[nodiscard]] std::optional<std::filesystem::path> extract(const ArchivedJob& job, const std::string& name) const;
+    void totals(std::size_t& done, std::size_t& failed) const;
+    // Among the indexes already loaded, no reload; for bulk checks after totals()
+    [[nodiscard]] bool contains(const JobId& id) const;
+    // Newest first, files left empty
+    [[nodiscard]] std::vector<ArchivedJob> recent(std::size_t max) const;
+
+    // Writer side: pack up to `maxJobs` finished jobs whose directory was last
+    // written more than `minAge` ago into a new segment. One pass at a time
+    // per workspace (flock); returns how many jobs left the live directories,
+    // -1 on error.
+    int compact(std::chrono::seconds minAge, std::size_t maxJobs) noexcept;
+
+private:
+    void refreshLocked() const;
+    [[nodiscard]] bool loadIndexLocked(const std::filesystem::path& idx, std::uint32_t segment) const;
+
+    std::filesystem::path workspace_;
+    std::filesystem::path dir_;
+
+    mutable std::mutex mutex_;
+    mutable std::set<std::uint32_t> segments_;     // with a loaded index
+    mutable std::unordered_map<JobId, ArchivedJob> jobs_;
+    mutable std::size_t done_ = 0;
+    mutable std::size_t failed_ = 0;
+};
+
+} // namespace nrvnaai
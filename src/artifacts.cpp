@@ -0,0 +1,156 @@
+/*
+ * nrvna ai - Binary job artifacts (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "artifacts.hpp"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace nrvnaai {
+
+namespace {
+
+void appendFloat(std::string& out, float v) {
+    char buf[32];
+    const int n = std::snprintf(buf, sizeof(buf), "%g", static_cast<double>(v));
+    if (n > 0) out.append(buf, static_cast<std::size_t>(n));
+}
+
+bool writeFileAtomic(const std::filesystem::path& path, const char* data, std::size_t size) {
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) return false;
+        file.write(data, static_cast<std::streamsize>(size));
+        file.flush();
+        if (!file.good()) return false;
+    }
+    std::filesystem::rename(tempPath, path);
+    return true;
+}
+
+} // namespace
+
+bool writeEmbeddingF32(const std::filesystem::path& dir, const std::vector<const std::vector<float>*>& rows) {
+    auto tempPath = dir / (std::string(kEmbeddingF32) + ".tmp");
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        if (!file) return false;
+        for (const auto* row : rows) {
+            if (!writeF32(file, row->data(), row->size())) return false;
+        }
+        file.flush();
+        if (!file.good()) return false;
+    }
+    std::filesystem::rename(tempPath, dir / kEmbeddingF32);
+    return true;
+}
+
+bool writeEmbeddingJson(const std::filesystem::path& dir, const std::vector<const std::vector<float>*>& rows,
+                        bool multi) {
+    // Formatted into one buffer: per-value ostream insertion dominated the
+    // cost for 4096-dim vectors
+    std::size_t values = 0;
+    for (const auto* row : rows) values += row->size();
+    std::string out;
+    out.reserve(64 + values * 14);
+
+    const std::size_t dim = rows.empty() ? 0 : rows.front()->size();
+    if (!multi) {
+        out += "{\n  \"dim\": " + std::to_string(dim) + ",\n  \"vector\": [";
+        const std::vector<float> empty;
+        const auto& v = rows.empty() ? empty : *rows.front();
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            if (i > 0) out += ", ";
+            if (i % 10 == 0 && i > 0) out += "\n    ";
+            appendFloat(out, v[i]);
+        }
+        out += "\n  ]\n}\n";
+    } else {
+        out += "{\n  \"dim\": " + std::to_string(dim) + ",\n  \"count\": " + std::to_string(rows.size()) +
+               ",\n  \"vectors\": [";
+        for (std::size_t r = 0; r < rows.size(); ++r) {
+            out += r > 0 ? ",\n    [" : "\n    [";
+            const auto& v = *rows[r];
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                if (i > 0) out += ", ";
+                appendFloat(out, v[i]);
+            }
+            out += "]";
+        }
+        out += "\n  ]\n}\n";
+    }
+    return writeFileAtomic(dir / "embedding.json", out.data(), out.size());
+}
+
+bool parseEmbeddingJson(const std::string& content, std::vector<float>& values, std::size_t& dimOut) {
+    auto dimPos = content.find("\"dim\": ");
+    auto arrPos = content.find("\"vector");
+    if (dimPos == std::string::npos || arrPos == std::string::npos) return false;
+    const long dim = std::strtol(content.c_str() + dimPos + 7, nullptr, 10);
+    if (dim <= 0) return false;
+
+    auto open = content.find('[', arrPos);
+    if (open == std::string::npos) return false;
+
+    const char* p = content.c_str() + open;
+    const char* end = content.c_str() + content.size();
+    while (p < end) {
+        if (*p == '-' || *p == '+' || *p == '.' || std::isdigit(static_cast<unsigned char>(*p))) {
+            char* next = nullptr;
+            float v = std::strtof(p, &next);
+            if (next == p) break;
+            values.push_back(v);
+            p = next;
+        } else {
+            ++p;
+        }
+    }
+    if (values.empty() || values.size() % static_cast<std::size_t>(dim) != 0) {
+        return false;
+    }
+    dimOut = static_cast<std::size_t>(dim);
+    return true;
+}
+
+bool readEmbeddingRows(const std::filesystem::path& dir, std::size_t dim, std::vector<std::vector<float>>& rows) {
+    if (dim == 0) return false;
+    std::vector<float> values;
+    std::error_code ec;
+    const auto f32Path = dir / kEmbeddingF32;
+    const auto size = std::filesystem::file_size(f32Path, ec);
+    if (!ec && size > 0 && size % (dim * sizeof(float)) == 0) {
+        std::ifstream file(f32Path, std::ios::binary);
+        values.resize(static_cast<std::size_t>(size) / sizeof(float));
+        if (!file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(size))) return false;
+        if (!hostIsLittleEndian()) {
+            for (float& v : values) {
+                uint32_t bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                bits = byteSwap32(bits);
+                std::memcpy(&v, &bits, sizeof(bits));
+            }
+        }
+    } else {
+        std::ifstream file(dir / "embedding.json", std::ios::binary);
+        if (!file) return false;
+        const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::size_t parsedDim = 0;
+        if (!parseEmbeddingJson(content, values, parsedDim) || parsedDim != dim) return false;
+    }
+    rows.clear();
+    for (std::size_t at = 0; at < values.size(); at += dim) {
+        rows.emplace_back(values.begin() + static_cast<std::ptrdiff_t>(at),
+                          values.begin() + static_cast<std::ptrdiff_t>(at + dim));
+    }
+    return true;
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,61 @@
+/*
+ * nrvna ai - Binary job artifacts (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+// Raw little-endian float32, row-major count x dim, no header. The shape is
+// recorded in meta.json (embedding_dim / embedding_count / embedding_dtype).
+constexpr const char* kEmbeddingF32 = "embedding.f32";
+
+inline bool hostIsLittleEndian() noexcept {
+    const uint16_t probe = 1;
+    unsigned char first = 0;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+inline uint32_t byteSwap32(uint32_t v) noexcept {
+    return (v >> 24) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | (v << 24);
+}
+
+inline bool writeF32(std::ostream& out, const float* data, std::size_t n) {
+    if (hostIsLittleEndian()) {
+        out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(n * sizeof(float)));
+        return out.good();
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        uint32_t bits;
+        std::memcpy(&bits, data + i, sizeof(bits));
+        bits = byteSwap32(bits);
+        out.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+    }
+    return out.good();
+}
+
+// Embedding artifacts of one job, each written as tmp + rename inside `dir`.
+// embedding.json holds "vector" for a single-input job and "vectors" (one
+// row per input line) for a multi-input job; values print as %g.
+bool writeEmbeddingF32(const std::filesystem::path& dir, const std::vector<const std::vector<float>*>& rows);
+bool writeEmbeddingJson(const std::filesystem::path& dir, const std::vector<const std::vector<float>*>& rows,
+                        bool multi);
+
+// embedding.json content ("vector" or "vectors") into row-major values
+bool parseEmbeddingJson(const std::string& content, std::vector<float>& values, std::size_t& dimOut);
+// Every row of a finished job in `dir`, from embedding.f32 when it is there,
+// else embedding.json; false if neither holds whole `dim`-wide rows
+bool readEmbeddingRows(const std::filesystem::path& dir, std::size_t dim, std::vector<std::vector<float>>& rows);
+
+} // namespace nrvnaai
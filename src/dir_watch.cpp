@@ -0,0 +1,183 @@
+/*
+ * nrvna ai - Directory change watcher (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "dir_watch.hpp"
+#include "nrvna/logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/event.h>
+#include <unistd.h>
+#endif
+
+namespace nrvnaai {
+
+DirWatcher::~DirWatcher() {
+#if defined(__APPLE__)
+    for (const auto& w : dirs_) {
+        close(w.wd);
+    }
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+#endif
+}
+
+#if defined(__linux__)
+
+bool DirWatcher::watch(const std::filesystem::path& dir) noexcept {
+    if (fd_ < 0) {
+        fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd_ < 0) {
+            LOG_WARN("inotify unavailable: " + std::string(std::strerror(errno)));
+            return false;
+        }
+    }
+
+    const uint32_t mask = IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    int wd = inotify_add_watch(fd_, dir.c_str(), mask);
+    if (wd < 0) {
+        LOG_WARN("Cannot watch " + dir.string() + ": " + std::string(std::strerror(errno)));
+        return false;
+    }
+
+    try {
+        dirs_.push_back({wd, dir});
+    } catch (...) {
+        inotify_rm_watch(fd_, wd);
+        return false;
+    }
+    return true;
+}
+
+bool DirWatcher::wait(std::chrono::milliseconds timeout,
+                      std::vector<std::filesystem::path>& paths,
+                      bool& overflow) noexcept {
+    if (!isActive()) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+
+    pollfd pfd{fd_, POLLIN, 0};
+    int rc = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    if (rc <= 0) {
+        return false;
+    }
+
+    bool any = false;
+    alignas(inotify_event) char buf[16 * 1024];
+    try {
+        for (;;) {
+            ssize_t len = read(fd_, buf, sizeof(buf));
+            if (len <= 0) {
+                break;  // EAGAIN: queue drained
+            }
+
+            for (char* p = buf; p < buf + len;) {
+                const auto* ev = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + ev->len;
+                any = true;
+
+                if (ev->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    overflow = true;
+                    continue;
+                }
+                if (ev->len == 0) {
+                    continue;
+                }
+                for (const auto& w : dirs_) {
+                    if (w.wd == ev->wd) {
+                        paths.push_back(w.dir / ev->name);
+                        break;
+                    }
+                }
+            }
+        }
+    } catch (...) {
+        overflow = true;
+    }
+    return any;
+}
+
+#elif defined(__APPLE__)
+
+bool DirWatcher::watch(const std::filesystem::path& dir) noexcept {
+    if (fd_ < 0) {
+        fd_ = kqueue();
+        if (fd_ < 0) {
+            LOG_WARN("kqueue unavailable: " + std::string(std::strerror(errno)));
+            return false;
+        }
+    }
+
+    int dfd = open(dir.c_str(), O_EVTONLY);
+    if (dfd < 0) {
+        LOG_WARN("Cannot watch " + dir.string() + ": " + std::string(std::strerror(errno)));
+        return false;
+    }
+
+    struct kevent kev;
+    EV_SET(&kev, dfd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_DELETE | NOTE_RENAME, 0, nullptr);
+    if (kevent(fd_, &kev, 1, nullptr, 0, nullptr) < 0) {
+        close(dfd);
+        return false;
+    }
+
+    try {
+        dirs_.push_back({dfd, dir});
+    } catch (...) {
+        close(dfd);
+        return false;
+    }
+    return true;
+}
+
+bool DirWatcher::wait(std::chrono::milliseconds timeout,
+                      std::vector<std::filesystem::path>& /*paths*/,
+                      bool& overflow) noexcept {
+    if (!isActive()) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+    }
+
+    struct kevent events[8];
+    timespec ts{static_cast<time_t>(timeout.count() / 1000),
+                static_cast<long>((timeout.count() % 1000) * 1000000)};
+    int n = kevent(fd_, nullptr, 0, events, 8, &ts);
+    if (n <= 0) {
+        return false;
+    }
+
+    // kqueue reports the directory, not the entry: caller rescans.
+    overflow = true;
+    return true;
+}
+
+#else
+
+bool DirWatcher::watch(const std::filesystem::path& /*dir*/) noexcept {
+    return false;
+}
+
+bool DirWatcher::wait(std::chrono::milliseconds timeout,
+                      std::vector<std::filesystem::path>& /*paths*/,
+                      bool& /*overflow*/) noexcept {
+    std::this_thread::sleep_for(timeout);
+    return false;
+}
+
+#endif
+
+} // namespace nrvnaai
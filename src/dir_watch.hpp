@@ -0,0 +1,54 @@
+/*
+ * nrvna ai - Directory change watcher (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+namespace nrvnaai {
+
+// Reports entries that appear in a set of directories (created or renamed in).
+// Backend: inotify on Linux, kqueue on macOS. Elsewhere watch() fails and the
+// caller is expected to poll.
+//
+// Events are a latency hint, never the source of truth: callers must still
+// rescan periodically, and must rescan immediately when wait() reports overflow
+// (queue overflowed, a watched directory vanished, or the backend cannot name
+// the entries that changed - kqueue only says "this directory was written").
+class DirWatcher {
+public:
+    DirWatcher() noexcept = default;
+    ~DirWatcher();
+
+    DirWatcher(const DirWatcher&) = delete;
+    DirWatcher& operator=(const DirWatcher&) = delete;
+    DirWatcher(DirWatcher&&) = delete;
+    DirWatcher& operator=(DirWatcher&&) = delete;
+
+    // Add a directory to the watch set. Returns false if no backend is available.
+    [[nodiscard]] bool watch(const std::filesystem::path& dir) noexcept;
+    [[nodiscard]] bool isActive() const noexcept { return fd_ >= 0 && !dirs_.empty(); }
+
+    // Block up to `timeout` for changes. Appends full paths of new entries to
+    // `paths`; sets `overflow` when the caller must rescan to see everything.
+    // Returns true if anything happened.
+    bool wait(std::chrono::milliseconds timeout,
+              std::vector<std::filesystem::path>& paths,
+              bool& overflow) noexcept;
+
+private:
+    struct Watch {
+        int wd;
+        std::filesystem::path dir;
+    };
+
+    int fd_ = -1;
+    std::vector<Watch> dirs_;
+};
+
+} // namespace nrvnaai
@@ -6,9 +6,21 @@
 
 #include "nrvna/flow.hpp"
 #include "nrvna/logger.hpp"
+#include "archive.hpp"
+#include "artifacts.hpp"
+#include "dir_watch.hpp"
+#include "job_index.hpp"
+#include "vector_store.hpp"
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include <thread>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace nrvnaai {
 
@@ -25,8 +37,52 @@ Flow::Flow(const std::filesystem::path& workspace) noexcept
     : workspace_(workspace) {
 }
 
+const Archive& Flow::archive() const {
+    if (!archive_) {
+        archive_ = std::make_shared<const Archive>(workspace_);
+    }
+    return *archive_;
+}
+
+// A finished job that only lives in the archive. Audio and binary-only
+// embeddings are extracted so the content can stay a file path.
+std::optional<Job> Flow::archivedJob(const JobId& id) const {
+    auto job = archive().find(id);
+    if (!job) return std::nullopt;
+
+    std::string content;
+    bool text = true;
+    if (job->status == Status::Failed) {
+        content = archive().read(*job, "error.txt").value_or("");
+    } else if (auto result = archive().read(*job, "result.txt")) {
+        content = std::move(*result);
+    } else if (job->file("audio.wav") || (!job->file("embedding.json") && job->file(kEmbeddingF32))) {
+        auto path = archive().extract(*job, job->file("audio.wav") ? "audio.wav" : kEmbeddingF32);
+        if (!path) return std::nullopt;
+        content = std::filesystem::absolute(*path).string();
+        text = false;
+    } else if (auto embedding = archive().read(*job, "embedding.json")) {
+        content = std::move(*embedding);
+    } else {
+        LOG_DEBUG("No result file found for archived job: " + id);
+        return std::nullopt;
+    }
+    // Live readers end every line with a newline; match them
+    if (text && !content.empty() && content.back() != '\n') content += "\n";
+
+    const auto ts = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(job->ts_ms)));
+    return Job{id, job->status, std::move(content), ts};
+}
+
 std::optional<Job> Flow::latest() const noexcept {
     try {
+        if (JobIndex::load(workspace_)) {
+            auto jobs = list(1);
+            if (jobs.empty()) return std::nullopt;
+            return jobs.front();
+        }
+
         std::optional<Job> newest;
         const std::pair<std::filesystem::path, Status> dirs[] = {
             {workspace_ / "output", Status::Done},
@@ -77,6 +133,11 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
         if (!isValidJobId(id)) return std::nullopt;
         Status jobStatus = status(id);
 
+        if ((jobStatus == Status::Done || jobStatus == Status::Failed) &&
+            !std::filesystem::exists(workspace_ / (jobStatus == Status::Done ? "output" : "failed") / id)) {
+            return archivedJob(id);
+        }
+
         if (jobStatus == Status::Done) {
             auto outputDir = workspace_ / "output" / id;
             auto resultFile = outputDir / "result.txt";
@@ -95,6 +156,9 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
                 while (std::getline(file, line)) {
                     content += line + "\n";
                 }
+            } else if (auto f32File = outputDir / kEmbeddingF32; std::filesystem::exists(f32File)) {
+                // Binary-only embedding — return absolute path, read it via embedding()
+                content = std::filesystem::absolute(f32File).string();
             } else {
                 LOG_DEBUG("No result file found for job: " + id);
                 return std::nullopt;
@@ -136,6 +200,9 @@ std::optional<Job> Flow::get(const JobId& id) const noexcept {
 std::vector<Job> Flow::list(std::size_t max) const noexcept {
     std::vector<Job> jobs;
     try {
+        // Finished jobs come from the index when nrvnad keeps one; only the
+        // small queued/running directories are walked.
+        auto index = JobIndex::load(workspace_);
         const std::pair<std::filesystem::path, Status> dirs[] = {
             {workspace_ / "output",          Status::Done},
             {workspace_ / "failed",          Status::Failed},
@@ -144,6 +211,7 @@ std::vector<Job> Flow::list(std::size_t max) const noexcept {
         };
 
         for (const auto& [dir, status] : dirs) {
+            if (index && (status == Status::Done || status == Status::Failed)) continue;
             if (!std::filesystem::exists(dir)) continue;
             for (const auto& entry : std::filesystem::directory_iterator(dir)) {
                 if (entry.is_directory()) {
@@ -154,6 +222,44 @@ std::vector<Job> Flow::list(std::size_t max) const noexcept {
             }
         }
 
+        if (index) {
+            // Recent entries are newest first; stop once enough still exist
+            std::unordered_set<JobId> seen;
+            std::size_t taken = 0;
+            for (const auto& e : index->recent) {
+                if (taken >= max) break;
+                if (!seen.insert(e.id).second) continue;
+                const char* phase = e.status == Status::Done ? "output" : "failed";
+                if (!std::filesystem::exists(workspace_ / phase / e.id) && !archive().find(e.id)) continue;
+                const auto ts = std::chrono::system_clock::time_point(
+                    std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        std::chrono::milliseconds(e.ts_ms)));
+                jobs.push_back({e.id, e.status, "", ts});
+                ++taken;
+            }
+            // A job can be caught mid-rename in both places; the index wins
+            jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&](const Job& job) {
+                return (job.status == Status::Queued || job.status == Status::Running) && seen.count(job.id) > 0;
+            }), jobs.end());
+        }
+
+        if (!index) {
+            // Archived jobs are older than anything still live; walk the
+            // archive only when the directories ran short
+            std::size_t live = 0;
+            for (const auto& job : jobs) {
+                if (job.status == Status::Done || job.status == Status::Failed) ++live;
+            }
+            if (live < max) {
+                for (auto& e : archive().recent(max - live)) {
+                    const auto ts = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                            std::chrono::milliseconds(e.ts_ms)));
+                    jobs.push_back({std::move(e.id), e.status, "", ts});
+                }
+            }
+        }
+
         std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
             return a.timestamp > b.timestamp;
         });
@@ -184,6 +290,9 @@ Status Flow::status(const JobId& id) const noexcept {
         if (std::filesystem::exists(workspace_ / "input" / "ready" / id)) {
             return Status::Queued;
         }
+        if (auto job = archive().find(id)) {
+            return job->status;
+        }
 
         return Status::Missing;
 
@@ -201,6 +310,9 @@ std::optional<std::string> Flow::error(const JobId& id) const {
         if (!isValidJobId(id)) return std::nullopt;
         auto errorFile = workspace_ / "failed" / id / "error.txt";
         if (!std::filesystem::exists(errorFile)) {
+            if (auto job = archive().find(id); job && job->status == Status::Failed) {
+                return archive().read(*job, "error.txt");
+            }
             return std::nullopt;
         }
 
@@ -240,6 +352,11 @@ std::optional<std::string> Flow::prompt(const JobId& id) const {
             }
         }
 
+        if (auto job = archive().find(id)) {
+            auto content = archive().read(*job, "prompt.txt");
+            if (content && !content->empty() && content->back() != '\n') *content += "\n";
+            return content;
+        }
         return std::nullopt;
 
     } catch (const std::exception& e) {
@@ -267,6 +384,11 @@ std::optional<JobMeta> Flow::meta(const JobId& id) const noexcept {
                 }
             }
         }
+        if (auto job = archive().find(id)) {
+            if (auto content = archive().read(*job, "meta.json")) {
+                return parseMetaJson(*content);
+            }
+        }
         return std::nullopt;
     } catch (...) {
         return std::nullopt;
@@ -284,15 +406,366 @@ static std::size_t countSubdirs(const std::filesystem::path& dir) noexcept {
     return n;
 }
 
+EmbeddingView::~EmbeddingView() {
+    reset();
+}
+
+EmbeddingView::EmbeddingView(EmbeddingView&& other) noexcept
+    : data_(other.data_), dim_(other.dim_), count_(other.count_),
+      map_(other.map_), mapBytes_(other.mapBytes_), owned_(std::move(other.owned_)) {
+    other.data_ = nullptr;
+    other.map_ = nullptr;
+    other.mapBytes_ = 0;
+    other.dim_ = other.count_ = 0;
+}
+
+EmbeddingView& EmbeddingView::operator=(EmbeddingView&& other) noexcept {
+    if (this != &other) {
+        reset();
+        data_ = other.data_;
+        dim_ = other.dim_;
+        count_ = other.count_;
+        map_ = other.map_;
+        mapBytes_ = other.mapBytes_;
+        owned_ = std::move(other.owned_);
+        other.data_ = nullptr;
+        other.map_ = nullptr;
+        other.mapBytes_ = 0;
+        other.dim_ = other.count_ = 0;
+    }
+    return *this;
+}
+
+void EmbeddingView::reset() noexcept {
+    if (map_) {
+        munmap(map_, mapBytes_);
+        map_ = nullptr;
+        mapBytes_ = 0;
+    }
+    owned_.clear();
+    data_ = nullptr;
+    dim_ = count_ = 0;
+}
+
+// `bytes` of float32 at `offset` of `path` (0 for a live embedding.f32, the
+// packed offset for an archived one), mapped in place on little-endian hosts
+static bool mapEmbeddingF32(const std::filesystem::path& path, std::uint64_t offset, std::size_t bytes,
+                            void*& map, std::size_t& mapBytes, std::vector<float>& owned, const float*& data) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_DEBUG("Cannot open embedding artifact: " + path.string());
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || static_cast<std::uint64_t>(st.st_size) < offset + bytes) {
+        LOG_WARN("Embedding artifact shorter than meta.json says: " + path.string());
+        ::close(fd);
+        return false;
+    }
+
+    if (hostIsLittleEndian()) {
+        // mmap offsets must be page aligned; archived rows start mid-page
+        const auto page = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+        const std::uint64_t base = offset - offset % page;
+        const std::size_t delta = static_cast<std::size_t>(offset - base);
+        void* m = mmap(nullptr, bytes + delta, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(base));
+        ::close(fd);
+        if (m == MAP_FAILED) {
+            return false;
+        }
+        map = m;
+        mapBytes = bytes + delta;
+        data = reinterpret_cast<const float*>(static_cast<const char*>(m) + delta);
+    } else {
+        // Big-endian host: copy and swap, no zero-copy
+        owned.resize(bytes / sizeof(float));
+        ssize_t n = ::pread(fd, owned.data(), bytes, static_cast<off_t>(offset));
+        ::close(fd);
+        if (n != static_cast<ssize_t>(bytes)) {
+            return false;
+        }
+        for (float& v : owned) {
+            uint32_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            bits = byteSwap32(bits);
+            std::memcpy(&v, &bits, sizeof(bits));
+        }
+        data = owned.data();
+    }
+    return true;
+}
+
+std::optional<EmbeddingView> Flow::embedding(const JobId& id) const noexcept {
+    try {
+        if (!isValidJobId(id)) return std::nullopt;
+        auto outputDir = workspace_ / "output" / id;
+        auto jobMeta = meta(id);
+
+        // Live directory first, then the archive
+        std::optional<ArchivedJob> archived;
+        if (!std::filesystem::exists(outputDir)) {
+            archived = archive().find(id);
+            if (!archived || archived->status != Status::Done) return std::nullopt;
+        }
+
+        if (jobMeta && jobMeta->embedding_dim > 0) {
+            const std::size_t dim = static_cast<std::size_t>(jobMeta->embedding_dim);
+            const std::size_t count = static_cast<std::size_t>(std::max(1, jobMeta->embedding_count));
+            const std::size_t bytes = dim * count * sizeof(float);
+
+            std::filesystem::path path;
+            std::uint64_t offset = 0;
+            std::uint64_t size = 0;
+            if (!archived) {
+                path = outputDir / kEmbeddingF32;
+                std::error_code ec;
+                size = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+                if (ec) size = 0;
+            } else if (const ArchivedFile* f = archived->file(kEmbeddingF32)) {
+                path = archive().packPath(*archived);
+                offset = f->offset;
+                size = f->size;
+            }
+            if (!path.empty() && size > 0) {
+                if (size != bytes) {
+                    LOG_WARN("Embedding artifact size does not match meta.json: " + id);
+                    return std::nullopt;
+                }
+                EmbeddingView view;
+                view.dim_ = dim;
+                view.count_ = count;
+                if (!mapEmbeddingF32(path, offset, bytes, view.map_, view.mapBytes_, view.owned_, view.data_)) {
+                    return std::nullopt;
+                }
+                return view;
+            }
+        }
+
+        std::string content;
+        if (archived) {
+            auto json = archive().read(*archived, "embedding.json");
+            if (!json) return std::nullopt;
+            content = std::move(*json);
+        } else {
+            std::ifstream file(outputDir / "embedding.json", std::ios::binary);
+            if (!file) return std::nullopt;
+            content.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        }
+
+        EmbeddingView view;
+        std::size_t dim = 0;
+        if (!parseEmbeddingJson(content, view.owned_, dim)) {
+            return std::nullopt;
+        }
+        view.dim_ = dim;
+        view.count_ = view.owned_.size() / view.dim_;
+        view.data_ = view.owned_.data();
+        return view;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error reading embedding for job " + id + ": " + e.what());
+        return std::nullopt;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+std::vector<SearchHit> Flow::searchStores(const float* query, std::size_t dim, std::size_t k,
+                                          const std::string& model, const JobId& exclude) const {
+    const std::string wanted = model.empty() ? std::string() : VectorStore::label(model);
+    std::vector<SearchHit> hits;
+    for (const auto& path : VectorIndex::list(workspace_)) {
+        const std::string stem = path.stem().string();
+        const std::string suffix = "-" + std::to_string(dim);
+        if (stem.size() <= suffix.size() || stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        if (!wanted.empty() && stem.compare(0, stem.size() - suffix.size(), wanted) != 0) continue;
+
+        auto& index = vectors_[path.string()];
+        if (!index || index->stale()) {
+            index = VectorIndex::open(path);
+        }
+        if (!index) continue;
+        auto found = index->search(query, k, exclude);
+        hits.insert(hits.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    }
+    std::stable_sort(hits.begin(), hits.end(), [](const SearchHit& a, const SearchHit& b) { return a.score > b.score; });
+    if (hits.size() > k) hits.resize(k);
+    return hits;
+}
+
+std::vector<SearchHit> Flow::search(const std::vector<float>& query, std::size_t k,
+                                    const std::string& model) const noexcept {
+    try {
+        if (query.empty() || k == 0) return {};
+        return searchStores(query.data(), query.size(), k, model, JobId());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Vector search failed: " + std::string(e.what()));
+        return {};
+    } catch (...) {
+        return {};
+    }
+}
+
+std::vector<SearchHit> Flow::similar(const JobId& id, std::size_t k) const noexcept {
+    try {
+        auto view = embedding(id);
+        if (!view || view->count() == 0 || k == 0) return {};
+        // Only the store of the model that made the vector; jobs finished
+        // before embedding_model was recorded fall back to the name they asked for
+        auto jobMeta = meta(id);
+        std::string model;
+        if (jobMeta) model = jobMeta->embedding_model.empty() ? jobMeta->model : jobMeta->embedding_model;
+        return searchStores(view->row(0), view->dim(), k, model, id);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Similarity search failed for job " + id + ": " + e.what());
+        return {};
+    } catch (...) {
+        return {};
+    }
+}
+
+Status Flow::follow(const JobId& id, const ChunkFn& onChunk, std::chrono::milliseconds poll) const {
+    if (!isValidJobId(id)) return Status::Missing;
+
+    std::size_t offset = 0;
+    auto drain = [&](const std::filesystem::path& partial) {
+        std::ifstream file(partial, std::ios::binary);
+        if (!file) return false;
+        file.seekg(static_cast<std::streamoff>(offset));
+        std::string chunk((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!chunk.empty()) {
+            offset += chunk.size();
+            onChunk(chunk);
+        }
+        return true;
+    };
+
+    while (true) {
+        Status s = status(id);
+        if (s == Status::Running) {
+            (void)drain(workspace_ / "processing" / id / "result.partial");
+        } else if (s == Status::Done) {
+            // The partial moved with the job; finish it, or hand over the result
+            // if nothing was streamed (fast job or streaming disabled)
+            if (offset > 0 && drain(workspace_ / "output" / id / "result.partial")) {
+                return s;
+            }
+            if (auto job = get(id); job && offset == 0) {
+                onChunk(job->content);
+            }
+            return s;
+        } else if (s == Status::Failed || s == Status::Missing) {
+            return s;
+        }
+        std::this_thread::sleep_for(poll);
+    }
+}
+
 WorkspaceCounts Flow::counts() const noexcept {
     WorkspaceCounts c;
     c.queued  = countSubdirs(workspace_ / "input" / "ready");
     c.running = countSubdirs(workspace_ / "processing");
-    c.done    = countSubdirs(workspace_ / "output");
-    c.failed  = countSubdirs(workspace_ / "failed");
+    if (auto index = JobIndex::load(workspace_)) {
+        c.done   = index->done;
+        c.failed = index->failed;
+        return c;
+    }
+    try {
+        archive().totals(c.done, c.failed);
+    } catch (...) {}
+    // Ids of an interrupted archive pass are live and packed; count them once
+    for (const auto& [phase, count] : {std::pair{"output", &c.done}, std::pair{"failed", &c.failed}}) {
+        try {
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(workspace_ / phase, ec)) {
+                if (entry.is_directory() && !archive().contains(entry.path().filename().string())) ++*count;
+            }
+        } catch (...) {}
+    }
     return c;
 }
 
+namespace {
+
+// Without a watcher we poll; with one, events wake us early and the slow
+// re-check only covers what the watcher cannot see.
+constexpr auto kPollInterval = std::chrono::milliseconds(100);
+constexpr auto kRecheckInterval = std::chrono::milliseconds(1000);
+
+// Runs `done` until it returns true, sleeping on `watcher` between checks.
+// `relevant` filters the paths a wakeup reports; overflow always re-checks.
+template <typename Done, typename Relevant>
+bool waitUntil(DirWatcher& watcher, std::chrono::milliseconds timeout, Done done, Relevant relevant) {
+    const bool forever = timeout.count() < 0;
+    const auto deadline = std::chrono::steady_clock::now() + (forever ? std::chrono::milliseconds(0) : timeout);
+    const auto slice = watcher.isActive() ? kRecheckInterval : kPollInterval;
+    std::vector<std::filesystem::path> paths;
+
+    bool check = true;
+    while (true) {
+        if (check && done()) return true;
+
+        auto wait = slice;
+        if (!forever) {
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) return false;
+            wait = std::min(slice, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                                       std::chrono::milliseconds(1));
+        }
+
+        if (watcher.isActive()) {
+            paths.clear();
+            bool overflow = false;
+            const bool woke = watcher.wait(wait, paths, overflow);
+            check = !woke || overflow || std::any_of(paths.begin(), paths.end(), relevant);
+        } else {
+            std::this_thread::sleep_for(wait);
+            check = true;
+        }
+    }
+}
+
+} // namespace
+
+Status Flow::waitFor(const JobId& id, std::chrono::milliseconds timeout) const noexcept {
+    try {
+        if (!isValidJobId(id)) return Status::Missing;
+
+        // Watch before the first check so a job finishing in between still wakes us
+        DirWatcher watcher;
+        (void)(watcher.watch(workspace_ / "output") && watcher.watch(workspace_ / "failed"));
+
+        Status s = Status::Missing;
+        (void)waitUntil(watcher, timeout,
+            [&] {
+                s = status(id);
+                return s == Status::Done || s == Status::Failed || s == Status::Missing;
+            },
+            [&](const std::filesystem::path& p) { return p.filename() == id; });
+        return s;
+    } catch (...) {
+        return status(id);
+    }
+}
+
+bool Flow::waitIdle(std::chrono::milliseconds timeout) const noexcept {
+    try {
+        // Every job leaving processing/ lands in output/ or failed/
+        DirWatcher watcher;
+        (void)(watcher.watch(workspace_ / "output") && watcher.watch(workspace_ / "failed"));
+
+        return waitUntil(watcher, timeout,
+            [&] {
+                return countSubdirs(workspace_ / "input" / "ready") == 0 &&
+                       countSubdirs(workspace_ / "processing") == 0;
+            },
+            [](const std::filesystem::path&) { return true; });
+    } catch (...) {
+        return false;
+    }
+}
+
 std::optional<Job> Flow::latestInDir(const std::filesystem::path& dir) const noexcept {
     try {
         if (!std::filesystem::exists(dir)) return std::nullopt;
@@ -0,0 +1,164 @@
+/*
+ * nrvna ai - Content hashing helpers (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+// 64-bit FNV-1a. Not cryptographic: used for cache keys, always paired with an
+// exact comparison (or accepted as a content fingerprint) by the caller.
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime  = 0x100000001b3ULL;
+
+inline uint64_t fnv1a(const void* data, std::size_t n, uint64_t h = kFnvOffset) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    for (std::size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= kFnvPrime;
+    }
+    return h;
+}
+
+inline uint64_t fnv1a(const std::string& s, uint64_t h = kFnvOffset) {
+    return fnv1a(s.data(), s.size(), h);
+}
+
+// fnv1a over a whole file, streamed; false if it cannot be read
+inline bool fnv1aFile(const std::filesystem::path& path, uint64_t& h) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    h = kFnvOffset;
+    std::vector<char> buf(1 << 16);
+    while (in) {
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        h = fnv1a(buf.data(), static_cast<std::size_t>(in.gcount()), h);
+    }
+    return !in.bad();
+}
+
+inline std::string hashToHex(uint64_t h) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+    return buf;
+}
+
+// SHA-256 (FIPS 180-4), for keys that someone submitting jobs must not be
+// able to collide: the result cache serves whatever an entry holds.
+class Sha256 {
+public:
+    Sha256() = default;
+
+    void update(const void* data, std::size_t n) {
+        const auto* p = static_cast<const unsigned char*>(data);
+        total_ += n;
+        while (n > 0) {
+            const std::size_t take = std::min(n, sizeof(block_) - used_);
+            std::memcpy(block_ + used_, p, take);
+            used_ += take;
+            p += take;
+            n -= take;
+            if (used_ == sizeof(block_)) {
+                compress();
+                used_ = 0;
+            }
+        }
+    }
+    void update(const std::string& s) { update(s.data(), s.size()); }
+    // Length-prefixed, so adjacent fields cannot run into each other
+    void field(const std::string& s) {
+        const uint64_t n = s.size();
+        update(&n, sizeof(n));
+        update(s);
+    }
+
+    // Lowercase hex digest; the object is spent afterwards
+    std::string hex() {
+        const uint64_t bits = total_ * 8;
+        const unsigned char pad = 0x80;
+        update(&pad, 1);
+        static const unsigned char zeros[64] = {};
+        update(zeros, (used_ <= 56 ? 56 - used_ : 120 - used_));
+        unsigned char len[8];
+        for (int i = 0; i < 8; ++i) len[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        update(len, sizeof(len));
+        char out[65];
+        for (int i = 0; i < 8; ++i) {
+            std::snprintf(out + 8 * i, 9, "%08x", static_cast<unsigned>(state_[i]));
+        }
+        return std::string(out, 64);
+    }
+
+private:
+    static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void compress() {
+        static constexpr uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (uint32_t(block_[4 * i]) << 24) | (uint32_t(block_[4 * i + 1]) << 16) |
+                   (uint32_t(block_[4 * i + 2]) << 8) | uint32_t(block_[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+        uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state_[0] += a; state_[1] += b; state_[2] += c; state_[3] += d;
+        state_[4] += e; state_[5] += f; state_[6] += g; state_[7] += h;
+    }
+
+    uint32_t state_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                          0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    unsigned char block_[64] = {};
+    std::size_t used_ = 0;
+    uint64_t total_ = 0;
+};
+
+// sha256 over a whole file, streamed; empty if it cannot be read
+inline std::string sha256File(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return "";
+    }
+    Sha256 sha;
+    std::vector<char> buf(1 << 16);
+    while (in) {
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        sha.update(buf.data(), static_cast<std::size_t>(in.gcount()));
+    }
+    return in.bad() ? "" : sha.hex();
+}
+
+} // namespace nrvnaai
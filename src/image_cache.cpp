@@ -0,0 +1,233 @@
+/*
+ * nrvna ai - Shared image embedding cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "image_cache.hpp"
+#include "hash.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+namespace nrvnaai {
+
+namespace {
+
+constexpr char kSpillMagic[4] = {'N', 'R', 'I', 'E'};
+constexpr uint32_t kSpillVersion = 1;
+
+// Hashes come from meta.json; anything but hex never reaches a path
+bool validHash(const std::string& hash) {
+    return !hash.empty() && hash.size() <= 32 &&
+           std::all_of(hash.begin(), hash.end(), [](unsigned char c) { return std::isxdigit(c) != 0; });
+}
+
+template <typename T>
+void put(std::ofstream& out, const T& v) {
+    out.write(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool get(std::ifstream& in, T& v) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(v)));
+}
+
+} // namespace
+
+ImageEmbedCache& sharedImageEmbedCache() {
+    static ImageEmbedCache cache;
+    return cache;
+}
+
+void ImageEmbedCache::configure(std::size_t budgetBytes, const std::filesystem::path& spillDir, uint64_t projectorKey) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (projectorKey != projectorKey_) {
+        entries_.clear();
+        lru_.clear();
+        bytes_ = 0;
+        projectorKey_ = projectorKey;
+    }
+    budget_ = budgetBytes;
+    spillDir_ = spillDir;
+    if (!spillDir_.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(spillDir_, ec);
+        if (ec) {
+            LOG_WARN("Image cache directory unavailable: " + spillDir_.string() + " - " + ec.message());
+            spillDir_.clear();
+        }
+    }
+    evictLocked(0);
+}
+
+bool ImageEmbedCache::enabled() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_ > 0;
+}
+
+std::size_t ImageEmbedCache::bytes() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::size_t ImageEmbedCache::sizeOf(const Image& image) noexcept {
+    std::size_t n = sizeof(Image);
+    for (const auto& chunk : image.chunks) {
+        n += sizeof(Chunk) + chunk.embd.size() * sizeof(float);
+    }
+    return n;
+}
+
+std::filesystem::path ImageEmbedCache::spillPathLocked(const std::string& imageHash) const {
+    if (spillDir_.empty()) {
+        return {};
+    }
+    return spillDir_ / (hashToHex(projectorKey_) + "-" + imageHash + ".emb");
+}
+
+ImageEmbedCache::Entry ImageEmbedCache::lookup(const std::string& imageHash) {
+    std::filesystem::path spill;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (budget_ == 0 || !validHash(imageHash)) {
+            return nullptr;
+        }
+        auto it = entries_.find(imageHash);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return it->second.image;
+        }
+        spill = spillPathLocked(imageHash);
+    }
+    if (spill.empty()) {
+        return nullptr;
+    }
+
+    // Disk read happens outside the lock; a concurrent insert of the same
+    // image just wins the race in storeLocked()
+    Entry image = readSpill(spill);
+    if (image) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        storeLocked(imageHash, image);
+    }
+    return image;
+}
+
+void ImageEmbedCache::insert(const std::string& imageHash, Image image) {
+    if (image.chunks.empty() || !validHash(imageHash)) {
+        return;
+    }
+    auto entry = std::make_shared<const Image>(std::move(image));
+    std::filesystem::path spill;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (budget_ == 0 || entries_.count(imageHash)) {
+            return;  // another worker stored it first
+        }
+        storeLocked(imageHash, entry);
+        spill = spillPathLocked(imageHash);
+    }
+    if (!spill.empty()) {
+        writeSpill(spill, *entry);
+    }
+}
+
+void ImageEmbedCache::storeLocked(const std::string& imageHash, Entry image) {
+    const std::size_t size = sizeOf(*image);
+    if (size > budget_ || entries_.count(imageHash)) {
+        return;
+    }
+    evictLocked(size);
+    lru_.push_front(imageHash);
+    entries_.emplace(imageHash, Slot{std::move(image), size, lru_.begin()});
+    bytes_ += size;
+}
+
+void ImageEmbedCache::evictLocked(std::size_t needed) {
+    while (!lru_.empty() && bytes_ + needed > budget_) {
+        auto it = entries_.find(lru_.back());
+        if (it != entries_.end()) {
+            bytes_ -= it->second.bytes;
+            entries_.erase(it);
+        }
+        lru_.pop_back();
+    }
+}
+
+ImageEmbedCache::Entry ImageEmbedCache::readSpill(const std::filesystem::path& path) const {
+    try {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            return nullptr;
+        }
+        char magic[4];
+        uint32_t version = 0, n_chunks = 0;
+        Image image;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kSpillMagic, sizeof(magic)) != 0 ||
+            !get(in, version) || version != kSpillVersion ||
+            !get(in, image.nx) || !get(in, image.ny) || !get(in, n_chunks) || n_chunks == 0) {
+            LOG_WARN("Ignoring malformed image cache file: " + path.string());
+            return nullptr;
+        }
+
+        std::error_code ec;
+        const auto fileSize = std::filesystem::file_size(path, ec);
+        std::uint64_t remaining = ec ? 0 : fileSize;
+        image.chunks.resize(n_chunks);
+        for (auto& chunk : image.chunks) {
+            uint64_t n_floats = 0;
+            if (!get(in, chunk.n_tokens) || !get(in, n_floats) || n_floats > remaining / sizeof(float)) {
+                LOG_WARN("Ignoring truncated image cache file: " + path.string());
+                return nullptr;
+            }
+            chunk.embd.resize(static_cast<std::size_t>(n_floats));
+            if (!in.read(reinterpret_cast<char*>(chunk.embd.data()),
+                         static_cast<std::streamsize>(n_floats * sizeof(float)))) {
+                LOG_WARN("Ignoring truncated image cache file: " + path.string());
+                return nullptr;
+            }
+        }
+        return std::make_shared<const Image>(std::move(image));
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read image cache file: " + std::string(e.what()));
+        return nullptr;
+    }
+}
+
+void ImageEmbedCache::writeSpill(const std::filesystem::path& path, const Image& image) const {
+    try {
+        auto tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                return;
+            }
+            out.write(kSpillMagic, sizeof(kSpillMagic));
+            put(out, kSpillVersion);
+            put(out, image.nx);
+            put(out, image.ny);
+            put(out, static_cast<uint32_t>(image.chunks.size()));
+            for (const auto& chunk : image.chunks) {
+                put(out, chunk.n_tokens);
+                put(out, static_cast<uint64_t>(chunk.embd.size()));
+                out.write(reinterpret_cast<const char*>(chunk.embd.data()),
+                          static_cast<std::streamsize>(chunk.embd.size() * sizeof(float)));
+            }
+            out.flush();
+            if (!out.good()) {
+                std::error_code ec;
+                std::filesystem::remove(tempPath, ec);
+                return;
+            }
+        }
+        std::filesystem::rename(tempPath, path);
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to write image cache file: " + std::string(e.what()));
+    }
+}
+
+} // namespace nrvnaai
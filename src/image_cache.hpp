@@ -0,0 +1,95 @@
+/*
+ * nrvna ai - Shared image embedding cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvnaai {
+
+// Process-wide cache of projected image embeddings, keyed by the image's
+// content hash (recorded in meta.json at submit) and the projector identity.
+//
+// One entry holds everything mtmd produced for one image: its size, so the
+// next job can tokenize from a placeholder bitmap without decoding the file,
+// and one embedding block per media chunk, so the encoder is skipped too.
+// Entries are LRU-evicted under a byte budget. With a spill directory every
+// insert is also written there and memory misses fall back to it, so hits
+// survive a daemon restart.
+class ImageEmbedCache {
+public:
+    struct Chunk {
+        uint32_t n_tokens = 0;
+        std::vector<float> embd;    // n_tokens * n_embd
+    };
+    struct Image {
+        uint32_t nx = 0;
+        uint32_t ny = 0;
+        std::vector<Chunk> chunks;
+    };
+    using Entry = std::shared_ptr<const Image>;
+
+    ImageEmbedCache() = default;
+    ImageEmbedCache(const ImageEmbedCache&) = delete;
+    ImageEmbedCache& operator=(const ImageEmbedCache&) = delete;
+
+    // Drops all entries when the projector identity changes.
+    void configure(std::size_t budgetBytes, const std::filesystem::path& spillDir, uint64_t projectorKey);
+    [[nodiscard]] bool enabled() const noexcept;
+
+    // Memory first, then the spill directory. Null on miss.
+    [[nodiscard]] Entry lookup(const std::string& imageHash);
+    void insert(const std::string& imageHash, Image image);
+
+    [[nodiscard]] std::size_t bytes() const noexcept;
+
+private:
+    struct Slot {
+        Entry image;
+        std::size_t bytes = 0;
+        std::list<std::string>::iterator lru;
+    };
+
+    static std::size_t sizeOf(const Image& image) noexcept;
+    [[nodiscard]] std::filesystem::path spillPathLocked(const std::string& imageHash) const;
+    [[nodiscard]] Entry readSpill(const std::filesystem::path& path) const;
+    void writeSpill(const std::filesystem::path& path, const Image& image) const;
+    void storeLocked(const std::string& imageHash, Entry image);
+    void evictLocked(std::size_t needed);
+
+    mutable std::mutex mutex_;
+    std::size_t budget_ = 0;
+    std::size_t bytes_ = 0;
+    uint64_t projectorKey_ = 0;
+    std::filesystem::path spillDir_;
+
+    std::unordered_map<std::string, Slot> entries_;
+    std::list<std::string> lru_;                    // front = most recent
+};
+
+// The one cache shared by every Runner
+ImageEmbedCache& sharedImageEmbedCache();
+
+// One job's use of the cache: entries pinned before the images are loaded,
+// embeddings of the misses collected while encoding and inserted afterwards
+struct ImageCacheJob {
+    std::vector<std::string> hashes;        // per image; empty = job is not cached
+    std::vector<std::string> ids;           // mtmd bitmap ids, unique per image
+    std::vector<ImageEmbedCache::Entry> hits;
+    std::vector<ImageEmbedCache::Image> fresh;
+    std::vector<std::size_t> ordinals;      // media chunks seen so far per image
+    bool placeholders = false;              // every image hit; bitmaps are blank
+};
+
+} // namespace nrvnaai
@@ -0,0 +1,314 @@
+/*
+ * nrvna ai - Append-only job index (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "job_index.hpp"
+#include "archive.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <sstream>
+
+namespace nrvnaai {
+
+namespace {
+
+constexpr const char* kMagic = "nrvna-index";
+constexpr int kVersion = 1;
+constexpr int kLoadAttempts = 3;
+
+std::int64_t nowMs() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::int64_t fileTimeMs(const std::filesystem::file_time_type& file_time) noexcept {
+    const auto delta = file_time - std::filesystem::file_time_type::clock::now();
+    const auto sys = std::chrono::system_clock::now() +
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(delta);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(sys.time_since_epoch()).count();
+}
+
+std::filesystem::path journalPath(const std::filesystem::path& dir, std::uint64_t gen) {
+    return dir / ("journal." + std::to_string(gen));
+}
+
+const char* phaseFor(Status status) noexcept {
+    return status == Status::Done ? "output" : "failed";
+}
+
+std::string formatEntry(const IndexEntry& e) {
+    return std::to_string(e.ts_ms) + (e.status == Status::Done ? " D " : " F ") +
+           std::to_string(e.duration_ms) + " " + e.id + "\n";
+}
+
+bool parseEntry(const std::string& line, IndexEntry& e) {
+    std::istringstream in(line);
+    char state = 0;
+    if (!(in >> e.ts_ms >> state >> e.duration_ms >> e.id)) return false;
+    if (state == 'D') e.status = Status::Done;
+    else if (state == 'F') e.status = Status::Failed;
+    else return false;
+    return true;
+}
+
+bool readCount(std::istream& in, const char* key, std::uint64_t& value) {
+    std::string name;
+    return (in >> name >> value) && name == key;
+}
+
+// Snapshot plus its journal tail; false when the journal has been rotated
+// away underneath us (caller retries) or the files are unreadable.
+bool readIndex(const std::filesystem::path& dir, std::uint64_t& gen, IndexView& view, bool& present) {
+    present = false;
+    std::ifstream snap(dir / "snapshot");
+    if (!snap) return false;
+
+    std::string magic;
+    int version = 0;
+    std::uint64_t done = 0, failed = 0;
+    if (!(snap >> magic >> version) || magic != kMagic || version != kVersion) return false;
+    if (!readCount(snap, "gen", gen) || !readCount(snap, "done", done) || !readCount(snap, "failed", failed)) {
+        return false;
+    }
+    present = true;
+
+    std::vector<IndexEntry> older;
+    std::string line;
+    std::getline(snap, line);
+    while (std::getline(snap, line)) {
+        IndexEntry e;
+        if (parseEntry(line, e)) older.push_back(std::move(e));
+    }
+
+    std::ifstream journal(journalPath(dir, gen));
+    if (!journal) return false;
+
+    std::vector<IndexEntry> tail;
+    while (std::getline(journal, line)) {
+        if (journal.eof()) break;   // torn last line, the writer is mid-append
+        IndexEntry e;
+        if (!parseEntry(line, e)) continue;
+        if (e.status == Status::Done) ++done; else ++failed;
+        tail.push_back(std::move(e));
+    }
+
+    view.done = static_cast<std::size_t>(done);
+    view.failed = static_cast<std::size_t>(failed);
+    view.recent.assign(tail.rbegin(), tail.rend());
+    view.recent.insert(view.recent.end(), older.begin(), older.end());
+    return true;
+}
+
+} // namespace
+
+JobIndex::JobIndex(const std::filesystem::path& workspace)
+    : dir_(workspace / ".nrvna"), workspace_(workspace) {
+}
+
+JobIndex::~JobIndex() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (journal_.is_open()) journal_.flush();
+}
+
+std::optional<IndexView> JobIndex::load(const std::filesystem::path& workspace) noexcept {
+    try {
+        const auto dir = workspace / ".nrvna";
+        for (int attempt = 0; attempt < kLoadAttempts; ++attempt) {
+            std::uint64_t gen = 0;
+            IndexView view;
+            bool present = false;
+            if (readIndex(dir, gen, view, present)) return view;
+            if (!present) return std::nullopt;
+        }
+    } catch (...) {}
+    return std::nullopt;
+}
+
+bool JobIndex::rebuild() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    try {
+        std::filesystem::create_directories(dir_);
+
+        // Keep the previous recent list (cheap) but trust only directories for counts
+        std::uint64_t oldGen = 0;
+        IndexView old;
+        bool present = false;
+        const bool hadIndex = readIndex(dir_, oldGen, old, present);
+
+        // Packed jobs still count; they are just no longer directories. A pass
+        // cut short leaves some in both places, counted once as archived.
+        const Archive archive(workspace_);
+        std::size_t archivedDone = 0, archivedFailed = 0;
+        archive.totals(archivedDone, archivedFailed);
+
+        done_ = archivedDone;
+        failed_ = archivedFailed;
+        std::vector<IndexEntry> scanned;
+        for (Status status : {Status::Done, Status::Failed}) {
+            const auto phase = workspace_ / phaseFor(status);
+            if (!std::filesystem::exists(phase)) continue;
+            for (const auto& entry : std::filesystem::directory_iterator(phase)) {
+                if (!entry.is_directory() || archive.contains(entry.path().filename().string())) continue;
+                (status == Status::Done ? done_ : failed_)++;
+                if (!hadIndex) {
+                    IndexEntry e;
+                    e.id = entry.path().filename().string();
+                    e.status = status;
+                    e.ts_ms = fileTimeMs(std::filesystem::last_write_time(entry));
+                    scanned.push_back(std::move(e));
+                }
+            }
+        }
+
+        recent_.clear();
+        if (hadIndex) {
+            for (auto& e : old.recent) {
+                if (recent_.size() >= kRecent) break;
+                if (std::filesystem::exists(workspace_ / phaseFor(e.status) / e.id) || archive.find(e.id)) {
+                    recent_.push_back(std::move(e));
+                }
+            }
+        } else {
+            const auto keep = std::min(kRecent, scanned.size());
+            std::partial_sort(scanned.begin(), scanned.begin() + static_cast<std::ptrdiff_t>(keep), scanned.end(),
+                              [](const IndexEntry& a, const IndexEntry& b) { return a.ts_ms > b.ts_ms; });
+            recent_.assign(std::make_move_iterator(scanned.begin()),
+                           std::make_move_iterator(scanned.begin() + static_cast<std::ptrdiff_t>(keep)));
+        }
+
+        gen_ = present ? oldGen + 1 : 1;
+        if (!rotateLocked()) return false;
+        ready_ = true;
+        LOG_DEBUG("Job index rebuilt: " + std::to_string(done_) + " done, " +
+                  std::to_string(failed_) + " failed");
+        return true;
+    } catch (const std::exception& e) {
+        disableLocked(e.what());
+        return false;
+    } catch (...) {
+        disableLocked("unknown error");
+        return false;
+    }
+}
+
+void JobIndex::claimed(const JobId& id) noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ready_) started_[id] = std::chrono::steady_clock::now();
+    } catch (...) {}
+}
+
+void JobIndex::finished(const JobId& id, Status status) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    try {
+        if (!ready_) return;
+
+        IndexEntry e;
+        e.id = id;
+        e.status = status;
+        e.ts_ms = nowMs();
+        if (auto it = started_.find(id); it != started_.end()) {
+            e.duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - it->second).count();
+            started_.erase(it);
+        }
+
+        journal_ << formatEntry(e);
+        journal_.flush();
+        if (!journal_.good()) {
+            disableLocked("journal write failed");
+            return;
+        }
+
+        (status == Status::Done ? done_ : failed_)++;
+        recent_.push_front(std::move(e));
+        if (recent_.size() > kRecent) recent_.pop_back();
+
+        if (++appended_ >= kSnapshotEvery) {
+            ++gen_;
+            (void)rotateLocked();
+        }
+    } catch (const std::exception& e) {
+        disableLocked(e.what());
+    } catch (...) {
+        disableLocked("unknown error");
+    }
+}
+
+// Start journal.<gen_>, then publish a snapshot pointing at it. Readers that
+// still hold the previous snapshot either finish on the old journal or retry.
+bool JobIndex::rotateLocked() noexcept {
+    try {
+        if (journal_.is_open()) journal_.close();
+        journal_.open(journalPath(dir_, gen_), std::ios::binary | std::ios::trunc);
+        if (!journal_) {
+            disableLocked("cannot open journal");
+            return false;
+        }
+
+        auto tempPath = dir_ / "snapshot.tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                disableLocked("cannot write snapshot");
+                return false;
+            }
+            file << kMagic << " " << kVersion << "\n"
+                 << "gen " << gen_ << "\n"
+                 << "done " << done_ << "\n"
+                 << "failed " << failed_ << "\n";
+            for (const auto& e : recent_) file << formatEntry(e);
+            file.flush();
+            if (!file.good()) {
+                disableLocked("cannot write snapshot");
+                return false;
+            }
+        }
+        std::filesystem::rename(tempPath, dir_ / "snapshot");
+
+        if (gen_ > 0) {
+            std::error_code ec;
+            std::filesystem::remove(journalPath(dir_, gen_ - 1), ec);
+        }
+        appended_ = 0;
+        return true;
+    } catch (const std::exception& e) {
+        disableLocked(e.what());
+        return false;
+    }
+}
+
+void JobIndex::disable(const std::string& why) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ready_) {
+        disableLocked(why);
+    } else {
+        // Never started here, but an earlier solo run may have left one
+        removeFilesLocked();
+    }
+}
+
+// A stale index is worse than none: drop the snapshot so readers walk directories
+void JobIndex::disableLocked(const std::string& why) noexcept {
+    LOG_WARN("Job index disabled: " + why);
+    ready_ = false;
+    if (journal_.is_open()) journal_.close();
+    removeFilesLocked();
+}
+
+void JobIndex::removeFilesLocked() noexcept {
+    try {
+        std::error_code ec;
+        std::filesystem::remove(dir_ / "snapshot", ec);
+        std::filesystem::remove(dir_ / "snapshot.tmp", ec);
+        for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+            if (entry.path().filename().string().rfind("journal.", 0) == 0) {
+                std::filesystem::remove(entry.path(), ec);
+            }
+        }
+    } catch (...) {}
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,88 @@
+/*
+ * nrvna ai - Append-only job index (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/types.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvnaai {
+
+struct IndexEntry {
+    JobId id;
+    Status status = Status::Missing;
+    std::int64_t ts_ms = 0;          // unix epoch, when the job finished
+    std::int64_t duration_ms = -1;   // claim to finish, -1 if unknown
+};
+
+// Everything a reader needs for counts/list without walking output/ and failed/
+struct IndexView {
+    std::size_t done = 0;
+    std::size_t failed = 0;
+    std::vector<IndexEntry> recent;  // newest first
+};
+
+// Finished-job index under <workspace>/.nrvna/. The daemon appends one line
+// per terminal transition (done/failed) to journal.<gen> and every
+// kSnapshotEvery records writes a snapshot (counts + most recent jobs) and
+// starts the next journal generation, so readers replay at most one short
+// journal. queued/running live in small directories and are never indexed.
+//
+// snapshot:  nrvna-index 1 / gen <n> / done <n> / failed <n> / entries...
+// entries:   <ts_ms> <D|F> <duration_ms> <job_id>
+class JobIndex {
+public:
+    static constexpr std::size_t kSnapshotEvery = 4096;
+    static constexpr std::size_t kRecent = 1024;
+
+    explicit JobIndex(const std::filesystem::path& workspace);
+    ~JobIndex();
+
+    JobIndex(const JobIndex&) = delete;
+    JobIndex& operator=(const JobIndex&) = delete;
+
+    // Writer side (nrvnad). rebuild() recounts output/ and failed/, keeps the
+    // recent list of any previous index and starts a fresh generation.
+    bool rebuild() noexcept;
+    void claimed(const JobId& id) noexcept;
+    void finished(const JobId& id, Status status) noexcept;
+    // Stop writing and drop the snapshot and journals (another daemon writes
+    // here too); also clears what an earlier run left when never started
+    void disable(const std::string& why) noexcept;
+
+    // Reader side: nullopt when there is no index (callers walk directories)
+    [[nodiscard]] static std::optional<IndexView> load(const std::filesystem::path& workspace) noexcept;
+
+private:
+    std::filesystem::path dir_;
+    std::filesystem::path workspace_;
+    std::mutex mutex_;
+    std::ofstream journal_;
+    std::uint64_t gen_ = 0;
+    std::size_t appended_ = 0;
+    std::size_t done_ = 0;
+    std::size_t failed_ = 0;
+    std::deque<IndexEntry> recent_;      // newest first, at most kRecent
+    std::unordered_map<JobId, std::chrono::steady_clock::time_point> started_;
+    bool ready_ = false;
+
+    bool rotateLocked() noexcept;
+    void disableLocked(const std::string& why) noexcept;
+    // Snapshot and journals, so readers fall back to walking directories
+    void removeFilesLocked() noexcept;
+};
+
+} // namespace nrvnaai
@@ -0,0 +1,81 @@
+/*
+ * nrvna ai - Per-job KV session files (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "kv_session.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+
+namespace nrvnaai {
+
+bool saveSession(llama_context* ctx, llama_seq_id seq,
+                 const std::filesystem::path& path,
+                 const std::vector<llama_token>& tokens) noexcept {
+    try {
+        auto tempPath = path;
+        tempPath += ".tmp";
+        if (llama_state_seq_save_file(ctx, tempPath.string().c_str(), seq, tokens.data(), tokens.size()) == 0) {
+            LOG_WARN("Failed to save session: " + path.string());
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+        std::filesystem::rename(tempPath, path);
+        LOG_DEBUG("Session saved: " + path.string() + " (" + std::to_string(tokens.size()) + " tokens)");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to save session " + path.string() + ": " + std::string(e.what()));
+        return false;
+    } catch (...) {
+        LOG_WARN("Unknown error saving session: " + path.string());
+        return false;
+    }
+}
+
+int restoreSession(llama_context* ctx, llama_seq_id seq,
+                   const std::filesystem::path& path,
+                   const std::vector<llama_token>& tokens,
+                   uint32_t capacity) noexcept {
+    llama_memory_t mem = llama_get_memory(ctx);
+    try {
+        std::error_code ec;
+        if (tokens.size() < 2 || !std::filesystem::is_regular_file(path, ec)) {
+            return 0;
+        }
+
+        std::vector<llama_token> saved(capacity);
+        size_t n_saved = 0;
+        if (llama_state_seq_load_file(ctx, path.string().c_str(), seq, saved.data(), saved.size(), &n_saved) == 0) {
+            LOG_WARN("Failed to load session (model or context changed?): " + path.string());
+            llama_memory_seq_rm(mem, seq, -1, -1);
+            return 0;
+        }
+
+        const size_t limit = std::min(n_saved, tokens.size() - 1);
+        size_t n_keep = 0;
+        while (n_keep < limit && saved[n_keep] == tokens[n_keep]) {
+            ++n_keep;
+        }
+
+        if (n_keep == 0) {
+            llama_memory_seq_rm(mem, seq, -1, -1);
+            return 0;
+        }
+        if (!llama_memory_seq_rm(mem, seq, static_cast<llama_pos>(n_keep), -1)) {
+            // Recurrent memory cannot be trimmed - only an exact continuation is usable
+            llama_memory_seq_rm(mem, seq, -1, -1);
+            return 0;
+        }
+
+        LOG_DEBUG("Session restored: " + std::to_string(n_keep) + "/" + std::to_string(tokens.size()) +
+                  " tokens from " + path.string());
+        return static_cast<int>(n_keep);
+    } catch (...) {
+        llama_memory_seq_rm(mem, seq, -1, -1);
+        return 0;
+    }
+}
+
+} // namespace nrvnaai
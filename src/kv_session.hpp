@@ -0,0 +1,33 @@
+/*
+ * nrvna ai - Per-job KV session files (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "llama.h"
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace nrvnaai {
+
+// A finished text job can leave its sequence state in output/<id>/session.bin
+// (llama_state_seq_save_file format: token list + KV cells). A follow-up job
+// restores it and keeps only the cells that match its own prompt.
+
+// Writes via a .tmp sibling so a crash never leaves a truncated session.bin.
+[[nodiscard]] bool saveSession(llama_context* ctx, llama_seq_id seq,
+                               const std::filesystem::path& path,
+                               const std::vector<llama_token>& tokens) noexcept;
+
+// Loads `path` into `seq` and trims it to the longest common prefix with
+// `tokens`, always leaving at least one token to prefill. Returns the number
+// of positions kept; on 0 the sequence is empty.
+[[nodiscard]] int restoreSession(llama_context* ctx, llama_seq_id seq,
+                                 const std::filesystem::path& path,
+                                 const std::vector<llama_token>& tokens,
+                                 uint32_t capacity) noexcept;
+
+} // namespace nrvnaai
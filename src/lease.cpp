@@ -0,0 +1,261 @@
+/*
+ * nrvna ai - Job leases for shared workspaces (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "lease.hpp"
+#include "llama_util.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <fstream>
+#include <signal.h>
+#include <unistd.h>
+
+namespace nrvnaai {
+
+namespace {
+
+constexpr const char* kNodeMagic = "nrvna-node";
+constexpr int kNodeVersion = 1;
+
+std::int64_t nowMs() noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Hostnames end up in file names; keep them to a safe alphabet
+std::string localHost() {
+    char buf[256] = {};
+    if (::gethostname(buf, sizeof(buf) - 1) != 0 || buf[0] == '\0') {
+        return "localhost";
+    }
+    std::string host = buf;
+    for (char& c : host) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') c = '_';
+    }
+    return host;
+}
+
+// Write then rename, so readers on any node see the old or the new file
+bool writeAtomic(const std::filesystem::path& path, const std::string& content) {
+    static std::atomic<unsigned> counter{0};
+    auto tempPath = path;
+    tempPath += ".tmp-" + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << content;
+        out.flush();
+        if (!out.good()) {
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool isTemp(const std::filesystem::path& path) {
+    return path.filename().string().find(".tmp-") != std::string::npos;
+}
+
+} // namespace
+
+LeaseTable::LeaseTable(const std::filesystem::path& workspace)
+    : workspace_(workspace),
+      nodesDir_(workspace / ".nrvna" / "nodes"),
+      leasesDir_(workspace / ".nrvna" / "leases"),
+      host_(localHost()),
+      pid_(static_cast<long>(::getpid())),
+      leaseMs_(1000LL * std::max(3, env_int("NRVNA_LEASE_S", 60))) {
+    owner_ = host_ + "-" + std::to_string(pid_) + "-" + std::to_string(nowMs());
+    std::filesystem::create_directories(nodesDir_);
+    std::filesystem::create_directories(leasesDir_);
+    if (!heartbeat()) {
+        throw std::runtime_error("Cannot write node heartbeat under " + nodesDir_.string());
+    }
+}
+
+LeaseTable::~LeaseTable() {
+    std::error_code ec;
+    std::filesystem::remove(nodesDir_ / owner_, ec);
+}
+
+bool LeaseTable::heartbeat() noexcept {
+    try {
+        const std::string content = std::string(kNodeMagic) + " " + std::to_string(kNodeVersion) + "\n" +
+                                    "host " + host_ + "\n" +
+                                    "pid " + std::to_string(pid_) + "\n" +
+                                    "heartbeat_ms " + std::to_string(nowMs()) + "\n";
+        if (!writeAtomic(nodesDir_ / owner_, content)) {
+            LOG_WARN("Failed to write node heartbeat: " + (nodesDir_ / owner_).string());
+            return false;
+        }
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void LeaseTable::claim(const JobId& id) noexcept {
+    try {
+        if (!writeAtomic(leasesDir_ / id, owner_ + "\n")) {
+            LOG_WARN("Failed to write lease for job " + id);
+        }
+    } catch (...) {}
+}
+
+void LeaseTable::release(const JobId& id) noexcept {
+    std::error_code ec;
+    std::filesystem::remove(leasesDir_ / id, ec);
+}
+
+std::optional<LeaseTable::Node> LeaseTable::readNode(const std::string& owner) const {
+    std::ifstream in(nodesDir_ / owner, std::ios::binary);
+    std::string magic;
+    int version = 0;
+    if (!in || !(in >> magic >> version) || magic != kNodeMagic || version != kNodeVersion) {
+        return std::nullopt;
+    }
+    Node node;
+    std::string key;
+    while (in >> key) {
+        if (key == "host") in >> node.host;
+        else if (key == "pid") in >> node.pid;
+        else if (key == "heartbeat_ms") in >> node.heartbeat_ms;
+        else in.ignore(4096, '\n');
+    }
+    return node;
+}
+
+bool LeaseTable::alive(const std::string& owner, const Node& node, std::int64_t now) const {
+    if (owner == owner_) {
+        return true;
+    }
+    if (node.heartbeat_ms + leaseMs_ < now) {
+        return false;
+    }
+    // Same host: a dead pid (or our own, from a previous run) frees its
+    // claims without waiting out the lease
+    if (node.host == host_) {
+        if (node.pid == pid_) return false;
+        if (node.pid > 0 && ::kill(static_cast<pid_t>(node.pid), 0) != 0 && errno == ESRCH) return false;
+    }
+    return true;
+}
+
+int LeaseTable::peers() const noexcept {
+    try {
+        const std::int64_t now = nowMs();
+        int live = 0;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(nodesDir_, ec)) {
+            const std::string owner = entry.path().filename().string();
+            if (owner == owner_ || isTemp(entry.path())) continue;
+            if (auto node = readNode(owner); node && alive(owner, *node, now)) ++live;
+        }
+        return live;
+    } catch (...) {
+        return 0;
+    }
+}
+
+int LeaseTable::recover(bool startup) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    try {
+        const auto processingDir = workspace_ / "processing";
+        const std::int64_t now = nowMs();
+        const auto steadyNow = std::chrono::steady_clock::now();
+        const bool alone = startup && peers() == 0;
+
+        // Liveness per owner, read once per pass; dead nodes are forgotten
+        std::unordered_map<std::string, bool> owners;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(nodesDir_, ec)) {
+            const std::string owner = entry.path().filename().string();
+            if (isTemp(entry.path())) continue;
+            auto node = readNode(owner);
+            const bool live = node && alive(owner, *node, now);
+            owners[owner] = live;
+            if (!live && owner != owner_) {
+                std::error_code rm;
+                std::filesystem::remove(entry.path(), rm);
+            }
+        }
+
+        int recovered = 0;
+        std::unordered_map<JobId, std::chrono::steady_clock::time_point> stillUnleased;
+        for (const auto& entry : std::filesystem::directory_iterator(processingDir, ec)) {
+            if (!entry.is_directory()) continue;
+            const JobId jobId = entry.path().filename().string();
+
+            std::string owner;
+            {
+                std::ifstream in(leasesDir_ / jobId, std::ios::binary);
+                if (in) std::getline(in, owner);
+            }
+            if (owner.empty()) {
+                const auto seen = unleased_.try_emplace(jobId, steadyNow).first->second;
+                if (!alone && steadyNow - seen < std::chrono::milliseconds(leaseMs_)) {
+                    stillUnleased.emplace(jobId, seen);
+                    continue;
+                }
+            } else {
+                auto it = owners.find(owner);
+                if (it != owners.end() && it->second) continue;
+            }
+
+            LOG_WARN("Recovering orphaned job: " + jobId +
+                     (owner.empty() ? std::string(" (no lease)") : " (owner " + owner + " gone)"));
+            // Lease first: whoever claims the job next writes a fresh one
+            release(jobId);
+            std::error_code mv;
+            std::filesystem::rename(entry.path(), workspace_ / "input" / "ready" / jobId, mv);
+            if (mv == std::errc::no_such_file_or_directory) {
+                continue;  // another node recovered or finished it first
+            }
+            if (mv) {
+                LOG_ERROR("Failed to recover job " + jobId + ": " + mv.message());
+                std::filesystem::rename(entry.path(), workspace_ / "failed" / jobId, mv);
+            } else {
+                recovered++;
+            }
+        }
+        unleased_ = std::move(stillUnleased);
+
+        // Leases whose job already left processing/ (finished by a node that died
+        // before releasing it)
+        for (const auto& entry : std::filesystem::directory_iterator(leasesDir_, ec)) {
+            const JobId jobId = entry.path().filename().string();
+            std::error_code st;
+            if (!isTemp(entry.path()) && !std::filesystem::exists(processingDir / jobId, st) && !st) {
+                std::string owner;
+                std::ifstream in(entry.path(), std::ios::binary);
+                if (in) std::getline(in, owner);
+                auto it = owners.find(owner);
+                if (it == owners.end() || !it->second) {
+                    std::error_code rm;
+                    std::filesystem::remove(entry.path(), rm);
+                }
+            }
+        }
+        return recovered;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error recovering orphaned jobs: " + std::string(e.what()));
+        return -1;
+    }
+}
+
+} // namespace nrvnaai
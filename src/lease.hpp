@@ -0,0 +1,80 @@
+/*
+ * nrvna ai - Job leases for shared workspaces (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/types.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace nrvnaai {
+
+// Ownership of claimed jobs, so several daemons (on one host or many) can
+// serve one workspace. Each daemon is a node with a heartbeat file
+// <workspace>/.nrvna/nodes/<owner> (host, pid, last heartbeat), rewritten
+// every NRVNA_LEASE_S / 3. Claiming a job also writes .nrvna/leases/<id>
+// naming the owner. A claim stays valid while its owner's heartbeat is
+// younger than NRVNA_LEASE_S and, when the owner is on this host, its pid
+// is alive; recover() returns every other job in processing/ to ready/.
+//
+// Heartbeats are wall-clock stamps, so nodes' clocks must agree to well
+// within the lease. A node that stalls past its lease may see its job run
+// again elsewhere; its own finalize then finds the directory gone.
+class LeaseTable {
+public:
+    explicit LeaseTable(const std::filesystem::path& workspace);
+    ~LeaseTable();  // removes this node, freeing its claims immediately
+
+    LeaseTable(const LeaseTable&) = delete;
+    LeaseTable& operator=(const LeaseTable&) = delete;
+
+    bool heartbeat() noexcept;
+    void claim(const JobId& id) noexcept;
+    void release(const JobId& id) noexcept;
+
+    // Move jobs with a dead or expired owner back to input/ready/ (to
+    // failed/ if that move fails); returns how many. Jobs without a lease
+    // get one lease period of grace, since the claimer may not have
+    // written it yet, except at startup with no other live node. -1 on error.
+    int recover(bool startup) noexcept;
+
+    // Other nodes with a live heartbeat
+    [[nodiscard]] int peers() const noexcept;
+    [[nodiscard]] const std::string& owner() const noexcept { return owner_; }
+    [[nodiscard]] std::chrono::milliseconds heartbeatInterval() const noexcept {
+        return std::chrono::milliseconds(leaseMs_ / 3);
+    }
+
+private:
+    struct Node {
+        std::string host;
+        long pid = 0;
+        std::int64_t heartbeat_ms = 0;
+    };
+
+    [[nodiscard]] std::optional<Node> readNode(const std::string& owner) const;
+    [[nodiscard]] bool alive(const std::string& owner, const Node& node, std::int64_t now) const;
+
+    std::filesystem::path workspace_;
+    std::filesystem::path nodesDir_;
+    std::filesystem::path leasesDir_;
+    std::string host_;
+    long pid_ = 0;
+    std::string owner_;
+    std::int64_t leaseMs_ = 60000;
+
+    std::mutex mutex_;
+    // Jobs in processing/ seen without a lease, and since when
+    std::unordered_map<JobId, std::chrono::steady_clock::time_point> unleased_;
+};
+
+} // namespace nrvnaai
@@ -7,8 +7,10 @@
 #pragma once
 
 #include "llama.h"
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <mutex>
 #include <string>
 
 namespace nrvnaai {
@@ -25,23 +27,75 @@ inline float env_float(const char* name, float defv) {
     return defv;
 }
 
+// Milliseconds since `start`, for RunStats phase timings
+inline double msSince(std::chrono::steady_clock::time_point start) noexcept {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Read GGUF metadata helpers
+inline std::string readModelStrMeta(const llama_model* model, const char* key) {
+    char buf[256] = {};
+    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
+    return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string();
+}
+
+inline float readModelFloatMeta(const llama_model* model, const char* key, float fallback) {
+    char buf[64] = {};
+    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
+    if (n > 0) {
+        try { return std::stof(std::string(buf, static_cast<size_t>(n))); }
+        catch (...) {}
+    }
+    return fallback;
+}
+
+inline int readModelIntMeta(const llama_model* model, const char* key, int fallback) {
+    char buf[64] = {};
+    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
+    if (n > 0) {
+        try { return std::stoi(std::string(buf, static_cast<size_t>(n))); }
+        catch (...) {}
+    }
+    return fallback;
+}
+
+inline void restrictModelToCpu(llama_model_params& params) {
+    ggml_backend_dev_t cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
+    static ggml_backend_dev_t cpu_only_devices[2] = { nullptr, nullptr };
+    cpu_only_devices[0] = cpu_dev;
+    cpu_only_devices[1] = nullptr;
+    if (cpu_dev) {
+        params.devices = cpu_only_devices;
+    }
+}
+
 // Configurable llama.cpp log filtering — keep UI clean
 inline void filtered_llama_log(enum ggml_log_level level, const char* text, void* /*user_data*/) {
     if (!text || text[0] == '.' || text[0] == '\n' || text[0] == '\0') return;
 
-    static int filter_level = -1;
-    if (filter_level == -1) {
+    static const int filter_level = [] {
         const char* env = std::getenv("LLAMA_LOG_LEVEL");
-        filter_level = env ?
+        return env ?
             (std::string(env) == "info" ? GGML_LOG_LEVEL_INFO :
              std::string(env) == "warn" ? GGML_LOG_LEVEL_WARN :
              std::string(env) == "debug" ? GGML_LOG_LEVEL_DEBUG :
              GGML_LOG_LEVEL_ERROR) : GGML_LOG_LEVEL_ERROR;
-    }
+    }();
 
     if (level >= filter_level) {
         fprintf(stderr, "%s", text);
     }
 }
 
+// Process-wide llama.cpp setup: log filter and backend registry. Both are
+// global, so this runs once, before the first model load; later calls
+// return at once and are safe while other threads decode.
+inline void initLlamaBackend() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        llama_log_set(filtered_llama_log, nullptr);
+        ggml_backend_load_all();
+    });
+}
+
 } // namespace nrvnaai
@@ -5,24 +5,25 @@
  */
 
 #include "nrvna/logger.hpp"
-#include <iostream>
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <sstream>
 #include <thread>
-#include <unordered_map>
 #include <ctime>
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
 
 namespace nrvnaai {
 
-static LogLevel g_level = LogLevel::INFO;
-static std::mutex g_log_mutex;
 static std::mutex g_time_mutex;
-static bool g_level_initialized = false;
-static std::unordered_map<std::thread::id, std::string> g_thread_names;
+static thread_local std::string t_thread_name;
 
 static std::tm toLocalTime(std::time_t raw_time) {
 #if defined(_WIN32)
@@ -40,30 +41,216 @@ static std::tm toLocalTime(std::time_t raw_time) {
 #endif
 }
 
+namespace {
+
+// Bounded multi-producer ring of formatted lines (Vyukov's sequence-per-cell
+// queue). push() and pop() are a CAS plus a string move; no locks.
+class LineRing {
+public:
+    LineRing() : cells_(new Cell[kCells]) {
+        for (std::size_t i = 0; i < kCells; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(std::string& line) noexcept {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (kCells - 1)];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.line.swap(line);
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(std::string& line) noexcept {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (kCells - 1)];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    line.swap(cell.line);
+                    cell.seq.store(pos + kCells, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return head_.load(std::memory_order_seq_cst) == tail_.load(std::memory_order_seq_cst);
+    }
+
+private:
+    static constexpr std::size_t kCells = 4096;   // power of two
+    struct Cell {
+        std::atomic<std::size_t> seq{0};
+        std::string line;
+    };
+    std::unique_ptr<Cell[]> cells_;
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+// Owns the ring and the stderr writer thread. Never destroyed, so lines
+// logged from static destructors still have somewhere to go; an atexit
+// hook drains what is queued.
+class AsyncSink {
+public:
+    static AsyncSink& instance() {
+        static AsyncSink* sink = new AsyncSink();
+        return *sink;
+    }
+
+    void write(std::string& line, bool urgent) noexcept {
+        if (urgent || !async_.load(std::memory_order_relaxed)) {
+            writeThrough(line);
+            return;
+        }
+        std::call_once(started_, [this] { start(); });
+        if (!async_.load(std::memory_order_relaxed) || !ring_.push(line)) {
+            writeThrough(line);  // writer unavailable or ring full: never drop
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with run()'s sleeping_ store
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            wake_.notify_one();
+        }
+    }
+
+    void flush() noexcept {
+        std::lock_guard<std::mutex> lock(outMutex_);
+        drainLocked();
+    }
+
+private:
+    AsyncSink() {
+        const char* sync = std::getenv("NRVNA_LOG_SYNC");
+        async_.store(!(sync && std::strcmp(sync, "0") != 0 && *sync), std::memory_order_relaxed);
+    }
+
+    void start() {
+        try {
+            std::thread(&AsyncSink::run, this).detach();
+            std::atexit([] { AsyncSink::instance().flush(); });
+#if defined(__unix__) || defined(__APPLE__)
+            // Drain before fork so the child neither loses nor repeats lines,
+            // and let the child (which has no writer thread) write through
+            pthread_atfork([] { AsyncSink& s = AsyncSink::instance(); s.outMutex_.lock(); s.drainLocked(); },
+                           [] { AsyncSink::instance().outMutex_.unlock(); },
+                           [] {
+                               AsyncSink& s = AsyncSink::instance();
+                               s.async_.store(false, std::memory_order_relaxed);
+                               s.outMutex_.unlock();
+                           });
+#endif
+        } catch (...) {
+            async_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void run() noexcept {
+        for (;;) {
+            flush();
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            sleeping_.store(true, std::memory_order_seq_cst);
+            if (ring_.empty()) {
+                // Timeout only bounds latency if a wakeup is ever missed
+                wake_.wait_for(lock, std::chrono::milliseconds(200));
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void writeThrough(const std::string& line) noexcept {
+        std::lock_guard<std::mutex> lock(outMutex_);
+        drainLocked();  // keep queued lines ahead of this one
+        emit(line);
+    }
+
+    void drainLocked() noexcept {
+        try {
+            batch_.clear();
+            std::string line;
+            while (ring_.pop(line)) {
+                batch_ += line;
+                if (batch_.size() >= 64 * 1024) {
+                    emit(batch_);
+                    batch_.clear();
+                }
+            }
+            if (!batch_.empty()) {
+                emit(batch_);
+            }
+        } catch (...) {}
+    }
+
+    static void emit(const std::string& text) noexcept {
+        // All logs go to stderr - keep stdout pure for UI
+        std::fwrite(text.data(), 1, text.size(), stderr);
+        std::fflush(stderr);
+    }
+
+    LineRing ring_;
+    std::mutex outMutex_;               // serializes drains and write-throughs
+    std::string batch_;                 // guarded by outMutex_
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> async_{true};
+    std::once_flag started_;
+};
+
+const std::string& threadInfo() {
+    if (t_thread_name.empty()) {
+        std::ostringstream oss;
+        oss << "T" << std::this_thread::get_id();
+        t_thread_name = oss.str();
+    }
+    return t_thread_name;
+}
+
+} // namespace
+
 void Logger::setLevel(LogLevel level) noexcept {
-    std::lock_guard<std::mutex> lock(g_log_mutex);
-    g_level = level;
-    g_level_initialized = true;
+    level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
 }
 
 void Logger::initFromEnv() noexcept {
-    std::lock_guard<std::mutex> lock(g_log_mutex);
-    g_level = parseEnvLevel();
-    g_level_initialized = true;
+    level_.store(static_cast<uint8_t>(parseEnvLevel()), std::memory_order_relaxed);
 }
 
 LogLevel Logger::level() noexcept {
-    std::lock_guard<std::mutex> lock(g_log_mutex);
-    if (!g_level_initialized) {
-        g_level = parseEnvLevel();
-        g_level_initialized = true;
+    uint8_t current = level_.load(std::memory_order_relaxed);
+    if (current == kUnset) {
+        // First use: an explicit setLevel() racing with this wins
+        uint8_t expected = kUnset;
+        const auto parsed = static_cast<uint8_t>(parseEnvLevel());
+        current = level_.compare_exchange_strong(expected, parsed) ? parsed : expected;
     }
-    return g_level;
+    return static_cast<LogLevel>(current);
 }
 
 void Logger::log(LogLevel level, const std::string& message) noexcept {
     try {
-        if (static_cast<uint8_t>(level) > static_cast<uint8_t>(Logger::level())) {
+        if (!enabled(level)) {
             return; // Skip if below threshold
         }
 
@@ -72,40 +259,39 @@ void Logger::log(LogLevel level, const std::string& message) noexcept {
         auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
             now.time_since_epoch()) % 1000;
 
-        // Get thread name/ID
-        std::string thread_info;
-        {
-            std::lock_guard<std::mutex> lock(g_log_mutex);
-            auto tid = std::this_thread::get_id();
-            auto it = g_thread_names.find(tid);
-            if (it != g_thread_names.end()) {
-                thread_info = it->second;
-            } else {
-                std::ostringstream oss;
-                oss << "T" << tid;
-                thread_info = oss.str();
-            }
+        // The date part changes once a second; format it once per thread
+        thread_local std::time_t t_last_second = -1;
+        thread_local char t_stamp[32] = {};
+        if (time_t != t_last_second) {
+            const std::tm tm_local = toLocalTime(time_t);
+            std::strftime(t_stamp, sizeof(t_stamp), "%Y-%m-%d %H:%M:%S", &tm_local);
+            t_last_second = time_t;
         }
 
-        const std::tm tm_local = toLocalTime(time_t);
+        const std::string& thread_info = threadInfo();
+        char head[64];
+        const int n = std::snprintf(head, sizeof(head), "[%s.%03d] [%s] [", t_stamp,
+                                    static_cast<int>(ms.count()), levelToString(level));
 
-        std::stringstream ss;
-        ss << "[" << std::put_time(&tm_local, "%Y-%m-%d %H:%M:%S");
-        ss << "." << std::setfill('0') << std::setw(3) << ms.count() << "]";
-        ss << " [" << levelToString(level) << "]";
-        ss << " [" << thread_info << "]";
-        ss << " " << message;
+        std::string line;
+        line.reserve(static_cast<std::size_t>(n) + thread_info.size() + message.size() + 3);
+        line.append(head, static_cast<std::size_t>(std::max(0, n)));
+        line += thread_info;
+        line += "] ";
+        line += message;
+        line += '\n';
 
-        {
-            // All logs go to stderr - keep stdout pure for UI
-            std::lock_guard<std::mutex> lock(g_log_mutex);
-            std::cerr << ss.str() << std::endl;
-        }
+        // Errors precede crashes; write them before returning
+        AsyncSink::instance().write(line, level == LogLevel::ERROR);
     } catch (...) {
         // Never throw from logging - would cause infinite loops
     }
 }
 
+void Logger::flush() noexcept {
+    AsyncSink::instance().flush();
+}
+
 LogLevel Logger::parseEnvLevel() noexcept {
     const char* env_val = std::getenv("NRVNA_LOG_LEVEL");
     if (!env_val) return LogLevel::INFO;
@@ -138,8 +324,7 @@ const char* Logger::levelToString(LogLevel level) noexcept {
 
 // Helper function to name threads for better logging
 void setThreadName(const std::string& name) {
-    std::lock_guard<std::mutex> lock(g_log_mutex);
-    g_thread_names[std::this_thread::get_id()] = name;
+    t_thread_name = name;
 }
 
 std::string getThreadName(int worker_id) {
@@ -0,0 +1,145 @@
+/*
+ * nrvna ai - Memory-budgeted job admission (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "memory_budget.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace nrvnaai {
+
+MemoryBudget::MemoryBudget(std::size_t budgetBytes, int workers, Reclaim reclaim)
+    : budget_(budgetBytes), reclaim_(std::move(reclaim)) {
+    for (int i = 0; i < std::max(1, workers); ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+bool MemoryBudget::fits(int worker, std::size_t bytes) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return fitsLocked(worker, bytes);
+}
+
+bool MemoryBudget::fitsLocked(int worker, std::size_t bytes) const {
+    const Worker& w = *workers_[static_cast<std::size_t>(worker)];
+    const std::size_t others = used_ - w.held;
+    return others + std::max(w.held, bytes) <= budget_;
+}
+
+std::size_t MemoryBudget::used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+}
+
+int MemoryBudget::active() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return active_;
+}
+
+void MemoryBudget::claim(int worker) {
+    if (worker >= 0 && worker < static_cast<int>(workers_.size())) {
+        workers_[static_cast<std::size_t>(worker)]->busy.lock();
+    }
+}
+
+bool MemoryBudget::admit(int worker, std::size_t bytes) {
+    if (worker < 0 || worker >= static_cast<int>(workers_.size())) {
+        return false;
+    }
+    Worker& w = *workers_[static_cast<std::size_t>(worker)];
+
+    bool waited = false;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!fitsLocked(worker, bytes)) {
+        if (reclaimIdleLocked(lock, worker)) {
+            continue;
+        }
+        if (active_ == 0) {
+            LOG_WARN("Job needs " + std::to_string(bytes >> 20) + " MB, over the " +
+                     std::to_string(budget_ >> 20) + " MB memory budget; running it alone");
+            break;
+        }
+        if (!waited) {
+            LOG_DEBUG("Worker-" + std::to_string(worker) + " waiting for memory (" +
+                      std::to_string(bytes >> 20) + " MB, " + std::to_string(active_) + " job(s) running)");
+        }
+        waited = true;
+        // Releases notify; the timeout only covers holders that went idle unseen
+        released_.wait_for(lock, std::chrono::seconds(1));
+    }
+
+    const std::size_t grown = std::max(w.held, bytes);
+    used_ = used_ - w.held + grown;
+    w.held = grown;
+    w.active = true;
+    ++active_;
+    return waited;
+}
+
+bool MemoryBudget::grow(int worker, std::size_t bytes) {
+    if (worker < 0 || worker >= static_cast<int>(workers_.size())) {
+        return false;
+    }
+    Worker& w = *workers_[static_cast<std::size_t>(worker)];
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!fitsLocked(worker, bytes)) {
+        if (!reclaimIdleLocked(lock, worker)) {
+            return false;
+        }
+    }
+    const std::size_t grown = std::max(w.held, bytes);
+    used_ = used_ - w.held + grown;
+    w.held = grown;
+    return true;
+}
+
+void MemoryBudget::release(int worker, std::size_t heldBytes) {
+    if (worker < 0 || worker >= static_cast<int>(workers_.size())) {
+        return;
+    }
+    Worker& w = *workers_[static_cast<std::size_t>(worker)];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (w.active) {
+            w.active = false;
+            --active_;
+        }
+        used_ = used_ - w.held + heldBytes;
+        w.held = heldBytes;
+    }
+    w.busy.unlock();
+    released_.notify_all();
+}
+
+// Drops the warm contexts of one idle worker that holds memory. The busy
+// lock is only tried, so a worker between admit() and release() is skipped,
+// and a reclaimed worker cannot be admitted until its holding is zeroed.
+bool MemoryBudget::reclaimIdleLocked(std::unique_lock<std::mutex>& lock, int worker) {
+    if (!reclaim_) {
+        return false;
+    }
+    for (int v = 0; v < static_cast<int>(workers_.size()); ++v) {
+        Worker& idle = *workers_[static_cast<std::size_t>(v)];
+        if (v == worker || idle.active || idle.held == 0 || !idle.busy.try_lock()) {
+            continue;
+        }
+        lock.unlock();
+        try {
+            reclaim_(v);
+        } catch (...) {}
+        lock.lock();
+        used_ -= idle.held;
+        LOG_DEBUG("Reclaimed " + std::to_string(idle.held >> 20) + " MB of warm contexts from Worker-" +
+                  std::to_string(v));
+        idle.held = 0;
+        idle.busy.unlock();
+        return true;
+    }
+    return false;
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,74 @@
+/*
+ * nrvna ai - Memory-budgeted job admission (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nrvnaai {
+
+// Admission control for worker contexts under NRVNA_MEM_BUDGET_MB.
+//
+// Warm contexts stay allocated between jobs, so the budget tracks what each
+// worker holds, not just what running jobs use. A job is admitted when its
+// worker's holding, grown to the job's estimate, fits next to everyone
+// else's. Otherwise idle workers are made to drop their warm contexts, and
+// failing that the job waits for a running one to finish. With nothing
+// running it is admitted regardless, so one oversized job cannot stall the
+// queue. Each worker holds its own busy lock from claim() to release().
+class MemoryBudget {
+public:
+    // Frees an idle worker's contexts; runs with that worker's busy lock held
+    using Reclaim = std::function<void(int worker)>;
+
+    MemoryBudget(std::size_t budgetBytes, int workers, Reclaim reclaim);
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    // Would `bytes` fit for this worker right now, counting idle holdings?
+    [[nodiscard]] bool fits(int worker, std::size_t bytes) const;
+    // Take the worker's busy lock; call before sizing the job against its
+    // contexts, which reclaim could otherwise free underneath
+    void claim(int worker);
+    // After claim(): blocks until the worker may hold `bytes`; true when it
+    // had to wait
+    bool admit(int worker, std::size_t bytes);
+    // After admit(): raise the worker's holding to `bytes` without waiting,
+    // reclaiming idle workers if needed; false, holding unchanged, when it
+    // does not fit (more work pulled into a running job)
+    bool grow(int worker, std::size_t bytes);
+    // Job done; the worker keeps `heldBytes` of warm contexts
+    void release(int worker, std::size_t heldBytes);
+
+    [[nodiscard]] std::size_t budget() const noexcept { return budget_; }
+    [[nodiscard]] std::size_t used() const;
+    [[nodiscard]] int active() const;
+
+private:
+    struct Worker {
+        std::mutex busy;
+        std::size_t held = 0;
+        bool active = false;
+    };
+
+    [[nodiscard]] bool fitsLocked(int worker, std::size_t bytes) const;
+    bool reclaimIdleLocked(std::unique_lock<std::mutex>& lock, int worker);
+
+    const std::size_t budget_;
+    Reclaim reclaim_;
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::size_t used_ = 0;
+    int active_ = 0;
+};
+
+} // namespace nrvnaai
@@ -5,11 +5,14 @@
  */
 
 #include "nrvna/meta.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
+#include <utility>
 
 namespace nrvnaai {
 
@@ -93,6 +96,29 @@ double extractDouble(const std::string& json, const std::string& key) {
     }
 }
 
+std::optional<int> extractInt(const std::string& json, const std::string& key) {
+    std::string needle = "\"" + key + "\": ";
+    auto pos = json.find(needle);
+    if (pos == std::string::npos) return std::nullopt;
+    pos += needle.size();
+    auto end = json.find_first_of(",\n}", pos);
+    try {
+        return std::stoi(json.substr(pos, end - pos));
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+std::optional<bool> extractBool(const std::string& json, const std::string& key) {
+    std::string needle = "\"" + key + "\": ";
+    auto pos = json.find(needle);
+    if (pos == std::string::npos) return std::nullopt;
+    pos += needle.size();
+    if (json.compare(pos, 4, "true") == 0) return true;
+    if (json.compare(pos, 5, "false") == 0) return false;
+    return std::nullopt;
+}
+
 std::vector<std::string> extractStringArray(const std::string& json, const std::string& key) {
     std::vector<std::string> result;
     std::string needle = "\"" + key + "\": [";
@@ -153,6 +179,21 @@ std::string formatTimestamp() {
     return result;
 }
 
+std::optional<double> parseTimestamp(const std::string& timestamp) {
+    struct tm tm_buf {};
+    long us = 0;
+    if (std::sscanf(timestamp.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d.%6ldZ",
+                    &tm_buf.tm_year, &tm_buf.tm_mon, &tm_buf.tm_mday,
+                    &tm_buf.tm_hour, &tm_buf.tm_min, &tm_buf.tm_sec, &us) != 7) {
+        return std::nullopt;
+    }
+    tm_buf.tm_year -= 1900;
+    tm_buf.tm_mon -= 1;
+    const time_t seconds = timegm(&tm_buf);
+    if (seconds == static_cast<time_t>(-1)) return std::nullopt;
+    return static_cast<double>(seconds) + static_cast<double>(us) / 1e6;
+}
+
 std::string jobTypeToString(JobType type) {
     switch (type) {
         case JobType::Text: return "text";
@@ -163,39 +204,125 @@ std::string jobTypeToString(JobType type) {
     }
 }
 
-bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta) {
-    try {
-        std::ostringstream json;
-        json << "{\n";
-        json << "  \"submitted_at\": \"" << escapeJson(meta.submitted_at) << "\",\n";
-        json << "  \"mode\": \"" << escapeJson(meta.mode) << "\"";
+std::string formatMetaJson(const JobMeta& meta) {
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"submitted_at\": \"" << escapeJson(meta.submitted_at) << "\",\n";
+    json << "  \"mode\": \"" << escapeJson(meta.mode) << "\"";
+
+    if (!meta.parent.empty()) {
+        json << ",\n  \"parent\": \"" << escapeJson(meta.parent) << "\"";
+    }
 
-        if (!meta.parent.empty()) {
-            json << ",\n  \"parent\": \"" << escapeJson(meta.parent) << "\"";
+    if (!meta.tags.empty()) {
+        json << ",\n  \"tags\": [";
+        for (size_t i = 0; i < meta.tags.size(); ++i) {
+            if (i > 0) json << ", ";
+            json << "\"" << escapeJson(meta.tags[i]) << "\"";
         }
+        json << "]";
+    }
 
-        if (!meta.tags.empty()) {
-            json << ",\n  \"tags\": [";
-            for (size_t i = 0; i < meta.tags.size(); ++i) {
-                if (i > 0) json << ", ";
-                json << "\"" << escapeJson(meta.tags[i]) << "\"";
-            }
-            json << "]";
+    if (!meta.image_hashes.empty()) {
+        json << ",\n  \"image_hashes\": [";
+        for (size_t i = 0; i < meta.image_hashes.size(); ++i) {
+            if (i > 0) json << ", ";
+            json << "\"" << escapeJson(meta.image_hashes[i]) << "\"";
         }
+        json << "]";
+    }
 
-        if (!meta.status.empty()) {
-            json << ",\n  \"completed_at\": \"" << escapeJson(meta.completed_at) << "\"";
-            json << ",\n  \"duration_s\": " << std::fixed << std::setprecision(2) << meta.duration_s;
-            json << ",\n  \"artifacts\": [";
-            for (size_t i = 0; i < meta.artifacts.size(); ++i) {
-                if (i > 0) json << ", ";
-                json << "\"" << escapeJson(meta.artifacts[i]) << "\"";
-            }
-            json << "]";
-            json << ",\n  \"status\": \"" << escapeJson(meta.status) << "\"";
+    if (meta.multi_input) {
+        json << ",\n  \"multi_input\": true";
+    }
+
+    if (meta.query) {
+        json << ",\n  \"query\": true";
+    }
+
+    if (meta.priority != 0) {
+        json << ",\n  \"priority\": " << meta.priority;
+    }
+
+    if (!meta.model.empty()) {
+        json << ",\n  \"model\": \"" << escapeJson(meta.model) << "\"";
+    }
+
+    if (meta.think_budget >= 0) {
+        json << ",\n  \"think_budget\": " << meta.think_budget;
+    }
+
+    if (!meta.status.empty()) {
+        json << ",\n  \"completed_at\": \"" << escapeJson(meta.completed_at) << "\"";
+        json << ",\n  \"duration_s\": " << std::fixed << std::setprecision(2) << meta.duration_s;
+        json << ",\n  \"artifacts\": [";
+        for (size_t i = 0; i < meta.artifacts.size(); ++i) {
+            if (i > 0) json << ", ";
+            json << "\"" << escapeJson(meta.artifacts[i]) << "\"";
+        }
+        json << "]";
+        json << ",\n  \"status\": \"" << escapeJson(meta.status) << "\"";
+        if (meta.context_reused) {
+            json << ",\n  \"context_reused\": " << (*meta.context_reused ? "true" : "false");
+        }
+        if (meta.prefix_cached_tokens > 0) {
+            json << ",\n  \"prefix_cached_tokens\": " << meta.prefix_cached_tokens;
+        }
+        if (meta.session_restored_tokens > 0) {
+            json << ",\n  \"session_restored_tokens\": " << meta.session_restored_tokens;
+        }
+        if (meta.embedding_dim > 0) {
+            json << ",\n  \"embedding_dim\": " << meta.embedding_dim;
+            json << ",\n  \"embedding_count\": " << meta.embedding_count;
+        }
+        if (!meta.embedding_dtype.empty()) {
+            json << ",\n  \"embedding_dtype\": \"" << escapeJson(meta.embedding_dtype) << "\"";
+        }
+        if (!meta.embedding_model.empty()) {
+            json << ",\n  \"embedding_model\": \"" << escapeJson(meta.embedding_model) << "\"";
+        }
+        if (meta.cache_hit) {
+            json << ",\n  \"cache_hit\": true";
+        }
+        json << std::setprecision(1);
+        const std::pair<const char*, double> timings[] = {
+            {"queue_wait_ms", meta.queue_wait_ms}, {"setup_ms", meta.setup_ms},
+            {"prompt_eval_ms", meta.prompt_eval_ms}, {"decode_ms", meta.decode_ms},
+            {"ttft_ms", meta.ttft_ms},
+        };
+        for (const auto& [key, ms] : timings) {
+            if (ms >= 0.0) json << ",\n  \"" << key << "\": " << ms;
+        }
+        if (meta.prompt_tokens > 0) {
+            json << ",\n  \"prompt_tokens\": " << meta.prompt_tokens;
         }
+        if (meta.generated_tokens > 0) {
+            json << ",\n  \"generated_tokens\": " << meta.generated_tokens;
+        }
+        if (meta.draft_tokens > 0) {
+            json << ",\n  \"draft_tokens\": " << meta.draft_tokens;
+            json << ",\n  \"draft_accepted\": " << meta.draft_accepted;
+            json << ",\n  \"draft_acceptance\": " << std::setprecision(3)
+                 << static_cast<double>(meta.draft_accepted) / meta.draft_tokens;
+        }
+        if (meta.think_tokens > 0) {
+            json << ",\n  \"think_tokens\": " << meta.think_tokens;
+        }
+        if (meta.think_capped) {
+            json << ",\n  \"think_capped\": true";
+        }
+        if (meta.tokens_per_s >= 0.0) {
+            json << ",\n  \"tokens_per_s\": " << std::setprecision(2) << meta.tokens_per_s;
+        }
+    }
 
-        json << "\n}\n";
+    json << "\n}\n";
+    return json.str();
+}
+
+bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta) {
+    try {
+        const std::string json = formatMetaJson(meta);
 
         auto tmpPath = dir / "meta.json.tmp";
         auto finalPath = dir / "meta.json";
@@ -203,7 +330,7 @@ bool writeMetaJson(const std::filesystem::path& dir, const JobMeta& meta) {
         {
             std::ofstream file(tmpPath, std::ios::binary);
             if (!file) return false;
-            file << json.str();
+            file << json;
             file.flush();
             if (!file.good()) return false;
         }
@@ -225,16 +352,49 @@ std::optional<JobMeta> readMetaJson(const std::filesystem::path& dir) {
 
         std::string content((std::istreambuf_iterator<char>(file)),
                             std::istreambuf_iterator<char>());
+        return parseMetaJson(content);
+    } catch (...) {
+        return std::nullopt;
+    }
+}
 
+std::optional<JobMeta> parseMetaJson(const std::string& content) {
+    try {
         JobMeta meta;
         meta.submitted_at = extractString(content, "submitted_at");
         meta.mode = extractString(content, "mode");
         meta.parent = extractString(content, "parent");
         meta.tags = extractStringArray(content, "tags");
+        meta.image_hashes = extractStringArray(content, "image_hashes");
+        meta.multi_input = extractBool(content, "multi_input").value_or(false);
+        meta.query = extractBool(content, "query").value_or(false);
+        meta.priority = extractInt(content, "priority").value_or(0);
+        meta.model = extractString(content, "model");
+        meta.think_budget = extractInt(content, "think_budget").value_or(-1);
         meta.completed_at = extractString(content, "completed_at");
         meta.duration_s = extractDouble(content, "duration_s");
         meta.artifacts = extractStringArray(content, "artifacts");
         meta.status = extractString(content, "status");
+        meta.context_reused = extractBool(content, "context_reused");
+        meta.prefix_cached_tokens = std::max(0, static_cast<int>(extractDouble(content, "prefix_cached_tokens")));
+        meta.session_restored_tokens = std::max(0, static_cast<int>(extractDouble(content, "session_restored_tokens")));
+        meta.embedding_dim = std::max(0, static_cast<int>(extractDouble(content, "embedding_dim")));
+        meta.embedding_count = std::max(0, static_cast<int>(extractDouble(content, "embedding_count")));
+        meta.embedding_dtype = extractString(content, "embedding_dtype");
+        meta.embedding_model = extractString(content, "embedding_model");
+        meta.cache_hit = extractBool(content, "cache_hit").value_or(false);
+        meta.queue_wait_ms = extractDouble(content, "queue_wait_ms");
+        meta.setup_ms = extractDouble(content, "setup_ms");
+        meta.prompt_eval_ms = extractDouble(content, "prompt_eval_ms");
+        meta.decode_ms = extractDouble(content, "decode_ms");
+        meta.ttft_ms = extractDouble(content, "ttft_ms");
+        meta.prompt_tokens = std::max(0, static_cast<int>(extractDouble(content, "prompt_tokens")));
+        meta.generated_tokens = std::max(0, static_cast<int>(extractDouble(content, "generated_tokens")));
+        meta.tokens_per_s = extractDouble(content, "tokens_per_s");
+        meta.draft_tokens = std::max(0, static_cast<int>(extractDouble(content, "draft_tokens")));
+        meta.draft_accepted = std::max(0, static_cast<int>(extractDouble(content, "draft_accepted")));
+        meta.think_tokens = std::max(0, static_cast<int>(extractDouble(content, "think_tokens")));
+        meta.think_capped = extractBool(content, "think_capped").value_or(false);
 
         return meta;
     } catch (...) {
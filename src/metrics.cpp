@@ -0,0 +1,229 @@
+/*
+ * nrvna ai - Daemon metrics file (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "metrics.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <fstream>
+
+namespace nrvnaai {
+
+namespace {
+
+// Formats straight into `out`, sized by a first vsnprintf pass: label values
+// come from meta.json, and a truncated line would lose its newline
+void appendf(std::string& out, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    va_list again;
+    va_copy(again, args);
+    const int n = std::vsnprintf(nullptr, 0, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        const std::size_t at = out.size();
+        out.resize(at + static_cast<std::size_t>(n) + 1);
+        std::vsnprintf(&out[at], static_cast<std::size_t>(n) + 1, fmt, again);
+        out.resize(at + static_cast<std::size_t>(n));
+    }
+    va_end(again);
+}
+
+void family(std::string& out, const char* name, const char* type, const char* help) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Lanes of the daemon's own model keep their original label set. The value
+// escapes backslash, double quote and newline, as the text format requires
+std::string modelLabel(const LaneStats& lane) {
+    if (lane.model.empty()) return std::string();
+    std::string out = ",model=\"";
+    for (char c : lane.model) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+void Metrics::Histogram::add(double seconds) noexcept {
+    const auto it = std::lower_bound(kBuckets.begin(), kBuckets.end(), seconds);
+    if (it != kBuckets.end()) {
+        ++counts[static_cast<std::size_t>(it - kBuckets.begin())];
+    }
+    ++count;
+    sum += seconds;
+}
+
+Metrics::Metrics(const std::filesystem::path& workspace)
+    : path_(workspace / "metrics"),
+      started_(std::chrono::steady_clock::now()),
+      lastWrite_(started_),
+      lastChange_(started_) {
+}
+
+void Metrics::observe(const JobMeta& meta) noexcept {
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ModeStats& m = modes_[meta.mode.empty() ? "text" : meta.mode];
+        (meta.status == "done" ? m.done : m.failed)++;
+        if (meta.duration_s >= 0.0) m.duration.add(meta.duration_s);
+        if (meta.queue_wait_ms >= 0.0) m.queue_wait.add(meta.queue_wait_ms / 1000.0);
+        if (meta.ttft_ms >= 0.0) m.ttft.add(meta.ttft_ms / 1000.0);
+        m.prompt_tokens += static_cast<std::uint64_t>(meta.prompt_tokens);
+        m.generated_tokens += static_cast<std::uint64_t>(meta.generated_tokens);
+        if (meta.decode_ms > 0.0) m.decode_seconds += meta.decode_ms / 1000.0;
+        m.draft_tokens += static_cast<std::uint64_t>(meta.draft_tokens);
+        m.draft_accepted += static_cast<std::uint64_t>(meta.draft_accepted);
+    } catch (...) {}
+}
+
+void Metrics::accrueLocked(std::chrono::steady_clock::time_point now) noexcept {
+    busySeconds_ += busyWorkers_ * std::chrono::duration<double>(now - lastChange_).count();
+    lastChange_ = now;
+}
+
+void Metrics::workerStarted() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    accrueLocked(std::chrono::steady_clock::now());
+    ++busyWorkers_;
+}
+
+void Metrics::workerFinished() noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    accrueLocked(std::chrono::steady_clock::now());
+    busyWorkers_ = std::max(0, busyWorkers_ - 1);
+}
+
+void Metrics::formatHistogram(std::string& out, const char* name, const std::string& mode, const Histogram& h) {
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < kBuckets.size(); ++i) {
+        cumulative += h.counts[i];
+        appendf(out, "%s_bucket{mode=\"%s\",le=\"%g\"} %llu\n", name, mode.c_str(), kBuckets[i],
+                static_cast<unsigned long long>(cumulative));
+    }
+    appendf(out, "%s_bucket{mode=\"%s\",le=\"+Inf\"} %llu\n", name, mode.c_str(),
+            static_cast<unsigned long long>(h.count));
+    appendf(out, "%s_sum{mode=\"%s\"} %.6f\n", name, mode.c_str(), h.sum);
+    appendf(out, "%s_count{mode=\"%s\"} %llu\n", name, mode.c_str(), static_cast<unsigned long long>(h.count));
+}
+
+bool Metrics::write(const std::vector<LaneStats>& lanes, int workers) noexcept {
+    try {
+        std::string out;
+        out.reserve(8192);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto now = std::chrono::steady_clock::now();
+            accrueLocked(now);
+
+            family(out, "nrvna_jobs_total", "counter", "Finished jobs by mode and status.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_jobs_total{mode=\"%s\",status=\"done\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.done));
+                appendf(out, "nrvna_jobs_total{mode=\"%s\",status=\"failed\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.failed));
+            }
+
+            struct HistogramFamily {
+                const char* name;
+                const char* help;
+                Histogram ModeStats::*field;
+            };
+            const HistogramFamily histograms[] = {
+                {"nrvna_job_duration_seconds", "Claim to completion.", &ModeStats::duration},
+                {"nrvna_job_queue_wait_seconds", "Submission to claim.", &ModeStats::queue_wait},
+                {"nrvna_job_ttft_seconds", "Runner start to first generated token.", &ModeStats::ttft},
+            };
+            for (const auto& h : histograms) {
+                family(out, h.name, "histogram", h.help);
+                for (const auto& [mode, m] : modes_) {
+                    formatHistogram(out, h.name, mode, m.*h.field);
+                }
+            }
+
+            family(out, "nrvna_prompt_tokens_total", "counter", "Prompt tokens evaluated.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_prompt_tokens_total{mode=\"%s\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.prompt_tokens));
+            }
+            family(out, "nrvna_generated_tokens_total", "counter", "Tokens generated.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_generated_tokens_total{mode=\"%s\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.generated_tokens));
+            }
+            family(out, "nrvna_decode_seconds_total", "counter",
+                   "Time spent generating; generated_tokens_total / this = tokens per second.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_decode_seconds_total{mode=\"%s\"} %.6f\n", mode.c_str(), m.decode_seconds);
+            }
+
+            family(out, "nrvna_draft_tokens_total", "counter", "Tokens proposed by the speculative draft model.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_draft_tokens_total{mode=\"%s\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.draft_tokens));
+            }
+            family(out, "nrvna_draft_accepted_total", "counter", "Draft tokens the target model accepted.");
+            for (const auto& [mode, m] : modes_) {
+                appendf(out, "nrvna_draft_accepted_total{mode=\"%s\"} %llu\n", mode.c_str(),
+                        static_cast<unsigned long long>(m.draft_accepted));
+            }
+
+            const double uptime = std::chrono::duration<double>(now - started_).count();
+            const double interval = std::chrono::duration<double>(now - lastWrite_).count();
+            const double ratio = interval > 0.0 && workers > 0
+                ? (busySeconds_ - busyAtLastWrite_) / (interval * workers) : 0.0;
+            lastWrite_ = now;
+            busyAtLastWrite_ = busySeconds_;
+
+            family(out, "nrvna_workers", "gauge", "Worker threads.");
+            appendf(out, "nrvna_workers %d\n", workers);
+            family(out, "nrvna_workers_busy", "gauge", "Workers inside a job right now.");
+            appendf(out, "nrvna_workers_busy %d\n", busyWorkers_);
+            family(out, "nrvna_worker_busy_seconds_total", "counter", "Summed worker time spent on jobs.");
+            appendf(out, "nrvna_worker_busy_seconds_total %.3f\n", busySeconds_);
+            family(out, "nrvna_worker_busy_ratio", "gauge", "Busy fraction of all workers since the previous write.");
+            appendf(out, "nrvna_worker_busy_ratio %.4f\n", std::clamp(ratio, 0.0, 1.0));
+            family(out, "nrvna_uptime_seconds", "gauge", "Seconds since the daemon started.");
+            appendf(out, "nrvna_uptime_seconds %.0f\n", uptime);
+        }
+
+        family(out, "nrvna_queue_depth", "gauge", "Jobs waiting in the pool by lane.");
+        for (const auto& lane : lanes) {
+            appendf(out, "nrvna_queue_depth{mode=\"%s\",priority=\"%d\"%s} %zu\n",
+                    jobTypeToString(lane.type).c_str(), lane.priority, modelLabel(lane).c_str(), lane.queued);
+        }
+        family(out, "nrvna_lane_wait_seconds", "gauge", "Moving average of queue wait at dequeue by lane.");
+        for (const auto& lane : lanes) {
+            appendf(out, "nrvna_lane_wait_seconds{mode=\"%s\",priority=\"%d\"%s} %.3f\n",
+                    jobTypeToString(lane.type).c_str(), lane.priority, modelLabel(lane).c_str(),
+                    lane.wait_ms / 1000.0);
+        }
+
+        auto tempPath = path_;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file) return false;
+            file << out;
+            file.flush();
+            if (!file.good()) return false;
+        }
+        std::filesystem::rename(tempPath, path_);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to write metrics: " + std::string(e.what()));
+        return false;
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,82 @@
+/*
+ * nrvna ai - Daemon metrics file (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/meta.hpp"
+#include "nrvna/pool.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+// Aggregates finished jobs and worker activity, and writes them as
+// Prometheus text exposition to <workspace>/metrics (tmp + rename), so a
+// node exporter textfile collector or a plain cat can scrape it without the
+// daemon opening a port. Counters are cumulative since daemon start.
+class Metrics {
+public:
+    explicit Metrics(const std::filesystem::path& workspace);
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // One finished job, from its completed meta.json
+    void observe(const JobMeta& meta) noexcept;
+
+    // Bracket every Processor::process() call
+    void workerStarted() noexcept;
+    void workerFinished() noexcept;
+
+    [[nodiscard]] bool write(const std::vector<LaneStats>& lanes, int workers) noexcept;
+
+private:
+    // Upper bounds in seconds, shared by every latency histogram
+    static constexpr std::array<double, 14> kBuckets = {
+        0.01, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600};
+
+    struct Histogram {
+        std::array<std::uint64_t, kBuckets.size()> counts{};   // non-cumulative
+        std::uint64_t count = 0;
+        double sum = 0.0;
+        void add(double seconds) noexcept;
+    };
+
+    struct ModeStats {
+        std::uint64_t done = 0;
+        std::uint64_t failed = 0;
+        std::uint64_t prompt_tokens = 0;
+        std::uint64_t generated_tokens = 0;
+        double decode_seconds = 0.0;
+        std::uint64_t draft_tokens = 0;
+        std::uint64_t draft_accepted = 0;
+        Histogram duration;
+        Histogram queue_wait;
+        Histogram ttft;
+    };
+
+    std::filesystem::path path_;
+    std::mutex mutex_;
+    std::map<std::string, ModeStats> modes_;
+    std::chrono::steady_clock::time_point started_;
+    std::chrono::steady_clock::time_point lastWrite_;
+    std::chrono::steady_clock::time_point lastChange_;
+    double busySeconds_ = 0.0;          // integral of busy workers over time
+    double busyAtLastWrite_ = 0.0;
+    int busyWorkers_ = 0;
+
+    void accrueLocked(std::chrono::steady_clock::time_point now) noexcept;
+    static void formatHistogram(std::string& out, const char* name, const std::string& mode, const Histogram& h);
+};
+
+} // namespace nrvnaai
@@ -0,0 +1,217 @@
+/*
+ * nrvna ai - Resident model registry (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "model_registry.hpp"
+#include "nrvna/logger.hpp"
+#include "llama_util.hpp"
+#include "chat.h"
+#include "llama.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace nrvnaai {
+
+namespace {
+
+llama_model_params modelParams() {
+    llama_model_params params = llama_model_default_params();
+    #if defined(__APPLE__)
+        params.n_gpu_layers = env_int("NRVNA_GPU_LAYERS", 99);
+    #else
+        params.n_gpu_layers = env_int("NRVNA_GPU_LAYERS", 0);
+    #endif
+    if (params.n_gpu_layers <= 0) {
+        restrictModelToCpu(params);
+    }
+    // Read every weight in at load and keep it resident (needs RLIMIT_MEMLOCK)
+    params.use_mlock = env_int("NRVNA_MLOCK", 0) != 0;
+    return params;
+}
+
+// Log only when the model provides a value
+SamplingDefaults resolveSamplingDefaults(const llama_model* model) {
+    SamplingDefaults d;
+    auto resolveFloat = [&](const char* key, float& out) {
+        float v = readModelFloatMeta(model, key, -1.0f);
+        if (v >= 0.0f) {
+            LOG_INFO(std::string("Model sampling hint: ") + key + "=" + std::to_string(v));
+            out = v;
+        }
+    };
+    auto resolveInt = [&](const char* key, int& out) {
+        int v = readModelIntMeta(model, key, -1);
+        if (v >= 0) {
+            LOG_INFO(std::string("Model sampling hint: ") + key + "=" + std::to_string(v));
+            out = v;
+        }
+    };
+    resolveFloat("general.sampling.temp",           d.temp);
+    resolveInt  ("general.sampling.top_k",          d.top_k);
+    resolveFloat("general.sampling.top_p",          d.top_p);
+    resolveFloat("general.sampling.min_p",          d.min_p);
+    resolveFloat("general.sampling.penalty_repeat", d.repeat_penalty);
+    resolveInt  ("general.sampling.penalty_last_n", d.repeat_last_n);
+    return d;
+}
+
+} // namespace
+
+LoadedModel::~LoadedModel() {
+    if (templates) {
+        common_chat_templates_free(templates);
+    }
+}
+
+ModelRegistry& sharedModelRegistry() {
+    static ModelRegistry registry;
+    return registry;
+}
+
+ModelRegistry::ModelRegistry() {
+    budget_ = static_cast<std::size_t>(std::max(0, env_int("NRVNA_MODEL_BUDGET_MB", 0))) * 1024 * 1024;
+    if (const char* draft = std::getenv("NRVNA_DRAFT_MODEL")) {
+        draftPath_ = draft;
+    }
+}
+
+std::shared_ptr<const LoadedModel> ModelRegistry::acquire(const std::string& path, bool pin) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        auto it = slots_.find(path);
+        if (it == slots_.end()) {
+            break;
+        }
+        if (!it->second.loading) {
+            Slot& slot = it->second;
+            slot.pinned = slot.pinned || pin;
+            lru_.splice(lru_.begin(), lru_, slot.lru);
+            std::shared_ptr<const LoadedModel> model = slot.model;
+            // Models released since the last load may be over budget now
+            evictLocked();
+            return model;
+        }
+        loaded_.wait(lock);
+    }
+
+    // First acquire of this path: load outside the lock so other models
+    // stay available, and let concurrent acquirers wait for this one
+    lru_.push_front(path);
+    slots_[path] = Slot{nullptr, true, pin, lru_.begin()};
+    lock.unlock();
+
+    std::shared_ptr<const LoadedModel> model = load(path);
+
+    lock.lock();
+    auto it = slots_.find(path);
+    if (!model) {
+        lru_.erase(it->second.lru);
+        slots_.erase(it);
+        loaded_.notify_all();
+        return nullptr;
+    }
+    it->second.model = model;
+    it->second.loading = false;
+    bytes_ += model->bytes;
+    evictLocked();
+    loaded_.notify_all();
+    return model;
+}
+
+bool ModelRegistry::resident(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = slots_.find(path);
+    return it != slots_.end() && it->second.model != nullptr;
+}
+
+void ModelRegistry::evictLocked() {
+    if (budget_ == 0) {
+        return;
+    }
+    // Oldest first; the most recent model is kept even when it alone is over budget
+    auto it = lru_.end();
+    while (bytes_ > budget_ && it != lru_.begin()) {
+        --it;
+        if (it == lru_.begin()) {
+            break;
+        }
+        auto slot = slots_.find(*it);
+        // use_count() == 1: only the registry holds it; a busy model keeps
+        // its weights resident whatever happens here, so it stays counted
+        if (slot == slots_.end() || slot->second.pinned || slot->second.loading ||
+            slot->second.model.use_count() > 1) {
+            continue;
+        }
+        LOG_INFO("Evicting model: " + *it);
+        bytes_ -= slot->second.model->bytes;
+        slots_.erase(slot);
+        it = lru_.erase(it);
+    }
+}
+
+std::shared_ptr<const LoadedModel> ModelRegistry::load(const std::string& path) {
+    try {
+        LOG_INFO("Loading model: " + path);
+        llama_model* raw = llama_model_load_from_file(path.c_str(), modelParams());
+        if (!raw) {
+            LOG_ERROR("Failed to load model: " + path);
+            return nullptr;
+        }
+
+        auto loaded = std::make_shared<LoadedModel>();
+        loaded->path = path;
+        loaded->model = std::shared_ptr<llama_model>(raw, llama_model_free);
+        loaded->bytes = static_cast<std::size_t>(llama_model_size(raw));
+        loaded->defaults = resolveSamplingDefaults(raw);
+
+        // Initialize chat templates (auto-detects Jinja vs legacy)
+        loaded->templates = common_chat_templates_init(raw, "", "", "").release();
+        loaded->draft = draftFor(raw);
+
+        LOG_INFO("Model loaded successfully");
+        return loaded;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to load model: " + path + " - " + e.what());
+        return nullptr;
+    }
+}
+
+std::shared_ptr<llama_model> ModelRegistry::draftFor(const llama_model* target) {
+    if (draftPath_.empty()) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(draftMutex_);
+    if (!draftTried_) {
+        draftTried_ = true;
+        LOG_INFO("Loading draft model: " + draftPath_);
+        llama_model* draft = llama_model_load_from_file(draftPath_.c_str(), modelParams());
+        if (!draft) {
+            LOG_WARN("Failed to load draft model: " + draftPath_ + " - speculative decoding disabled");
+            return nullptr;
+        }
+        draft_ = std::shared_ptr<llama_model>(draft, llama_model_free);
+    }
+    if (!draft_) {
+        return nullptr;
+    }
+
+    // Draft tokens are verified by id, so both models must tokenize alike.
+    // Same rule as llama.cpp's speculative examples: same vocab type and
+    // special tokens, sizes within 128 (extra added tokens are never drafted).
+    const llama_vocab* vt = llama_model_get_vocab(target);
+    const llama_vocab* vd = llama_model_get_vocab(draft_.get());
+    const int size_diff = std::abs(llama_vocab_n_tokens(vt) - llama_vocab_n_tokens(vd));
+    if (llama_vocab_type(vt) != llama_vocab_type(vd) || llama_vocab_bos(vt) != llama_vocab_bos(vd) ||
+        llama_vocab_eos(vt) != llama_vocab_eos(vd) || size_diff > 128) {
+        LOG_WARN("Draft model vocabulary does not match the target - speculative decoding disabled");
+        return nullptr;
+    }
+
+    LOG_INFO("Speculative decoding enabled, draft up to " +
+             std::to_string(std::max(1, env_int("NRVNA_DRAFT_MAX", 8))) + " tokens");
+    return draft_;
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,91 @@
+/*
+ * nrvna ai - Resident model registry (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct llama_model;
+struct common_chat_templates;
+
+namespace nrvnaai {
+
+// GGUF general.sampling.* hints, or the hardcoded defaults when absent
+struct SamplingDefaults {
+    float temp = 0.8f;
+    int top_k = 40;
+    float top_p = 0.9f;
+    float min_p = 0.05f;
+    float repeat_penalty = 1.1f;
+    int repeat_last_n = 64;
+};
+
+// One loaded GGUF and everything derived from it once per load
+struct LoadedModel {
+    std::string path;
+    std::shared_ptr<llama_model> model;
+    std::shared_ptr<llama_model> draft;         // compatible NRVNA_DRAFT_MODEL, or null
+    common_chat_templates* templates = nullptr; // owned
+    SamplingDefaults defaults;
+    std::size_t bytes = 0;                      // llama_model_size()
+
+    LoadedModel() = default;
+    ~LoadedModel();
+    LoadedModel(const LoadedModel&) = delete;
+    LoadedModel& operator=(const LoadedModel&) = delete;
+};
+
+// Process-wide set of loaded models, keyed by path. Models are loaded on
+// first acquire() (mmap'd as llama.cpp does by default) and kept resident
+// under NRVNA_MODEL_BUDGET_MB, least recently used evicted first; the
+// daemon's own model is pinned. Only models no Runner holds are evicted: a
+// held model stays in its slot and in the budget, so the next acquire reuses
+// it instead of loading a second copy, and it goes on a later pass once its
+// last holder switches. Concurrent acquires of one path share a single load.
+class ModelRegistry {
+public:
+    ModelRegistry();
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    // Null when the file cannot be loaded
+    [[nodiscard]] std::shared_ptr<const LoadedModel> acquire(const std::string& path, bool pin = false);
+    [[nodiscard]] bool resident(const std::string& path) const;
+
+private:
+    struct Slot {
+        std::shared_ptr<const LoadedModel> model;
+        bool loading = false;
+        bool pinned = false;
+        std::list<std::string>::iterator lru;
+    };
+
+    std::shared_ptr<const LoadedModel> load(const std::string& path);
+    std::shared_ptr<llama_model> draftFor(const llama_model* target);
+    void evictLocked();
+
+    mutable std::mutex mutex_;
+    std::condition_variable loaded_;
+    std::size_t budget_ = 0;                    // 0 = unlimited
+    std::size_t bytes_ = 0;
+    std::unordered_map<std::string, Slot> slots_;
+    std::list<std::string> lru_;                // front = most recent
+
+    std::mutex draftMutex_;
+    std::shared_ptr<llama_model> draft_;        // loaded once, shared by compatible targets
+    std::string draftPath_;                     // NRVNA_DRAFT_MODEL, empty = none
+    bool draftTried_ = false;
+};
+
+ModelRegistry& sharedModelRegistry();
+
+} // namespace nrvnaai
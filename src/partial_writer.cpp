@@ -0,0 +1,67 @@
+/*
+ * nrvna ai - Streaming result.partial writer (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "partial_writer.hpp"
+#include "nrvna/logger.hpp"
+#include "llama_util.hpp"
+#include <algorithm>
+
+namespace nrvnaai {
+
+bool PartialWriter::open(const std::filesystem::path& path) noexcept {
+    try {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) {
+            LOG_WARN("Streaming disabled, cannot open " + path.string());
+            file_.close();
+            return false;
+        }
+        everyTokens_ = std::max(1, env_int("NRVNA_STREAM_TOKENS", 16));
+        everyMs_ = std::chrono::milliseconds(std::max(0, env_int("NRVNA_STREAM_MS", 200)));
+        lastFlush_ = std::chrono::steady_clock::now();
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+void PartialWriter::append(const char* data, std::size_t n) noexcept {
+    if (!file_.is_open()) {
+        return;
+    }
+    try {
+        buffer_.append(data, n);
+        if (++pending_ >= everyTokens_ ||
+            std::chrono::steady_clock::now() - lastFlush_ >= everyMs_) {
+            flush();
+        }
+    } catch (...) {
+        file_.close();
+    }
+}
+
+void PartialWriter::flush() noexcept {
+    if (!file_.is_open()) {
+        return;
+    }
+    try {
+        if (!buffer_.empty()) {
+            file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            file_.flush();
+            buffer_.clear();
+        }
+        pending_ = 0;
+        lastFlush_ = std::chrono::steady_clock::now();
+        if (!file_.good()) {
+            LOG_WARN("Streaming write failed, disabling result.partial for this job");
+            file_.close();
+        }
+    } catch (...) {
+        file_.close();
+    }
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,44 @@
+/*
+ * nrvna ai - Streaming result.partial writer (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace nrvnaai {
+
+// Appends detokenized pieces to processing/<id>/result.partial so clients can
+// tail a running job. Pieces are buffered and flushed every
+// NRVNA_STREAM_TOKENS tokens or NRVNA_STREAM_MS milliseconds, whichever comes
+// first. The stream carries only the answer as ThinkFilter routes it, so it
+// is a prefix of result.txt. A write failure disables the stream, never the job.
+class PartialWriter {
+public:
+    PartialWriter() = default;
+    ~PartialWriter() { flush(); }
+
+    PartialWriter(const PartialWriter&) = delete;
+    PartialWriter& operator=(const PartialWriter&) = delete;
+
+    bool open(const std::filesystem::path& path) noexcept;
+    [[nodiscard]] bool isOpen() const noexcept { return file_.is_open(); }
+
+    void append(const char* data, std::size_t n) noexcept;
+    void flush() noexcept;
+
+private:
+    std::ofstream file_;
+    std::string buffer_;
+    int pending_ = 0;
+    int everyTokens_ = 16;
+    std::chrono::milliseconds everyMs_{200};
+    std::chrono::steady_clock::time_point lastFlush_;
+};
+
+} // namespace nrvnaai
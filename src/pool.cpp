@@ -6,11 +6,31 @@
 
 #include "nrvna/pool.hpp"
 #include "nrvna/logger.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 
 namespace nrvnaai {
 
-Pool::Pool(int workers) noexcept : workers_(workers) {
+namespace {
+
+// Expected service time per job type before any job of that type finished
+// (indexed by JobType: text, embed, vision, tts)
+constexpr std::array<double, 4> kServicePriorMs = {30000.0, 200.0, 30000.0, 20000.0};
+constexpr double kEwmaAlpha = 0.2;
+constexpr auto kLaneIdle = std::chrono::minutes(30);
+
+std::size_t typeIndex(JobType type) noexcept {
+    return std::min<std::size_t>(static_cast<std::size_t>(type), kServicePriorMs.size() - 1);
+}
+
+double ewma(double current, double sample, std::size_t samples) noexcept {
+    return samples == 0 ? sample : current + kEwmaAlpha * (sample - current);
+}
+
+} // namespace
+
+Pool::Pool(int workers) noexcept : workers_(workers), serviceEwmaMs_(kServicePriorMs) {
     LOG_DEBUG("Pool created with " + std::to_string(workers) + " workers");
 }
 
@@ -81,9 +101,8 @@ void Pool::stop() noexcept {
     // Clear remaining jobs
     {
         std::lock_guard<std::mutex> lock(queueMutex_);
-        while (!jobQueue_.empty()) {
-            jobQueue_.pop();
-        }
+        lanes_.clear();
+        queued_ = 0;
         enqueuedJobs_.clear();
     }
     
@@ -97,6 +116,10 @@ bool Pool::submit(const JobId& jobId) noexcept {
     }
 
     try {
+        // Classify outside the lock: the classifier reads the job's files
+        JobTraits traits = classifier_ ? classifier_(jobId) : JobTraits{};
+        traits.priority = std::clamp(traits.priority, -kMaxPriority, kMaxPriority);
+
         std::lock_guard<std::mutex> lock(queueMutex_);
         
         // Check if job is already in the queue to prevent duplicates
@@ -105,7 +128,10 @@ bool Pool::submit(const JobId& jobId) noexcept {
             return false;
         }
         
-        jobQueue_.push(jobId);
+        Lane& lane = laneFor(traits);
+        lane.jobs.push_back({jobId, Clock::now()});
+        lane.lastUsed = lane.jobs.back().enqueued;
+        ++queued_;
         enqueuedJobs_.insert(jobId);
         
         jobAvailable_.notify_one();
@@ -117,15 +143,113 @@ bool Pool::submit(const JobId& jobId) noexcept {
     }
 }
 
+std::vector<JobId> Pool::take(std::size_t max, const JobFilter& filter) noexcept {
+    // Bounded scan: the filter may touch the filesystem and runs under the lock
+    constexpr std::size_t kMaxScan = 256;
+
+    std::vector<JobId> taken;
+    if (max == 0 || !filter) {
+        return taken;
+    }
+
+    try {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        std::size_t scanned = 0;
+        const auto now = Clock::now();
+        for (auto& lane : lanes_) {
+            auto& jobs = lane.jobs;
+            for (auto it = jobs.begin(); it != jobs.end() && taken.size() < max && scanned < kMaxScan; ++scanned) {
+                if (filter(it->id)) {
+                    taken.push_back(it->id);
+                    enqueuedJobs_.erase(it->id);
+                    it = jobs.erase(it);
+                    --queued_;
+                    lane.lastUsed = now;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    } catch (...) {
+        LOG_ERROR("Failed to take jobs from queue");
+    }
+    return taken;
+}
+
 std::size_t Pool::queueSize() const noexcept {
     try {
         std::lock_guard<std::mutex> lock(queueMutex_);
-        return jobQueue_.size();
+        return queued_;
     } catch (...) {
         return 0;
     }
 }
 
+std::vector<LaneStats> Pool::laneStats() const {
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    std::vector<LaneStats> stats;
+    stats.reserve(lanes_.size());
+    for (const auto& lane : lanes_) {
+        LaneStats st;
+        st.type = lane.traits.type;
+        st.priority = lane.traits.priority;
+        st.model = lane.traits.model;
+        st.queued = lane.jobs.size();
+        st.served = lane.served;
+        st.wait_ms = lane.waitEwmaMs;
+        st.service_ms = serviceEwmaMs_[typeIndex(lane.traits.type)];
+        stats.push_back(st);
+    }
+    return stats;
+}
+
+Pool::Lane& Pool::laneFor(const JobTraits& traits) {
+    for (auto& lane : lanes_) {
+        if (lane.traits.type == traits.type && lane.traits.priority == traits.priority &&
+            lane.traits.model == traits.model) {
+            return lane;
+        }
+    }
+    lanes_.push_back(Lane{traits, {}, 0, 0.0, Clock::now()});
+    return lanes_.back();
+}
+
+// Response ratio = (wait + expected) / expected, doubled per priority level
+// and halved while the lane's model is not loaded. Short job types win while
+// their wait is comparable to their service time, and every waiting job's
+// ratio keeps growing, so no lane starves.
+Pool::Lane* Pool::pickLaneLocked(Clock::time_point now) {
+    Lane* best = nullptr;
+    double bestScore = 0.0;
+    for (auto& lane : lanes_) {
+        if (lane.jobs.empty()) continue;
+        const auto& head = lane.jobs.front();
+        const double expected = std::max(1.0, serviceEwmaMs_[typeIndex(lane.traits.type)]);
+        const double waited = std::chrono::duration<double, std::milli>(now - head.enqueued).count();
+        const bool cold = !lane.traits.model.empty() && warmth_ && !warmth_(lane.traits.model);
+        const double score = std::ldexp((waited + expected) / expected, lane.traits.priority - (cold ? 1 : 0));
+        if (!best || score > bestScore ||
+            (score == bestScore && head.enqueued < best->jobs.front().enqueued)) {
+            best = &lane;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+void Pool::pruneIdleLanesLocked(Clock::time_point now) {
+    lanes_.erase(std::remove_if(lanes_.begin(), lanes_.end(), [now](const Lane& lane) {
+        return lane.jobs.empty() && now - lane.lastUsed > kLaneIdle;
+    }), lanes_.end());
+}
+
+// Priors are rough guesses; the EWMA pulls them toward what this
+// machine and model actually deliver within a handful of jobs
+void Pool::recordServiceLocked(JobType type, double ms) {
+    auto& current = serviceEwmaMs_[typeIndex(type)];
+    current += kEwmaAlpha * (ms - current);
+}
+
 bool Pool::isJobInQueue(const JobId& jobId) const {
     return enqueuedJobs_.find(jobId) != enqueuedJobs_.end();
 }
@@ -136,8 +260,12 @@ void Pool::workerLoop(int workerId) {
     LOG_DEBUG("Worker-" + std::to_string(workerId) + " thread started");
     
     try {
+        if (workerInit_) {
+            workerInit_(workerId);
+        }
         while (!shutdown_.load()) {
             JobId jobId;
+            JobType type = JobType::Text;
             
             // Get next job
             {
@@ -145,20 +273,30 @@ void Pool::workerLoop(int workerId) {
                 
                 // Wait for job or shutdown signal
                 jobAvailable_.wait(lock, [this] { 
-                    return !jobQueue_.empty() || shutdown_.load(); 
+                    return queued_ > 0 || shutdown_.load(); 
                 });
                 
                 if (shutdown_.load()) {
                     break;
                 }
                 
-                if (jobQueue_.empty()) {
+                const auto now = Clock::now();
+                Lane* lane = pickLaneLocked(now);
+                if (!lane) {
                     continue;
                 }
                 
-                jobId = jobQueue_.front();
-                jobQueue_.pop();
-                enqueuedJobs_.erase(jobId);
+                Queued next = std::move(lane->jobs.front());
+                lane->jobs.pop_front();
+                --queued_;
+                enqueuedJobs_.erase(next.id);
+                const double waited = std::chrono::duration<double, std::milli>(now - next.enqueued).count();
+                lane->waitEwmaMs = ewma(lane->waitEwmaMs, waited, lane->served);
+                ++lane->served;
+                jobId = std::move(next.id);
+                type = lane->traits.type;
+                lane->lastUsed = now;
+                pruneIdleLanesLocked(now);
             }
             
             // Process job outside of lock
@@ -166,7 +304,12 @@ void Pool::workerLoop(int workerId) {
                 LOG_INFO("Worker-" + std::to_string(workerId) + " claimed job: " + jobId);
                 
                 try {
-                    processor_(jobId, workerId);
+                    const auto started = Clock::now();
+                    if (processor_(jobId, workerId)) {
+                        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+                        std::lock_guard<std::mutex> lock(queueMutex_);
+                        recordServiceLocked(type, ms);
+                    }
                 } catch (const std::exception& e) {
                     LOG_ERROR("Worker " + std::to_string(workerId) + " job processing error: " + 
                              std::string(e.what()) + " (job: " + jobId + ")");
@@ -0,0 +1,149 @@
+/*
+ * nrvna ai - Shared prompt-prefix KV cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "prefix_cache.hpp"
+#include "hash.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+
+namespace nrvnaai {
+
+namespace {
+// Cap on distinct boundaries tracked for the "seen twice" rule
+constexpr std::size_t kMaxSeen = 65536;
+}
+
+PrefixCache& sharedPrefixCache() {
+    static PrefixCache cache;
+    return cache;
+}
+
+void PrefixCache::configure(std::size_t budgetBytes, int blockTokens, uint64_t modelKey) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (modelKey != modelKey_) {
+        entries_.clear();
+        lru_.clear();
+        seen_.clear();
+        bytes_ = 0;
+        modelKey_ = modelKey;
+    }
+    budget_ = budgetBytes;
+    block_ = std::max(16, blockTokens);
+    evictLocked(0);
+}
+
+bool PrefixCache::enabled() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_ > 0;
+}
+
+std::size_t PrefixCache::bytes() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+}
+
+std::vector<uint64_t> PrefixCache::boundaryHashes(const std::vector<int32_t>& tokens) const {
+    // hashes[k] covers tokens[0, (k+1)*block); only boundaries that leave at
+    // least one token to prefill are produced.
+    std::vector<uint64_t> hashes;
+    uint64_t h = fnv1a(&modelKey_, sizeof(modelKey_));
+    for (std::size_t end = block_; end < tokens.size(); end += block_) {
+        h = fnv1a(tokens.data() + end - block_, block_ * sizeof(int32_t), h);
+        hashes.push_back(h);
+    }
+    return hashes;
+}
+
+PrefixCache::Hit PrefixCache::lookup(const std::vector<int32_t>& tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_ == 0 || entries_.empty()) {
+        return {};
+    }
+
+    auto hashes = boundaryHashes(tokens);
+    for (std::size_t k = hashes.size(); k-- > 0;) {
+        auto it = entries_.find(hashes[k]);
+        if (it == entries_.end()) {
+            continue;
+        }
+        const std::size_t n = (k + 1) * block_;
+        if (it->second.tokens.size() != n ||
+            !std::equal(it->second.tokens.begin(), it->second.tokens.end(), tokens.begin())) {
+            continue;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        return {static_cast<int>(n), it->second.state};
+    }
+    return {};
+}
+
+int PrefixCache::observe(const std::vector<int32_t>& tokens, int n_cached) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_ == 0) {
+        return 0;
+    }
+
+    if (seen_.size() > kMaxSeen) {
+        seen_.clear();
+    }
+
+    int best = 0;
+    auto hashes = boundaryHashes(tokens);
+    for (std::size_t k = 0; k < hashes.size(); ++k) {
+        const int n = static_cast<int>((k + 1) * block_);
+        uint32_t& count = seen_[hashes[k]];
+        if (count < UINT32_MAX) {
+            ++count;
+        }
+        if (n > n_cached && count >= 2 && entries_.find(hashes[k]) == entries_.end()) {
+            best = n;
+        }
+    }
+    return best;
+}
+
+void PrefixCache::insert(const std::vector<int32_t>& tokens, int n_tokens, std::vector<uint8_t> state) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (budget_ == 0 || n_tokens <= 0 || n_tokens % block_ != 0 ||
+        static_cast<std::size_t>(n_tokens) >= tokens.size() || state.size() > budget_) {
+        return;
+    }
+
+    std::vector<int32_t> prefix(tokens.begin(), tokens.begin() + n_tokens);
+    auto hashes = boundaryHashes(tokens);
+    const uint64_t key = hashes[n_tokens / block_ - 1];
+    if (entries_.count(key)) {
+        return;  // another worker stored it first
+    }
+
+    const std::size_t size = state.size();
+    evictLocked(size);
+
+    lru_.push_front(key);
+    Entry entry;
+    entry.tokens = std::move(prefix);
+    entry.state = std::make_shared<const std::vector<uint8_t>>(std::move(state));
+    entry.lru = lru_.begin();
+    entries_.emplace(key, std::move(entry));
+    bytes_ += size;
+
+    LOG_DEBUG("Prefix cache: stored " + std::to_string(n_tokens) + " tokens (" +
+              std::to_string(size / (1024 * 1024)) + " MB, total " +
+              std::to_string(bytes_ / (1024 * 1024)) + " MB)");
+}
+
+void PrefixCache::evictLocked(std::size_t needed) {
+    while (!lru_.empty() && bytes_ + needed > budget_) {
+        auto it = entries_.find(lru_.back());
+        if (it != entries_.end()) {
+            bytes_ -= it->second.state->size();
+            entries_.erase(it);
+        }
+        lru_.pop_back();
+    }
+}
+
+} // namespace nrvnaai
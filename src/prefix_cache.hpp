@@ -0,0 +1,81 @@
+/*
+ * nrvna ai - Shared prompt-prefix KV cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace nrvnaai {
+
+// Process-wide cache of sequence KV state for common prompt prefixes.
+//
+// Prefixes are cut at fixed token-block boundaries (NRVNA_PREFIX_BLOCK) and
+// keyed by a rolling hash over the blocks, so "system prompt + template header"
+// shared by many jobs lands on the same key regardless of what follows. A
+// boundary is only snapshotted once two jobs have reached it, so one-off
+// prompts never pay the copy. Entries are LRU-evicted under a byte budget.
+//
+// Snapshots are opaque llama_state_seq_get_data() blobs for seq 0; the caller
+// does the llama.cpp calls, this class only does bookkeeping.
+class PrefixCache {
+public:
+    struct Hit {
+        int n_tokens = 0;
+        std::shared_ptr<const std::vector<uint8_t>> state;
+    };
+
+    PrefixCache() = default;
+    PrefixCache(const PrefixCache&) = delete;
+    PrefixCache& operator=(const PrefixCache&) = delete;
+
+    // Drops all entries when the model identity changes.
+    void configure(std::size_t budgetBytes, int blockTokens, uint64_t modelKey);
+    [[nodiscard]] bool enabled() const noexcept;
+
+    // Longest cached prefix of `tokens` (strictly shorter, so one token is left
+    // to prefill for logits). Empty hit on miss.
+    [[nodiscard]] Hit lookup(const std::vector<int32_t>& tokens);
+
+    // Record that a job reached these boundaries. Returns the longest boundary
+    // beyond `n_cached` that is now shared by two jobs and not yet stored
+    // (0 = nothing worth snapshotting).
+    [[nodiscard]] int observe(const std::vector<int32_t>& tokens, int n_cached);
+
+    void insert(const std::vector<int32_t>& tokens, int n_tokens, std::vector<uint8_t> state);
+
+    [[nodiscard]] std::size_t bytes() const noexcept;
+
+private:
+    struct Entry {
+        std::vector<int32_t> tokens;    // exact prefix, guards against hash collisions
+        std::shared_ptr<const std::vector<uint8_t>> state;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    std::vector<uint64_t> boundaryHashes(const std::vector<int32_t>& tokens) const;
+    void evictLocked(std::size_t needed);
+
+    mutable std::mutex mutex_;
+    std::size_t budget_ = 0;
+    std::size_t bytes_ = 0;
+    int block_ = 256;
+    uint64_t modelKey_ = 0;
+
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::list<uint64_t> lru_;                       // front = most recent
+    std::unordered_map<uint64_t, uint32_t> seen_;   // boundary hash -> jobs that reached it
+};
+
+// The one cache shared by every Runner and the batch scheduler
+PrefixCache& sharedPrefixCache();
+
+} // namespace nrvnaai
@@ -8,9 +8,25 @@
 #include "nrvna/meta.hpp"
 #include "nrvna/runner.hpp"
 #include "nrvna/runner_tts.hpp"
+#include "nrvna/scheduler.hpp"
 #include "nrvna/logger.hpp"
+#include "archive.hpp"
+#include "artifacts.hpp"
+#include "hash.hpp"
+#include "job_index.hpp"
+#include "lease.hpp"
+#include "llama_util.hpp"
+#include "memory_budget.hpp"
+#include "metrics.hpp"
+#include "model_registry.hpp"
+#include "result_cache.hpp"
+#include "thread_plan.hpp"
+#include "tts_spectral.hpp"
+#include "vector_store.hpp"
+#include "wav_writer.hpp"
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 #include <ctime>
 #include <algorithm>
 #include <fstream>
@@ -30,24 +46,6 @@ std::string timestamp() {
     return buf;
 }
 
-void writeCompletionMeta(const std::filesystem::path& jobPath,
-                         double elapsed_s,
-                         const std::vector<std::string>& artifacts,
-                         const std::string& status) {
-    auto meta = nrvnaai::readMetaJson(jobPath).value_or(nrvnaai::JobMeta{});
-    if (meta.submitted_at.empty()) {
-        meta.submitted_at = nrvnaai::formatTimestamp();
-    }
-    if (meta.mode.empty()) {
-        meta.mode = "text";
-    }
-    meta.completed_at = nrvnaai::formatTimestamp();
-    meta.duration_s = elapsed_s;
-    meta.artifacts = artifacts;
-    meta.status = status;
-    (void)nrvnaai::writeMetaJson(jobPath, meta);
-}
-
 void printJobStatus(const nrvnaai::JobId& id, const std::string& status, double elapsed = -1.0, const std::string& detail = "") {
     std::lock_guard<std::mutex> lock(g_output_mutex);
     const char* color = "\033[33m"; // yellow = running
@@ -66,26 +64,197 @@ void printJobStatus(const nrvnaai::JobId& id, const std::string& status, double
     std::cout << "\n" << std::flush;
 }
 
-void completeJob(const std::filesystem::path& jobPath,
-                 double elapsed,
-                 const std::vector<std::string>& artifacts,
-                 const std::string& status) {
-    writeCompletionMeta(jobPath, elapsed, artifacts, status);
 }
 
+namespace nrvnaai {
+
+// ~3 bytes per token is on the short side for most tokenizers, which errs
+// towards over-reserving
+static int estimatedPromptTokens(const std::filesystem::path& jobDir) {
+    std::error_code ec;
+    const auto promptBytes = std::filesystem::file_size(jobDir / "prompt.txt", ec);
+    return static_cast<int>(std::min<std::uintmax_t>(ec ? 0 : promptBytes / 3, 1 << 20)) + 16;
 }
 
-namespace nrvnaai {
+// Shape of an embed job's output, recorded in meta.json
+struct Processor::EmbeddingShape {
+    std::size_t dim = 0;
+    std::size_t count = 0;
+    bool f32 = false;
+};
+
+void Processor::completeJob(const std::filesystem::path& jobPath,
+                            double elapsed_s,
+                            const std::vector<std::string>& artifacts,
+                            const std::string& status,
+                            const RunStats* stats,
+                            const EmbeddingShape* shape,
+                            bool cacheHit) noexcept {
+    try {
+        auto meta = readMetaJson(jobPath).value_or(JobMeta{});
+        if (meta.submitted_at.empty()) {
+            meta.submitted_at = formatTimestamp();
+        }
+        if (meta.mode.empty()) {
+            meta.mode = "text";
+        }
+        meta.completed_at = formatTimestamp();
+        meta.duration_s = elapsed_s;
+        meta.artifacts = artifacts;
+        meta.status = status;
+        meta.cache_hit = cacheHit;
+
+        // Whatever of submit-to-now the processor did not account for was queueing
+        const auto submitted = parseTimestamp(meta.submitted_at);
+        const auto completed = parseTimestamp(meta.completed_at);
+        if (submitted && completed) {
+            meta.queue_wait_ms = std::max(0.0, (*completed - *submitted - elapsed_s) * 1000.0);
+        }
+
+        if (stats) {
+            meta.context_reused = stats->context_reused;
+            meta.prefix_cached_tokens = stats->prefix_cached_tokens;
+            meta.session_restored_tokens = stats->session_restored_tokens;
+            meta.setup_ms = stats->setup_ms;
+            meta.prompt_eval_ms = stats->prompt_ms;
+            meta.decode_ms = stats->decode_ms;
+            meta.ttft_ms = stats->ttft_ms;
+            meta.prompt_tokens = stats->prompt_tokens;
+            meta.generated_tokens = stats->generated_tokens;
+            meta.draft_tokens = stats->draft_tokens;
+            meta.draft_accepted = stats->draft_accepted;
+            meta.think_tokens = stats->think_tokens;
+            meta.think_capped = stats->think_capped;
+            if (stats->decode_ms > 0.0 && stats->generated_tokens > 0) {
+                // Each generated token costs one decode after the first sample
+                meta.tokens_per_s = stats->generated_tokens * 1000.0 / stats->decode_ms;
+            }
+        }
+        if (shape) {
+            meta.embedding_dim = static_cast<int>(shape->dim);
+            meta.embedding_count = static_cast<int>(shape->count);
+            meta.embedding_dtype = shape->f32 ? "f32" : "";
+            // The store the rows belong to, so searches never mix models
+            std::string model = resolveJobModel(meta.model);
+            meta.embedding_model = VectorStore::label(model.empty() ? meta.model : model);
+        }
+        (void)writeMetaJson(jobPath, meta);
+        if (metrics_) {
+            metrics_->observe(meta);
+        }
+
+        if (resultCache_) {
+            std::string key;
+            {
+                std::lock_guard<std::mutex> lock(pendingCacheMutex_);
+                auto it = pendingCacheKeys_.find(jobPath.filename().string());
+                if (it != pendingCacheKeys_.end()) {
+                    key = std::move(it->second);
+                    pendingCacheKeys_.erase(it);
+                }
+            }
+            if (!key.empty() && status == "done") {
+                resultCache_->store(key, jobPath, meta);
+            }
+        }
+    } catch (...) {
+        LOG_WARN("Failed to record completion metadata: " + jobPath.string());
+    }
+}
 
-Processor::Processor(const std::filesystem::path& workspace, const std::string& modelPath, const std::string& mmprojPath, const std::string& vocoderPath)
-    : workspace_(workspace), modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath) {
+Processor::Processor(const std::filesystem::path& workspace, const std::string& modelPath, const std::string& mmprojPath,
+                     const std::string& vocoderPath, LeaseTable* leases)
+    : workspace_(workspace), modelPath_(modelPath), mmprojPath_(mmprojPath), vocoderPath_(vocoderPath), leases_(leases) {
+    // NRVNA_STREAM=1: text/vision jobs append to processing/<id>/result.partial
+    if (const char* stream = std::getenv("NRVNA_STREAM")) {
+        streaming_ = std::string(stream) == "1";
+    }
+
+    // Reasoning models: cap the tokens spent per think block and optionally
+    // keep the reasoning next to the answer
+    thinkBudget_ = std::max(0, env_int("NRVNA_THINK_BUDGET", 0));
+    thinkingFile_ = env_int("NRVNA_THINK_FILE", 0) != 0;
+
+    // NRVNA_EMBED_FORMAT: json (default) | f32 | both
+    if (const char* format = std::getenv("NRVNA_EMBED_FORMAT")) {
+        const std::string value = format;
+        if (value == "f32") {
+            embedJson_ = false;
+            embedF32_ = true;
+        } else if (value == "both") {
+            embedF32_ = true;
+        } else if (value != "json") {
+            LOG_WARN("Unknown NRVNA_EMBED_FORMAT '" + value + "', using json");
+        }
+    }
+
+    // NRVNA_RESULT_CACHE=1: serve exact duplicates of reproducible jobs
+    if (const char* cache = std::getenv("NRVNA_RESULT_CACHE")) {
+        if (std::string(cache) == "1") {
+            resultCache_ = std::make_unique<ResultCache>(workspace_);
+            LOG_INFO("Result cache enabled: " + (workspace_ / ".nrvna" / "results").string());
+        }
+    }
+
+    // NRVNA_VECTOR_STORE=f32|f16|i8 (1 = f32): index finished embeddings for
+    // Flow::search under .nrvna/vectors/
+    if (const char* store = std::getenv("NRVNA_VECTOR_STORE"); store && *store && std::string(store) != "0") {
+        if (auto type = parseVectorType(store); !type) {
+            LOG_WARN("Unknown NRVNA_VECTOR_STORE '" + std::string(store) + "', vector store off");
+        } else if (!hostIsLittleEndian()) {
+            LOG_WARN("Vector store needs a little-endian host, off");
+        } else {
+            vectorStore_ = std::make_unique<VectorStore>(workspace_, *type);
+            LOG_INFO("Vector store enabled (" + std::string(vectorTypeName(*type)) + "): " +
+                     VectorStore::directory(workspace_).string());
+        }
+    }
+
+    // NRVNA_MODELS_DIR (default ./models) first, then next to the default model
+    const char* modelsDir = std::getenv("NRVNA_MODELS_DIR");
+    modelDirs_.emplace_back(modelsDir && *modelsDir ? modelsDir : "models");
+    const auto defaultDir = std::filesystem::path(modelPath_).parent_path();
+    if (!defaultDir.empty() && defaultDir != modelDirs_.front()) {
+        modelDirs_.push_back(defaultDir);
+    }
+
+    // Recount output/ and failed/ once so clients can skip the directory walk.
+    // Daemons sharing the workspace would clobber each other's index.
+    index_ = std::make_unique<JobIndex>(workspace_);
+    archive_ = std::make_unique<Archive>(workspace_);
+    if (leases_ && leases_->peers() > 0) {
+        LOG_INFO("Job index off: workspace shared with other daemons");
+        index_->disable("workspace shared with other daemons");
+    } else if (!index_->rebuild()) {
+        LOG_WARN("Job index unavailable, status queries will scan the workspace");
+    }
     LOG_DEBUG("Processor created for workspace: " + workspace_.string() + " with model: " + modelPath_);
 }
 
+Processor::~Processor() {
+    finishWarmup();
+    // Drain batched jobs while finalization paths are still valid
+    if (scheduler_) {
+        scheduler_->stop();
+        scheduler_.reset();
+    }
+}
+
 ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
     LOG_DEBUG("Processing job: " + jobId);
 
     try {
+        // Step 0: Wait for room in the memory budget; whatever the worker
+        // keeps warm afterwards is what stays reserved
+        struct AdmissionRelease {
+            Processor& processor;
+            int workerId;
+            bool admitted;
+            ~AdmissionRelease() {
+                if (admitted) processor.releaseJob(workerId);
+            }
+        } admission{*this, workerId, admitJob(jobId, workerId)};
+
         // Step 1: Move from ready to processing (atomic)
         if (!moveReadyToProcessing(jobId)) {
             LOG_DEBUG("Job not found or already claimed by another worker: " + jobId);
@@ -99,6 +268,23 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
         std::string prompt = readPrompt(jobId);
         std::string jobType = readJobType(jobId);
         std::vector<std::filesystem::path> imagePaths = readImages(jobId);
+
+        // Content hashes recorded at submit key the image embedding cache
+        const auto jobMeta = readMetaJson(getJobPath("processing", jobId));
+        const bool multiInput = jobMeta && jobMeta->multi_input;
+        std::vector<std::string> imageHashes;
+        if (!imagePaths.empty()) {
+            if (jobMeta) {
+                imageHashes = jobMeta->image_hashes;
+            }
+            std::string refError;
+            if (!verifyImageRefs(imagePaths, imageHashes, refError)) {
+                completeJob(getJobPath("processing", jobId), 0.0, {"error.txt"}, "failed");
+                printJobStatus(jobId, "failed", 0.0, "image changed");
+                (void)finalizeFailure(jobId, refError);
+                return ProcessResult::Failed;
+            }
+        }
         const bool allowEmptyPrompt = prompt.empty() && jobType == "embed" && !imagePaths.empty();
         if (prompt.empty() && !allowEmptyPrompt) {
             completeJob(getJobPath("processing", jobId), 0.0, {"error.txt"}, "failed");
@@ -126,13 +312,33 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
                 return ProcessResult::SystemError;
             }
 
-            auto ttsResult = ttsRunner->run(prompt);
+            // PCM is appended to audio.wav.partial as the vocoder produces it;
+            // if that file cannot be opened the audio is buffered as before
+            WavWriter wav;
+            const auto partialPath = getJobPath("processing", jobId) / "audio.wav.partial";
+            TtsRunner::AudioSink sink;
+            if (wav.open(partialPath, 24000)) {
+                sink = [&wav](const float* samples, std::size_t n) { (void)wav.append(samples, n); };
+            } else {
+                LOG_WARN("Cannot stream audio for " + jobId + ", buffering in memory");
+            }
+
+            auto ttsResult = ttsRunner->run(prompt, sink);
             auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            if (!ttsResult.ok && wav.isOpen()) {
+                (void)wav.finish();
+                std::error_code ec;
+                std::filesystem::remove(partialPath, ec);
+            }
             if (ttsResult.ok) {
-                if (finalizeAudio(jobId, ttsResult.audio, ttsResult.sample_rate)) {
-                    completeJob(getJobPath("output", jobId), elapsed, {"audio.wav"}, "done");
+                const std::size_t samples = wav.isOpen() ? wav.samples() : ttsResult.audio.size();
+                const bool written = wav.isOpen()
+                    ? finalizeAudioFile(jobId, wav)
+                    : finalizeAudio(jobId, ttsResult.audio, ttsResult.sample_rate);
+                if (written) {
+                    completeJob(getJobPath("output", jobId), elapsed, {"audio.wav"}, "done", &ttsResult.stats);
                     printJobStatus(jobId, "done", elapsed);
-                    LOG_INFO("TTS COMPLETED: " + jobId + " -> " + std::to_string(ttsResult.audio.size()) + " samples");
+                    LOG_INFO("TTS COMPLETED: " + jobId + " -> " + std::to_string(samples) + " samples");
                     return ProcessResult::Success;
                 } else {
                     LOG_ERROR("Failed to finalize TTS job: " + jobId);
@@ -146,7 +352,7 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
             } else {
                 printJobStatus(jobId, "failed", elapsed);
                 if (finalizeFailure(jobId, ttsResult.error)) {
-                    completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed");
+                    completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed", &ttsResult.stats);
                 }
                 LOG_WARN("TTS job failed: " + jobId + " - " + ttsResult.error);
                 return ProcessResult::Failed;
@@ -163,47 +369,156 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
             return ProcessResult::SystemError;
         }
 
-        if (jobType == "embed") {
-            auto embedResult = imagePaths.empty()
-                ? runner->embed(prompt)
-                : runner->embedVision(prompt, imagePaths);
+        // Switch this worker to the job's model, loading it if nobody has
+        const std::string modelName = jobMeta ? jobMeta->model : std::string();
+        const std::string jobModel = resolveJobModel(modelName);
+        if (jobModel.empty() || !runner->useModel(jobModel)) {
             auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
-            if (embedResult.ok) {
-                if (finalizeEmbedding(jobId, embedResult.embedding)) {
-                    completeJob(getJobPath("output", jobId), elapsed, {"embedding.json"}, "done");
-                    printJobStatus(jobId, "done", elapsed);
-                    LOG_INFO("EMBED COMPLETED: " + jobId + " -> " + std::to_string(embedResult.embedding.size()) + " dims");
+            completeJob(getJobPath("processing", jobId), elapsed, {"error.txt"}, "failed");
+            printJobStatus(jobId, "failed", elapsed, "model unavailable");
+            (void)finalizeFailure(jobId, jobModel.empty() ? "Unknown model: " + modelName
+                                                          : "Failed to load model: " + modelName);
+            return ProcessResult::Failed;
+        }
+        const bool defaultModel = jobModel == modelPath_;
+
+        // Images without recorded hashes cannot be keyed. Submit-time hashes
+        // are FNV-1a, easy to collide on purpose, so the key takes SHA-256 of
+        // the files instead.
+        bool cacheable = resultCache_ && imageHashes.size() == imagePaths.size();
+        std::vector<std::string> keyImages;
+        for (std::size_t i = 0; cacheable && i < imagePaths.size(); ++i) {
+            keyImages.push_back(sha256File(imagePaths[i]));
+            cacheable = !keyImages.back().empty();
+        }
+
+        if (jobType == "embed") {
+            if (cacheable) {
+                const std::string key = embedCacheKey(*runner, prompt, keyImages, imagePaths.empty() && multiInput);
+                if (serveFromCache(jobId, key, startTime)) {
                     return ProcessResult::Success;
-                } else {
-                    LOG_ERROR("Failed to finalize embedding job: " + jobId);
-                    if (!finalizeFailure(jobId, "Failed to write embedding to output directory")) {
-                        LOG_ERROR("STUCK JOB: " + jobId + " trapped in processing/ — manual intervention required");
-                    } else {
-                        completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed");
-                    }
-                    return ProcessResult::SystemError;
                 }
-            } else {
-                printJobStatus(jobId, "failed", elapsed);
-                if (finalizeFailure(jobId, embedResult.error)) {
-                    completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed");
+            }
+            if (imagePaths.empty()) {
+                if (multiInput) {
+                    return processMultiEmbed(jobId, prompt, *runner, startTime);
                 }
-                LOG_WARN("Embed job failed: " + jobId + " - " + embedResult.error);
-                return ProcessResult::Failed;
+                if (embedSeqs_ > 1 && jobSource_ && defaultModel) {
+                    return processEmbedBatch(jobId, prompt, *runner, workerId, startTime);
+                }
+            }
+            auto embedResult = imagePaths.empty()
+                ? runner->embed(prompt)
+                : runner->embedVision(prompt, imagePaths, imageHashes);
+            return completeEmbed(jobId, embedResult, startTime);
+        }
+
+        RunOptions options;
+        if (sessions_ && imagePaths.empty()) {
+            options = buildRunOptions(jobId);
+        }
+        if (streaming_) {
+            options.stream_path = getJobPath("processing", jobId) / "result.partial";
+        }
+        if (thinkingFile_) {
+            options.thinking_path = getJobPath("processing", jobId) / "thinking.txt";
+        }
+        options.think_budget = jobMeta && jobMeta->think_budget >= 0 ? jobMeta->think_budget : thinkBudget_;
+        if (cacheable) {
+            const std::string key = runner->resultKey(imagePaths.empty() ? "text" : "vision",
+                                                      prompt, keyImages, options);
+            if (!key.empty() && serveFromCache(jobId, key, startTime)) {
+                return ProcessResult::Success;
             }
         }
+        options.image_hashes = std::move(imageHashes);
+
+        // Plain text jobs on the daemon's model join the shared batch when
+        // enabled; if the scheduler declines (stopping, prompt too large) the
+        // worker runs the job itself. The batch does not enforce think
+        // budgets or write thinking.txt, so those jobs stay on the worker.
+        const bool batchable = options.think_budget == 0 && options.thinking_path.empty();
+        if (imagePaths.empty() && defaultModel && batchable && scheduler_ &&
+            scheduler_->submit(jobId, prompt, options, startTime)) {
+            return ProcessResult::Deferred;
+        }
 
         RunResult result;
         if (imagePaths.empty()) {
-            result = runner->run(prompt);
+            result = runner->run(prompt, options);
         } else {
-            result = runner->run(prompt, imagePaths);
+            result = runner->run(prompt, imagePaths, options);
         }
 
+        return completeText(jobId, result, startTime);
+        
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception processing job " + jobId + ": " + std::string(e.what()));
+        (void)finalizeFailure(jobId, "Internal processing error: " + std::string(e.what()));
+        return ProcessResult::SystemError;
+    } catch (...) {
+        LOG_ERROR("Unknown exception processing job: " + jobId);
+        (void)finalizeFailure(jobId, "Unknown internal processing error");
+        return ProcessResult::SystemError;
+    }
+}
+
+bool Processor::serveFromCache(const JobId& jobId, const std::string& key,
+                               std::chrono::steady_clock::time_point startTime) noexcept {
+    try {
+        const auto processingPath = getJobPath("processing", jobId);
+        auto hit = resultCache_->restore(key, processingPath);
+        if (!hit) {
+            std::lock_guard<std::mutex> lock(pendingCacheMutex_);
+            pendingCacheKeys_[jobId] = key;
+            return false;
+        }
+
+        std::filesystem::rename(processingPath, getJobPath("output", jobId));
+        recordFinished(jobId, Status::Done);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        EmbeddingShape shape{static_cast<std::size_t>(hit->embedding_dim),
+                             static_cast<std::size_t>(hit->embedding_count), hit->embedding_dtype == "f32"};
+        completeJob(getJobPath("output", jobId), elapsed, hit->artifacts, "done", nullptr,
+                    hit->embedding_dim > 0 ? &shape : nullptr, true);
+        if (vectorStore_ && hit->embedding_dim > 0) {
+            std::vector<std::vector<float>> rows;
+            if (readEmbeddingRows(getJobPath("output", jobId), shape.dim, rows)) {
+                std::vector<const std::vector<float>*> ptrs;
+                for (const auto& row : rows) ptrs.push_back(&row);
+                storeVectors(jobId, ptrs);
+            } else {
+                LOG_WARN("Embedding not added to the vector store: " + jobId);
+            }
+        }
+        printJobStatus(jobId, "done", elapsed, "cached");
+        LOG_INFO("JOB COMPLETED: " + jobId + " -> result cache " + key);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Result cache hit could not be finalized for " + jobId + ": " + std::string(e.what()));
+        std::error_code ec;
+        for (const char* name : {"result.txt", "embedding.json", "embedding.f32"}) {
+            std::filesystem::remove(getJobPath("processing", jobId) / name, ec);
+        }
+        return false;
+    }
+}
+
+ProcessResult Processor::completeText(const JobId& jobId, const RunResult& result,
+                                      std::chrono::steady_clock::time_point startTime) noexcept {
+    try {
         auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
         if (result.ok) {
             if (finalizeSuccess(jobId, result.output)) {
-                completeJob(getJobPath("output", jobId), elapsed, {"result.txt"}, "done");
+                std::vector<std::string> artifacts = {"result.txt"};
+                if (result.stats.session_saved) {
+                    artifacts.push_back("session.bin");
+                }
+                std::error_code ec;
+                if (std::filesystem::exists(getJobPath("output", jobId) / "thinking.txt", ec)) {
+                    artifacts.push_back("thinking.txt");
+                }
+                completeJob(getJobPath("output", jobId), elapsed, artifacts, "done", &result.stats);
                 printJobStatus(jobId, "done", elapsed);
                 LOG_INFO("JOB COMPLETED: " + jobId + " -> " + std::to_string(result.output.size()) + " chars");
                 return ProcessResult::Success;
@@ -219,23 +534,373 @@ ProcessResult Processor::process(const JobId& jobId, int workerId) noexcept {
         } else {
             printJobStatus(jobId, "failed", elapsed);
             if (finalizeFailure(jobId, result.error)) {
-                completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed");
+                completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed", &result.stats);
             }
             LOG_WARN("Job failed during inference: " + jobId + " - " + result.error);
             return ProcessResult::Failed;
         }
-        
     } catch (const std::exception& e) {
-        LOG_ERROR("Exception processing job " + jobId + ": " + std::string(e.what()));
+        LOG_ERROR("Exception completing job " + jobId + ": " + std::string(e.what()));
         (void)finalizeFailure(jobId, "Internal processing error: " + std::string(e.what()));
         return ProcessResult::SystemError;
     } catch (...) {
-        LOG_ERROR("Unknown exception processing job: " + jobId);
+        LOG_ERROR("Unknown exception completing job: " + jobId);
+        (void)finalizeFailure(jobId, "Unknown internal processing error");
+        return ProcessResult::SystemError;
+    }
+}
+
+ProcessResult Processor::completeEmbed(const JobId& jobId, const EmbedResult& result,
+                                       std::chrono::steady_clock::time_point startTime) noexcept {
+    try {
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (result.ok) {
+            if (finalizeEmbedding(jobId, result.embedding)) {
+                const EmbeddingShape shape{result.embedding.size(), 1, embedF32_};
+                completeJob(getJobPath("output", jobId), elapsed, embeddingArtifacts(), "done", &result.stats, &shape);
+                printJobStatus(jobId, "done", elapsed);
+                LOG_INFO("EMBED COMPLETED: " + jobId + " -> " + std::to_string(result.embedding.size()) + " dims");
+                return ProcessResult::Success;
+            } else {
+                LOG_ERROR("Failed to finalize embedding job: " + jobId);
+                if (!finalizeFailure(jobId, "Failed to write embedding to output directory")) {
+                    LOG_ERROR("STUCK JOB: " + jobId + " trapped in processing/ — manual intervention required");
+                } else {
+                    completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed");
+                }
+                return ProcessResult::SystemError;
+            }
+        } else {
+            printJobStatus(jobId, "failed", elapsed);
+            if (finalizeFailure(jobId, result.error)) {
+                completeJob(getJobPath("failed", jobId), elapsed, {"error.txt"}, "failed", &result.stats);
+            }
+            LOG_WARN("Embed job failed: " + jobId + " - " + result.error);
+            return ProcessResult::Failed;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception completing embed job " + jobId + ": " + std::string(e.what()));
+        (void)finalizeFailure(jobId, "Internal processing error: " + std::string(e.what()));
+        return ProcessResult::SystemError;
+    } catch (...) {
+        LOG_ERROR("Unknown exception completing embed job: " + jobId);
         (void)finalizeFailure(jobId, "Unknown internal processing error");
         return ProcessResult::SystemError;
     }
 }
 
+// Drain more queued text-embed jobs and decode them with this one as separate
+// sequences. Each job is still claimed and finalized on its own.
+ProcessResult Processor::processEmbedBatch(const JobId& jobId, const std::string& prompt, Runner& runner,
+                                           int workerId, std::chrono::steady_clock::time_point startTime) noexcept {
+    // Every job this batch claimed, so none is left in processing/ on error
+    std::vector<JobId> claimed = {jobId};
+    auto failAll = [&](const std::string& error) {
+        std::error_code ec;
+        for (const auto& id : claimed) {
+            if (std::filesystem::exists(getJobPath("processing", id), ec)) {
+                (void)finalizeFailure(id, error);
+            }
+        }
+    };
+    try {
+        std::vector<JobId> ids = {jobId};
+        std::vector<std::string> texts = {prompt};
+        std::vector<std::chrono::steady_clock::time_point> starts = {startTime};
+
+        auto more = jobSource_(static_cast<std::size_t>(embedSeqs_ - 1),
+                               [this](const JobId& id) { return isBatchableEmbed(id); });
+        bool full = false;
+        for (const auto& id : more) {
+            // The worker was admitted for the lead job; each extra has to fit
+            // too, and once one does not the rest go back to the queue
+            if (memoryBudget_ && !full) {
+                const int tokens = estimatedPromptTokens(getJobPath("input/ready", id));
+                full = !memoryBudget_->grow(workerId, runner.projectedBytes("embed", tokens, false));
+            }
+            if (full) {
+                if (jobReturn_) jobReturn_(id);
+                continue;
+            }
+            if (!moveReadyToProcessing(id)) {
+                continue;
+            }
+            claimed.push_back(id);
+            printJobStatus(id, "running");
+            auto start = std::chrono::steady_clock::now();
+            std::string text = readPrompt(id);
+            if (text.empty()) {
+                completeJob(getJobPath("processing", id), 0.0, {"error.txt"}, "failed");
+                printJobStatus(id, "failed", 0.0, "empty prompt");
+                (void)finalizeFailure(id, "Failed to read prompt file");
+                continue;
+            }
+            // Same lookup as a job run on its own; misses are stored by completeEmbed
+            if (resultCache_ && serveFromCache(id, embedCacheKey(runner, text, {}, false), start)) {
+                continue;
+            }
+            ids.push_back(id);
+            texts.push_back(std::move(text));
+            starts.push_back(start);
+        }
+
+        if (ids.size() > 1) {
+            LOG_DEBUG("Embedding " + std::to_string(ids.size()) + " jobs together");
+        }
+        auto results = runner.embedBatch(texts, embedSeqs_);
+
+        ProcessResult first = ProcessResult::SystemError;
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            ProcessResult r = completeEmbed(ids[i], results[i], starts[i]);
+            if (i == 0) {
+                first = r;
+            }
+        }
+        return first;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception in embedding batch for " + jobId + ": " + std::string(e.what()));
+        failAll("Internal processing error: " + std::string(e.what()));
+        return ProcessResult::SystemError;
+    } catch (...) {
+        LOG_ERROR("Unknown exception in embedding batch for: " + jobId);
+        failAll("Unknown internal processing error");
+        return ProcessResult::SystemError;
+    }
+}
+
+// One job, one vector per non-empty prompt line
+ProcessResult Processor::processMultiEmbed(const JobId& jobId, const std::string& prompt, Runner& runner,
+                                           std::chrono::steady_clock::time_point startTime) noexcept {
+    try {
+        std::vector<std::string> lines;
+        std::size_t pos = 0;
+        while (pos <= prompt.size()) {
+            std::size_t end = prompt.find('\n', pos);
+            if (end == std::string::npos) {
+                end = prompt.size();
+            }
+            std::string line = prompt.substr(pos, end - pos);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                lines.push_back(std::move(line));
+            }
+            pos = end + 1;
+        }
+
+        auto elapsed = [&] {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        };
+        if (lines.empty()) {
+            completeJob(getJobPath("processing", jobId), 0.0, {"error.txt"}, "failed");
+            printJobStatus(jobId, "failed", 0.0, "no input lines");
+            (void)finalizeFailure(jobId, "Multi-input embed job has no non-empty lines");
+            return ProcessResult::Failed;
+        }
+
+        auto results = runner.embedBatch(lines, std::max(1, embedSeqs_));
+
+        std::vector<std::vector<float>> vectors;
+        vectors.reserve(results.size());
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (!results[i].ok) {
+                const std::string error = "Line " + std::to_string(i + 1) + ": " + results[i].error;
+                printJobStatus(jobId, "failed", elapsed());
+                if (finalizeFailure(jobId, error)) {
+                    completeJob(getJobPath("failed", jobId), elapsed(), {"error.txt"}, "failed", &results[i].stats);
+                }
+                LOG_WARN("Embed job failed: " + jobId + " - " + error);
+                return ProcessResult::Failed;
+            }
+            vectors.push_back(std::move(results[i].embedding));
+        }
+
+        if (!finalizeEmbeddings(jobId, vectors)) {
+            LOG_ERROR("Failed to finalize embedding job: " + jobId);
+            if (!finalizeFailure(jobId, "Failed to write embeddings to output directory")) {
+                LOG_ERROR("STUCK JOB: " + jobId + " trapped in processing/ — manual intervention required");
+            } else {
+                completeJob(getJobPath("failed", jobId), elapsed(), {"error.txt"}, "failed");
+            }
+            return ProcessResult::SystemError;
+        }
+        const EmbeddingShape shape{vectors.front().size(), vectors.size(), embedF32_};
+        completeJob(getJobPath("output", jobId), elapsed(), embeddingArtifacts(), "done", &results.front().stats, &shape);
+        printJobStatus(jobId, "done", elapsed());
+        LOG_INFO("EMBED COMPLETED: " + jobId + " -> " + std::to_string(vectors.size()) + " vectors");
+        return ProcessResult::Success;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Exception processing multi-input embed " + jobId + ": " + std::string(e.what()));
+        (void)finalizeFailure(jobId, "Internal processing error: " + std::string(e.what()));
+        return ProcessResult::SystemError;
+    } catch (...) {
+        LOG_ERROR("Unknown exception processing multi-input embed: " + jobId);
+        (void)finalizeFailure(jobId, "Unknown internal processing error");
+        return ProcessResult::SystemError;
+    }
+}
+
+// Artifacts depend on the output format and on multi-input splitting
+std::string Processor::embedCacheKey(Runner& runner, const std::string& prompt,
+                                     const std::vector<std::string>& imageHashes, bool multi) const {
+    std::string key = runner.resultKey("embed", prompt, imageHashes, {});
+    key += embedJson_ ? (embedF32_ ? "-both" : "-json") : "-f32";
+    key += multi ? "-multi" : "";
+    return key;
+}
+
+std::vector<std::string> Processor::embeddingArtifacts() const {
+    std::vector<std::string> artifacts;
+    if (embedJson_) artifacts.push_back("embedding.json");
+    if (embedF32_) artifacts.push_back(kEmbeddingF32);
+    return artifacts;
+}
+
+bool Processor::isBatchableEmbed(const JobId& jobId) const noexcept {
+    try {
+        auto readyPath = getJobPath("input/ready", jobId);
+        std::ifstream typeFile(readyPath / "type.txt", std::ios::binary);
+        std::string type;
+        if (!typeFile || !std::getline(typeFile, type) || type != "embed") {
+            return false;
+        }
+        if (std::filesystem::exists(readyPath / "images")) {
+            return false;
+        }
+        // Batches run on the daemon's model
+        auto meta = readMetaJson(readyPath);
+        return !(meta && (meta->multi_input || !meta->model.empty()));
+    } catch (...) {
+        return false;
+    }
+}
+
+std::string Processor::resolveJobModel(const std::string& name) noexcept {
+    if (name.empty()) {
+        return modelPath_;
+    }
+    try {
+        {
+            std::lock_guard<std::mutex> lock(modelPathsMutex_);
+            auto it = modelPaths_.find(name);
+            if (it != modelPaths_.end()) {
+                return it->second;
+            }
+        }
+        // A file name, never a path (meta.json may be written by hand)
+        if (name.find('/') != std::string::npos || name.find("..") != std::string::npos) {
+            LOG_WARN("Rejecting model name: " + name);
+            return "";
+        }
+        for (const auto& dir : modelDirs_) {
+            for (const auto& file : {name, name + ".gguf"}) {
+                std::error_code ec;
+                const auto candidate = dir / file;
+                if (std::filesystem::is_regular_file(candidate, ec)) {
+                    // Naming the daemon's own file must not load a second copy
+                    const std::string path = std::filesystem::equivalent(candidate, modelPath_, ec)
+                        ? modelPath_ : candidate.string();
+                    std::lock_guard<std::mutex> lock(modelPathsMutex_);
+                    modelPaths_.emplace(name, path);
+                    return path;
+                }
+            }
+        }
+        LOG_WARN("Model not found in models directory: " + name);
+        return "";
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to resolve model " + name + ": " + e.what());
+        return "";
+    }
+}
+
+bool Processor::modelResident(const std::string& name) const noexcept {
+    if (name.empty()) {
+        return true;
+    }
+    try {
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(modelPathsMutex_);
+            auto it = modelPaths_.find(name);
+            if (it == modelPaths_.end()) {
+                return false;
+            }
+            path = it->second;
+        }
+        return sharedModelRegistry().resident(path);
+    } catch (...) {
+        return false;
+    }
+}
+
+// A parent-linked job continues the conversation: earlier turns come from the
+// ancestors' prompt.txt/result.txt, KV state from the parent's session.bin.
+RunOptions Processor::buildRunOptions(const JobId& jobId) const {
+    RunOptions options;
+    options.save_session = getJobPath("processing", jobId) / "session.bin";
+
+    auto meta = readMetaJson(getJobPath("processing", jobId));
+    if (!meta || meta->parent.empty()) {
+        return options;
+    }
+
+    // Ancestors packed into the archive keep their turns (not their session.bin)
+    constexpr int kMaxChain = 256;  // also guards against parent cycles
+    JobId ancestor = meta->parent;
+    for (int depth = 0; !ancestor.empty() && depth < kMaxChain; ++depth) {
+        auto prompt = readFinishedFile(ancestor, "prompt.txt");
+        auto result = prompt ? readFinishedFile(ancestor, "result.txt") : std::nullopt;
+        if (!prompt || !result) {
+            LOG_DEBUG("Conversation chain stops at " + ancestor + " (not a finished text job)");
+            break;
+        }
+        ChatTurn turn;
+        turn.user = std::move(*prompt);
+        turn.assistant = std::move(*result);
+        options.history.push_back(std::move(turn));
+
+        auto metaJson = readFinishedFile(ancestor, "meta.json");
+        auto ancestorMeta = metaJson ? parseMetaJson(*metaJson) : std::nullopt;
+        ancestor = ancestorMeta ? ancestorMeta->parent : JobId{};
+    }
+    std::reverse(options.history.begin(), options.history.end());
+
+    // KV state only transfers between runs of the same model; the history
+    // above is replayed as text either way
+    auto session = getJobPath("output", meta->parent) / "session.bin";
+    auto parentMeta = readMetaJson(getJobPath("output", meta->parent));
+    std::error_code ec;
+    if (parentMeta && parentMeta->model == meta->model && std::filesystem::is_regular_file(session, ec)) {
+        options.resume_session = session;
+    }
+    LOG_DEBUG("Job " + jobId + " continues " + std::to_string(options.history.size()) + " turn(s)" +
+              (options.resume_session.empty() ? "" : " from parent session"));
+    return options;
+}
+
+std::optional<std::string> Processor::readFinishedFile(const JobId& jobId, const char* name) const {
+    if (std::ifstream file(getJobPath("output", jobId) / name, std::ios::binary); file) {
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    // Also covers a directory removed by compaction while we read it
+    auto archived = archive_->find(jobId);
+    if (!archived || archived->status != Status::Done) return std::nullopt;
+    return archive_->read(*archived, name);
+}
+
+void Processor::recordFinished(const JobId& jobId, Status status) noexcept {
+    index_->finished(jobId, status);
+    if (leases_) {
+        leases_->release(jobId);
+    }
+}
+
+void Processor::shareWorkspace() noexcept {
+    index_->disable("workspace shared with another daemon");
+}
+
 bool Processor::moveReadyToProcessing(const JobId& jobId) noexcept {
     try {
         auto readyPath = getJobPath("input/ready", jobId);
@@ -251,6 +916,10 @@ bool Processor::moveReadyToProcessing(const JobId& jobId) noexcept {
             return false;
         }
         
+        if (leases_) {
+            leases_->claim(jobId);
+        }
+        index_->claimed(jobId);
         LOG_DEBUG("Job moved to processing: " + jobId);
         return true;
     } catch (const std::exception& e) {
@@ -283,7 +952,8 @@ bool Processor::finalizeSuccess(const JobId& jobId, const std::string& result) n
         
         // Atomic move entire job to output
         std::filesystem::rename(processingPath, outputPath);
-        
+        recordFinished(jobId, Status::Done);
+
         LOG_DEBUG("Job finalized successfully: " + jobId);
         return true;
     } catch (const std::exception& e) {
@@ -300,29 +970,18 @@ bool Processor::finalizeEmbedding(const JobId& jobId, const std::vector<float>&
         auto processingPath = getJobPath("processing", jobId);
         auto outputPath = getJobPath("output", jobId);
 
-        // Write embedding as JSON
-        auto tempPath = processingPath / "embedding.json.tmp";
-        {
-            std::ofstream file(tempPath, std::ios::binary);
-            if (!file) return false;
-
-            file << "{\n  \"dim\": " << embedding.size() << ",\n  \"vector\": [";
-            for (size_t i = 0; i < embedding.size(); ++i) {
-                if (i > 0) file << ", ";
-                if (i % 10 == 0 && i > 0) file << "\n    ";
-                file << embedding[i];
-            }
-            file << "\n  ]\n}\n";
-            file.flush();
-            if (!file.good()) return false;
+        const std::vector<const std::vector<float>*> rows = {&embedding};
+        if (embedF32_ && !writeEmbeddingF32(processingPath, rows)) {
+            return false;
+        }
+        if (embedJson_ && !writeEmbeddingJson(processingPath, rows, false)) {
+            return false;
         }
-
-        // Rename temp to final
-        auto finalPath = processingPath / "embedding.json";
-        std::filesystem::rename(tempPath, finalPath);
 
         // Atomic move to output
         std::filesystem::rename(processingPath, outputPath);
+        recordFinished(jobId, Status::Done);
+        storeVectors(jobId, rows);
 
         LOG_DEBUG("Embedding job finalized: " + jobId);
         return true;
@@ -335,6 +994,56 @@ bool Processor::finalizeEmbedding(const JobId& jobId, const std::vector<float>&
     }
 }
 
+bool Processor::finalizeEmbeddings(const JobId& jobId, const std::vector<std::vector<float>>& embeddings) noexcept {
+    try {
+        auto processingPath = getJobPath("processing", jobId);
+        auto outputPath = getJobPath("output", jobId);
+
+        std::vector<const std::vector<float>*> rows;
+        rows.reserve(embeddings.size());
+        for (const auto& row : embeddings) {
+            rows.push_back(&row);
+        }
+        if (embedF32_ && !writeEmbeddingF32(processingPath, rows)) {
+            return false;
+        }
+        if (embedJson_ && !writeEmbeddingJson(processingPath, rows, true)) {
+            return false;
+        }
+
+        // Atomic move to output
+        std::filesystem::rename(processingPath, outputPath);
+        recordFinished(jobId, Status::Done);
+        storeVectors(jobId, rows);
+
+        LOG_DEBUG("Multi-input embedding job finalized: " + jobId);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to finalize embeddings for job " + jobId + ": " + std::string(e.what()));
+        return false;
+    } catch (...) {
+        LOG_ERROR("Unknown error finalizing embeddings for job: " + jobId);
+        return false;
+    }
+}
+
+void Processor::storeVectors(const JobId& jobId, const std::vector<const std::vector<float>*>& rows) noexcept {
+    if (!vectorStore_) return;
+    try {
+        // One store per model file, so vectors of different models never mix
+        const auto meta = readMetaJson(getJobPath("output", jobId));
+        // Search queries would otherwise match their own earlier copies
+        if (meta && meta->query) return;
+        std::string model = resolveJobModel(meta ? meta->model : std::string());
+        if (model.empty()) model = meta ? meta->model : modelPath_;
+        if (!vectorStore_->append(model, jobId, rows)) {
+            LOG_WARN("Embedding not added to the vector store: " + jobId);
+        }
+    } catch (...) {
+        LOG_WARN("Embedding not added to the vector store: " + jobId);
+    }
+}
+
 bool Processor::finalizeFailure(const JobId& jobId, const std::string& error) noexcept {
     try {
         auto processingPath = getJobPath("processing", jobId);
@@ -353,7 +1062,8 @@ bool Processor::finalizeFailure(const JobId& jobId, const std::string& error) no
         
         // Atomic move to failed directory
         std::filesystem::rename(processingPath, failedPath);
-        
+        recordFinished(jobId, Status::Failed);
+
         LOG_DEBUG("Job moved to failed: " + jobId);
         return true;
     } catch (const std::exception& e) {
@@ -387,6 +1097,42 @@ std::vector<std::filesystem::path> Processor::readImages(const JobId& jobId) con
     return imagePaths;
 }
 
+bool Processor::verifyImageRefs(const std::vector<std::filesystem::path>& imagePaths,
+                                const std::vector<std::string>& hashes, std::string& error) const noexcept {
+    // Images submitted by reference (symlinks, or hardlinks where reflinks
+    // fail) share bytes with a file outside the job; make sure they still
+    // hold what was hashed at submit. A private copy has one link and is skipped.
+    try {
+        for (size_t i = 0; i < imagePaths.size(); ++i) {
+            std::error_code ec;
+            const bool shared = std::filesystem::is_symlink(imagePaths[i], ec) ||
+                (std::filesystem::is_regular_file(imagePaths[i], ec) &&
+                 std::filesystem::hard_link_count(imagePaths[i], ec) > 1 && !ec);
+            if (!shared) {
+                continue;
+            }
+            // Without a recorded hash there is nothing to hold the bytes to
+            if (i >= hashes.size()) {
+                error = "Referenced image has no recorded hash: " + imagePaths[i].filename().string();
+                return false;
+            }
+            uint64_t h = 0;
+            if (!fnv1aFile(imagePaths[i], h)) {
+                error = "Referenced image is unreadable: " + imagePaths[i].filename().string();
+                return false;
+            }
+            if (hashes[i] != hashToHex(h)) {
+                error = "Referenced image changed since submit: " + imagePaths[i].filename().string();
+                return false;
+            }
+        }
+        return true;
+    } catch (const std::exception& e) {
+        error = "Failed to verify image references: " + std::string(e.what());
+        return false;
+    }
+}
+
 std::string Processor::readJobType(const JobId& jobId) const noexcept {
     try {
         auto typePath = getJobPath("processing", jobId) / "type.txt";
@@ -448,22 +1194,38 @@ std::filesystem::path Processor::getJobPath(const char* phase, const JobId& jobI
     }
 }
 
-// Pre-initialize all Runner instances before worker threads start
-// This ensures ggml_backend_load_all() is called sequentially from main thread
+// Pre-initialize all Runner instances before worker threads start.
+// Backend and log setup happen once here, before the warmup thread exists;
+// the Runner and TtsRunner constructors built alongside it only load models.
 bool Processor::initializeRunners(int numWorkers) {
     std::lock_guard<std::mutex> lock(runnersMutex_);
 
     try {
+        initLlamaBackend();
+        threadPlan_ = std::make_unique<ThreadPlan>(planThreads(numWorkers));
+        for (const auto& line : threadPlan_->describe()) {
+            LOG_INFO(line);
+        }
+
         for (int i = 0; i < numWorkers; ++i) {
             LOG_DEBUG("Pre-creating Runner instance for worker " + std::to_string(i));
-            if (mmprojPath_.empty()) {
-                runners_[i] = std::make_unique<Runner>(modelPath_);
-            } else {
-                // Pass numWorkers so each Runner divides CPU threads appropriately
-                runners_[i] = std::make_unique<Runner>(modelPath_, mmprojPath_, numWorkers);
+            runners_[i] = std::make_unique<Runner>(modelPath_, mmprojPath_, numWorkers, threadsForWorker(i));
+            if (i == 0 && env_int("NRVNA_WARMUP", 1) != 0) {
+                warmupThread_ = std::thread([runner = runners_[0].get()] {
+                    setThreadName("Warmup");
+                    (void)runner->warmup();
+                });
             }
         }
         LOG_DEBUG("All " + std::to_string(numWorkers) + " Runner instances initialized");
+
+        const int budget_mb = env_int("NRVNA_MEM_BUDGET_MB", 0);
+        if (budget_mb > 0) {
+            memoryBudget_ = std::make_unique<MemoryBudget>(
+                static_cast<std::size_t>(budget_mb) * 1024 * 1024, numWorkers,
+                [this](int worker) { getRunnerForWorker(worker)->releaseContexts(); });
+            LOG_INFO("Memory budget: " + std::to_string(budget_mb) + " MB for worker contexts");
+        }
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("Failed to initialize runners: " + std::string(e.what()));
@@ -471,6 +1233,96 @@ bool Processor::initializeRunners(int numWorkers) {
     }
 }
 
+void Processor::finishWarmup() noexcept {
+    if (!warmupThread_.joinable()) {
+        return;
+    }
+    warmupThread_.join();
+    // The budget accounts for contexts from admitted jobs only; the weights
+    // stay paged in either way
+    if (memoryBudget_) {
+        std::lock_guard<std::mutex> lock(runnersMutex_);
+        if (auto it = runners_.find(0); it != runners_.end()) {
+            it->second->releaseContexts();
+        }
+    }
+}
+
+bool Processor::admitJob(const JobId& jobId, int workerId) noexcept {
+    if (!memoryBudget_) {
+        return false;
+    }
+    bool claimed = false;
+    try {
+        const auto readyPath = getJobPath("input/ready", jobId);
+        std::error_code ec;
+        if (!std::filesystem::exists(readyPath, ec)) {
+            return false;  // claimed by another worker
+        }
+        std::string type = "text";
+        if (std::ifstream in{readyPath / "type.txt"}; in) {
+            std::getline(in, type);
+        }
+        if (type == "tts") {
+            return false;  // TTS contexts are small and not counted
+        }
+        if (type != "embed") {
+            type = std::filesystem::exists(readyPath / "images", ec) ? "vision" : "text";
+        }
+        const int tokens = estimatedPromptTokens(readyPath);
+
+        // From here on other workers leave this one's contexts alone
+        memoryBudget_->claim(workerId);
+        claimed = true;
+        Runner& runner = *getRunnerForWorker(workerId);
+        std::size_t need = runner.projectedBytes(type, tokens, false);
+        bool compact = false;
+        if (runner.kvQuantAuto() && !memoryBudget_->fits(workerId, need)) {
+            compact = true;
+            need = runner.projectedBytes(type, tokens, true);
+        }
+        runner.setCompactKv(compact);
+
+        if (memoryBudget_->admit(workerId, need)) {
+            LOG_DEBUG("Job " + jobId + " waited for memory (" + std::to_string(need >> 20) + " MB)");
+        }
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Memory admission skipped for " + jobId + ": " + e.what());
+        if (claimed) {
+            (void)memoryBudget_->admit(workerId, 0);
+        }
+        return claimed;
+    }
+}
+
+void Processor::releaseJob(int workerId) noexcept {
+    try {
+        memoryBudget_->release(workerId, getRunnerForWorker(workerId)->residentBytes());
+    } catch (...) {
+        memoryBudget_->release(workerId, 0);
+    }
+}
+
+WorkerThreads Processor::threadsForWorker(int workerId) const {
+    if (!threadPlan_ || workerId < 0 || workerId >= static_cast<int>(threadPlan_->workers.size())) {
+        return {};
+    }
+    return threadPlan_->workers[static_cast<std::size_t>(workerId)];
+}
+
+void Processor::bindWorkerThread(int workerId) const noexcept {
+    try {
+        if (!threadPlan_ || !threadPlan_->pinned) {
+            return;
+        }
+        const WorkerThreads threads = threadsForWorker(workerId);
+        if (pinCurrentThread(threads.cpus)) {
+            LOG_DEBUG("Worker-" + std::to_string(workerId) + " pinned to " + std::to_string(threads.cpus.size()) + " CPUs");
+        }
+    } catch (...) {}
+}
+
 // CRITICAL: Metal-compatible per-thread Runner management
 std::unique_ptr<Runner>& Processor::getRunnerForWorker(int workerId) {
     std::lock_guard<std::mutex> lock(runnersMutex_);
@@ -484,6 +1336,31 @@ std::unique_ptr<Runner>& Processor::getRunnerForWorker(int workerId) {
     return it->second;
 }
 
+bool Processor::enableBatching(int maxSeqs) {
+    try {
+        auto scheduler = std::make_unique<Scheduler>(modelPath_, maxSeqs,
+                                                     threadPlan_ ? threadPlan_->shared : WorkerThreads{});
+        if (!scheduler->start([this](const JobId& jobId, const RunResult& result,
+                                     std::chrono::steady_clock::time_point startTime) {
+                (void)completeText(jobId, result, startTime);
+            })) {
+            return false;
+        }
+        scheduler_ = std::move(scheduler);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to enable batching: " + std::string(e.what()));
+        return false;
+    }
+}
+
+void Processor::enableEmbedBatching(int maxSeqs, JobSource source, JobReturn requeue) {
+    embedSeqs_ = std::max(1, maxSeqs);
+    jobSource_ = std::move(source);
+    jobReturn_ = std::move(requeue);
+    LOG_DEBUG("Embedding batches enabled: up to " + std::to_string(embedSeqs_) + " jobs per decode");
+}
+
 bool Processor::initializeTtsRunners(int numWorkers) {
     if (vocoderPath_.empty()) {
         LOG_DEBUG("No vocoder path, skipping TTS runner init");
@@ -492,9 +1369,13 @@ bool Processor::initializeTtsRunners(int numWorkers) {
 
     std::lock_guard<std::mutex> lock(ttsRunnersMutex_);
     try {
+        // The ISTFT pool is shared by every worker; start it from this
+        // (unpinned) thread so its threads are not confined to one worker's CPUs
+        (void)sharedTaskPool();
+
         for (int i = 0; i < numWorkers; ++i) {
             LOG_DEBUG("Pre-creating TtsRunner instance for worker " + std::to_string(i));
-            ttsRunners_[i] = std::make_unique<TtsRunner>(modelPath_, vocoderPath_);
+            ttsRunners_[i] = std::make_unique<TtsRunner>(modelPath_, vocoderPath_, threadsForWorker(i));
         }
         LOG_DEBUG("All " + std::to_string(numWorkers) + " TtsRunner instances initialized");
         return true;
@@ -523,41 +1404,9 @@ bool Processor::finalizeAudio(const JobId& jobId, const std::vector<float>& audi
 
         // Write WAV to temp file first
         auto tempPath = processingPath / "audio.wav.tmp";
-        {
-            std::ofstream file(tempPath, std::ios::binary);
-            if (!file) return false;
-
-            // WAV header
-            struct {
-                char riff[4] = {'R', 'I', 'F', 'F'};
-                uint32_t chunk_size;
-                char wave[4] = {'W', 'A', 'V', 'E'};
-                char fmt[4] = {'f', 'm', 't', ' '};
-                uint32_t fmt_chunk_size = 16;
-                uint16_t audio_format = 1;
-                uint16_t num_channels = 1;
-                uint32_t sample_rate;
-                uint32_t byte_rate;
-                uint16_t block_align;
-                uint16_t bits_per_sample = 16;
-                char data[4] = {'d', 'a', 't', 'a'};
-                uint32_t data_size;
-            } header;
-            static_assert(sizeof(header) == 44, "WAV header struct has unexpected padding");
-
-            header.sample_rate = static_cast<uint32_t>(sampleRate);
-            header.byte_rate = header.sample_rate * header.num_channels * (header.bits_per_sample / 8);
-            header.block_align = header.num_channels * (header.bits_per_sample / 8);
-            header.data_size = static_cast<uint32_t>(audio.size() * (header.bits_per_sample / 8));
-            header.chunk_size = 36 + header.data_size;
-
-            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
-            for (const auto& sample : audio) {
-                int16_t pcm = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, sample * 32767.0)));
-                file.write(reinterpret_cast<const char*>(&pcm), sizeof(pcm));
-            }
-            file.flush();
-            if (!file.good()) return false;
+        WavWriter wav;
+        if (!wav.open(tempPath, sampleRate) || !wav.append(audio.data(), audio.size()) || !wav.finish()) {
+            return false;
         }
 
         // Rename temp to final
@@ -566,6 +1415,31 @@ bool Processor::finalizeAudio(const JobId& jobId, const std::vector<float>& audi
 
         // Atomic move to output
         std::filesystem::rename(processingPath, outputPath);
+        recordFinished(jobId, Status::Done);
+
+        LOG_DEBUG("TTS job finalized: " + jobId);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to finalize audio for job " + jobId + ": " + std::string(e.what()));
+        return false;
+    } catch (...) {
+        LOG_ERROR("Unknown error finalizing audio for job: " + jobId);
+        return false;
+    }
+}
+
+bool Processor::finalizeAudioFile(const JobId& jobId, WavWriter& wav) noexcept {
+    try {
+        auto processingPath = getJobPath("processing", jobId);
+        auto outputPath = getJobPath("output", jobId);
+
+        // Patch the header sizes, then publish the streamed file under its final name
+        if (!wav.finish()) return false;
+        std::filesystem::rename(processingPath / "audio.wav.partial", processingPath / "audio.wav");
+
+        // Atomic move to output
+        std::filesystem::rename(processingPath, outputPath);
+        recordFinished(jobId, Status::Done);
 
         LOG_DEBUG("TTS job finalized: " + jobId);
         return true;
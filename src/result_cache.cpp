@@ -0,0 +1,124 @@
+/*
+ * nrvna ai - Deterministic result cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "result_cache.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <unistd.h>
+
+namespace nrvnaai {
+
+namespace {
+
+bool linkOrCopy(const std::filesystem::path& src, const std::filesystem::path& dest) {
+    std::error_code ec;
+    std::filesystem::create_hard_link(src, dest, ec);
+    if (!ec) {
+        return true;
+    }
+    return std::filesystem::copy_file(src, dest, std::filesystem::copy_options::overwrite_existing, ec) && !ec;
+}
+
+// Keys are hex digests with a short suffix; nothing else becomes a path
+bool validKey(const std::string& key) {
+    return !key.empty() && key.size() <= 96 && std::all_of(key.begin(), key.end(), [](unsigned char c) {
+        return std::isalnum(c) != 0 || c == '-';
+    });
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::filesystem::path& workspace)
+    : root_(workspace / ".nrvna" / "results") {
+    std::error_code ec;
+    std::filesystem::create_directories(root_, ec);
+    if (ec) {
+        LOG_WARN("Result cache directory unavailable: " + root_.string() + " - " + ec.message());
+    }
+}
+
+std::optional<JobMeta> ResultCache::restore(const std::string& key, const std::filesystem::path& jobDir) const noexcept {
+    try {
+        if (!validKey(key)) {
+            return std::nullopt;
+        }
+        const auto entryDir = root_ / key;
+        auto entry = readMetaJson(entryDir);
+        if (!entry || entry->artifacts.empty()) {
+            return std::nullopt;
+        }
+        for (const auto& name : entry->artifacts) {
+            if (!linkOrCopy(entryDir / name, jobDir / name)) {
+                // Partial restore: undo it and let the job run normally
+                std::error_code ec;
+                for (const auto& undo : entry->artifacts) {
+                    std::filesystem::remove(jobDir / undo, ec);
+                }
+                LOG_WARN("Result cache entry unreadable, ignoring: " + key);
+                return std::nullopt;
+            }
+        }
+        return entry;
+    } catch (const std::exception& e) {
+        LOG_WARN("Result cache lookup failed: " + std::string(e.what()));
+        return std::nullopt;
+    }
+}
+
+void ResultCache::store(const std::string& key, const std::filesystem::path& jobDir, const JobMeta& meta) const noexcept {
+    static std::atomic<unsigned> counter{0};
+    std::error_code ec;
+    std::filesystem::path tempDir;
+    try {
+        if (!validKey(key)) {
+            return;
+        }
+        const auto entryDir = root_ / key;
+        if (std::filesystem::exists(entryDir, ec)) {
+            return;
+        }
+
+        tempDir = root_ / (".tmp-" + key + "-" + std::to_string(::getpid()) + "-" + std::to_string(counter++));
+        std::filesystem::create_directories(tempDir);
+
+        JobMeta entry;
+        entry.mode = meta.mode;
+        entry.status = "done";
+        entry.duration_s = 0.0;
+        entry.embedding_dim = meta.embedding_dim;
+        entry.embedding_count = meta.embedding_count;
+        entry.embedding_dtype = meta.embedding_dtype;
+        for (const auto& name : meta.artifacts) {
+            if (name == "session.bin") {
+                continue;
+            }
+            if (!linkOrCopy(jobDir / name, tempDir / name)) {
+                std::filesystem::remove_all(tempDir, ec);
+                return;
+            }
+            entry.artifacts.push_back(name);
+        }
+        if (entry.artifacts.empty() || !writeMetaJson(tempDir, entry)) {
+            std::filesystem::remove_all(tempDir, ec);
+            return;
+        }
+
+        // Fails when another worker published the key first; keep theirs
+        std::filesystem::rename(tempDir, entryDir, ec);
+        if (ec) {
+            std::filesystem::remove_all(tempDir, ec);
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to store result cache entry: " + std::string(e.what()));
+        if (!tempDir.empty()) {
+            std::filesystem::remove_all(tempDir, ec);
+        }
+    }
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,39 @@
+/*
+ * nrvna ai - Deterministic result cache (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/meta.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+// Finished artifacts of reproducible jobs under <workspace>/.nrvna/results/<key>/,
+// where the key fingerprints everything that determines the output (see
+// Runner::resultKey). An entry is a directory of hardlinks to the first
+// job's artifacts plus a meta.json carrying their names and embedding shape.
+// Entries are published with a rename, so concurrent workers storing the
+// same key leave exactly one.
+class ResultCache {
+public:
+    explicit ResultCache(const std::filesystem::path& workspace);
+
+    // Link (or copy) the cached artifacts into jobDir. The returned meta has
+    // artifacts and embedding shape set; nullopt on miss.
+    [[nodiscard]] std::optional<JobMeta> restore(const std::string& key, const std::filesystem::path& jobDir) const noexcept;
+
+    // Record a finished job's artifacts (session.bin is never cached)
+    void store(const std::string& key, const std::filesystem::path& jobDir, const JobMeta& meta) const noexcept;
+
+private:
+    std::filesystem::path root_;
+};
+
+} // namespace nrvnaai
@@ -7,246 +7,217 @@
 #include "nrvna/runner.hpp"
 #include "nrvna/logger.hpp"
 #include "llama_util.hpp"
+#include "hash.hpp"
+#include "prefix_cache.hpp"
+#include "image_cache.hpp"
+#include "model_registry.hpp"
+#include "kv_session.hpp"
+#include "partial_writer.hpp"
+#include "think_filter.hpp"
 #include "chat.h"
+#include "gguf.h"
 #include "llama.h"
 #include "mtmd.h"
 #include "mtmd-helper.h"
 #include <chrono>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
 #include <thread>
 #include <algorithm>
 
 namespace nrvnaai {
 
-// Static member definitions (model is shared, mtmd context is per-worker)
-std::shared_ptr<llama_model> Runner::shared_model_ = nullptr;
-std::string Runner::current_model_path_ = "";
-std::mutex Runner::model_mutex_;
-
-common_chat_templates* Runner::chat_templates_ = nullptr;
-
-// GGUF sampling defaults — hardcoded fallbacks until model is loaded
-float Runner::gguf_temp_           = 0.8f;
-int   Runner::gguf_top_k_          = 40;
-float Runner::gguf_top_p_          = 0.9f;
-float Runner::gguf_min_p_          = 0.05f;
-float Runner::gguf_repeat_penalty_ = 1.1f;
-int   Runner::gguf_repeat_last_n_  = 64;
-
-// Vision encoding mutex - serializes mtmd_helper_eval_chunks across all workers
-// because the underlying GGML compute graph has shared state that corrupts
-// when multiple vision encodings run simultaneously
-static std::mutex vision_encoding_mutex_;
-
-// Strip <think>...</think> blocks from reasoning models (DeepSeek-R1, QwQ, Qwen3, etc.)
-// Handles both closed (<think>...</think>) and unclosed (<think>... to end) blocks —
-// unclosed blocks occur when the model exhausts n_predict tokens while still reasoning.
-static std::string stripThinkBlocks(const std::string& text) {
-    std::string result = text;
-    size_t pos = 0;
-
-    // Strip <think>...</think> blocks (Qwen/DeepSeek style)
-    while ((pos = result.find("<think>", pos)) != std::string::npos) {
-        size_t end = result.find("</think>", pos);
-        if (end != std::string::npos) {
-            end += 8;
-            while (end < result.size() && (result[end] == ' ' || result[end] == '\t' || result[end] == '\n' || result[end] == '\r'))
-                ++end;
-            result.erase(pos, end - pos);
-        } else {
-            result.erase(pos);
-        }
+// Bounds concurrent mtmd_encode_chunk calls across workers. Only the image
+// encoder runs under it: text chunks and the projected image embeddings are
+// decoded on each worker's own llama_context. Every worker has its own
+// mtmd_context (clip graph, allocator, threads), so on CPU the encoders run
+// side by side; with the projector on a GPU backend the device is shared and
+// encodes stay serialized unless NRVNA_VISION_ENCODERS raises the limit.
+class VisionEncodeGate {
+public:
+    void setLimit(int limit) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_ = std::max(1, limit);
+        cv_.notify_all();
     }
 
-    // Strip <|channel>thought...<channel|> blocks (Gemma 4 style)
-    pos = 0;
-    while ((pos = result.find("<|channel>thought", pos)) != std::string::npos) {
-        size_t end = result.find("<channel|>", pos);
-        if (end != std::string::npos) {
-            end += 10;
-            while (end < result.size() && (result[end] == ' ' || result[end] == '\t' || result[end] == '\n' || result[end] == '\r'))
-                ++end;
-            result.erase(pos, end - pos);
-        } else {
-            result.erase(pos);
+    class Slot {
+    public:
+        explicit Slot(VisionEncodeGate& gate) : gate_(gate) {
+            std::unique_lock<std::mutex> lock(gate_.mutex_);
+            gate_.cv_.wait(lock, [&] { return gate_.active_ < gate_.limit_; });
+            ++gate_.active_;
         }
-    }
-
-    // Strip [Start thinking]...[/End thinking] or similar (Gemma 4 alternate)
-    pos = 0;
-    while ((pos = result.find("[Start thinking]", pos)) != std::string::npos) {
-        size_t end = result.find("[/End thinking]", pos);
-        if (end != std::string::npos) {
-            end += 15; // strlen("[/End thinking]")
-            while (end < result.size() && (result[end] == ' ' || result[end] == '\t' || result[end] == '\n' || result[end] == '\r'))
-                ++end;
-            result.erase(pos, end - pos);
-        } else {
-            // Also check for Thinking Process: pattern without explicit end
-            size_t thinkEnd = result.find("<channel|>", pos);
-            if (thinkEnd != std::string::npos) {
-                thinkEnd += 10;
-                while (thinkEnd < result.size() && (result[thinkEnd] == ' ' || result[thinkEnd] == '\t' || result[thinkEnd] == '\n' || result[thinkEnd] == '\r'))
-                    ++thinkEnd;
-                result.erase(pos, thinkEnd - pos);
-            } else {
-                result.erase(pos);
-            }
+        ~Slot() {
+            std::lock_guard<std::mutex> lock(gate_.mutex_);
+            --gate_.active_;
+            gate_.cv_.notify_one();
         }
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+    private:
+        VisionEncodeGate& gate_;
+    };
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    int limit_ = 1;
+    int active_ = 0;
+};
+
+static VisionEncodeGate vision_encode_gate_;
+
+// KV cache plus compute buffer of one context. The KV part is exact for
+// standard attention; the compute part (logits and attention scores of one
+// ubatch) is an upper-ish estimate, which is what admission wants.
+static std::size_t estimateContextBytes(const llama_model* model, uint32_t n_ctx, uint32_t n_ubatch, int type_kv) {
+    if (!model || n_ctx == 0) {
+        return 0;
     }
-
-    size_t start = result.find_first_not_of(" \t\n\r");
-    return (start == std::string::npos) ? "" : result.substr(start);
+    const int64_t n_layer = llama_model_n_layer(model);
+    const int64_t n_head = std::max(1, llama_model_n_head(model));
+    const int64_t n_head_kv = std::max(1, llama_model_n_head_kv(model));
+    const int64_t n_embd_kv = llama_model_n_embd(model) / n_head * n_head_kv;
+    const int64_t n_vocab = llama_vocab_n_tokens(llama_model_get_vocab(model));
+    const std::size_t kv = 2 * static_cast<std::size_t>(n_layer) *
+                           ggml_row_size(static_cast<ggml_type>(type_kv < 0 ? GGML_TYPE_F16 : type_kv),
+                                         n_embd_kv * static_cast<int64_t>(n_ctx));
+    const std::size_t compute = sizeof(float) * static_cast<std::size_t>(n_ubatch) *
+                                static_cast<std::size_t>(n_vocab + n_head * static_cast<int64_t>(n_ctx));
+    return kv + compute;
 }
 
-// Read GGUF metadata helpers
-static std::string readModelStrMeta(const llama_model* model, const char* key) {
-    char buf[256] = {};
-    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
-    return (n > 0) ? std::string(buf, static_cast<size_t>(n)) : std::string();
-}
+namespace {
 
-static float readModelFloatMeta(const llama_model* model, const char* key, float fallback) {
-    char buf[64] = {};
-    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
-    if (n > 0) {
-        try { return std::stof(std::string(buf, static_cast<size_t>(n))); }
-        catch (...) {}
+std::string ggufStr(const gguf_context* ctx, const std::string& key) {
+    const int64_t id = gguf_find_key(ctx, key.c_str());
+    if (id < 0 || gguf_get_kv_type(ctx, id) != GGUF_TYPE_STRING) {
+        return "";
     }
-    return fallback;
+    return gguf_get_val_str(ctx, id);
 }
 
-static int readModelIntMeta(const llama_model* model, const char* key, int fallback) {
-    char buf[64] = {};
-    int32_t n = llama_model_meta_val_str(model, key, buf, sizeof(buf));
-    if (n > 0) {
-        try { return std::stoi(std::string(buf, static_cast<size_t>(n))); }
-        catch (...) {}
+// Integer keys are written as u32 by llama.cpp's converters, but not always
+int64_t ggufInt(const gguf_context* ctx, const std::string& key, int64_t fallback) {
+    const int64_t id = gguf_find_key(ctx, key.c_str());
+    if (id < 0) {
+        return fallback;
+    }
+    switch (gguf_get_kv_type(ctx, id)) {
+        case GGUF_TYPE_UINT32: return gguf_get_val_u32(ctx, id);
+        case GGUF_TYPE_INT32:  return gguf_get_val_i32(ctx, id);
+        case GGUF_TYPE_UINT64: return static_cast<int64_t>(gguf_get_val_u64(ctx, id));
+        case GGUF_TYPE_INT64:  return gguf_get_val_i64(ctx, id);
+        default:               return fallback;
     }
-    return fallback;
 }
 
-static void restrictModelToCpu(llama_model_params& params) {
-    ggml_backend_dev_t cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
-    static ggml_backend_dev_t cpu_only_devices[2] = { nullptr, nullptr };
-    cpu_only_devices[0] = cpu_dev;
-    cpu_only_devices[1] = nullptr;
-    if (cpu_dev) {
-        params.devices = cpu_only_devices;
+uint64_t ggufTensorBytes(const gguf_context* ctx) {
+    uint64_t bytes = 0;
+    for (int64_t i = 0; i < gguf_get_n_tensors(ctx); ++i) {
+        bytes += gguf_get_tensor_size(ctx, i);
     }
+    return bytes;
 }
 
-// Populate ModelInfo from a loaded model pointer
-static ModelInfo buildModelInfoFromModel(const llama_model* model) {
-    ModelInfo info;
-    info.valid = true;
-
-    char desc_buf[256] = {};
-    llama_model_desc(model, desc_buf, sizeof(desc_buf));
-    info.desc = desc_buf;
-
-    info.arch = readModelStrMeta(model, "general.architecture");
-    info.n_ctx_train = llama_model_n_ctx_train(model);
-    info.model_size_bytes = llama_model_size(model);
-    info.has_chat_template = (llama_model_chat_template(model, nullptr) != nullptr);
-    info.has_encoder = llama_model_has_encoder(model);
-    info.has_decoder = llama_model_has_decoder(model);
-    info.n_embd_out = llama_model_n_embd_out(model);
-
-    return info;
-}
+} // namespace
 
 ModelInfo Runner::probeModelInfo(const std::string& modelPath) {
-    llama_log_set(filtered_llama_log, nullptr);
-    ggml_backend_load_all();
-
-    llama_model_params params = llama_model_default_params();
-    params.n_gpu_layers = 0;  // CPU only for probing — fast, no GPU contention
-    restrictModelToCpu(params);
-
-    llama_model* model = llama_model_load_from_file(modelPath.c_str(), params);
-    if (!model) {
+    // Header only: no_alloc with no ggml context reads keys and tensor
+    // descriptors, never tensor data
+    gguf_init_params params{};
+    params.no_alloc = true;
+    params.ctx = nullptr;
+    gguf_context* ctx = gguf_init_from_file(modelPath.c_str(), params);
+    if (!ctx) {
         LOG_ERROR("Failed to probe model: " + modelPath);
         return ModelInfo{};
     }
 
-    ModelInfo info = buildModelInfoFromModel(model);
-    llama_model_free(model);
+    ModelInfo info;
+    info.valid = true;
+    info.arch = ggufStr(ctx, "general.architecture");
+    info.desc = info.arch;
+    if (const std::string label = ggufStr(ctx, "general.size_label"); !label.empty()) {
+        info.desc += " " + label;
+    }
+    info.n_ctx_train = static_cast<int>(ggufInt(ctx, info.arch + ".context_length", 0));
+    info.has_chat_template = gguf_find_key(ctx, "tokenizer.chat_template") >= 0;
+    // Same rule as llama_model_has_encoder/has_decoder: decided by architecture
+    info.has_encoder = info.arch == "t5" || info.arch == "t5encoder";
+    info.has_decoder = info.arch != "t5encoder";
+    info.n_embd_out = static_cast<int>(ggufInt(ctx, info.arch + ".embedding_length_out",
+                                               ggufInt(ctx, info.arch + ".embedding_length", 0)));
+    info.model_size_bytes = ggufTensorBytes(ctx);
+
+    // Split models: the first file carries the metadata, every shard its own tensors
+    const int splits = static_cast<int>(ggufInt(ctx, "split.count", 1));
+    gguf_free(ctx);
+    if (splits > 1) {
+        char prefix[PATH_MAX] = {};
+        if (llama_split_prefix(prefix, sizeof(prefix), modelPath.c_str(), 0, splits) <= 0) {
+            LOG_WARN("Split model not named as the first shard, size covers it alone: " + modelPath);
+            return info;
+        }
+        for (int i = 1; i < splits; ++i) {
+            char shard[PATH_MAX] = {};
+            llama_split_path(shard, sizeof(shard), prefix, i, splits);
+            gguf_context* part = gguf_init_from_file(shard, params);
+            if (!part) {
+                LOG_WARN("Failed to probe model shard: " + std::string(shard));
+                continue;
+            }
+            info.model_size_bytes += ggufTensorBytes(part);
+            gguf_free(part);
+        }
+    }
     return info;
 }
 
 Runner::Runner(const std::string& modelPath) : Runner(modelPath, "", 1) {
 }
 
-Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers)
-    : mmproj_path_(mmprojPath) {
-    llama_log_set(filtered_llama_log, nullptr);
-    ggml_backend_load_all();
-
-    // Model loading is shared across workers (thread-safe)
-    {
-        std::lock_guard<std::mutex> lock(model_mutex_);
-        if (!shared_model_ || current_model_path_ != modelPath) {
-            LOG_INFO("Loading model: " + modelPath);
-
-            llama_model_params model_params = llama_model_default_params();
-
-            #if defined(__APPLE__)
-                model_params.n_gpu_layers = env_int("NRVNA_GPU_LAYERS", 99);
-            #else
-                model_params.n_gpu_layers = env_int("NRVNA_GPU_LAYERS", 0);
-            #endif
-            if (model_params.n_gpu_layers <= 0) {
-                restrictModelToCpu(model_params);
-            }
-
-            llama_model* model = llama_model_load_from_file(modelPath.c_str(), model_params);
-            if (!model) {
-                LOG_ERROR("Failed to load model: " + modelPath);
-                throw std::runtime_error("Failed to load model: " + modelPath);
-            }
-
-            // Free old chat templates before replacing model
-            if (chat_templates_) {
-                common_chat_templates_free(chat_templates_);
-                chat_templates_ = nullptr;
-            }
-
-            shared_model_ = std::shared_ptr<llama_model>(model, llama_model_free);
-            current_model_path_ = modelPath;
-
-            // Resolve GGUF sampling defaults once — log only when model provides a value
-            auto resolveGgufFloat = [&](const char* key, float hardcoded, float& out) {
-                float v = readModelFloatMeta(model, key, -1.0f);
-                if (v >= 0.0f) {
-                    LOG_INFO(std::string("Model sampling hint: ") + key + "=" + std::to_string(v));
-                    out = v;
-                } else {
-                    out = hardcoded;
-                }
-            };
-            auto resolveGgufInt = [&](const char* key, int hardcoded, int& out) {
-                int v = readModelIntMeta(model, key, -1);
-                if (v >= 0) {
-                    LOG_INFO(std::string("Model sampling hint: ") + key + "=" + std::to_string(v));
-                    out = v;
-                } else {
-                    out = hardcoded;
-                }
-            };
-            resolveGgufFloat("general.sampling.temp",           0.8f,  gguf_temp_);
-            resolveGgufInt  ("general.sampling.top_k",          40,    gguf_top_k_);
-            resolveGgufFloat("general.sampling.top_p",          0.9f,  gguf_top_p_);
-            resolveGgufFloat("general.sampling.min_p",          0.05f, gguf_min_p_);
-            resolveGgufFloat("general.sampling.penalty_repeat", 1.1f,  gguf_repeat_penalty_);
-            resolveGgufInt  ("general.sampling.penalty_last_n", 64,    gguf_repeat_last_n_);
-
-            LOG_INFO("Model loaded successfully");
+Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int numWorkers,
+               const WorkerThreads& threads)
+    : threads_(threads), mmproj_path_(mmprojPath) {
+    initLlamaBackend();
+
+    // Models are shared across workers through the registry (thread-safe);
+    // the daemon's own model stays resident
+    default_model_path_ = modelPath;
+    auto loaded = sharedModelRegistry().acquire(modelPath, true);
+    if (!loaded) {
+        throw std::runtime_error("Failed to load model: " + modelPath);
+    }
+    adoptModel(std::move(loaded));
+
+    // Prefix KV cache is opt-in: snapshots are large (KV bytes per token)
+    const int prefix_mb = std::max(0, env_int("NRVNA_PREFIX_CACHE_MB", 0));
+    const bool prefix_was_enabled = sharedPrefixCache().enabled();
+    sharedPrefixCache().configure(static_cast<std::size_t>(prefix_mb) * 1024 * 1024,
+                                  env_int("NRVNA_PREFIX_BLOCK", 256), fnv1a(modelPath));
+    if (prefix_mb > 0 && !prefix_was_enabled) {
+        LOG_INFO("Prefix cache enabled: " + std::to_string(prefix_mb) + " MB");
+    }
 
-            // Initialize chat templates (auto-detects Jinja vs legacy)
-            auto tmpl_ptr = common_chat_templates_init(shared_model_.get(), "", "", "");
-            chat_templates_ = tmpl_ptr.release();
+    // KV cache type: f16 unless NRVNA_KV_QUANT asks for less
+    if (const char* kv = std::getenv("NRVNA_KV_QUANT")) {
+        const std::string quant = kv;
+        if (quant == "q8_0") {
+            kv_type_ = GGML_TYPE_Q8_0;
+        } else if (quant == "q4_0") {
+            kv_type_ = GGML_TYPE_Q4_0;
+        } else if (quant == "auto") {
+            kv_auto_ = true;
+        } else if (!quant.empty() && quant != "f16") {
+            LOG_WARN("Unknown NRVNA_KV_QUANT '" + quant + "', using f16");
         }
     }
+    fit_contexts_ = env_int("NRVNA_MEM_BUDGET_MB", 0) > 0;
 
     // Each worker gets its own mtmd context (NOT thread-safe, so per-instance)
     // CRITICAL: Divide CPU threads among workers to prevent contention
@@ -257,11 +228,25 @@ Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int
 
         // Divide threads among workers to prevent parallel vision corruption
         int total_threads = std::thread::hardware_concurrency();
-        mparams.n_threads = std::max(1, total_threads / std::max(1, numWorkers));
+        mparams.n_threads = threads_.n_threads_batch > 0 ? threads_.n_threads_batch
+                                                         : std::max(1, total_threads / std::max(1, numWorkers));
         LOG_INFO("Vision threads per worker: " + std::to_string(mparams.n_threads) +
                  " (total: " + std::to_string(total_threads) + ", workers: " + std::to_string(numWorkers) + ")");
         mparams.print_timings = false;
 
+        const int encoders = env_int("NRVNA_VISION_ENCODERS", mparams.use_gpu ? 1 : std::max(1, numWorkers));
+        vision_encode_gate_.setLimit(encoders);
+        LOG_INFO("Concurrent vision encoders: " + std::to_string(std::max(1, encoders)));
+
+        // Projected embeddings depend only on the image and the projector
+        std::error_code ec;
+        const auto mmprojSize = std::filesystem::file_size(mmprojPath, ec);
+        const uint64_t projectorKey = fnv1a(&mmprojSize, sizeof(mmprojSize), fnv1a(mmprojPath));
+        const int image_mb = std::max(0, env_int("NRVNA_IMAGE_CACHE_MB", 256));
+        const char* spillDir = std::getenv("NRVNA_IMAGE_CACHE_DIR");
+        sharedImageEmbedCache().configure(static_cast<std::size_t>(image_mb) * 1024 * 1024,
+                                          spillDir ? spillDir : "", projectorKey);
+
         mtmd_context* ctx = mtmd_init_from_file(mmprojPath.c_str(), shared_model_.get(), mparams);
         if (!ctx) {
             LOG_WARN("Failed to load mmproj: " + mmprojPath + " - running in text-only mode");
@@ -274,10 +259,210 @@ Runner::Runner(const std::string& modelPath, const std::string& mmprojPath, int
     } else {
         mtmd_ctx_ = nullptr;
     }
+
+    createThreadpools();
+}
+
+void Runner::createThreadpools() {
+    if (threads_.cpus.empty()) {
+        return;
+    }
+    auto make = [](const std::vector<int>& cpus, int n_threads) -> ggml_threadpool* {
+        ggml_threadpool_params params = ggml_threadpool_params_default(std::max(1, n_threads));
+        for (int c : cpus) {
+            if (c >= 0 && c < GGML_MAX_N_THREADS) params.cpumask[c] = true;
+        }
+        return ggml_threadpool_new(&params);
+    };
+    threadpool_ = make(threads_.decode_cpus.empty() ? threads_.cpus : threads_.decode_cpus, threads_.n_threads);
+    threadpool_batch_ = make(threads_.cpus, threads_.n_threads_batch);
+    if (!threadpool_ || !threadpool_batch_) {
+        LOG_WARN("Failed to create pinned threadpools, using llama.cpp's per-call threads");
+        for (ggml_threadpool** tp : {&threadpool_, &threadpool_batch_}) {
+            if (*tp) ggml_threadpool_free(*tp);
+            *tp = nullptr;
+        }
+    }
+}
+
+void Runner::adoptModel(std::shared_ptr<const LoadedModel> loaded) {
+    loaded_ = std::move(loaded);
+    shared_model_ = loaded_->model;
+    shared_draft_model_ = loaded_->draft;
+    chat_templates_ = loaded_->templates;
+    model_path_ = loaded_->path;
+
+    const SamplingDefaults& d = loaded_->defaults;
+    gguf_temp_           = d.temp;
+    gguf_top_k_          = d.top_k;
+    gguf_top_p_          = d.top_p;
+    gguf_min_p_          = d.min_p;
+    gguf_repeat_penalty_ = d.repeat_penalty;
+    gguf_repeat_last_n_  = d.repeat_last_n;
+}
+
+bool Runner::useModel(const std::string& modelPath) {
+    if (modelPath == model_path_) {
+        return true;
+    }
+    auto loaded = sharedModelRegistry().acquire(modelPath);
+    if (!loaded) {
+        return false;
+    }
+    // Warm contexts were built against the old model
+    releaseContexts();
+    adoptModel(std::move(loaded));
+    LOG_DEBUG("Worker switched to model: " + modelPath);
+    return true;
 }
 
 Runner::~Runner() {
-    // chat_templates_ is static/shared — freed on model replacement, not per-instance
+    // Contexts go before loaded_ releases the model they were built on, and
+    // before the threadpools attached to them
+    releaseContexts();
+    for (ggml_threadpool* tp : {threadpool_, threadpool_batch_}) {
+        if (tp) ggml_threadpool_free(tp);
+    }
+}
+
+void Runner::applyKvType(llama_context_params& params) const {
+    const int type = kv_type_ >= 0 ? kv_type_ : (kv_auto_ && compact_kv_ ? GGML_TYPE_Q8_0 : -1);
+    if (type < 0) {
+        return;
+    }
+    params.type_k = static_cast<ggml_type>(type);
+    params.type_v = static_cast<ggml_type>(type);
+    // llama.cpp only quantizes the V cache with flash attention
+    params.flash_attn_type = LLAMA_FLASH_ATTN_TYPE_ENABLED;
+}
+
+std::size_t Runner::residentBytes() const noexcept {
+    return gen_ctx_.bytes + embed_ctx_.bytes + draft_ctx_.bytes;
+}
+
+std::size_t Runner::projectedBytes(const std::string& mode, int promptTokens, bool compactKv) const {
+    const llama_model* model = shared_model_.get();
+    const int max_ctx = std::min(llama_model_n_ctx_train(model), env_int("NRVNA_MAX_CTX", 8192));
+    const int type = kv_type_ >= 0 ? kv_type_ : (kv_auto_ && compactKv ? GGML_TYPE_Q8_0 : GGML_TYPE_F16);
+    // A warm slot is reused when big enough and of the same type, else rebuilt
+    auto grown = [&](const WarmContext& slot, const llama_model* m, uint32_t n_ctx, uint32_t n_ubatch) {
+        const bool reuse = slot.ctx && slot.n_ctx >= n_ctx && slot.type_k == type;
+        return reuse ? slot.bytes : estimateContextBytes(m, n_ctx, n_ubatch, type);
+    };
+
+    if (mode == "embed") {
+        const auto n_ctx = static_cast<uint32_t>(std::max(promptTokens + 1, max_ctx));
+        return gen_ctx_.bytes + draft_ctx_.bytes + grown(embed_ctx_, model, n_ctx, n_ctx);
+    }
+    const auto n_ctx = static_cast<uint32_t>(mode == "text" ? fittedContext(promptTokens, max_ctx) : max_ctx);
+    const auto n_ubatch = llama_context_default_params().n_ubatch;
+    std::size_t bytes = embed_ctx_.bytes + grown(gen_ctx_, model, n_ctx, n_ubatch);
+    if (shared_draft_model_ && mode == "text") {
+        bytes += grown(draft_ctx_, shared_draft_model_.get(), n_ctx, n_ubatch);
+    } else {
+        bytes += draft_ctx_.bytes;
+    }
+    return bytes;
+}
+
+int Runner::fittedContext(int promptTokens, int max_ctx) const {
+    if (!fit_contexts_) {
+        return max_ctx;
+    }
+    // Prompt, generation and headroom, in 1024-cell steps so similar jobs
+    // still reuse the warm context
+    int n_predict = env_int("NRVNA_PREDICT", 2048);
+    if (n_predict == 2048) {
+        n_predict = env_int("NRVNA_N_PREDICT", 2048);
+    }
+    const long need = static_cast<long>(promptTokens) + std::max(0, n_predict) + 64;
+    return static_cast<int>(std::min<long>(max_ctx, (need + 1023) / 1024 * 1024));
+}
+
+void Runner::releaseContexts() noexcept {
+    for (WarmContext* slot : {&gen_ctx_, &embed_ctx_, &draft_ctx_}) {
+        if (slot->ctx) {
+            llama_free(slot->ctx);
+        }
+        *slot = WarmContext{};
+    }
+}
+
+bool Runner::warmup() noexcept {
+    try {
+        llama_model* model = shared_model_.get();
+        if (!model || llama_model_has_encoder(model) || !llama_model_has_decoder(model)) {
+            return false;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const SamplingConfig config = buildSamplingConfig();
+        llama_context_params ctx_params;
+        buildContextParams(config, ctx_params);
+        ctx_params.n_ctx = static_cast<uint32_t>(fittedContext(0, config.max_ctx));
+        bool reused = false;
+        llama_context* ctx = acquireContext(gen_ctx_, ctx_params, reused);
+        if (!ctx) {
+            return false;
+        }
+
+        const llama_vocab* vocab = llama_model_get_vocab(model);
+        std::vector<llama_token> tokens;
+        for (llama_token t : {llama_vocab_bos(vocab), llama_vocab_eos(vocab)}) {
+            if (t != LLAMA_TOKEN_NULL) tokens.push_back(t);
+        }
+        if (tokens.empty()) {
+            tokens.push_back(0);
+        }
+        const bool ok = llama_decode(ctx, llama_batch_get_one(tokens.data(), static_cast<int32_t>(tokens.size()))) == 0;
+        llama_synchronize(ctx);
+        if (llama_memory_t mem = llama_get_memory(ctx)) {
+            llama_memory_clear(mem, true);
+        }
+        llama_perf_context_reset(ctx);
+        if (ok) {
+            LOG_INFO("Warmup decode: " + std::to_string(static_cast<int>(msSince(start))) + " ms");
+        }
+        return ok;
+    } catch (const std::exception& e) {
+        LOG_WARN("Warmup failed: " + std::string(e.what()));
+        return false;
+    }
+}
+
+llama_context* Runner::acquireContext(WarmContext& slot, const llama_context_params& params, bool& reused) {
+    return acquireContext(slot, shared_model_.get(), params, reused);
+}
+
+llama_context* Runner::acquireContext(WarmContext& slot, llama_model* model, const llama_context_params& params,
+                                      bool& reused) {
+    if (slot.ctx && slot.n_ctx >= params.n_ctx && slot.n_seq_max >= params.n_seq_max &&
+        slot.type_k == static_cast<int>(params.type_k)) {
+        if (llama_memory_t mem = llama_get_memory(slot.ctx)) {
+            llama_memory_clear(mem, true);
+        }
+        reused = true;
+        return slot.ctx;
+    }
+
+    if (slot.ctx) {
+        LOG_DEBUG("Rebuilding context: " + std::to_string(slot.n_ctx) + " -> " +
+                  std::to_string(params.n_ctx) + " tokens");
+        llama_free(slot.ctx);
+        slot = WarmContext{};
+    }
+
+    reused = false;
+    slot.ctx = llama_init_from_model(model, params);
+    if (slot.ctx) {
+        slot.n_ctx = llama_n_ctx(slot.ctx);
+        slot.n_seq_max = llama_n_seq_max(slot.ctx);
+        slot.type_k = static_cast<int>(params.type_k);
+        slot.bytes = estimateContextBytes(model, slot.n_ctx, std::min(params.n_ubatch, params.n_batch), params.type_k);
+        if (threadpool_) {
+            llama_attach_threadpool(slot.ctx, threadpool_, threadpool_batch_);
+        }
+    }
+    return slot.ctx;
 }
 
 Runner::SamplingConfig Runner::buildSamplingConfig() const {
@@ -308,11 +493,17 @@ Runner::SamplingConfig Runner::buildSamplingConfig() const {
     return config;
 }
 
-void Runner::buildContextParams(int n_prompt, const SamplingConfig& config, llama_context_params& params) const {
+void Runner::buildContextParams(const SamplingConfig& config, llama_context_params& params) const {
     params = llama_context_default_params();
-    params.n_ctx = std::min(n_prompt + config.n_predict + 64, config.max_ctx);
+    // Sized to max_ctx rather than per prompt so one warm context serves every job
+    params.n_ctx = config.max_ctx;
     params.n_batch = env_int("NRVNA_BATCH", 2048);  // Match reference CLI default
     params.no_perf = false;
+    if (threads_.n_threads > 0) {
+        params.n_threads = threads_.n_threads;
+        params.n_threads_batch = threads_.n_threads_batch;
+    }
+    applyKvType(params);
 
     if (env_int("NRVNA_GPU_LAYERS", 0) <= 0) {
         params.offload_kqv = false;
@@ -320,6 +511,32 @@ void Runner::buildContextParams(int n_prompt, const SamplingConfig& config, llam
     }
 }
 
+void Runner::buildEmbedContextParams(int n_tokens, llama_context_params& params, int n_seqs) const {
+    const int n_ctx_train = llama_model_n_ctx_train(shared_model_.get());
+    const int max_ctx = std::min(n_ctx_train, env_int("NRVNA_MAX_CTX", 8192));
+    const int n_ctx = std::max(n_tokens + 1, max_ctx);
+
+    params = llama_context_default_params();
+    params.n_ctx = n_ctx;
+    params.n_batch = n_ctx;
+    params.n_ubatch = n_ctx;  // encoder requires n_ubatch >= n_tokens
+    params.embeddings = true;
+    params.pooling_type = LLAMA_POOLING_TYPE_MEAN;  // Mean pooling for sentence embeddings
+    params.n_seq_max = static_cast<uint32_t>(std::max(1, n_seqs));
+    params.kv_unified = true;  // every sequence may use the whole n_ctx
+    params.no_perf = false;
+    if (threads_.n_threads > 0) {
+        // One forward pass over the whole input: prefill work throughout
+        params.n_threads = threads_.n_threads_batch;
+        params.n_threads_batch = threads_.n_threads_batch;
+    }
+    applyKvType(params);
+    if (env_int("NRVNA_GPU_LAYERS", 0) <= 0) {
+        params.offload_kqv = false;
+        params.op_offload = false;
+    }
+}
+
 llama_sampler* Runner::buildSampler(const SamplingConfig& config) const {
     auto sparams = llama_sampler_chain_default_params();
     sparams.no_perf = false;
@@ -342,51 +559,52 @@ llama_sampler* Runner::buildSampler(const SamplingConfig& config) const {
 }
 
 RunResult Runner::run(const std::string& prompt) {
-    return runText(prompt);
+    return runText(prompt, {});
+}
+
+RunResult Runner::run(const std::string& prompt, const RunOptions& options) {
+    return runText(prompt, options);
 }
 
 EmbedResult Runner::embed(const std::string& text) {
     if (!shared_model_) {
-        return {false, {}, "Model not loaded"};
+        return {false, {}, "Model not loaded", {}};
     }
 
     try {
+        const auto runStart = std::chrono::steady_clock::now();
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
 
         // Tokenize input
         const int n_tokens = -llama_tokenize(vocab, text.c_str(), text.size(), nullptr, 0, true, true);
         if (n_tokens <= 0) {
-            return {false, {}, "Failed to tokenize input"};
+            return {false, {}, "Failed to tokenize input", {}};
         }
 
         std::vector<llama_token> tokens(n_tokens);
         if (llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), tokens.size(), true, true) < 0) {
-            return {false, {}, "Failed to tokenize input"};
+            return {false, {}, "Failed to tokenize input", {}};
         }
 
-        // Create context with embedding mode enabled
-        llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = tokens.size() + 1;
-        ctx_params.n_batch = tokens.size();
-        ctx_params.n_ubatch = tokens.size();  // encoder requires n_ubatch >= n_tokens
-        ctx_params.embeddings = true;
-        ctx_params.pooling_type = LLAMA_POOLING_TYPE_MEAN;  // Mean pooling for sentence embeddings
-        if (env_int("NRVNA_GPU_LAYERS", 0) <= 0) {
-            ctx_params.offload_kqv = false;
-            ctx_params.op_offload = false;
-        }
+        // Embedding context with embedding mode enabled (warm, reused across jobs)
+        llama_context_params ctx_params;
+        buildEmbedContextParams(static_cast<int>(tokens.size()), ctx_params);
 
-        llama_context* ctx = llama_init_from_model(shared_model_.get(), ctx_params);
+        RunStats stats;
+        llama_context* ctx = acquireContext(embed_ctx_, ctx_params, stats.context_reused);
         if (!ctx) {
-            return {false, {}, "Failed to create embedding context"};
+            return {false, {}, "Failed to create embedding context", {}};
         }
+        stats.setup_ms = msSince(runStart);
+        stats.prompt_tokens = n_tokens;
 
         // Create batch and decode
+        const auto promptStart = std::chrono::steady_clock::now();
         llama_batch batch = llama_batch_get_one(tokens.data(), tokens.size());
         if (llama_decode(ctx, batch) != 0) {
-            llama_free(ctx);
-            return {false, {}, "Failed to decode for embeddings"};
+            return {false, {}, "Failed to decode for embeddings", stats};
         }
+        stats.prompt_ms = msSince(promptStart);
 
         // Get embeddings
         float* emb = llama_get_embeddings_seq(ctx, 0);
@@ -396,13 +614,11 @@ EmbedResult Runner::embed(const std::string& text) {
         }
 
         if (!emb) {
-            llama_free(ctx);
-            return {false, {}, "Failed to get embeddings"};
+            return {false, {}, "Failed to get embeddings", stats};
         }
 
         int n_embd = llama_model_n_embd_out(shared_model_.get());
         std::vector<float> embedding(emb, emb + n_embd);
-        llama_free(ctx);
 
         // L2 normalize — upstream does this in common_embd_normalize(, , , 2)
         // Without it, stored vectors aren't unit length, forcing every consumer
@@ -415,37 +631,170 @@ EmbedResult Runner::embed(const std::string& text) {
         }
 
         LOG_INFO("Generated embedding with " + std::to_string(n_embd) + " dimensions (L2 normalized)");
-        return {true, std::move(embedding), ""};
+        return {true, std::move(embedding), "", stats};
+
+    } catch (const std::exception& e) {
+        LOG_ERROR("Embedding error: " + std::string(e.what()));
+        return {false, {}, "Embedding error: " + std::string(e.what()), {}};
+    }
+}
+
+std::vector<EmbedResult> Runner::embedBatch(const std::vector<std::string>& texts, int maxSeqs) {
+    std::vector<EmbedResult> results(texts.size());
+    if (!shared_model_) {
+        for (auto& r : results) r.error = "Model not loaded";
+        return results;
+    }
+
+    llama_batch batch{};
+    bool batch_owned = false;
+    try {
+        const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
+        const int n_embd = llama_model_n_embd_out(shared_model_.get());
+        const int n_ctx_train = llama_model_n_ctx_train(shared_model_.get());
+        const int cap = std::min(n_ctx_train, env_int("NRVNA_MAX_CTX", 8192));
+        maxSeqs = std::max(1, maxSeqs);
+
+        std::vector<std::vector<llama_token>> tokens(texts.size());
+        for (std::size_t i = 0; i < texts.size(); ++i) {
+            const std::string& text = texts[i];
+            const int n = -llama_tokenize(vocab, text.c_str(), text.size(), nullptr, 0, true, true);
+            if (n <= 0) {
+                results[i].error = "Failed to tokenize input";
+                continue;
+            }
+            tokens[i].resize(n);
+            if (llama_tokenize(vocab, text.c_str(), text.size(), tokens[i].data(), tokens[i].size(), true, true) < 0) {
+                results[i].error = "Failed to tokenize input";
+                tokens[i].clear();
+            }
+        }
+
+        // Greedy packing in input order: a group closes when the next text would
+        // overflow the one-ubatch token budget or the sequence count. A text longer
+        // than the budget gets a group (and a larger context) of its own.
+        std::size_t next = 0;
+        while (next < texts.size()) {
+            std::vector<std::size_t> group;
+            int n_group = 0;
+            for (; next < texts.size() && static_cast<int>(group.size()) < maxSeqs; ++next) {
+                if (tokens[next].empty()) {
+                    continue;
+                }
+                const int n = static_cast<int>(tokens[next].size());
+                if (!group.empty() && n_group + n > cap) {
+                    break;
+                }
+                group.push_back(next);
+                n_group += n;
+            }
+            if (group.empty()) {
+                continue;
+            }
+
+            const auto groupStart = std::chrono::steady_clock::now();
+            llama_context_params ctx_params;
+            buildEmbedContextParams(n_group, ctx_params, maxSeqs);
+
+            RunStats stats;
+            llama_context* ctx = acquireContext(embed_ctx_, ctx_params, stats.context_reused);
+            if (!ctx) {
+                for (std::size_t i : group) results[i] = {false, {}, "Failed to create embedding context", stats};
+                continue;
+            }
+            stats.setup_ms = msSince(groupStart);
+
+            batch = llama_batch_init(n_group, 0, 1);
+            batch_owned = true;
+            batch.n_tokens = 0;
+            for (std::size_t s = 0; s < group.size(); ++s) {
+                const auto& seq_tokens = tokens[group[s]];
+                for (std::size_t p = 0; p < seq_tokens.size(); ++p) {
+                    const int k = batch.n_tokens++;
+                    batch.token[k] = seq_tokens[p];
+                    batch.pos[k] = static_cast<llama_pos>(p);
+                    batch.n_seq_id[k] = 1;
+                    batch.seq_id[k][0] = static_cast<llama_seq_id>(s);
+                    batch.logits[k] = true;
+                }
+            }
+
+            const auto promptStart = std::chrono::steady_clock::now();
+            const bool decoded = llama_decode(ctx, batch) == 0;
+            stats.prompt_ms = msSince(promptStart);  // shared by the whole group
+            for (std::size_t s = 0; s < group.size(); ++s) {
+                EmbedResult& result = results[group[s]];
+                result.stats = stats;
+                result.stats.prompt_tokens = static_cast<int>(tokens[group[s]].size());
+                if (!decoded) {
+                    result.error = "Failed to decode for embeddings";
+                    continue;
+                }
+                const float* emb = llama_get_embeddings_seq(ctx, static_cast<llama_seq_id>(s));
+                if (!emb) {
+                    result.error = "Failed to get embeddings";
+                    continue;
+                }
+                result.embedding.assign(emb, emb + n_embd);
+
+                // L2 normalize — same as embed()
+                double norm = 0.0;
+                for (float v : result.embedding) { norm += v * v; }
+                norm = std::sqrt(norm);
+                if (norm > 0.0) {
+                    for (float& v : result.embedding) { v /= norm; }
+                }
+                result.ok = true;
+            }
+            llama_batch_free(batch);
+            batch_owned = false;
+
+            LOG_INFO("Generated " + std::to_string(group.size()) + " embeddings in one batch (" +
+                     std::to_string(n_group) + " tokens)");
+        }
+        return results;
 
     } catch (const std::exception& e) {
+        if (batch_owned) {
+            llama_batch_free(batch);
+        }
         LOG_ERROR("Embedding error: " + std::string(e.what()));
-        return {false, {}, "Embedding error: " + std::string(e.what())};
+        for (auto& r : results) {
+            if (!r.ok && r.error.empty()) r.error = "Embedding error: " + std::string(e.what());
+        }
+        return results;
     }
 }
 
-EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths) {
+EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                                const std::vector<std::string>& imageHashes) {
     if (!shared_model_) {
-        return {false, {}, "Model not loaded"};
+        return {false, {}, "Model not loaded", {}};
     }
 
     if (!mtmd_ctx_) {
-        return {false, {}, "Vision embedding requires --mmproj flag"};
+        return {false, {}, "Vision embedding requires --mmproj flag", {}};
+    }
+    if (model_path_ != default_model_path_) {
+        return {false, {}, "Vision embedding requires the daemon's own model", {}};
     }
 
     if (imagePaths.empty()) {
-        return {false, {}, "No images provided for vision embedding"};
+        return {false, {}, "No images provided for vision embedding", {}};
     }
 
     mtmd_input_chunks* chunks = nullptr;
     std::vector<mtmd_bitmap*> bitmaps;
-    llama_context* ctx = nullptr;
+    RunStats stats;
     try {
+        const auto runStart = std::chrono::steady_clock::now();
         const char* marker = mtmd_default_marker();
         std::string formatted_prompt = formatMultimodalPrompt(prompt, imagePaths.size(), marker);
 
-        bitmaps = loadImages(imagePaths);
+        ImageCacheJob cache;
+        bitmaps = loadImages(imagePaths, imageHashes, cache);
         if (bitmaps.empty()) {
-            return {false, {}, "Failed to load image(s)"};
+            return {false, {}, "Failed to load image(s)", {}};
         }
 
         mtmd_input_text text;
@@ -456,7 +805,7 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
         chunks = mtmd_input_chunks_init();
         if (!chunks) {
             freeBitmaps(bitmaps);
-            return {false, {}, "Failed to init image chunks"};
+            return {false, {}, "Failed to init image chunks", {}};
         }
 
         std::vector<const mtmd_bitmap*> bitmap_ptrs;
@@ -470,52 +819,44 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
             mtmd_input_chunks_free(chunks);
             chunks = nullptr;
             freeBitmaps(bitmaps);
-            return {false, {}, "Failed to tokenize multimodal prompt"};
+            return {false, {}, "Failed to tokenize multimodal prompt", {}};
         }
 
         const int n_prompt = static_cast<int>(mtmd_helper_get_n_tokens(chunks));
-        llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = std::max(n_prompt + 8, 128);
-        ctx_params.n_batch = std::max(1, std::min(n_prompt, env_int("NRVNA_BATCH", 2048)));
-        ctx_params.embeddings = true;
-        ctx_params.pooling_type = LLAMA_POOLING_TYPE_MEAN;
-        ctx_params.no_perf = false;
-        if (env_int("NRVNA_GPU_LAYERS", 0) <= 0) {
-            ctx_params.offload_kqv = false;
-            ctx_params.op_offload = false;
-        }
-
-        ctx = llama_init_from_model(shared_model_.get(), ctx_params);
+        const int n_batch = std::max(1, std::min(n_prompt, env_int("NRVNA_BATCH", 2048)));
+        llama_context_params ctx_params;
+        buildEmbedContextParams(n_prompt + 8, ctx_params);
+
+        llama_context* ctx = acquireContext(embed_ctx_, ctx_params, stats.context_reused);
         if (!ctx) {
             mtmd_input_chunks_free(chunks);
             chunks = nullptr;
             freeBitmaps(bitmaps);
-            return {false, {}, "Failed to create embedding context"};
+            return {false, {}, "Failed to create embedding context", {}};
         }
+        stats.setup_ms = msSince(runStart);
+        stats.prompt_tokens = n_prompt;
 
+        const auto promptStart = std::chrono::steady_clock::now();
         llama_pos n_past = 0;
-        {
-            std::lock_guard<std::mutex> vision_lock(vision_encoding_mutex_);
-            if (mtmd_helper_eval_chunks(mtmd_ctx_, ctx, chunks, 0, 0, ctx_params.n_batch, true, &n_past) != 0) {
-                llama_free(ctx);
-                mtmd_input_chunks_free(chunks);
-                chunks = nullptr;
-                freeBitmaps(bitmaps);
-                return {false, {}, "Failed to eval multimodal prompt"};
-            }
+        if (!evalChunks(ctx, chunks, n_batch, n_past, cache)) {
+            mtmd_input_chunks_free(chunks);
+            chunks = nullptr;
+            freeBitmaps(bitmaps);
+            return {false, {}, "Failed to eval multimodal prompt", stats};
         }
 
         mtmd_input_chunks_free(chunks);
         chunks = nullptr;
         freeBitmaps(bitmaps);
+        stats.prompt_ms = msSince(promptStart);
 
         float* emb = llama_get_embeddings_seq(ctx, 0);
         if (!emb) {
             emb = llama_get_embeddings_ith(ctx, -1);
         }
         if (!emb) {
-            llama_free(ctx);
-            return {false, {}, "Failed to get multimodal embeddings"};
+            return {false, {}, "Failed to get multimodal embeddings", stats};
         }
 
         int n_embd = llama_model_n_embd_out(shared_model_.get());
@@ -523,12 +864,10 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
             n_embd = llama_model_n_embd(shared_model_.get());
         }
         if (n_embd <= 0) {
-            llama_free(ctx);
-            return {false, {}, "Invalid embedding dimension"};
+            return {false, {}, "Invalid embedding dimension", stats};
         }
 
         std::vector<float> embedding(emb, emb + n_embd);
-        llama_free(ctx);
 
         // L2 normalize — same as embed(), matches upstream common_embd_normalize(, , , 2)
         double norm = 0.0;
@@ -540,41 +879,90 @@ EmbedResult Runner::embedVision(const std::string& prompt, const std::vector<std
 
         LOG_INFO("Generated multimodal embedding with " + std::to_string(n_embd) +
                  " dimensions from " + std::to_string(imagePaths.size()) + " image(s)");
-        return {true, std::move(embedding), ""};
+        return {true, std::move(embedding), "", stats};
 
     } catch (const std::exception& e) {
-        if (ctx) {
-            llama_free(ctx);
-        }
         if (chunks) {
             mtmd_input_chunks_free(chunks);
         }
         freeBitmaps(bitmaps);
         LOG_ERROR("Vision embedding error: " + std::string(e.what()));
-        return {false, {}, "Vision embedding error: " + std::string(e.what())};
+        return {false, {}, "Vision embedding error: " + std::string(e.what()), {}};
+    }
+}
+
+std::string Runner::resultKey(const std::string& mode, const std::string& prompt,
+                              const std::vector<std::string>& imageHashes, const RunOptions& options) {
+    if (!shared_model_) {
+        return "";
+    }
+    const std::string& modelPath = model_path_;
+    std::error_code ec;
+    const auto modelSize = std::filesystem::file_size(modelPath, ec);
+
+    // SHA-256 over length-prefixed fields: anyone who can submit a job could
+    // craft a collision with a 64-bit hash and plant what another job is served
+    Sha256 sha;
+    sha.field(modelPath);
+    sha.update(&modelSize, sizeof(modelSize));
+    sha.field(mode);
+    const uint64_t nImages = imageHashes.size();
+    sha.update(&nImages, sizeof(nImages));
+    for (const auto& hash : imageHashes) {
+        sha.field(hash);
+    }
+
+    if (mode == "embed") {
+        // Pooling and normalization are fixed; the raw prompt determines the vector
+        sha.field(prompt);
+        return sha.hex();
+    }
+
+    SamplingConfig config = buildSamplingConfig();
+    if (!imageHashes.empty()) {
+        config.temp = env_float("NRVNA_VISION_TEMP", 0.3f);
+    }
+    if (config.temp > 0.0f && config.seed == LLAMA_DEFAULT_SEED) {
+        return "";
     }
+    const std::string formatted = imageHashes.empty()
+        ? formatPrompt(prompt, options.history)
+        : formatMultimodalPrompt(prompt, imageHashes.size(), mtmd_default_marker());
+    sha.field(formatted);
+    const float floats[] = {config.temp, config.top_p, config.min_p, config.repeat_penalty};
+    const int32_t ints[] = {config.top_k, config.repeat_last_n, config.n_predict, config.max_ctx,
+                            static_cast<int32_t>(config.seed), options.think_budget};
+    sha.update(floats, sizeof(floats));
+    sha.update(ints, sizeof(ints));
+    return sha.hex();
 }
 
 RunResult Runner::run(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths) {
+    return run(prompt, imagePaths, {});
+}
+
+RunResult Runner::run(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                      const RunOptions& options) {
     if (imagePaths.empty()) {
-        return runText(prompt);
+        return runText(prompt, options);
     }
-    return runVision(prompt, imagePaths);
+    return runVision(prompt, imagePaths, options);
 }
 
-RunResult Runner::runText(const std::string& prompt) {
+RunResult Runner::runText(const std::string& prompt, const RunOptions& options) {
     if (!shared_model_) {
-        return {false, "", "Model not loaded"};
+        return {false, "", "Model not loaded", {}};
     }
     
     llama_sampler* smpl = nullptr;
     try {
+        const auto runStart = std::chrono::steady_clock::now();
         SamplingConfig config = buildSamplingConfig();
-        std::string formatted_prompt = formatPrompt(prompt);
+        std::string formatted_prompt = formatPrompt(prompt, options.history);
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
         const int n_prompt = -llama_tokenize(vocab, formatted_prompt.c_str(), formatted_prompt.size(), NULL, 0, true, true);
         if (n_prompt <= 0) {
-            return {false, "", "Failed to tokenize input"};
+            return {false, "", "Failed to tokenize input", {}};
         }
 
         int max_predict = config.max_ctx - n_prompt - 64;
@@ -585,19 +973,25 @@ RunResult Runner::runText(const std::string& prompt) {
 
         std::vector<llama_token> prompt_tokens(n_prompt);
         if (llama_tokenize(vocab, formatted_prompt.c_str(), formatted_prompt.size(), prompt_tokens.data(), prompt_tokens.size(), true, true) < 0) {
-            return {false, "", "Failed to tokenize the prompt"};
+            return {false, "", "Failed to tokenize the prompt", {}};
         }
 
         llama_context_params ctx_params;
-        buildContextParams(n_prompt, config, ctx_params);
-        llama_context* ctx = llama_init_from_model(shared_model_.get(), ctx_params);
+        buildContextParams(config, ctx_params);
+        ctx_params.n_ctx = static_cast<uint32_t>(fittedContext(n_prompt, config.max_ctx));
+        RunStats stats;
+        llama_context* ctx = acquireContext(gen_ctx_, ctx_params, stats.context_reused);
         if (!ctx) {
-            return {false, "", "Failed to create context"};
+            return {false, "", "Failed to create context", {}};
         }
 
-        LOG_DEBUG("Context: " + std::to_string(ctx_params.n_ctx) + " tokens");
+        LOG_DEBUG("Context: " + std::to_string(gen_ctx_.n_ctx) + " tokens" +
+                  (stats.context_reused ? " (reused)" : ""));
 
         smpl = buildSampler(config);
+        stats.setup_ms = msSince(runStart);
+        stats.prompt_tokens = n_prompt;
+        const auto promptStart = std::chrono::steady_clock::now();
 
         llama_token decoder_start_token_id = 0;
         if (llama_model_has_encoder(shared_model_.get())) {
@@ -605,8 +999,7 @@ RunResult Runner::runText(const std::string& prompt) {
             if (llama_encode(ctx, enc_batch)) {
                 LOG_ERROR("Failed to encode");
                 llama_sampler_free(smpl);
-                llama_free(ctx);
-                return {false, "", "Failed to encode"};
+                return {false, "", "Failed to encode", stats};
             }
 
             decoder_start_token_id = llama_model_decoder_start_token(shared_model_.get());
@@ -617,6 +1010,7 @@ RunResult Runner::runText(const std::string& prompt) {
 
         // Decode prompt in n_batch-sized chunks (reference: simple.cpp)
         int n_batch = ctx_params.n_batch;
+        llama_context* dctx = nullptr;
 
         if (decoder_start_token_id != 0) {
             // Encoder model: decode the start token
@@ -624,58 +1018,192 @@ RunResult Runner::runText(const std::string& prompt) {
             if (llama_decode(ctx, start_batch)) {
                 LOG_ERROR("Failed to decode start token");
                 llama_sampler_free(smpl);
-                llama_free(ctx);
-                return {false, "", "Failed to decode start token"};
+                return {false, "", "Failed to decode start token", stats};
             }
         } else {
+            // Resume the parent's session, or else restore the longest cached shared
+            // prefix, then prefill only the rest. When this job completes a prefix
+            // other jobs reached too, the prefill pauses at that boundary for a snapshot.
+            PrefixCache& cache = sharedPrefixCache();
+            const bool use_prefix = model_path_ == default_model_path_ && cache.enabled();
+            int n_cached = 0;
+            int store_at = 0;
+            if (!options.resume_session.empty()) {
+                n_cached = restoreSession(ctx, 0, options.resume_session, prompt_tokens, gen_ctx_.n_ctx);
+                stats.session_restored_tokens = n_cached;
+            }
+            if (n_cached == 0 && use_prefix) {
+                PrefixCache::Hit hit = cache.lookup(prompt_tokens);
+                if (hit.state && llama_state_seq_set_data(ctx, hit.state->data(), hit.state->size(), 0) != 0) {
+                    n_cached = hit.n_tokens;
+                    LOG_DEBUG("Prefix cache hit: " + std::to_string(n_cached) + "/" + std::to_string(n_prompt) + " tokens");
+                } else if (hit.state) {
+                    llama_memory_seq_rm(llama_get_memory(ctx), 0, -1, -1);
+                }
+            }
+            if (use_prefix) {
+                store_at = cache.observe(prompt_tokens, n_cached);
+            }
+            stats.prefix_cached_tokens = n_cached - stats.session_restored_tokens;
+
             // Standard model: decode prompt in chunks
-            for (int i = 0; i < n_prompt; i += n_batch) {
-                int n_eval = std::min(n_batch, n_prompt - i);
+            for (int i = n_cached; i < n_prompt;) {
+                const int end = store_at > i ? store_at : n_prompt;
+                int n_eval = std::min(n_batch, end - i);
                 llama_batch batch = llama_batch_get_one(prompt_tokens.data() + i, n_eval);
                 if (llama_decode(ctx, batch)) {
                     LOG_ERROR("Failed to decode prompt chunk");
                     llama_sampler_free(smpl);
-                    llama_free(ctx);
-                    return {false, "", "Failed to decode prompt"};
+                    return {false, "", "Failed to decode prompt", stats};
+                }
+                i += n_eval;
+
+                if (i == store_at) {
+                    std::vector<uint8_t> state(llama_state_seq_get_size(ctx, 0));
+                    if (!state.empty() && llama_state_seq_get_data(ctx, state.data(), state.size(), 0) == state.size()) {
+                        cache.insert(prompt_tokens, store_at, std::move(state));
+                    }
+                }
+            }
+
+            // The draft model prefills the whole prompt; it has no session or
+            // prefix cache, but is small enough that this is cheap
+            if (shared_draft_model_ && config.n_predict > 1) {
+                bool draft_reused = false;
+                dctx = acquireContext(draft_ctx_, shared_draft_model_.get(), ctx_params, draft_reused);
+                for (int i = 0; dctx && i < n_prompt; i += n_batch) {
+                    const int n_eval = std::min(n_batch, n_prompt - i);
+                    llama_batch batch = llama_batch_get_one(prompt_tokens.data() + i, n_eval);
+                    if (llama_decode(dctx, batch)) {
+                        LOG_WARN("Draft prefill failed, decoding without speculation");
+                        dctx = nullptr;
+                    }
                 }
             }
         }
 
-        std::string output;
+        std::size_t output_bytes = 0;
         llama_token new_token_id;
 
-        int generated = 0;
-        for (; generated < config.n_predict; ) {
-            new_token_id = llama_sampler_sample(smpl, ctx, -1);
-            llama_sampler_accept(smpl, new_token_id);
 
-            if (llama_vocab_is_eog(vocab, new_token_id)) {
-                break;
-            }
+        // Reasoning blocks are split off as tokens arrive; only the answer streams
+        ThinkFilter think(formatted_prompt);
+        PartialWriter thinking;
+        if (!options.thinking_path.empty() && thinking.open(options.thinking_path)) {
+            think.setSink(&thinking);
+        }
+        PartialWriter stream;
+        if (!options.stream_path.empty() && stream.open(options.stream_path)) {
+            think.setAnswerSink(&stream);
+        }
+        bool close_pending = false;
 
+        // Everything decoded into the sequence, for session.bin
+        std::vector<llama_token> history;
+        if (!options.save_session.empty()) {
+            history = prompt_tokens;
+        }
+
+        // Append one sampled token to the output; false ends generation, or
+        // pauses it with close_pending once the think budget is spent
+        auto emit = [&](llama_token token) {
+            if (llama_vocab_is_eog(vocab, token)) {
+                return false;
+            }
+            if (options.think_budget > 0 && think.thinking() && think.blockTokens() >= options.think_budget) {
+                close_pending = true;
+                return false;
+            }
             char buf[128];
-            int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
+            int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
             if (n < 0) {
                 LOG_ERROR("Failed to convert token to piece");
-                break;
+                return false;
             }
+            output_bytes += static_cast<std::size_t>(n);
+            think.feed(buf, static_cast<std::size_t>(n));
+            return true;
+        };
+        // The sampled token that hit the budget is dropped for the closing marker
+        auto force_close = [&]() {
+            close_pending = false;
+            const std::string text = think.closingText();
+            if (!closeThinking(ctx, smpl, text, nullptr, options.save_session.empty() ? nullptr : &history)) {
+                LOG_WARN("Failed to close the reasoning block at the think budget");
+                return false;
+            }
+            LOG_DEBUG("Think budget reached after " + std::to_string(think.blockTokens()) + " tokens in the block");
+            output_bytes += text.size();
+            think.feed(text);
+            stats.think_capped = true;
+            return true;
+        };
 
-            output.append(buf, n);
+        int generated = 0;
+        std::chrono::steady_clock::time_point decodeStart;
+        if (dctx && config.n_predict > 0) {
+            new_token_id = llama_sampler_sample(smpl, ctx, -1);
+            llama_sampler_accept(smpl, new_token_id);
+            decodeStart = std::chrono::steady_clock::now();
+            stats.prompt_ms = msSince(promptStart);
+            stats.ttft_ms = msSince(runStart);
+
+            std::vector<llama_token> seq = prompt_tokens;
+            generated = generateSpeculative(ctx, dctx, smpl, seq, new_token_id, config.n_predict, emit, stats);
+            if (!options.save_session.empty()) {
+                history = std::move(seq);
+            }
+            // Speculation stops at the budget; the answer decodes token by token
+            if (close_pending && generated < config.n_predict && force_close()) {
+                dctx = nullptr;
+            }
+        }
+        for (; !dctx && generated < config.n_predict; ) {
+            new_token_id = llama_sampler_sample(smpl, ctx, -1);
+            llama_sampler_accept(smpl, new_token_id);
+            if (generated == 0) {
+                decodeStart = std::chrono::steady_clock::now();
+                stats.prompt_ms = msSince(promptStart);
+                stats.ttft_ms = msSince(runStart);
+            }
+
+            if (!emit(new_token_id)) {
+                if (close_pending && force_close()) {
+                    continue;
+                }
+                break;
+            }
 
             llama_batch gen_batch = llama_batch_get_one(&new_token_id, 1);
             if (llama_decode(ctx, gen_batch)) {
                 LOG_ERROR("Failed to decode generated token");
                 break;
             }
+            if (!options.save_session.empty()) {
+                history.push_back(new_token_id);
+            }
             generated += 1;
         }
 
         llama_sampler_free(smpl);
-        llama_free(ctx);
+        if (stats.prompt_ms < 0.0) {
+            stats.prompt_ms = msSince(promptStart);
+        } else {
+            stats.decode_ms = msSince(decodeStart);
+        }
+        stats.generated_tokens = generated;
+
+        if (!options.save_session.empty() && decoder_start_token_id == 0) {
+            stats.session_saved = saveSession(ctx, 0, options.save_session, history);
+        }
 
-        LOG_INFO("Generated " + std::to_string(output.size()) + " bytes");
-        output = stripThinkBlocks(output);
-        return {true, output, ""};
+        think.finish();
+        thinking.flush();
+        stream.flush();
+        stats.think_tokens = think.thinkingTokens();
+
+        LOG_INFO("Generated " + std::to_string(output_bytes) + " bytes");
+        return {true, think.takeAnswer(), "", stats};
 
     } catch (const std::exception& e) {
         if (smpl) {
@@ -683,20 +1211,193 @@ RunResult Runner::runText(const std::string& prompt) {
             smpl = nullptr;
         }
         LOG_ERROR("Inference error: " + std::string(e.what()));
-        return {false, "", "Inference error: " + std::string(e.what())};
+        return {false, "", "Inference error: " + std::string(e.what()), {}};
     }
 }
 
-RunResult Runner::runVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths) {
+int Runner::generateSpeculative(llama_context* ctx, llama_context* draft, llama_sampler* smpl,
+                                std::vector<llama_token>& seq, llama_token last, int n_predict,
+                                const std::function<bool(llama_token)>& emit, RunStats& stats) {
+    const int n_draft_max = std::clamp(env_int("NRVNA_DRAFT_MAX", 8), 1, 64);
+    const float p_min = env_float("NRVNA_DRAFT_P_MIN", 0.75f);
+    const int n_ctx = static_cast<int>(llama_n_ctx(ctx));
+    // Tokens past the target's vocabulary could never be accepted
+    const int n_vocab = std::min(llama_vocab_n_tokens(llama_model_get_vocab(shared_model_.get())),
+                                 llama_vocab_n_tokens(llama_model_get_vocab(shared_draft_model_.get())));
+    llama_memory_t mem = llama_get_memory(ctx);
+    llama_memory_t draft_mem = llama_get_memory(draft);
+
+    // Verification decodes `last` plus the drafts; the draft side may also
+    // have to catch up on the one accepted token it never decoded
+    llama_batch batch = llama_batch_init(n_draft_max + 2, 0, 1);
+    auto add = [&](llama_token token, int pos, bool logits) {
+        const int i = batch.n_tokens++;
+        batch.token[i] = token;
+        batch.pos[i] = pos;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = 0;
+        batch.logits[i] = logits;
+    };
+
+    std::vector<llama_token> drafts;
+    auto n_draft_kv = static_cast<int>(seq.size());    // positions valid in the draft context
+    int emitted = 0;
+    bool drafting = true;
+    while (emitted < n_predict && emit(last)) {
+        ++emitted;
+        const int n_past = static_cast<int>(seq.size());
+        const int n_room = n_ctx - n_past - 2;
+        if (emitted >= n_predict || n_room < 0) break;
+
+        // Draft greedily from where the target is, and stop early once the
+        // draft is unsure: a rejected draft token costs a verify slot. Once the
+        // draft context has failed it stays behind, so it is left alone and
+        // the batch only ever holds the verify tokens.
+        drafts.clear();
+        const int k = drafting ? std::min({n_draft_max, n_predict - emitted, n_room}) : 0;
+        batch.n_tokens = 0;
+        if (k > 0) {
+            for (int p = n_draft_kv; p < n_past; ++p) {
+                add(seq[static_cast<std::size_t>(p)], p, false);
+            }
+            add(last, n_past, true);
+        }
+        while (static_cast<int>(drafts.size()) < k) {
+            if (llama_decode(draft, batch)) {
+                LOG_WARN("Draft decode failed, continuing without speculation");
+                drafting = false;
+                break;
+            }
+            n_draft_kv = n_past + 1 + static_cast<int>(drafts.size());
+            const float* logits = llama_get_logits_ith(draft, -1);
+            int best = 0;
+            for (int v = 1; v < n_vocab; ++v) {
+                if (logits[v] > logits[best]) best = v;
+            }
+            double sum = 0.0;
+            for (int v = 0; v < n_vocab; ++v) {
+                sum += std::exp(static_cast<double>(logits[v] - logits[best]));
+            }
+            if (1.0 / sum < p_min) {
+                break;
+            }
+            drafts.push_back(best);
+            batch.n_tokens = 0;
+            add(best, n_draft_kv, true);
+        }
+
+        // One target decode scores `last` and every draft token
+        batch.n_tokens = 0;
+        add(last, n_past, true);
+        for (std::size_t i = 0; i < drafts.size(); ++i) {
+            add(drafts[i], n_past + 1 + static_cast<int>(i), true);
+        }
+        if (llama_decode(ctx, batch)) {
+            LOG_ERROR("Failed to decode generated token");
+            break;
+        }
+        seq.push_back(last);
+        stats.draft_tokens += static_cast<int>(drafts.size());
+
+        // Sample the target at each position; a draft token is kept only when
+        // the target draws the same token, so the output follows the target's
+        // distribution exactly. The first mismatch becomes the next `last`.
+        bool stop = false;
+        for (std::size_t i = 0;; ++i) {
+            const llama_token token = llama_sampler_sample(smpl, ctx, static_cast<int32_t>(i));
+            llama_sampler_accept(smpl, token);
+            if (i < drafts.size() && token == drafts[i]) {
+                if (!emit(token)) {
+                    stop = true;
+                    break;
+                }
+                seq.push_back(token);
+                ++stats.draft_accepted;
+                if (++emitted >= n_predict) {
+                    stop = true;
+                    break;
+                }
+                continue;
+            }
+            last = token;
+            break;
+        }
+
+        // Drop rejected positions so both sequences end at seq
+        const auto n_kept = static_cast<int>(seq.size());
+        llama_memory_seq_rm(mem, 0, n_kept, -1);
+        n_draft_kv = std::min(n_draft_kv, n_kept);
+        llama_memory_seq_rm(draft_mem, 0, n_draft_kv, -1);
+        if (stop) break;
+    }
+
+    llama_batch_free(batch);
+    if (stats.draft_tokens > 0) {
+        LOG_DEBUG("Draft acceptance: " + std::to_string(stats.draft_accepted) + "/" +
+                  std::to_string(stats.draft_tokens));
+    }
+    return emitted;
+}
+
+bool Runner::closeThinking(llama_context* ctx, llama_sampler* smpl, const std::string& text,
+                           llama_pos* n_past, std::vector<llama_token>* history) {
+    const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
+    const int n = -llama_tokenize(vocab, text.c_str(), text.size(), nullptr, 0, false, true);
+    if (n <= 0) {
+        return false;
+    }
+    std::vector<llama_token> tokens(static_cast<std::size_t>(n));
+    if (llama_tokenize(vocab, text.c_str(), text.size(), tokens.data(), n, false, true) < 0) {
+        return false;
+    }
+
+    const llama_pos start = n_past ? *n_past : llama_memory_seq_pos_max(llama_get_memory(ctx), 0) + 1;
+    if (start + n > static_cast<llama_pos>(llama_n_ctx(ctx))) {
+        return false;
+    }
+    llama_batch batch = llama_batch_init(n, 0, 1);
+    for (int i = 0; i < n; ++i) {
+        batch.token[i] = tokens[static_cast<std::size_t>(i)];
+        batch.pos[i] = start + i;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = 0;
+        batch.logits[i] = i + 1 == n;
+    }
+    batch.n_tokens = n;
+    const bool ok = llama_decode(ctx, batch) == 0;
+    llama_batch_free(batch);
+    if (!ok) {
+        return false;
+    }
+
+    // Penalties see the marker as if the model had written it
+    for (llama_token t : tokens) {
+        llama_sampler_accept(smpl, t);
+    }
+    if (n_past) {
+        *n_past += n;
+    }
+    if (history) {
+        history->insert(history->end(), tokens.begin(), tokens.end());
+    }
+    return true;
+}
+
+RunResult Runner::runVision(const std::string& prompt, const std::vector<std::filesystem::path>& imagePaths,
+                            const RunOptions& options) {
     if (!shared_model_) {
-        return {false, "", "Model not loaded"};
+        return {false, "", "Model not loaded", {}};
     }
 
     if (!mtmd_ctx_) {
-        return {false, "", "Vision job requires --mmproj flag"};
+        return {false, "", "Vision job requires --mmproj flag", {}};
+    }
+    if (model_path_ != default_model_path_) {
+        return {false, "", "Vision job requires the daemon's own model", {}};
     }
 
     try {
+        const auto runStart = std::chrono::steady_clock::now();
         SamplingConfig config = buildSamplingConfig();
 
         // Lower temperature for vision tasks (more accurate OCR/descriptions)
@@ -708,9 +1409,10 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         std::string formatted_prompt = formatMultimodalPrompt(prompt, imagePaths.size(), marker);
 
         auto loadStart = std::chrono::steady_clock::now();
-        std::vector<mtmd_bitmap*> bitmaps = loadImages(imagePaths);
+        ImageCacheJob cache;
+        std::vector<mtmd_bitmap*> bitmaps = loadImages(imagePaths, options.image_hashes, cache);
         if (bitmaps.empty()) {
-            return {false, "", "Failed to load image(s)"};
+            return {false, "", "Failed to load image(s)", {}};
         }
         auto loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
         LOG_DEBUG("Image load time: " + std::to_string(loadTime) + "s");
@@ -723,7 +1425,7 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         mtmd_input_chunks* chunks = mtmd_input_chunks_init();
         if (!chunks) {
             freeBitmaps(bitmaps);
-            return {false, "", "Failed to init image chunks"};
+            return {false, "", "Failed to init image chunks", {}};
         }
 
         std::vector<const mtmd_bitmap*> bitmap_ptrs;
@@ -736,7 +1438,7 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         if (res != 0) {
             mtmd_input_chunks_free(chunks);
             freeBitmaps(bitmaps);
-            return {false, "", "Failed to tokenize multimodal prompt"};
+            return {false, "", "Failed to tokenize multimodal prompt", {}};
         }
 
         size_t n_prompt = mtmd_helper_get_n_tokens(chunks);
@@ -746,30 +1448,26 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
             config.n_predict = max_predict;
         }
         llama_context_params ctx_params;
-        buildContextParams(static_cast<int>(n_prompt), config, ctx_params);
-        llama_context* ctx = llama_init_from_model(shared_model_.get(), ctx_params);
+        buildContextParams(config, ctx_params);
+        RunStats stats;
+        llama_context* ctx = acquireContext(gen_ctx_, ctx_params, stats.context_reused);
         if (!ctx) {
             mtmd_input_chunks_free(chunks);
             freeBitmaps(bitmaps);
-            return {false, "", "Failed to create context"};
+            return {false, "", "Failed to create context", {}};
         }
 
         llama_sampler* smpl = buildSampler(config);
         llama_pos n_past = 0;
+        stats.setup_ms = msSince(runStart);
+        stats.prompt_tokens = static_cast<int>(n_prompt);
 
-        // CRITICAL: Serialize vision encoding across all workers
-        // The GGML compute graph has shared state that corrupts when multiple
-        // vision encodings run simultaneously, even with separate mtmd contexts
         auto encodeStart = std::chrono::steady_clock::now();
-        {
-            std::lock_guard<std::mutex> vision_lock(vision_encoding_mutex_);
-            if (mtmd_helper_eval_chunks(mtmd_ctx_, ctx, chunks, 0, 0, ctx_params.n_batch, true, &n_past) != 0) {
-                llama_sampler_free(smpl);
-                llama_free(ctx);
-                mtmd_input_chunks_free(chunks);
-                freeBitmaps(bitmaps);
-                return {false, "", "Failed to eval multimodal prompt"};
-            }
+        if (!evalChunks(ctx, chunks, ctx_params.n_batch, n_past, cache)) {
+            llama_sampler_free(smpl);
+            mtmd_input_chunks_free(chunks);
+            freeBitmaps(bitmaps);
+            return {false, "", "Failed to eval multimodal prompt", stats};
         }
 
         mtmd_input_chunks_free(chunks);
@@ -780,24 +1478,57 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
 
         // Token generation loop with explicit position tracking (matches reference)
         const llama_vocab* vocab = llama_model_get_vocab(shared_model_.get());
-        std::string output;
+        std::size_t output_bytes = 0;
         llama_token new_token_id;
         llama_batch batch = llama_batch_init(1, 0, 1);
 
+
+        ThinkFilter think(formatted_prompt);
+        PartialWriter thinking;
+        if (!options.thinking_path.empty() && thinking.open(options.thinking_path)) {
+            think.setSink(&thinking);
+        }
+        PartialWriter stream;
+        if (!options.stream_path.empty() && stream.open(options.stream_path)) {
+            think.setAnswerSink(&stream);
+        }
+
+        int generated = 0;
+        std::chrono::steady_clock::time_point decodeStart;
         for (int i = 0; i < config.n_predict; ++i) {
             new_token_id = llama_sampler_sample(smpl, ctx, -1);
             llama_sampler_accept(smpl, new_token_id);
+            if (i == 0) {
+                decodeStart = std::chrono::steady_clock::now();
+                stats.prompt_ms = msSince(encodeStart);
+                stats.ttft_ms = msSince(runStart);
+            }
 
             if (llama_vocab_is_eog(vocab, new_token_id)) {
                 break;
             }
 
+            // Budget spent: the closing marker replaces the sampled token
+            if (options.think_budget > 0 && think.thinking() && think.blockTokens() >= options.think_budget) {
+                const std::string text = think.closingText();
+                if (!closeThinking(ctx, smpl, text, &n_past, nullptr)) {
+                    LOG_WARN("Failed to close the reasoning block at the think budget");
+                    break;
+                }
+                output_bytes += text.size();
+                think.feed(text);
+                stats.think_capped = true;
+                continue;
+            }
+
             char buf[128];
             int n = llama_token_to_piece(vocab, new_token_id, buf, sizeof(buf), 0, true);
             if (n < 0) {
                 break;
             }
-            output.append(buf, n);
+            ++generated;
+            output_bytes += static_cast<std::size_t>(n);
+            think.feed(buf, static_cast<std::size_t>(n));
 
             // Decode next token with explicit position (like reference)
             batch.n_tokens = 1;
@@ -813,30 +1544,58 @@ RunResult Runner::runVision(const std::string& prompt, const std::vector<std::fi
         }
 
         llama_batch_free(batch);
+        if (stats.prompt_ms < 0.0) {
+            stats.prompt_ms = msSince(encodeStart);
+        } else {
+            stats.decode_ms = msSince(decodeStart);
+        }
+        stats.generated_tokens = generated;
 
         llama_sampler_free(smpl);
-        llama_free(ctx);
 
-        LOG_INFO("Generated " + std::to_string(output.size()) + " bytes before strip");
-        output = stripThinkBlocks(output);
-        return {true, output, ""};
+        think.finish();
+        thinking.flush();
+        stream.flush();
+        stats.think_tokens = think.thinkingTokens();
+
+        LOG_INFO("Generated " + std::to_string(output_bytes) + " bytes");
+        return {true, think.takeAnswer(), "", stats};
 
     } catch (const std::exception& e) {
-        return {false, "", "Multimodal inference error: " + std::string(e.what())};
+        return {false, "", "Multimodal inference error: " + std::string(e.what()), {}};
     }
 }
 
-std::string Runner::formatPrompt(const std::string& content) {
+std::string Runner::formatPrompt(const std::string& content, const std::vector<ChatTurn>& history) {
     if (!chat_templates_) {
-        return content;
+        if (history.empty()) {
+            return content;
+        }
+        // Base model: plain transcript, so each turn still extends the previous one
+        std::string transcript;
+        for (const auto& turn : history) {
+            transcript += turn.user + "\n\n" + turn.assistant + "\n\n";
+        }
+        return transcript + content;
+    }
+
+    common_chat_templates_inputs inputs;
+    for (const auto& turn : history) {
+        common_chat_msg user;
+        user.role = "user";
+        user.content = turn.user;
+        inputs.messages.push_back(user);
+
+        common_chat_msg assistant;
+        assistant.role = "assistant";
+        assistant.content = turn.assistant;
+        inputs.messages.push_back(assistant);
     }
 
     common_chat_msg msg;
     msg.role = "user";
     msg.content = content;
-
-    common_chat_templates_inputs inputs;
-    inputs.messages = {msg};
+    inputs.messages.push_back(msg);
     inputs.use_jinja = true;
     inputs.add_generation_prompt = true;
     inputs.enable_thinking = true;
@@ -883,15 +1642,127 @@ std::string Runner::formatMultimodalPrompt(const std::string& prompt, size_t ima
     return params.prompt;
 }
 
-std::vector<mtmd_bitmap*> Runner::loadImages(const std::vector<std::filesystem::path>& imagePaths) const {
+bool Runner::evalChunks(llama_context* ctx, const mtmd_input_chunks* chunks, int n_batch, llama_pos& n_past,
+                        ImageCacheJob& cache) {
+    // mtmd_helper_eval_chunks without holding anything across the decodes:
+    // text chunks go straight to llama_decode, media chunks are encoded under
+    // the gate and their embeddings decoded from this worker's mtmd output
+    const size_t n_embd = static_cast<size_t>(std::max(0, llama_model_n_embd(shared_model_.get())));
+    const size_t n_chunks = mtmd_input_chunks_size(chunks);
+    for (size_t i = 0; i < n_chunks; ++i) {
+        const mtmd_input_chunk* chunk = mtmd_input_chunks_get(chunks, i);
+        const bool logits_last = i + 1 == n_chunks;
+        if (mtmd_input_chunk_get_type(chunk) == MTMD_INPUT_CHUNK_TYPE_TEXT) {
+            if (mtmd_helper_eval_chunk_single(mtmd_ctx_, ctx, chunk, n_past, 0, n_batch, logits_last, &n_past) != 0) {
+                LOG_ERROR("Failed to decode multimodal text chunk");
+                return false;
+            }
+            continue;
+        }
+
+        // Which image this chunk belongs to, and its cached embeddings if any
+        const uint32_t n_tokens = static_cast<uint32_t>(mtmd_input_chunk_get_n_tokens(chunk));
+        const char* id = mtmd_input_chunk_get_id(chunk);
+        int image = -1;
+        const ImageEmbedCache::Chunk* cached = nullptr;
+        if (id && mtmd_input_chunk_get_type(chunk) == MTMD_INPUT_CHUNK_TYPE_IMAGE) {
+            for (size_t k = 0; k < cache.ids.size(); ++k) {
+                if (cache.ids[k] == id) {
+                    image = static_cast<int>(k);
+                    break;
+                }
+            }
+        }
+        if (image >= 0) {
+            const size_t ordinal = cache.ordinals[image]++;
+            const auto& hit = cache.hits[image];
+            if (hit && ordinal < hit->chunks.size() && hit->chunks[ordinal].n_tokens == n_tokens &&
+                hit->chunks[ordinal].embd.size() == n_tokens * n_embd) {
+                cached = &hit->chunks[ordinal];
+            } else if (cache.placeholders) {
+                // The bitmap is blank; encoding it would be silently wrong
+                LOG_ERROR("Cached image embeddings do not match the prompt");
+                return false;
+            }
+        }
+
+        float* embd = nullptr;
+        if (cached) {
+            embd = const_cast<float*>(cached->embd.data());
+        } else {
+            {
+                VisionEncodeGate::Slot slot(vision_encode_gate_);
+                if (mtmd_encode_chunk(mtmd_ctx_, chunk) != 0) {
+                    LOG_ERROR("Failed to encode image chunk");
+                    return false;
+                }
+            }
+            embd = mtmd_get_output_embd(mtmd_ctx_);
+            if (embd && image >= 0 && !cache.hits[image]) {
+                cache.fresh[image].chunks.push_back({n_tokens, std::vector<float>(embd, embd + n_tokens * n_embd)});
+            }
+        }
+        if (!embd || mtmd_helper_decode_image_chunk(mtmd_ctx_, ctx, chunk, embd, n_past, 0, n_batch, &n_past) != 0) {
+            LOG_ERROR("Failed to decode image embeddings");
+            return false;
+        }
+    }
+
+    size_t hits = 0;
+    for (size_t k = 0; k < cache.hashes.size(); ++k) {
+        if (cache.hits[k]) {
+            ++hits;
+        } else if (!cache.fresh[k].chunks.empty()) {
+            sharedImageEmbedCache().insert(cache.hashes[k], std::move(cache.fresh[k]));
+        }
+    }
+    if (!cache.hashes.empty()) {
+        LOG_DEBUG("Image embedding cache: " + std::to_string(hits) + "/" + std::to_string(cache.hashes.size()) +
+                  " hit(s)" + (cache.placeholders ? ", files not decoded" : ""));
+    }
+    return true;
+}
+
+std::vector<mtmd_bitmap*> Runner::loadImages(const std::vector<std::filesystem::path>& imagePaths,
+                                             const std::vector<std::string>& hashes, ImageCacheJob& cache) const {
+    const size_t n = imagePaths.size();
+    ImageEmbedCache& shared = sharedImageEmbedCache();
+    cache = {};
+    if (hashes.size() == n && shared.enabled()) {
+        cache.hashes = hashes;
+        cache.hits.resize(n);
+        cache.fresh.resize(n);
+        cache.ordinals.assign(n, 0);
+        cache.placeholders = true;
+        for (size_t i = 0; i < n; ++i) {
+            // Unique per position so a repeated image still maps chunk -> slot
+            cache.ids.push_back(hashes[i] + ":" + std::to_string(i));
+            cache.hits[i] = shared.lookup(hashes[i]);
+            cache.placeholders = cache.placeholders && cache.hits[i] && cache.hits[i]->nx > 0 && cache.hits[i]->ny > 0;
+        }
+    }
+
     std::vector<mtmd_bitmap*> bitmaps;
-    bitmaps.reserve(imagePaths.size());
-    for (const auto& path : imagePaths) {
-        mtmd_bitmap* bmp = mtmd_helper_bitmap_init_from_file(mtmd_ctx_, path.c_str());
+    bitmaps.reserve(n);
+    std::vector<unsigned char> blank;
+    for (size_t i = 0; i < n; ++i) {
+        mtmd_bitmap* bmp = nullptr;
+        if (cache.placeholders) {
+            const auto& hit = *cache.hits[i];
+            blank.resize(static_cast<size_t>(hit.nx) * hit.ny * 3);
+            bmp = mtmd_bitmap_init(hit.nx, hit.ny, blank.data());
+        } else {
+            bmp = mtmd_helper_bitmap_init_from_file(mtmd_ctx_, imagePaths[i].c_str());
+        }
         if (!bmp) {
             freeBitmaps(bitmaps);
             return {};
         }
+        if (!cache.ids.empty()) {
+            mtmd_bitmap_set_id(bmp, cache.ids[i].c_str());
+            cache.fresh[i].nx = mtmd_bitmap_get_nx(bmp);
+            cache.fresh[i].ny = mtmd_bitmap_get_ny(bmp);
+        }
         bitmaps.push_back(bmp);
     }
     return bitmaps;
@@ -3,18 +3,20 @@
  * Copyright (c) 2025 Sanmathi Bharamgouda
  * SPDX-License-Identifier: MIT
  *
- * Spectral ops (irfft, fold, embd_to_audio), text preprocessing, WAV format,
- * and default speaker profile adapted from llama.cpp tools/tts/tts.cpp.
+ * Text preprocessing, WAV format, and default speaker profile adapted from
+ * llama.cpp tools/tts/tts.cpp. Spectral ops live in tts_spectral.cpp.
  */
 
-#define _USE_MATH_DEFINES
-
 #include "nrvna/runner_tts.hpp"
 #include "nrvna/logger.hpp"
 #include "llama_util.hpp"
+#include "tts_spectral.hpp"
 #include "llama.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <regex>
 #include <thread>
@@ -33,146 +35,6 @@ std::string TtsRunner::v3_audio_data_;
 
 namespace {
 
-void restrictModelToCpu(llama_model_params& params) {
-    ggml_backend_dev_t cpu_dev = ggml_backend_dev_by_type(GGML_BACKEND_DEVICE_TYPE_CPU);
-    static ggml_backend_dev_t cpu_only_devices[2] = { nullptr, nullptr };
-    cpu_only_devices[0] = cpu_dev;
-    cpu_only_devices[1] = nullptr;
-    if (cpu_dev) {
-        params.devices = cpu_only_devices;
-    }
-}
-
-// ============================================================================
-// Spectral ops (from tts.cpp — pure math, safe to borrow)
-// ============================================================================
-
-void fill_hann_window(int length, bool periodic, float* output) {
-    int offset = periodic ? 0 : -1;
-    for (int i = 0; i < length; i++) {
-        output[i] = 0.5f * (1.0f - cosf((2.0f * static_cast<float>(M_PI) * i) / (length + offset)));
-    }
-}
-
-void twiddle(float* real, float* imag, int k, int N) {
-    float angle = 2.0f * static_cast<float>(M_PI) * k / N;
-    *real = cosf(angle);
-    *imag = sinf(angle);
-}
-
-void irfft(int n, const float* inp_cplx, float* out_real) {
-    int N = n / 2 + 1;
-    std::vector<float> real_input(N), imag_input(N);
-    for (int i = 0; i < N; ++i) {
-        real_input[i] = inp_cplx[2 * i];
-        imag_input[i] = inp_cplx[2 * i + 1];
-    }
-
-    std::vector<float> real_output(n), imag_output(n);
-    for (int k = 0; k < n; ++k) {
-        real_output[k] = 0.0f;
-        imag_output[k] = 0.0f;
-        for (int m = 0; m < N; ++m) {
-            float tw_r, tw_i;
-            twiddle(&tw_r, &tw_i, k * m, n);
-            real_output[k] += real_input[m] * tw_r - imag_input[m] * tw_i;
-            imag_output[k] += real_input[m] * tw_i + imag_input[m] * tw_r;
-        }
-    }
-    for (int i = 0; i < n; ++i) {
-        out_real[i] = real_output[i] / N;
-    }
-}
-
-void fold(const std::vector<float>& data, int64_t n_out, int64_t n_win,
-          int64_t n_hop, int64_t n_pad, std::vector<float>& output) {
-    int64_t output_height = n_out;
-    int64_t kernel_w = n_win;
-    int64_t stride_w = n_hop;
-    int64_t width = n_out;
-
-    output.resize(width, 0.0f);
-
-    int64_t col_idx = 0;
-    for (int64_t w_col = 0; w_col < width; ++w_col) {
-        int64_t start = w_col * stride_w - n_pad;
-        int64_t end = start + kernel_w;
-        for (int64_t w_im = start; w_im < end; ++w_im) {
-            if (w_im >= 0 && w_im < output_height && col_idx < static_cast<int64_t>(data.size())) {
-                output[w_im] += data[col_idx];
-            }
-            col_idx++;
-        }
-    }
-    output.resize(n_out - 2 * n_pad);
-}
-
-std::vector<float> embd_to_audio(const float* embd, int n_codes, int n_embd, int n_thread) {
-    const int n_fft = 1280;
-    const int n_hop = 320;
-    const int n_win = 1280;
-    const int n_pad = (n_win - n_hop) / 2;
-    const int n_out = (n_codes - 1) * n_hop + n_win;
-
-    std::vector<float> hann(n_fft);
-    fill_hann_window(hann.size(), true, hann.data());
-
-    int n_spec = n_embd * n_codes;
-    std::vector<float> E(n_spec), S(n_spec), ST(n_spec);
-
-    for (int l = 0; l < n_codes; ++l) {
-        for (int k = 0; k < n_embd; ++k) {
-            E[k * n_codes + l] = embd[l * n_embd + k];
-        }
-    }
-
-    for (int k = 0; k < n_embd / 2; ++k) {
-        for (int l = 0; l < n_codes; ++l) {
-            float mag = E[(k) * n_codes + l];
-            float phi = E[(k + n_embd / 2) * n_codes + l];
-            mag = exp(mag);
-            if (mag > 1e2f) mag = 1e2f;
-            S[2 * (k * n_codes + l) + 0] = mag * cosf(phi);
-            S[2 * (k * n_codes + l) + 1] = mag * sinf(phi);
-        }
-    }
-
-    for (int l = 0; l < n_codes; ++l) {
-        for (int k = 0; k < n_embd / 2; ++k) {
-            ST[l * n_embd + 2 * k + 0] = S[2 * (k * n_codes + l) + 0];
-            ST[l * n_embd + 2 * k + 1] = S[2 * (k * n_codes + l) + 1];
-        }
-    }
-
-    std::vector<float> res(n_codes * n_fft);
-    std::vector<float> hann2(n_codes * n_fft);
-
-    std::vector<std::thread> workers(n_thread);
-    for (int i = 0; i < n_thread; ++i) {
-        workers[i] = std::thread([&, i]() {
-            for (int l = i; l < n_codes; l += n_thread) {
-                irfft(n_fft, ST.data() + l * n_embd, res.data() + l * n_fft);
-                for (int j = 0; j < n_fft; ++j) {
-                    res[l * n_fft + j] *= hann[j];
-                    hann2[l * n_fft + j] = hann[j] * hann[j];
-                }
-            }
-        });
-    }
-    for (int i = 0; i < n_thread; ++i) {
-        workers[i].join();
-    }
-
-    std::vector<float> audio, env;
-    fold(res, n_out, n_win, n_hop, n_pad, audio);
-    fold(hann2, n_out, n_win, n_hop, n_pad, env);
-
-    for (size_t i = 0; i < audio.size(); ++i) {
-        audio[i] /= env[i];
-    }
-    return audio;
-}
-
 // ============================================================================
 // Text preprocessing (from tts.cpp)
 // ============================================================================
@@ -391,15 +253,134 @@ it<|t_0.09|><|code_start|><|848|><|1366|><|395|><|1601|><|1513|><|593|><|1302|><
 looks<|t_0.27|><|code_start|><|1281|><|1266|><|1755|><|572|><|248|><|1751|><|1257|><|695|><|1380|><|457|><|659|><|585|><|1315|><|1105|><|1776|><|736|><|24|><|736|><|654|><|1027|><|code_end|>
 lovely<|t_0.56|><|code_start|><|634|><|596|><|1766|><|1556|><|1306|><|1285|><|1481|><|1721|><|1123|><|438|><|1246|><|1251|><|795|><|659|><|1381|><|1658|><|217|><|1772|><|562|><|952|><|107|><|1129|><|1112|><|467|><|550|><|1079|><|840|><|1615|><|1469|><|1380|><|168|><|917|><|836|><|1827|><|437|><|583|><|67|><|595|><|1087|><|1646|><|1493|><|1677|><|code_end|>)";
 
+// Audio code N from a "<|N|>" token piece (handles non-contiguous token IDs in v0.3), -1 otherwise
+int audioCode(const llama_vocab* vocab, llama_token token) {
+    char piece[32] = {};
+    int plen = llama_token_to_piece(vocab, token, piece, sizeof(piece), 0, true);
+    if (plen < 5 || plen > static_cast<int>(sizeof(piece))) return -1;
+    std::string s(piece, plen);
+    if (s[0] != '<' || s[1] != '|' || s[s.size()-2] != '|' || s[s.size()-1] != '>') return -1;
+    std::string num_str = s.substr(2, s.size() - 4);
+    // Verify all digits
+    if (num_str.empty() || num_str.size() > 4) return -1;
+    for (char c : num_str) {
+        if (c < '0' || c > '9') return -1;
+    }
+    int code = std::stoi(num_str);
+    return code <= 4100 ? code : -1;
+}
+
+// Second pipeline stage: turns audio codes into PCM while the TTC model is
+// still sampling. The vocoder is not causal, so each chunk of `chunk` codes is
+// encoded with up to `overlap` codes of context on both sides and only its
+// own frames go through the ISTFT. chunk == 0 encodes everything at close().
+class VocoderStage {
+public:
+    using Encode = std::function<const float*(const llama_token* codes, int n)>;
+    using Emit = std::function<void(const float* samples, std::size_t n)>;
+
+    VocoderStage(Encode encode, Emit emit, Istft& istft, int n_embd, int chunk, int overlap)
+        : encode_(std::move(encode)), emit_(std::move(emit)), istft_(istft),
+          n_embd_(n_embd), chunk_(static_cast<std::size_t>(chunk)), overlap_(static_cast<std::size_t>(overlap)) {}
+
+    void push(llama_token code) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            codes_.push_back(code);
+        }
+        if (chunk_ > 0) cv_.notify_one();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    [[nodiscard]] bool failed() const noexcept { return failed_.load(); }
+    [[nodiscard]] const std::string& error() const noexcept { return error_; }
+    [[nodiscard]] std::size_t codes() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return codes_.size();
+    }
+
+    // Consumer loop; returns once close() was called and every code is vocoded
+    bool run() noexcept {
+        try {
+            istft_.reset();
+            std::vector<float> pcm;
+            std::vector<llama_token> window;
+            std::size_t next = 0;
+            while (true) {
+                std::size_t avail = 0, start = 0, end = 0;
+                bool closed = false;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    cv_.wait(lock, [&] {
+                        return closed_ || (chunk_ > 0 && codes_.size() >= next + chunk_ + overlap_);
+                    });
+                    closed = closed_;
+                    avail = codes_.size();
+                    end = chunk_ > 0 ? std::min(avail, next + chunk_) : avail;
+                    start = next > overlap_ ? next - overlap_ : 0;
+                    window.assign(codes_.begin() + static_cast<std::ptrdiff_t>(start),
+                                  codes_.begin() + static_cast<std::ptrdiff_t>(std::min(avail, end + overlap_)));
+                }
+
+                if (end > next) {
+                    const float* embd = encode_(window.data(), static_cast<int>(window.size()));
+                    if (!embd) return fail("Vocoder encode failed");
+                    pcm.clear();
+                    if (!istft_.push(embd + (next - start) * n_embd_, static_cast<int>(end - next), n_embd_, pcm)) {
+                        return fail("Unsupported vocoder embedding size " + std::to_string(n_embd_));
+                    }
+                    emit_(pcm.data(), pcm.size());
+                    next = end;
+                }
+                if (closed && next >= avail) break;
+            }
+            pcm.clear();
+            istft_.finish(pcm);
+            emit_(pcm.data(), pcm.size());
+            return true;
+        } catch (const std::exception& e) {
+            return fail(std::string("Vocoder error: ") + e.what());
+        }
+    }
+
+private:
+    bool fail(const std::string& error) {
+        error_ = error;
+        failed_.store(true);
+        return false;
+    }
+
+    Encode encode_;
+    Emit emit_;
+    Istft& istft_;
+    const int n_embd_;
+    const std::size_t chunk_;
+    const std::size_t overlap_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<llama_token> codes_;
+    bool closed_ = false;
+    std::atomic<bool> failed_{false};
+    std::string error_;
+};
+
 } // anonymous namespace
 
 // ============================================================================
 // TtsRunner implementation
 // ============================================================================
 
-TtsRunner::TtsRunner(const std::string& modelPath, const std::string& vocoderPath) {
-    llama_log_set(filtered_llama_log, nullptr);
-    ggml_backend_load_all();
+TtsRunner::TtsRunner(const std::string& modelPath, const std::string& vocoderPath, const WorkerThreads& threads)
+    : threads_(threads) {
+    initLlamaBackend();
 
     std::lock_guard<std::mutex> lock(tts_model_mutex_);
 
@@ -534,14 +515,87 @@ TtsRunner::TtsRunner(const std::string& modelPath, const std::string& vocoderPat
     }
 }
 
-TtsRunner::~TtsRunner() = default;
+TtsRunner::~TtsRunner() {
+    for (WarmContext* slot : {&ttc_ctx_, &voc_ctx_}) {
+        if (slot->ctx) {
+            llama_free(slot->ctx);
+        }
+        *slot = WarmContext{};
+    }
+}
+
+llama_context* TtsRunner::acquireContext(WarmContext& slot, const std::shared_ptr<llama_model>& model,
+                                         const llama_context_params& params, bool& reused) {
+    if (slot.ctx && slot.n_ctx >= params.n_ctx) {
+        if (llama_memory_t mem = llama_get_memory(slot.ctx)) {
+            llama_memory_clear(mem, true);
+        }
+        reused = true;
+        return slot.ctx;
+    }
+
+    if (slot.ctx) {
+        llama_free(slot.ctx);
+        slot = WarmContext{};
+    }
+
+    reused = false;
+    slot.ctx = llama_init_from_model(model.get(), params);
+    if (slot.ctx) {
+        slot.n_ctx = llama_n_ctx(slot.ctx);
+    }
+    return slot.ctx;
+}
+
+// Vocoder: encode codes to get embeddings (n_embd_out floats per code).
+// Context grows in 1024-code steps; encode needs n_ubatch >= n_codes.
+const float* TtsRunner::encodeCodes(const int32_t* codes, int n_codes, bool& reused) {
+    const uint32_t voc_size = static_cast<uint32_t>((n_codes + 1023) / 1024 * 1024);
+    llama_context_params voc_params = llama_context_default_params();
+    voc_params.n_ctx = voc_size;
+    voc_params.n_batch = voc_size;
+    voc_params.n_ubatch = voc_size;
+    voc_params.embeddings = true;
+    if (threads_.n_threads_batch > 0) {
+        voc_params.n_threads = threads_.n_threads_batch;
+        voc_params.n_threads_batch = threads_.n_threads_batch;
+    }
+    // Vocoder: CPU-only — model loaded with n_gpu_layers=0, context must match
+    voc_params.offload_kqv = false;
+    voc_params.op_offload = false;
+
+    llama_context* ctx_voc = acquireContext(voc_ctx_, shared_vocoder_, voc_params, reused);
+    if (!ctx_voc) {
+        LOG_ERROR("Failed to create vocoder context");
+        return nullptr;
+    }
+
+    llama_batch voc_batch = llama_batch_init(n_codes, 0, 1);
+    for (int i = 0; i < n_codes; ++i) {
+        voc_batch.token[i] = codes[i];
+        voc_batch.pos[i] = i;
+        voc_batch.n_seq_id[i] = 1;
+        voc_batch.seq_id[i][0] = 0;
+        voc_batch.logits[i] = true;
+    }
+    voc_batch.n_tokens = n_codes;
+
+    const int rc = llama_encode(ctx_voc, voc_batch);
+    llama_batch_free(voc_batch);
+    if (rc != 0) {
+        return nullptr;
+    }
+    return llama_get_embeddings(ctx_voc);
+}
 
-TtsResult TtsRunner::run(const std::string& text) {
+TtsResult TtsRunner::run(const std::string& text, const AudioSink& sink) {
     if (!shared_tts_model_ || !shared_vocoder_) {
-        return {false, {}, 24000, "TTS models not loaded"};
+        return {false, {}, 24000, "TTS models not loaded", {}};
     }
 
     try {
+        const auto runStart = std::chrono::steady_clock::now();
+        RunStats stats;
         const llama_vocab* vocab = llama_model_get_vocab(shared_tts_model_.get());
 
         std::string full_prompt;
@@ -562,12 +616,12 @@ TtsResult TtsRunner::run(const std::string& text) {
         // Tokenize
         int n_tokens = -llama_tokenize(vocab, full_prompt.c_str(), full_prompt.size(), nullptr, 0, true, true);
         if (n_tokens <= 0) {
-            return {false, {}, 24000, "Failed to tokenize TTS prompt"};
+            return {false, {}, 24000, "Failed to tokenize TTS prompt", {}};
         }
 
         std::vector<llama_token> prompt_tokens(n_tokens);
         if (llama_tokenize(vocab, full_prompt.c_str(), full_prompt.size(), prompt_tokens.data(), prompt_tokens.size(), true, true) < 0) {
-            return {false, {}, 24000, "Failed to tokenize TTS prompt"};
+            return {false, {}, 24000, "Failed to tokenize TTS prompt", {}};
         }
 
         LOG_INFO("TTS prompt: " + std::to_string(prompt_tokens.size()) + " tokens");
@@ -578,24 +632,31 @@ TtsResult TtsRunner::run(const std::string& text) {
         int max_ctx = std::min(n_ctx_train, env_int("NRVNA_MAX_CTX", 8192));
         int n_prompt = static_cast<int>(prompt_tokens.size());
         int n_ctx = std::min(n_prompt + n_predict, max_ctx);
+        n_predict = n_ctx - n_prompt;
 
         if (n_prompt >= n_ctx) {
             return {false, {}, 24000,
                 "TTS prompt too long (" + std::to_string(n_prompt) + " tokens, context limit " +
-                std::to_string(max_ctx) + "). Try shorter text."};
+                std::to_string(max_ctx) + "). Try shorter text.", {}};
         }
 
+        // Warm context sized to max_ctx so later jobs reuse it
         llama_context_params ctx_params = llama_context_default_params();
-        ctx_params.n_ctx = n_ctx;
+        ctx_params.n_ctx = max_ctx;
         ctx_params.n_batch = env_int("NRVNA_BATCH", 8192);
         ctx_params.no_perf = false;
+        if (threads_.n_threads > 0) {
+            ctx_params.n_threads = threads_.n_threads;
+            ctx_params.n_threads_batch = threads_.n_threads_batch;
+        }
         // TTS: CPU-only — model loaded with n_gpu_layers=0, context must match
         ctx_params.offload_kqv = false;
         ctx_params.op_offload = false;
 
-        llama_context* ctx_ttc = llama_init_from_model(shared_tts_model_.get(), ctx_params);
+        bool ttc_reused = false;
+        llama_context* ctx_ttc = acquireContext(ttc_ctx_, shared_tts_model_, ctx_params, ttc_reused);
         if (!ctx_ttc) {
-            return {false, {}, 24000, "Failed to create TTS context"};
+            return {false, {}, 24000, "Failed to create TTS context", {}};
         }
 
         // Build sampler — TTS uses top_k=4 (matches upstream tts.cpp)
@@ -613,137 +674,137 @@ TtsResult TtsRunner::run(const std::string& text) {
         llama_sampler_chain_add(smpl, llama_sampler_init_top_k(4));
         llama_sampler_chain_add(smpl, llama_sampler_init_dist(env_int("NRVNA_SEED", 0)));
 
+        stats.setup_ms = msSince(runStart);
+        stats.prompt_tokens = n_prompt;
+
         // Eval prompt
+        const auto promptStart = std::chrono::steady_clock::now();
         llama_batch batch = llama_batch_get_one(prompt_tokens.data(), prompt_tokens.size());
         if (llama_decode(ctx_ttc, batch) != 0) {
             llama_sampler_free(smpl);
-            llama_free(ctx_ttc);
-            return {false, {}, 24000, "Failed to decode TTS prompt"};
+            return {false, {}, 24000, "Failed to decode TTS prompt", {}};
         }
 
-        // Generate code tokens
-        std::vector<llama_token> codes;
+        // Two-stage pipeline: the vocoder thread turns code chunks into PCM
+        // while this thread keeps sampling. NRVNA_TTS_CHUNK=0 vocodes once at the end.
+        const int chunk = std::max(0, env_int("NRVNA_TTS_CHUNK", 128));
+        const int overlap = std::max(0, env_int("NRVNA_TTS_OVERLAP", 32));
+        const int n_embd = llama_model_n_embd_out(shared_vocoder_.get());
 
-        for (int i = 0; i < n_predict; ++i) {
-            llama_token new_token = llama_sampler_sample(smpl, ctx_ttc, -1);
-            llama_sampler_accept(smpl, new_token);
-
-            if (llama_vocab_is_eog(vocab, new_token)) {
-                break;
-            }
+        // Mute start of audio to suppress onset artifacts (from tts.cpp)
+        // NRVNA_TTS_MUTE_MS=0 disables for narration (avoids clipping chunk starts)
+        const int mute_ms = env_int("NRVNA_TTS_MUTE_MS", 250);
+        const std::size_t silence_samples = mute_ms > 0 ? static_cast<std::size_t>(24000 * mute_ms / 1000) : 0;
 
-            codes.push_back(new_token);
+        if (!istft_) {
+            istft_ = std::make_unique<Istft>(1280, 320);
+        }
 
-            batch = llama_batch_get_one(&new_token, 1);
-            if (llama_decode(ctx_ttc, batch) != 0) {
-                LOG_WARN("TTS decode failed at token " + std::to_string(i));
-                break;
+        std::vector<float> audio;
+        std::size_t n_samples = 0;
+        std::vector<float> muted;
+        auto emit = [&](const float* pcm, std::size_t n) {
+            if (n == 0) return;
+            if (n_samples < silence_samples) {
+                muted.assign(pcm, pcm + n);
+                const std::size_t quiet = std::min(n, silence_samples - n_samples);
+                std::fill(muted.begin(), muted.begin() + static_cast<std::ptrdiff_t>(quiet), 0.0f);
+                pcm = muted.data();
             }
+            if (sink) sink(pcm, n);
+            else audio.insert(audio.end(), pcm, pcm + n);
+            n_samples += n;
+        };
+
+        bool voc_reused = true;
+        auto encode = [&](const llama_token* codes, int n) -> const float* {
+            bool reused = false;
+            const float* embd = encodeCodes(codes, n, reused);
+            voc_reused = voc_reused && reused;
+            return embd;
+        };
+
+        VocoderStage stage(encode, emit, *istft_, n_embd, chunk, overlap);
+        std::thread vocoder;
+        bool vocoded = false;
+        if (chunk > 0) {
+            vocoder = std::thread([&] { vocoded = stage.run(); });
         }
+        // Every path out of generation closes the stage and joins the thread
+        struct StageGuard {
+            VocoderStage& stage;
+            std::thread& thread;
+            ~StageGuard() {
+                stage.close();
+                if (thread.joinable()) thread.join();
+            }
+        };
 
-        llama_sampler_free(smpl);
-        llama_free(ctx_ttc);
+        // Generate code tokens, handing audio codes to the vocoder as they appear
+        int n_generated = 0;
+        std::chrono::steady_clock::time_point decodeStart;
+        {
+            StageGuard guard{stage, vocoder};
+            for (int i = 0; i < n_predict && !stage.failed(); ++i) {
+                llama_token new_token = llama_sampler_sample(smpl, ctx_ttc, -1);
+                llama_sampler_accept(smpl, new_token);
+                if (i == 0) {
+                    decodeStart = std::chrono::steady_clock::now();
+                    stats.prompt_ms = msSince(promptStart);
+                    stats.ttft_ms = msSince(runStart);
+                }
 
-        LOG_INFO("TTS generated " + std::to_string(codes.size()) + " code tokens");
+                if (llama_vocab_is_eog(vocab, new_token)) {
+                    break;
+                }
 
-        // Extract audio codes by parsing token text (handles non-contiguous token IDs in v0.3)
-        {
-            std::vector<llama_token> audio_codes;
-            for (auto token : codes) {
-                char piece[32] = {};
-                int plen = llama_token_to_piece(vocab, token, piece, sizeof(piece), 0, true);
-                if (plen < 5) continue;
-                std::string s(piece, plen);
-                // Match <|N|> pattern
-                if (s.size() >= 5 && s[0] == '<' && s[1] == '|'
-                    && s[s.size()-2] == '|' && s[s.size()-1] == '>') {
-                    std::string num_str = s.substr(2, s.size() - 4);
-                    // Verify all digits
-                    bool all_digits = !num_str.empty();
-                    for (char c : num_str) {
-                        if (c < '0' || c > '9') { all_digits = false; break; }
-                    }
-                    if (all_digits) {
-                        int code = std::stoi(num_str);
-                        if (code >= 0 && code <= 4100) {
-                            audio_codes.push_back(static_cast<llama_token>(code));
-                        }
-                    }
+                ++n_generated;
+                const int code = audioCode(vocab, new_token);
+                if (code >= 0) {
+                    stage.push(static_cast<llama_token>(code));
+                }
+
+                batch = llama_batch_get_one(&new_token, 1);
+                if (llama_decode(ctx_ttc, batch) != 0) {
+                    LOG_WARN("TTS decode failed at token " + std::to_string(i));
+                    break;
                 }
             }
-            codes = std::move(audio_codes);
         }
 
-        LOG_INFO("TTS audio tokens after filter: " + std::to_string(codes.size()));
-
-        if (codes.empty()) {
-            return {false, {}, 24000, "No audio tokens generated"};
+        llama_sampler_free(smpl);
+        // Includes draining the vocoder stage: audio is done when the thread joins
+        if (stats.prompt_ms >= 0.0) {
+            stats.decode_ms = msSince(decodeStart);
         }
+        stats.generated_tokens = n_generated;
 
-        // Vocoder: encode codes to get embeddings
-        int n_codes = static_cast<int>(codes.size());
-        llama_context_params voc_params = llama_context_default_params();
-        voc_params.n_ctx = n_codes;
-        voc_params.n_batch = n_codes;
-        voc_params.n_ubatch = n_codes;
-        voc_params.embeddings = true;
-        // Vocoder: CPU-only — model loaded with n_gpu_layers=0, context must match
-        voc_params.offload_kqv = false;
-        voc_params.op_offload = false;
-
-        llama_context* ctx_voc = llama_init_from_model(shared_vocoder_.get(), voc_params);
-        if (!ctx_voc) {
-            return {false, {}, 24000, "Failed to create vocoder context"};
-        }
+        const std::size_t n_codes = stage.codes();
+        LOG_INFO("TTS generated " + std::to_string(n_generated) + " code tokens, " +
+                 std::to_string(n_codes) + " audio tokens after filter");
 
-        llama_batch voc_batch = llama_batch_init(n_codes, 0, 1);
-        for (int i = 0; i < n_codes; ++i) {
-            voc_batch.token[i] = codes[i];
-            voc_batch.pos[i] = i;
-            voc_batch.n_seq_id[i] = 1;
-            voc_batch.seq_id[i][0] = 0;
-            voc_batch.logits[i] = true;
+        if (n_codes == 0) {
+            return {false, {}, 24000, "No audio tokens generated", {}};
         }
-        voc_batch.n_tokens = n_codes;
-
-        if (llama_encode(ctx_voc, voc_batch) != 0) {
-            llama_batch_free(voc_batch);
-            llama_free(ctx_voc);
-            return {false, {}, 24000, "Vocoder encode failed"};
+        if (chunk == 0) {
+            vocoded = stage.run();
         }
-
-        llama_batch_free(voc_batch);
-
-        // Get embeddings and convert to audio
-        int n_embd = llama_model_n_embd_out(shared_vocoder_.get());
-        const float* embd = llama_get_embeddings(ctx_voc);
-        if (!embd) {
-            llama_free(ctx_voc);
-            return {false, {}, 24000, "Failed to get vocoder embeddings"};
+        if (!vocoded) {
+            return {false, {}, 24000, stage.error(), stats};
         }
 
-        int n_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
-        auto audio = embd_to_audio(embd, n_codes, n_embd, n_threads);
+        LOG_INFO("TTS generated " + std::to_string(n_samples) + " audio samples");
 
-        llama_free(ctx_voc);
-
-        // Mute start of audio to suppress onset artifacts (from tts.cpp)
-        // NRVNA_TTS_MUTE_MS=0 disables for narration (avoids clipping chunk starts)
-        int mute_ms = env_int("NRVNA_TTS_MUTE_MS", 250);
-        if (mute_ms > 0) {
-            int silence_samples = std::min(static_cast<int>(audio.size()), 24000 * mute_ms / 1000);
-            for (int i = 0; i < silence_samples; ++i) {
-                audio[i] = 0.0f;
-            }
+        if (chunk == 0 && stats.decode_ms >= 0.0) {
+            stats.decode_ms = msSince(decodeStart);
         }
-
-        LOG_INFO("TTS generated " + std::to_string(audio.size()) + " audio samples");
-
-        return {true, std::move(audio), 24000, ""};
+        stats.context_reused = ttc_reused && voc_reused;
+        TtsResult result{true, std::move(audio), 24000, "", stats};
+        return result;
 
     } catch (const std::exception& e) {
         LOG_ERROR("TTS error: " + std::string(e.what()));
-        return {false, {}, 24000, "TTS error: " + std::string(e.what())};
+        return {false, {}, 24000, "TTS error: " + std::string(e.what()), {}};
     }
 }
 
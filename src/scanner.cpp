@@ -7,8 +7,10 @@
 #include "nrvna/scanner.hpp"
 #include "nrvna/flow.hpp"
 #include "nrvna/logger.hpp"
+#include "dir_watch.hpp"
 #include <algorithm>
 #include <fstream>
+#include <thread>
 
 namespace nrvnaai {
 
@@ -16,6 +18,59 @@ Scanner::Scanner(const std::filesystem::path& workspace) noexcept
     : workspace_(workspace), readyPath_(workspace / "input" / "ready") {
 }
 
+Scanner::~Scanner() = default;
+Scanner::Scanner(Scanner&&) noexcept = default;
+Scanner& Scanner::operator=(Scanner&&) noexcept = default;
+
+bool Scanner::watch() noexcept {
+    try {
+        auto watcher = std::make_unique<DirWatcher>();
+        if (!watcher->watch(readyPath_)) {
+            return false;
+        }
+        watcher_ = std::move(watcher);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool Scanner::isWatching() const noexcept {
+    return watcher_ && watcher_->isActive();
+}
+
+std::vector<JobId> Scanner::waitForJobs(std::chrono::milliseconds timeout, bool& rescan) noexcept {
+    std::vector<JobId> jobs;
+
+    if (!isWatching()) {
+        std::this_thread::sleep_for(timeout);
+        rescan = true;
+        return jobs;
+    }
+
+    try {
+        std::vector<std::filesystem::path> paths;
+        watcher_->wait(timeout, paths, rescan);
+
+        for (const auto& path : paths) {
+            JobId jobId = extractJobId(path);
+            if (Flow::isValidJobId(jobId) && isValidJobDirectory(path)) {
+                jobs.push_back(jobId);
+                LOG_TRACE("Watcher found job: " + jobId);
+            }
+        }
+        std::sort(jobs.begin(), jobs.end());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Scanner watch error: " + std::string(e.what()));
+        rescan = true;
+    } catch (...) {
+        LOG_ERROR("Unknown scanner watch error");
+        rescan = true;
+    }
+
+    return jobs;
+}
+
 std::vector<JobId> Scanner::scan() const noexcept {
     std::vector<JobId> jobs;
     
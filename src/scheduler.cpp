@@ -0,0 +1,463 @@
+/*
+ * nrvna ai - Asynchronous Inference Primitive
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "nrvna/scheduler.hpp"
+#include "nrvna/logger.hpp"
+#include "llama_util.hpp"
+#include "prefix_cache.hpp"
+#include "kv_session.hpp"
+#include "partial_writer.hpp"
+#include "think_filter.hpp"
+#include "llama.h"
+#include <algorithm>
+
+namespace nrvnaai {
+
+Scheduler::Scheduler(const std::string& modelPath, int maxSeqs, const WorkerThreads& threads)
+    : runner_(std::make_unique<Runner>(modelPath, "", 1, threads)), maxSeqs_(std::max(1, maxSeqs)) {
+    LOG_DEBUG("Scheduler created with " + std::to_string(maxSeqs_) + " sequence slots");
+}
+
+Scheduler::~Scheduler() {
+    stop();
+}
+
+bool Scheduler::start(CompletionFn onComplete) {
+    if (running_.load()) {
+        LOG_WARN("Scheduler already running");
+        return false;
+    }
+    if (!onComplete) {
+        LOG_ERROR("Invalid completion callback provided");
+        return false;
+    }
+
+    llama_model* model = runner_->shared_model_.get();
+    if (!model) {
+        LOG_ERROR("Scheduler: model not loaded");
+        return false;
+    }
+    if (llama_model_has_encoder(model)) {
+        LOG_WARN("Batching disabled: encoder-decoder models decode one job at a time");
+        return false;
+    }
+
+    Runner::SamplingConfig config = runner_->buildSamplingConfig();
+
+    // One unified KV cache shared by all sequences; admission keeps the sum of
+    // per-job reservations under n_ctx so decode never runs out of cells.
+    llama_context_params params;
+    runner_->buildContextParams(config, params);
+    nCtx_ = env_int("NRVNA_BATCH_CTX", maxSeqs_ * config.max_ctx);
+    nCtx_ = std::max(nCtx_, 512);
+    nBatch_ = std::max(static_cast<int>(params.n_batch), maxSeqs_);
+    params.n_ctx = static_cast<uint32_t>(nCtx_);
+    params.n_batch = static_cast<uint32_t>(nBatch_);
+    params.n_seq_max = static_cast<uint32_t>(maxSeqs_);
+    params.kv_unified = true;
+
+    ctx_ = llama_init_from_model(model, params);
+    if (!ctx_) {
+        LOG_ERROR("Scheduler: failed to create batched context (n_ctx=" + std::to_string(nCtx_) + ")");
+        return false;
+    }
+    nCtx_ = static_cast<int>(llama_n_ctx(ctx_));
+
+    batch_ = std::make_unique<llama_batch>(llama_batch_init(nBatch_, 0, 1));
+
+    freeSeqIds_.clear();
+    for (int i = maxSeqs_ - 1; i >= 0; --i) {
+        freeSeqIds_.push_back(i);
+    }
+
+    onComplete_ = std::move(onComplete);
+    stopping_.store(false);
+    running_.store(true);
+
+    try {
+        thread_ = std::thread(&Scheduler::loop, this);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to start scheduler thread: " + std::string(e.what()));
+        running_.store(false);
+        llama_batch_free(*batch_);
+        batch_.reset();
+        llama_free(ctx_);
+        ctx_ = nullptr;
+        return false;
+    }
+
+    LOG_INFO("Batch scheduler started: " + std::to_string(maxSeqs_) + " sequences, " +
+             std::to_string(nCtx_) + " shared context, batch " + std::to_string(nBatch_));
+    return true;
+}
+
+void Scheduler::stop() noexcept {
+    if (!running_.load()) {
+        return;
+    }
+
+    LOG_DEBUG("Stopping scheduler (draining in-flight sequences)...");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_.store(true);
+    }
+    work_.notify_all();
+    slots_.notify_all();
+
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    running_.store(false);
+
+    if (batch_) {
+        llama_batch_free(*batch_);
+        batch_.reset();
+    }
+    if (ctx_) {
+        llama_free(ctx_);
+        ctx_ = nullptr;
+    }
+
+    LOG_INFO("Batch scheduler stopped");
+}
+
+bool Scheduler::submit(const JobId& jobId, const std::string& prompt, const RunOptions& options,
+                       Clock::time_point startTime) noexcept {
+    if (!running_.load() || stopping_.load()) {
+        return false;
+    }
+
+    try {
+        auto seq = std::make_unique<Sequence>();
+        seq->id = jobId;
+        seq->start = startTime;
+        seq->resume_session = options.resume_session;
+        seq->save_session = options.save_session;
+
+        // Tokenize on the submitting worker so the decode thread stays on the GPU/CPU
+        Runner::SamplingConfig config = runner_->buildSamplingConfig();
+        std::string formatted = runner_->formatPrompt(prompt, options.history);
+
+        // Same split as the worker path: only the answer reaches result.partial
+        seq->think = std::make_unique<ThinkFilter>(formatted);
+        if (!options.stream_path.empty()) {
+            seq->stream = std::make_unique<PartialWriter>();
+            if (seq->stream->open(options.stream_path)) {
+                seq->think->setAnswerSink(seq->stream.get());
+            }
+        }
+        const llama_vocab* vocab = llama_model_get_vocab(runner_->shared_model_.get());
+        const int n_prompt = -llama_tokenize(vocab, formatted.c_str(), formatted.size(), nullptr, 0, true, true);
+        if (n_prompt <= 0) {
+            return false;
+        }
+        seq->tokens.resize(n_prompt);
+        if (llama_tokenize(vocab, formatted.c_str(), formatted.size(), seq->tokens.data(), seq->tokens.size(), true, true) < 0) {
+            return false;
+        }
+
+        // Same budget as runText: prompt + n_predict + slack, capped by max_ctx
+        // and by the shared context so a lone job always fits.
+        const int limit = std::min(config.max_ctx, nCtx_);
+        if (n_prompt + 64 > limit) {
+            return false;
+        }
+        seq->n_predict = std::min(config.n_predict, limit - n_prompt - 64);
+        seq->reserved = n_prompt + seq->n_predict + 64;
+        seq->smpl = runner_->buildSampler(config);
+        seq->store_at = sharedPrefixCache().observe(seq->tokens, 0);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        slots_.wait(lock, [this] { return inflight_ < maxSeqs_ || stopping_.load(); });
+        if (stopping_.load()) {
+            lock.unlock();
+            llama_sampler_free(seq->smpl);
+            return false;
+        }
+        pending_.push_back(std::move(seq));
+        ++inflight_;
+        lock.unlock();
+
+        work_.notify_one();
+        LOG_DEBUG("Job batched: " + jobId + " (" + std::to_string(n_prompt) + " prompt tokens)");
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to batch job " + jobId + ": " + std::string(e.what()));
+        return false;
+    } catch (...) {
+        LOG_ERROR("Unknown error batching job: " + jobId);
+        return false;
+    }
+}
+
+void Scheduler::loop() {
+    setThreadName("Scheduler");
+    LOG_DEBUG("Scheduler thread started");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] {
+                return !pending_.empty() || !active_.empty() || stopping_.load();
+            });
+            if (stopping_.load() && pending_.empty() && active_.empty()) {
+                break;
+            }
+        }
+
+        admit();
+        if (!step()) {
+            // Nothing admissible yet (waiting on KV budget) - yield briefly
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    LOG_DEBUG("Scheduler thread stopped");
+}
+
+void Scheduler::admit() {
+    const std::size_t first = active_.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // FIFO: the head waits for KV budget rather than being overtaken
+        while (!pending_.empty() && !freeSeqIds_.empty()) {
+            auto& next = pending_.front();
+            if (!active_.empty() && reserved_ + next->reserved > nCtx_) {
+                break;
+            }
+            next->seq_id = freeSeqIds_.back();
+            next->admitted = Clock::now();
+            freeSeqIds_.pop_back();
+            reserved_ += next->reserved;
+            LOG_DEBUG("Admitted " + next->id + " as seq " + std::to_string(next->seq_id));
+            active_.push_back(std::move(next));
+            pending_.pop_front();
+        }
+    }
+
+    // State copies happen outside the lock so submitters are not held up
+    for (std::size_t i = first; i < active_.size(); ++i) {
+        restorePrefix(*active_[i]);
+    }
+}
+
+void Scheduler::restorePrefix(Sequence& seq) {
+    if (!seq.resume_session.empty()) {
+        const int n_keep = restoreSession(ctx_, seq.seq_id, seq.resume_session, seq.tokens,
+                                          static_cast<uint32_t>(nCtx_));
+        if (n_keep > 0) {
+            seq.n_prefilled = static_cast<std::size_t>(n_keep);
+            seq.n_past = n_keep;
+            seq.session_restored = n_keep;
+            if (seq.store_at <= n_keep) {
+                seq.store_at = 0;
+            }
+            return;
+        }
+    }
+
+    PrefixCache& cache = sharedPrefixCache();
+    if (!cache.enabled()) {
+        return;
+    }
+
+    PrefixCache::Hit hit = cache.lookup(seq.tokens);
+    if (!hit.state) {
+        return;
+    }
+    if (llama_state_seq_set_data(ctx_, hit.state->data(), hit.state->size(), seq.seq_id) == 0) {
+        llama_memory_seq_rm(llama_get_memory(ctx_), seq.seq_id, -1, -1);
+        return;
+    }
+
+    seq.n_prefilled = static_cast<std::size_t>(hit.n_tokens);
+    seq.n_past = hit.n_tokens;
+    seq.prefix_cached = hit.n_tokens;
+    if (seq.store_at <= hit.n_tokens) {
+        seq.store_at = 0;
+    }
+    LOG_DEBUG("Prefix cache hit for " + seq.id + ": " + std::to_string(hit.n_tokens) + "/" +
+              std::to_string(seq.tokens.size()) + " tokens");
+}
+
+bool Scheduler::step() {
+    if (active_.empty()) {
+        return false;
+    }
+
+    llama_batch& batch = *batch_;
+    batch.n_tokens = 0;
+    auto add = [&](int32_t token, int32_t pos, int32_t seqId, bool logits) {
+        const int i = batch.n_tokens++;
+        batch.token[i] = token;
+        batch.pos[i] = pos;
+        batch.n_seq_id[i] = 1;
+        batch.seq_id[i][0] = seqId;
+        batch.logits[i] = logits;
+        return i;
+    };
+
+    // Decode tokens first so running jobs never stall behind a long prefill
+    for (auto& seq : active_) {
+        seq->batch_idx = -1;
+        if (seq->next_token >= 0) {
+            seq->batch_idx = add(seq->next_token, seq->n_past++, seq->seq_id, true);
+            seq->next_token = -1;
+        }
+    }
+    for (auto& seq : active_) {
+        const std::size_t remaining = seq->tokens.size() - seq->n_prefilled;
+        if (remaining == 0 || batch.n_tokens >= nBatch_) {
+            continue;
+        }
+        std::size_t n = std::min(remaining, static_cast<std::size_t>(nBatch_ - batch.n_tokens));
+        if (seq->store_at > 0) {
+            // Stop at the shared boundary so its state can be snapshotted
+            n = std::min(n, static_cast<std::size_t>(seq->store_at) - seq->n_prefilled);
+        }
+        for (std::size_t k = 0; k < n; ++k) {
+            const bool last = seq->n_prefilled + 1 == seq->tokens.size();
+            int idx = add(seq->tokens[seq->n_prefilled++], seq->n_past++, seq->seq_id, last);
+            if (last) {
+                seq->batch_idx = idx;
+            }
+        }
+    }
+
+    if (batch.n_tokens == 0) {
+        return false;
+    }
+
+    if (llama_decode(ctx_, batch) != 0) {
+        LOG_ERROR("Batched decode failed (" + std::to_string(batch.n_tokens) + " tokens, " +
+                  std::to_string(active_.size()) + " sequences)");
+        for (auto& seq : active_) {
+            retire(*seq, false, "Failed to decode batch");
+        }
+    } else {
+        for (auto& seq : active_) {
+            if (seq->store_at > 0 && seq->n_prefilled == static_cast<std::size_t>(seq->store_at)) {
+                std::vector<uint8_t> state(llama_state_seq_get_size(ctx_, seq->seq_id));
+                if (!state.empty() &&
+                    llama_state_seq_get_data(ctx_, state.data(), state.size(), seq->seq_id) == state.size()) {
+                    sharedPrefixCache().insert(seq->tokens, seq->store_at, std::move(state));
+                }
+                seq->store_at = 0;
+            }
+        }
+
+        const llama_vocab* vocab = llama_model_get_vocab(runner_->shared_model_.get());
+        for (auto& seq : active_) {
+            if (seq->batch_idx < 0) {
+                continue;
+            }
+            if (seq->n_predict <= 0) {
+                retire(*seq, true, "");
+                continue;
+            }
+
+            llama_token token = llama_sampler_sample(seq->smpl, ctx_, seq->batch_idx);
+            llama_sampler_accept(seq->smpl, token);
+            if (!seq->sampled_any) {
+                seq->sampled_any = true;
+                seq->first_token = Clock::now();
+            }
+            if (llama_vocab_is_eog(vocab, token)) {
+                retire(*seq, true, "");
+                continue;
+            }
+
+            char buf[128];
+            int n = llama_token_to_piece(vocab, token, buf, sizeof(buf), 0, true);
+            if (n < 0) {
+                LOG_ERROR("Failed to convert token to piece");
+                retire(*seq, true, "");
+                continue;
+            }
+            seq->output_bytes += static_cast<std::size_t>(n);
+            seq->think->feed(buf, static_cast<std::size_t>(n));
+
+            if (++seq->generated >= seq->n_predict) {
+                retire(*seq, true, "");
+                continue;
+            }
+            seq->next_token = token;
+            if (!seq->save_session.empty()) {
+                seq->sampled.push_back(token);
+            }
+        }
+    }
+
+    active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                 [](const std::unique_ptr<Sequence>& s) { return s->seq_id < 0; }),
+                  active_.end());
+    return true;
+}
+
+void Scheduler::retire(Sequence& seq, bool ok, const std::string& error) {
+    bool session_saved = false;
+    if (ok && !seq.save_session.empty()) {
+        // Every sampled token has been decoded by the time a sequence retires
+        std::vector<llama_token> history = seq.tokens;
+        history.insert(history.end(), seq.sampled.begin(), seq.sampled.end());
+        session_saved = saveSession(ctx_, seq.seq_id, seq.save_session, history);
+    }
+    llama_memory_seq_rm(llama_get_memory(ctx_), seq.seq_id, -1, -1);
+    if (seq.think) seq.think->finish();
+    seq.stream.reset();  // flush result.partial before the job directory moves
+    if (seq.smpl) {
+        llama_sampler_free(seq.smpl);
+        seq.smpl = nullptr;
+    }
+
+    RunResult result;
+    if (ok) {
+        LOG_INFO("Generated " + std::to_string(seq.output_bytes) + " bytes");
+        result = {true, seq.think ? seq.think->takeAnswer() : std::string(), "", {}};
+    } else {
+        result = {false, "", error, {}};
+    }
+    result.stats.context_reused = true;  // the batched context outlives every job
+    result.stats.prefix_cached_tokens = seq.prefix_cached;
+    result.stats.session_restored_tokens = seq.session_restored;
+    result.stats.session_saved = session_saved;
+    result.stats.think_tokens = seq.think ? seq.think->thinkingTokens() : 0;
+
+    // Setup here is the wait for a sequence slot; prefill shares batches with
+    // other jobs' decode steps, so prompt/decode are wall time, not compute
+    using Ms = std::chrono::duration<double, std::milli>;
+    const auto now = Clock::now();
+    if (seq.admitted != Clock::time_point{}) {
+        result.stats.setup_ms = Ms(seq.admitted - seq.start).count();
+        const auto prefillEnd = seq.sampled_any ? seq.first_token : now;
+        result.stats.prompt_ms = Ms(prefillEnd - seq.admitted).count();
+    }
+    if (seq.sampled_any) {
+        result.stats.ttft_ms = Ms(seq.first_token - seq.start).count();
+        result.stats.decode_ms = Ms(now - seq.first_token).count();
+    }
+    result.stats.prompt_tokens = static_cast<int>(seq.tokens.size());
+    result.stats.generated_tokens = seq.generated;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        freeSeqIds_.push_back(seq.seq_id);
+        reserved_ -= seq.reserved;
+        --inflight_;
+    }
+    seq.seq_id = -1;
+    slots_.notify_one();
+
+    try {
+        onComplete_(seq.id, result, seq.start);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Scheduler completion error: " + std::string(e.what()) + " (job: " + seq.id + ")");
+    } catch (...) {
+        LOG_ERROR("Unknown scheduler completion error (job: " + seq.id + ")");
+    }
+}
+
+}
@@ -11,13 +11,50 @@
 #include "nrvna/runner.hpp"
 #include "nrvna/runner_tts.hpp"
 #include "nrvna/logger.hpp"
+#include "nrvna/meta.hpp"
+#include "archive.hpp"
+#include "lease.hpp"
+#include "llama_util.hpp"
+#include "metrics.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace nrvnaai {
 
+namespace {
+
+JobType parseJobType(const std::string& mode) noexcept {
+    if (mode == "embed") return JobType::Embed;
+    if (mode == "vision") return JobType::Vision;
+    if (mode == "tts") return JobType::Tts;
+    return JobType::Text;
+}
+
+// Lane for a job in input/ready/: meta.json when Work wrote one, else type.txt
+JobTraits classifyJob(const std::filesystem::path& workspace, const JobId& jobId) noexcept {
+    JobTraits traits;
+    try {
+        const auto dir = workspace / "input" / "ready" / jobId;
+        if (auto meta = readMetaJson(dir); meta && !meta->mode.empty()) {
+            traits.type = parseJobType(meta->mode);
+            traits.priority = meta->priority;
+            traits.model = meta->model;
+            return traits;
+        }
+        std::ifstream typeFile(dir / "type.txt", std::ios::binary);
+        std::string mode;
+        if (typeFile && std::getline(typeFile, mode)) traits.type = parseJobType(mode);
+    } catch (...) {}
+    return traits;
+}
+
+} // namespace
+
 // Note: Signal handling is done by the CLI (nrvnad.cpp), not by Server class
 
 Server::Server(const std::string& modelPath, const std::filesystem::path& workspace, int workers,
@@ -48,7 +85,16 @@ bool Server::start() {
         return false;
     }
 
-    // Recover any orphaned jobs from previous run
+    // Join the workspace as a node: claims carry its lease, and other
+    // daemons sharing the workspace leave them alone while it heartbeats
+    try {
+        leases_ = std::make_unique<LeaseTable>(workspace_);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to register with workspace: " + std::string(e.what()));
+        return false;
+    }
+
+    // Recover jobs orphaned by a previous run (or by a dead peer)
     if (!recoverOrphanedJobs()) {
         LOG_WARN("Some orphaned jobs could not be recovered");
     }
@@ -74,7 +120,7 @@ bool Server::start() {
     try {
         scanner_ = std::make_unique<Scanner>(workspace_);
         pool_ = std::make_unique<Pool>(workers_);
-        processor_ = std::make_unique<Processor>(workspace_, modelPath_, mmprojPath_, vocoderPath_);
+        processor_ = std::make_unique<Processor>(workspace_, modelPath_, mmprojPath_, vocoderPath_, leases_.get());
 
         // Pre-initialize all Runners BEFORE starting worker threads
         LOG_DEBUG("Pre-initializing " + std::to_string(workers_) + " Runner instances...");
@@ -84,6 +130,29 @@ bool Server::start() {
         }
         LOG_DEBUG("All " + std::to_string(workers_) + " Runner instances initialized successfully");
 
+        // Optional continuous batching: text jobs share one multi-sequence context
+        const int batchSeqs = env_int("NRVNA_BATCH_SEQS", 0);
+        if (batchSeqs > 1) {
+            if (!processor_->enableBatching(batchSeqs)) {
+                LOG_WARN("Continuous batching unavailable, text jobs run per worker");
+            }
+        }
+
+        // Text-embed jobs waiting in the queue are decoded together by one worker
+        const int embedSeqs = env_int("NRVNA_EMBED_SEQS", 16);
+        if (embedSeqs > 1) {
+            processor_->enableEmbedBatching(
+                embedSeqs,
+                [this](std::size_t max, const JobFilter& filter) { return pool_->take(max, filter); },
+                [this](const JobId& jobId) { (void)pool_->submit(jobId); });
+        }
+
+        // Optional KV sessions: text jobs keep session.bin, children resume from it
+        if (env_int("NRVNA_KV_SESSIONS", 0) > 0) {
+            processor_->enableSessions(true);
+            LOG_INFO("KV sessions enabled: parent-linked jobs resume their parent's state");
+        }
+
         // Pre-initialize TTS Runners if vocoder is available
         if (!vocoderPath_.empty()) {
             LOG_DEBUG("Pre-initializing TTS runners...");
@@ -94,10 +163,34 @@ bool Server::start() {
             LOG_DEBUG("TTS runners initialized successfully");
         }
 
+        // The warmup decode ran alongside the setup above
+        processor_->finishWarmup();
+
         // Start pool with processor function
         LOG_DEBUG("Starting worker pool with " + std::to_string(workers_) + " threads...");
+        // Prometheus text file for scraping (NRVNA_METRICS_INTERVAL=0 disables)
+        if (env_int("NRVNA_METRICS_INTERVAL", 15) > 0) {
+            metrics_ = std::make_unique<Metrics>(workspace_);
+            processor_->setMetrics(metrics_.get());
+        }
+
+        // Job-type lanes: short embeds are not stuck behind long generations
+        pool_->setClassifier([this](const JobId& jobId) {
+            return classifyJob(workspace_, jobId);
+        });
+        // Jobs for a model that is already loaded go first, so workers switch less
+        pool_->setModelWarmth([this](const std::string& model) {
+            return processor_->modelResident(model);
+        });
+        // Each worker runs on the CPUs planned for its Runner's threads
+        pool_->setWorkerInit([this](int workerId) {
+            processor_->bindWorkerThread(workerId);
+        });
         if (!pool_->start([this](const JobId& jobId, int workerId) {
-            (void)processor_->process(jobId, workerId);
+            if (metrics_) metrics_->workerStarted();
+            const auto result = processor_->process(jobId, workerId);
+            if (metrics_) metrics_->workerFinished();
+            return result != ProcessResult::Deferred && result != ProcessResult::NotFound;
         })) {
             LOG_ERROR("Failed to start worker pool");
             return false;
@@ -107,6 +200,9 @@ bool Server::start() {
 
         // Start scanner loop in background
         scannerThread_ = std::thread(&Server::scanLoop, this);
+        if (const int archiveAge = env_int("NRVNA_ARCHIVE_AGE_S", 0); archiveAge > 0) {
+            archiveThread_ = std::thread(&Server::archiveLoop, this, archiveAge);
+        }
 
         LOG_DEBUG("Server started successfully");
         return true;
@@ -116,10 +212,13 @@ bool Server::start() {
         // Clean up anything that was partially started
         shutdown_.store(true);
         running_.store(false);
+        if (scannerThread_.joinable()) scannerThread_.join();
         if (pool_) pool_->stop();
         processor_.reset();
+        metrics_.reset();
         pool_.reset();
         scanner_.reset();
+        leases_.reset();
         return false;
     }
 }
@@ -134,10 +233,13 @@ void Server::shutdown() noexcept {
     shutdown_.store(true);
     running_.store(false);
 
-    // Stop scanner thread
+    // Stop scanner thread; the archiver finishes its current pass first
     if (scannerThread_.joinable()) {
         scannerThread_.join();
     }
+    if (archiveThread_.joinable()) {
+        archiveThread_.join();
+    }
 
     // Stop pool
     if (pool_) {
@@ -146,8 +248,14 @@ void Server::shutdown() noexcept {
 
     // Clean up components
     processor_.reset();
+    if (metrics_ && pool_) {
+        (void)metrics_->write(pool_->laneStats(), workers_);
+    }
+    metrics_.reset();
     pool_.reset();
     scanner_.reset();
+    // Jobs still in processing/ are free for peers (or our next start) at once
+    leases_.reset();
 
     LOG_INFO("Server shutdown complete");
 }
@@ -169,92 +277,179 @@ bool Server::createWorkspace() noexcept {
 }
 
 bool Server::recoverOrphanedJobs() noexcept {
-    try {
-        auto processingDir = workspace_ / "processing";
-        if (!std::filesystem::exists(processingDir)) {
-            return true;
-        }
-
-        int recovered = 0;
-        for (const auto& entry : std::filesystem::directory_iterator(processingDir)) {
-            if (entry.is_directory()) {
-                std::string jobId = entry.path().filename().string();
-                LOG_WARN("Recovering orphaned job: " + jobId);
-
-                std::error_code ec;
-                std::filesystem::rename(entry.path(), workspace_ / "input" / "ready" / jobId, ec);
-                if (ec) {
-                    LOG_ERROR("Failed to recover job " + jobId + ": " + ec.message());
-                    std::filesystem::rename(entry.path(), workspace_ / "failed" / jobId, ec);
-                } else {
-                    recovered++;
-                }
-            }
-        }
-
-        if (recovered > 0) {
-            LOG_INFO("Recovered " + std::to_string(recovered) + " orphaned job(s)");
-        }
-        return true;
-    } catch (const std::exception& e) {
-        LOG_ERROR("Error recovering orphaned jobs: " + std::string(e.what()));
-        return false;
+    const int peers = leases_->peers();
+    if (peers > 0) {
+        LOG_INFO("Workspace shared with " + std::to_string(peers) +
+                 " other daemon(s): only their expired claims are recovered");
+    }
+    const int recovered = leases_->recover(true);
+    if (recovered > 0) {
+        LOG_INFO("Recovered " + std::to_string(recovered) + " orphaned job(s)");
     }
+    return recovered >= 0;
 }
 
 void Server::scanLoop() {
     LOG_DEBUG("Scanner loop started");
 
-    const auto scanInterval = std::chrono::seconds(5);
+    const auto pollInterval = std::chrono::seconds(5);
     const auto retryInterval = std::chrono::seconds(30);
+    const auto waitSlice = std::chrono::milliseconds(100);
     std::unordered_map<JobId, std::chrono::steady_clock::time_point> submittedJobs;
 
+    // With a watcher, jobs are submitted as soon as they are renamed into ready/.
+    // The full scan then only runs as a safety net for missed events.
+    const bool watching = scanner_->watch();
+    const auto scanInterval = watching
+        ? std::chrono::seconds(std::max(1, env_int("NRVNA_RESCAN_INTERVAL", 30)))
+        : pollInterval;
+    if (watching) {
+        LOG_DEBUG("Watching input/ready/ (full rescan every " +
+                  std::to_string(scanInterval.count()) + "s)");
+    } else {
+        LOG_DEBUG("No directory watcher available, polling every " +
+                  std::to_string(scanInterval.count()) + "s");
+    }
+
+    auto nextScan = std::chrono::steady_clock::now();
+    bool rescan = true;
+    const auto statsInterval = std::chrono::seconds(60);
+    auto nextStats = nextScan + statsInterval;
+    std::size_t lastServed = 0;
+    const auto metricsInterval = std::chrono::seconds(std::max(1, env_int("NRVNA_METRICS_INTERVAL", 15)));
+    auto nextMetrics = nextScan;
+    const auto leaseInterval = leases_->heartbeatInterval();
+    auto nextLease = nextScan + leaseInterval;
+    bool shared = leases_->peers() > 0;
+
     while (!shutdown_.load()) {
         try {
-            auto jobs = scanner_->scan();
-            int newCount = 0;
             auto now = std::chrono::steady_clock::now();
-            std::unordered_set<JobId> currentJobs(jobs.begin(), jobs.end());
 
-            for (auto it = submittedJobs.begin(); it != submittedJobs.end();) {
-                if (currentJobs.find(it->first) == currentJobs.end()) {
-                    it = submittedJobs.erase(it);
-                } else {
-                    ++it;
+            if (rescan || now >= nextScan) {
+                auto jobs = scanner_->scan();
+                int newCount = 0;
+                std::unordered_set<JobId> currentJobs(jobs.begin(), jobs.end());
+
+                for (auto it = submittedJobs.begin(); it != submittedJobs.end();) {
+                    if (currentJobs.find(it->first) == currentJobs.end()) {
+                        it = submittedJobs.erase(it);
+                    } else {
+                        ++it;
+                    }
                 }
-            }
 
-            for (const auto& jobId : jobs) {
-                if (shutdown_.load()) break;
+                for (const auto& jobId : jobs) {
+                    if (shutdown_.load()) break;
 
-                auto it = submittedJobs.find(jobId);
-                if (it == submittedJobs.end() || (now - it->second) >= retryInterval) {
-                    if (pool_->submit(jobId)) {
-                        submittedJobs[jobId] = now;
-                        newCount++;
+                    auto it = submittedJobs.find(jobId);
+                    if (it == submittedJobs.end() || (now - it->second) >= retryInterval) {
+                        if (pool_->submit(jobId)) {
+                            submittedJobs[jobId] = now;
+                            newCount++;
+                        }
                     }
                 }
+
+                if (newCount > 0) {
+                    LOG_DEBUG("Submitted " + std::to_string(newCount) + " new jobs to pool");
+                }
+
+                rescan = false;
+                nextScan = now + scanInterval;
+            }
+
+            if (now >= nextStats) {
+                nextStats = now + statsInterval;
+                logLaneStats(lastServed);
+            }
+
+            if (metrics_ && now >= nextMetrics) {
+                nextMetrics = now + metricsInterval;
+                (void)metrics_->write(pool_->laneStats(), workers_);
             }
 
-            if (newCount > 0) {
-                LOG_DEBUG("Submitted " + std::to_string(newCount) + " new jobs to pool");
+            // Keep our claims alive and take back those of daemons that died
+            if (now >= nextLease) {
+                nextLease = now + leaseInterval;
+                (void)leases_->heartbeat();
+                const int recovered = leases_->recover(false);
+                if (recovered > 0) {
+                    LOG_INFO("Recovered " + std::to_string(recovered) + " job(s) from an expired lease");
+                    rescan = true;
+                }
+                if (!shared && leases_->peers() > 0) {
+                    shared = true;
+                    processor_->shareWorkspace();
+                }
             }
 
-            auto sleepEnd = std::chrono::steady_clock::now() + scanInterval;
-            while (std::chrono::steady_clock::now() < sleepEnd && !shutdown_.load()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (watching) {
+                // Coalesce overflow rescans: at most one per wait slice
+                bool overflow = false;
+                auto jobs = scanner_->waitForJobs(waitSlice, overflow);
+                now = std::chrono::steady_clock::now();
+                for (const auto& jobId : jobs) {
+                    if (pool_->submit(jobId)) {
+                        submittedJobs[jobId] = now;
+                        LOG_DEBUG("Submitted job on arrival: " + jobId);
+                    }
+                }
+                rescan = overflow;
+            } else {
+                std::this_thread::sleep_for(waitSlice);
             }
 
         } catch (const std::exception& e) {
             LOG_ERROR("Scanner loop error: " + std::string(e.what()));
-            std::this_thread::sleep_for(scanInterval);
+            std::this_thread::sleep_for(pollInterval);
         } catch (...) {
             LOG_ERROR("Unknown scanner loop error");
-            std::this_thread::sleep_for(scanInterval);
+            std::this_thread::sleep_for(pollInterval);
         }
     }
 
     LOG_DEBUG("Scanner loop stopped");
 }
 
+void Server::archiveLoop(int ageSeconds) {
+    setThreadName("Archiver");
+    LOG_INFO("Archiving finished jobs older than " + std::to_string(ageSeconds) + "s");
+
+    // A full batch means there is more, so the next pass runs right away
+    Archive archive(workspace_);
+    const auto interval = std::chrono::seconds(std::clamp(ageSeconds / 4, 10, 300));
+    const auto batch = static_cast<std::size_t>(std::max(1, env_int("NRVNA_ARCHIVE_BATCH", 1024)));
+    const auto waitSlice = std::chrono::milliseconds(200);
+    auto next = std::chrono::steady_clock::now() + interval;
+
+    while (!shutdown_.load()) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= next) {
+            const int packed = archive.compact(std::chrono::seconds(ageSeconds), batch);
+            const auto done = std::chrono::steady_clock::now();
+            next = packed >= static_cast<int>(batch) ? done : done + interval;
+            continue;
+        }
+        std::this_thread::sleep_for(waitSlice);
+    }
+}
+
+// One line per lane, only when jobs were served since the last report
+void Server::logLaneStats(std::size_t& lastServed) const {
+    const auto lanes = pool_->laneStats();
+    std::size_t served = 0;
+    for (const auto& lane : lanes) served += lane.served;
+    if (served == lastServed) return;
+    lastServed = served;
+
+    for (const auto& lane : lanes) {
+        char line[320];
+        std::snprintf(line, sizeof(line), "Lane %s/%+d%s%s: queued %zu, served %zu, wait %.0fms, service %.0fms",
+                      jobTypeToString(lane.type).c_str(), lane.priority, lane.model.empty() ? "" : "/",
+                      lane.model.c_str(), lane.queued, lane.served, lane.wait_ms, lane.service_ms);
+        LOG_INFO(line);
+    }
+}
+
 }
@@ -0,0 +1,149 @@
+/*
+ * nrvna ai - Incremental reasoning-block filter (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "think_filter.hpp"
+#include "partial_writer.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace nrvnaai {
+
+namespace {
+
+struct BlockKind {
+    const char* open;
+    const char* close[2];       // either ends the block
+    const char* forced;         // written to end it early
+};
+
+constexpr BlockKind kKinds[] = {
+    {"<think>",           {"</think>", nullptr},               "\n</think>\n\n"},
+    {"<|channel>thought", {"<channel|>", nullptr},             "<channel|>"},
+    {"[Start thinking]",  {"[/End thinking]", "<channel|>"},   "[/End thinking]\n\n"},
+};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+template <typename F>
+void forEachMarker(int block, F&& f) {
+    if (block < 0) {
+        for (int k = 0; k < static_cast<int>(std::size(kKinds)); ++k) f(kKinds[k].open, k);
+        return;
+    }
+    for (const char* close : kKinds[block].close) {
+        if (close) f(close, -1);
+    }
+}
+
+} // namespace
+
+ThinkFilter::ThinkFilter(const std::string& formattedPrompt) {
+    const std::size_t end = formattedPrompt.find_last_not_of(" \t\n\r");
+    if (end == std::string::npos) {
+        return;
+    }
+    for (int k = 0; k < static_cast<int>(std::size(kKinds)); ++k) {
+        const std::size_t len = std::strlen(kKinds[k].open);
+        if (end + 1 >= len && formattedPrompt.compare(end + 1 - len, len, kKinds[k].open) == 0) {
+            block_ = k;
+            return;
+        }
+    }
+}
+
+std::size_t ThinkFilter::findMarker(std::size_t from, std::size_t& length, int& next) const {
+    std::size_t best = std::string::npos;
+    forEachMarker(block_, [&](const char* marker, int kind) {
+        const std::size_t at = buf_.find(marker, from);
+        if (at < best) {
+            best = at;
+            length = std::strlen(marker);
+            next = kind;
+        }
+    });
+    return best;
+}
+
+std::size_t ThinkFilter::heldTail() const {
+    std::size_t held = 0;
+    forEachMarker(block_, [&](const char* marker, int) {
+        const std::size_t len = std::strlen(marker);
+        for (std::size_t k = std::min(len - 1, buf_.size()); k > held; --k) {
+            if (buf_.compare(buf_.size() - k, k, marker, k) == 0) {
+                held = k;
+                break;
+            }
+        }
+    });
+    return held;
+}
+
+void ThinkFilter::emit(const char* data, std::size_t n) {
+    if (block_ >= 0) {
+        if (sink_ && n > 0) sink_->append(data, n);
+        return;
+    }
+    std::size_t i = 0;
+    if (skipSpace_ || answer_.empty()) {
+        while (i < n && isSpace(data[i])) ++i;
+        if (i < n) skipSpace_ = false;
+    }
+    answer_.append(data + i, n - i);
+    if (answerSink_ && i < n) answerSink_->append(data + i, n - i);
+}
+
+void ThinkFilter::feed(const char* data, std::size_t n) {
+    const bool wasThinking = thinking();
+    buf_.append(data, n);
+
+    std::size_t pos = 0;
+    for (;;) {
+        std::size_t length = 0;
+        int next = -1;
+        const std::size_t at = findMarker(pos, length, next);
+        if (at == std::string::npos) break;
+        emit(buf_.data() + pos, at - pos);
+        if (block_ < 0) {
+            block_ = next;
+        } else {
+            block_ = -1;
+            skipSpace_ = true;
+        }
+        blockTokens_ = 0;
+        pos = at + length;
+    }
+    buf_.erase(0, pos);
+
+    // Keep back only what could still grow into a marker
+    const std::size_t held = heldTail();
+    emit(buf_.data(), buf_.size() - held);
+    buf_.erase(0, buf_.size() - held);
+
+    if (wasThinking && thinking()) {
+        ++tokens_;
+        ++blockTokens_;
+    }
+}
+
+void ThinkFilter::finish() {
+    emit(buf_.data(), buf_.size());
+    buf_.clear();
+}
+
+std::string ThinkFilter::closingText() const {
+    return block_ >= 0 ? kKinds[block_].forced : "";
+}
+
+std::string ThinkFilter::strip(const std::string& text) {
+    ThinkFilter filter;
+    filter.feed(text);
+    filter.finish();
+    return filter.takeAnswer();
+}
+
+} // namespace nrvnaai
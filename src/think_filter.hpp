@@ -0,0 +1,69 @@
+/*
+ * nrvna ai - Incremental reasoning-block filter (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace nrvnaai {
+
+class PartialWriter;
+
+// Splits generated text into the answer and the reasoning blocks of
+// reasoning models, one detokenized piece at a time: <think>...</think>
+// (Qwen3, DeepSeek-R1, QwQ), <|channel>thought...<channel|> and
+// [Start thinking]...[/End thinking] (Gemma 4). Markers may span pieces; a
+// tail that could still become one is held back until the next piece.
+// Whitespace after a closing marker and before the answer is dropped, and a
+// block still open at finish() is discarded (n_predict ran out mid-thought).
+// Reasoning text goes to an optional sink (thinking.txt), never the answer;
+// answer text is mirrored to another (result.partial) as it is routed.
+class ThinkFilter {
+public:
+    ThinkFilter() = default;
+    // Templates that open the block themselves (generation prompt ending in
+    // "<think>") start the output inside it
+    explicit ThinkFilter(const std::string& formattedPrompt);
+
+    void setSink(PartialWriter* sink) noexcept { sink_ = sink; }
+    void setAnswerSink(PartialWriter* sink) noexcept { answerSink_ = sink; }
+
+    // One generated piece; counts as a reasoning token when it starts and
+    // ends inside a block
+    void feed(const char* data, std::size_t n);
+    void feed(const std::string& text) { feed(text.data(), text.size()); }
+    void finish();
+
+    [[nodiscard]] bool thinking() const noexcept { return block_ >= 0; }
+    // Reasoning tokens of the whole output, and of the open block alone
+    [[nodiscard]] int thinkingTokens() const noexcept { return tokens_; }
+    [[nodiscard]] int blockTokens() const noexcept { return blockTokens_; }
+    // Text that ends the open block cleanly, for forcing it shut
+    [[nodiscard]] std::string closingText() const;
+    [[nodiscard]] const std::string& answer() const noexcept { return answer_; }
+    [[nodiscard]] std::string takeAnswer() { return std::move(answer_); }
+
+    // Whole-string form, for output that was not filtered while decoding
+    static std::string strip(const std::string& text);
+
+private:
+    void emit(const char* data, std::size_t n);
+    // Earliest marker of the current state in buf_ from `from`; npos if none
+    std::size_t findMarker(std::size_t from, std::size_t& length, int& next) const;
+    [[nodiscard]] std::size_t heldTail() const;
+
+    std::string buf_;           // pending text not yet routed
+    std::string answer_;
+    PartialWriter* sink_ = nullptr;
+    PartialWriter* answerSink_ = nullptr;
+    int block_ = -1;            // index of the open block kind, -1 = outside
+    bool skipSpace_ = false;    // just closed a block
+    int tokens_ = 0;
+    int blockTokens_ = 0;       // reset whenever a block opens or closes
+};
+
+} // namespace nrvnaai
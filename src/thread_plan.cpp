@@ -0,0 +1,223 @@
+/*
+ * nrvna ai - CPU thread budgeting across workers (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "thread_plan.hpp"
+#include "llama_util.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace nrvnaai {
+
+namespace {
+
+struct Core {
+    int node = -1;
+    int package = 0;
+    int id = 0;
+    std::vector<int> cpus;      // SMT siblings, lowest first
+};
+
+// "0-3,8,10-11" as used by sysfs cpulist files
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < list.size()) {
+        std::size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        const std::string part = list.substr(pos, end - pos);
+        pos = end + 1;
+        try {
+            const std::size_t dash = part.find('-');
+            const int lo = std::stoi(part.substr(0, dash));
+            const int hi = dash == std::string::npos ? lo : std::stoi(part.substr(dash + 1));
+            for (int c = lo; c <= hi; ++c) cpus.push_back(c);
+        } catch (...) {}
+    }
+    return cpus;
+}
+
+std::string formatCpuList(const std::vector<int>& cpus) {
+    std::string out;
+    for (std::size_t i = 0; i < cpus.size();) {
+        std::size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!out.empty()) out += ",";
+        out += std::to_string(cpus[i]);
+        if (j > i) out += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return out;
+}
+
+int readSysInt(const std::filesystem::path& path, int fallback) {
+    std::ifstream in(path);
+    int v = fallback;
+    return (in >> v) ? v : fallback;
+}
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) cpus.push_back(c);
+        }
+    }
+#endif
+    return cpus;
+}
+
+// Physical cores among the allowed CPUs, ordered by node so contiguous runs stay local
+std::vector<Core> detectCores(const std::vector<int>& allowed) {
+    const std::filesystem::path sys = "/sys/devices/system";
+    std::map<int, int> nodeOf;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(sys / "node", ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4) continue;
+        std::ifstream in(entry.path() / "cpulist");
+        std::string list;
+        if (!std::getline(in, list)) continue;
+        const int node = std::atoi(name.c_str() + 4);
+        for (int c : parseCpuList(list)) nodeOf[c] = node;
+    }
+
+    std::map<std::tuple<int, int, int>, Core> byKey;
+    for (int c : allowed) {
+        const auto topo = sys / "cpu" / ("cpu" + std::to_string(c)) / "topology";
+        Core core;
+        core.package = readSysInt(topo / "physical_package_id", 0);
+        core.id = readSysInt(topo / "core_id", c);
+        auto it = nodeOf.find(c);
+        core.node = it == nodeOf.end() ? -1 : it->second;
+        auto& slot = byKey.try_emplace({core.node, core.package, core.id}, core).first->second;
+        slot.cpus.push_back(c);
+    }
+
+    std::vector<Core> cores;
+    cores.reserve(byKey.size());
+    for (auto& [key, core] : byKey) cores.push_back(std::move(core));
+    return cores;
+}
+
+} // namespace
+
+ThreadPlan planThreads(int workers) {
+    ThreadPlan plan;
+    workers = std::max(1, workers);
+    plan.workers.resize(static_cast<std::size_t>(workers));
+
+    const std::vector<int> allowed = allowedCpus();
+    const std::vector<Core> cores = allowed.empty() ? std::vector<Core>{} : detectCores(allowed);
+
+    if (cores.empty()) {
+        // No topology (not Linux): split the logical CPU count evenly
+        const int total = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        plan.cores = total;
+        for (auto& w : plan.workers) {
+            w.n_threads = w.n_threads_batch = std::max(1, total / workers);
+        }
+        plan.shared.n_threads = plan.shared.n_threads_batch = total;
+    } else {
+        plan.cores = static_cast<int>(cores.size());
+        std::vector<int> nodes;
+        for (const auto& core : cores) {
+            if (std::find(nodes.begin(), nodes.end(), core.node) == nodes.end()) nodes.push_back(core.node);
+        }
+        plan.nodes = static_cast<int>(nodes.size());
+
+        // Fewer cores than workers: nothing disjoint to pin to, share everything
+        plan.pinned = plan.cores >= workers && env_int("NRVNA_PIN", 1) != 0;
+        for (int w = 0; w < workers; ++w) {
+            auto& share = plan.workers[static_cast<std::size_t>(w)];
+            if (plan.cores < workers) {
+                share.n_threads = 1;
+                share.n_threads_batch = std::max(1, static_cast<int>(allowed.size()) / workers);
+                continue;
+            }
+            const std::size_t first = cores.size() * static_cast<std::size_t>(w) / static_cast<std::size_t>(workers);
+            const std::size_t last = cores.size() * static_cast<std::size_t>(w + 1) / static_cast<std::size_t>(workers);
+            share.node = cores[first].node;
+            for (std::size_t i = first; i < last; ++i) {
+                share.cpus.insert(share.cpus.end(), cores[i].cpus.begin(), cores[i].cpus.end());
+                share.decode_cpus.push_back(cores[i].cpus.front());
+                if (cores[i].node != share.node) share.node = -1;
+            }
+            std::sort(share.cpus.begin(), share.cpus.end());
+            share.n_threads = static_cast<int>(share.decode_cpus.size());
+            share.n_threads_batch = static_cast<int>(share.cpus.size());
+            if (!plan.pinned) {
+                share.cpus.clear();
+                share.decode_cpus.clear();
+            }
+        }
+        plan.shared.n_threads = plan.cores;
+        plan.shared.n_threads_batch = static_cast<int>(allowed.size());
+    }
+
+    const int threads = env_int("NRVNA_THREADS", 0);
+    const int threadsBatch = env_int("NRVNA_THREADS_BATCH", 0);
+    for (auto& w : plan.workers) {
+        if (threads > 0) w.n_threads = threads;
+        if (threadsBatch > 0) w.n_threads_batch = threadsBatch;
+    }
+    return plan;
+}
+
+std::vector<std::string> ThreadPlan::describe() const {
+    std::vector<std::string> lines;
+    std::string head = "Thread plan: " + std::to_string(workers.size()) + " worker(s) on " +
+                       std::to_string(cores) + " core(s)";
+    if (nodes > 1) head += ", " + std::to_string(nodes) + " NUMA nodes";
+    head += pinned ? ", pinned" : ", not pinned";
+    lines.push_back(head);
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        const auto& w = workers[i];
+        std::string line = "  Worker-" + std::to_string(i) + ": decode " + std::to_string(w.n_threads) +
+                           " threads, prefill " + std::to_string(w.n_threads_batch);
+        if (!w.cpus.empty()) {
+            line += ", CPUs " + formatCpuList(w.cpus);
+            if (w.node >= 0) line += " (node " + std::to_string(w.node) + ")";
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus) noexcept {
+    if (cpus.empty()) {
+        return false;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c : cpus) {
+        if (c >= 0 && c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    const int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        LOG_WARN("Failed to pin thread to CPUs " + formatCpuList(cpus));
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace nrvnaai
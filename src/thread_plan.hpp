@@ -0,0 +1,39 @@
+/*
+ * nrvna ai - CPU thread budgeting across workers (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/types.hpp"
+
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+// How the daemon's CPUs are divided. Physical cores (grouped by NUMA node)
+// are split into contiguous, disjoint runs, one per worker, so a worker's
+// threads never compete with another worker's and stay on one node when the
+// split allows it. Decode is memory bound and gets one thread per core;
+// prefill is compute bound and also uses the SMT siblings.
+struct ThreadPlan {
+    std::vector<WorkerThreads> workers;
+    WorkerThreads shared;           // every allowed CPU, for the batch scheduler
+    bool pinned = false;            // workers have disjoint CPU sets to pin to
+    int cores = 0;
+    int nodes = 0;
+
+    // One line per worker, for the startup log
+    [[nodiscard]] std::vector<std::string> describe() const;
+};
+
+// NRVNA_PIN=0 keeps the split counts without pinning; NRVNA_THREADS and
+// NRVNA_THREADS_BATCH override the per-worker counts.
+[[nodiscard]] ThreadPlan planThreads(int workers);
+
+// Restrict the calling thread to cpus; false when empty or unsupported
+bool pinCurrentThread(const std::vector<int>& cpus) noexcept;
+
+} // namespace nrvnaai
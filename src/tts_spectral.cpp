@@ -0,0 +1,518 @@
+/*
+ * nrvna ai - Vocoder spectral ops (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ *
+ * Reference path (irfft, fold, embd_to_audio) adapted from llama.cpp
+ * tools/tts/tts.cpp; the FFT path computes the same transform.
+ */
+
+#define _USE_MATH_DEFINES
+
+#include "tts_spectral.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace nrvnaai {
+
+namespace {
+
+// ============================================================================
+// Reference spectral ops (from tts.cpp)
+// ============================================================================
+
+void fill_hann_window(int length, bool periodic, float* output) {
+    int offset = periodic ? 0 : -1;
+    for (int i = 0; i < length; i++) {
+        output[i] = 0.5f * (1.0f - cosf((2.0f * static_cast<float>(M_PI) * i) / (length + offset)));
+    }
+}
+
+void twiddle(float* real, float* imag, int k, int N) {
+    float angle = 2.0f * static_cast<float>(M_PI) * k / N;
+    *real = cosf(angle);
+    *imag = sinf(angle);
+}
+
+void irfft(int n, const float* inp_cplx, float* out_real) {
+    int N = n / 2 + 1;
+    std::vector<float> real_input(N), imag_input(N);
+    for (int i = 0; i < N; ++i) {
+        real_input[i] = inp_cplx[2 * i];
+        imag_input[i] = inp_cplx[2 * i + 1];
+    }
+
+    std::vector<float> real_output(n), imag_output(n);
+    for (int k = 0; k < n; ++k) {
+        real_output[k] = 0.0f;
+        imag_output[k] = 0.0f;
+        for (int m = 0; m < N; ++m) {
+            float tw_r, tw_i;
+            twiddle(&tw_r, &tw_i, k * m, n);
+            real_output[k] += real_input[m] * tw_r - imag_input[m] * tw_i;
+            imag_output[k] += real_input[m] * tw_i + imag_input[m] * tw_r;
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        out_real[i] = real_output[i] / N;
+    }
+}
+
+void fold(const std::vector<float>& data, int64_t n_out, int64_t n_win,
+          int64_t n_hop, int64_t n_pad, std::vector<float>& output) {
+    int64_t output_height = n_out;
+    int64_t kernel_w = n_win;
+    int64_t stride_w = n_hop;
+    int64_t width = n_out;
+
+    output.resize(width, 0.0f);
+
+    int64_t col_idx = 0;
+    for (int64_t w_col = 0; w_col < width; ++w_col) {
+        int64_t start = w_col * stride_w - n_pad;
+        int64_t end = start + kernel_w;
+        for (int64_t w_im = start; w_im < end; ++w_im) {
+            if (w_im >= 0 && w_im < output_height && col_idx < static_cast<int64_t>(data.size())) {
+                output[w_im] += data[col_idx];
+            }
+            col_idx++;
+        }
+    }
+    output.resize(n_out - 2 * n_pad);
+}
+
+// WavTokenizer head geometry
+constexpr int kFftSize = 1280;
+constexpr int kHopSize = 320;
+
+// Smallest factors first, preferring radix 4
+std::vector<int> factorize(int n) {
+    std::vector<int> radices;
+    while (n % 4 == 0) { radices.push_back(4); n /= 4; }
+    for (int p : {2, 3, 5}) {
+        while (n % p == 0) { radices.push_back(p); n /= p; }
+    }
+    for (int p = 7; n > 1; p += 2) {
+        while (n % p == 0) { radices.push_back(p); n /= p; }
+    }
+    return radices;
+}
+
+} // namespace
+
+std::vector<float> embdToAudioReference(const float* embd, int n_codes, int n_embd, int n_thread) {
+    const int n_fft = kFftSize;
+    const int n_hop = kHopSize;
+    const int n_win = kFftSize;
+    const int n_pad = (n_win - n_hop) / 2;
+    const int n_out = (n_codes - 1) * n_hop + n_win;
+
+    std::vector<float> hann(n_fft);
+    fill_hann_window(hann.size(), true, hann.data());
+
+    int n_spec = n_embd * n_codes;
+    std::vector<float> E(n_spec), S(n_spec), ST(n_spec);
+
+    for (int l = 0; l < n_codes; ++l) {
+        for (int k = 0; k < n_embd; ++k) {
+            E[k * n_codes + l] = embd[l * n_embd + k];
+        }
+    }
+
+    for (int k = 0; k < n_embd / 2; ++k) {
+        for (int l = 0; l < n_codes; ++l) {
+            float mag = E[(k) * n_codes + l];
+            float phi = E[(k + n_embd / 2) * n_codes + l];
+            mag = exp(mag);
+            if (mag > 1e2f) mag = 1e2f;
+            S[2 * (k * n_codes + l) + 0] = mag * cosf(phi);
+            S[2 * (k * n_codes + l) + 1] = mag * sinf(phi);
+        }
+    }
+
+    for (int l = 0; l < n_codes; ++l) {
+        for (int k = 0; k < n_embd / 2; ++k) {
+            ST[l * n_embd + 2 * k + 0] = S[2 * (k * n_codes + l) + 0];
+            ST[l * n_embd + 2 * k + 1] = S[2 * (k * n_codes + l) + 1];
+        }
+    }
+
+    std::vector<float> res(n_codes * n_fft);
+    std::vector<float> hann2(n_codes * n_fft);
+
+    std::vector<std::thread> workers(n_thread);
+    for (int i = 0; i < n_thread; ++i) {
+        workers[i] = std::thread([&, i]() {
+            for (int l = i; l < n_codes; l += n_thread) {
+                irfft(n_fft, ST.data() + l * n_embd, res.data() + l * n_fft);
+                for (int j = 0; j < n_fft; ++j) {
+                    res[l * n_fft + j] *= hann[j];
+                    hann2[l * n_fft + j] = hann[j] * hann[j];
+                }
+            }
+        });
+    }
+    for (int i = 0; i < n_thread; ++i) {
+        workers[i].join();
+    }
+
+    std::vector<float> audio, env;
+    fold(res, n_out, n_win, n_hop, n_pad, audio);
+    fold(hann2, n_out, n_win, n_hop, n_pad, env);
+
+    for (size_t i = 0; i < audio.size(); ++i) {
+        audio[i] /= env[i];
+    }
+    return audio;
+}
+
+// ============================================================================
+// TaskPool
+// ============================================================================
+
+TaskPool::TaskPool(int threads) {
+    for (int i = 1; i < threads; ++i) {
+        workers_.emplace_back(&TaskPool::workerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void TaskPool::run(int n, const std::function<void(int task, int worker)>& fn) {
+    if (n <= 0) return;
+    std::lock_guard<std::mutex> call(callMutex_);
+    if (workers_.empty() || n == 1) {
+        for (int i = 0; i < n; ++i) fn(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fn_ = &fn;
+        total_ = n;
+        next_ = 0;
+        pending_ = n;
+        ++generation_;
+    }
+    wake_.notify_all();
+    drain(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+    fn_ = nullptr;
+}
+
+void TaskPool::workerLoop(int worker) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+        drain(worker);
+    }
+}
+
+void TaskPool::drain(int worker) {
+    while (true) {
+        const std::function<void(int, int)>* fn = nullptr;
+        int task = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!fn_ || next_ >= total_) return;
+            fn = fn_;
+            task = next_++;
+        }
+        (*fn)(task, worker);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) idle_.notify_all();
+    }
+}
+
+TaskPool& sharedTaskPool() {
+    static TaskPool pool(std::max(1, static_cast<int>(std::thread::hardware_concurrency())));
+    return pool;
+}
+
+// ============================================================================
+// RealIfft
+// ============================================================================
+
+RealIfft::RealIfft(int n) : n_(n), half_(n / 2) {
+    // Twiddles are computed in double: k*m angles get large at n=1280
+    int stride = 1;
+    int remaining = half_;
+    for (int p : factorize(half_)) {
+        Stage st;
+        st.radix = p;
+        st.m = remaining / p;
+        st.stride = stride;
+        st.twr.resize(static_cast<std::size_t>(st.m) * p);
+        st.twi.resize(st.twr.size());
+        for (int j = 0; j < st.m; ++j) {
+            for (int u = 0; u < p; ++u) {
+                const double angle = 2.0 * M_PI * j * u / remaining;
+                st.twr[j * p + u] = static_cast<float>(std::cos(angle));
+                st.twi[j * p + u] = static_cast<float>(std::sin(angle));
+            }
+        }
+        if (p != 2 && p != 4) {
+            st.rootr.resize(p);
+            st.rooti.resize(p);
+            for (int e = 0; e < p; ++e) {
+                st.rootr[e] = static_cast<float>(std::cos(2.0 * M_PI * e / p));
+                st.rooti[e] = static_cast<float>(std::sin(2.0 * M_PI * e / p));
+            }
+        }
+        stages_.push_back(std::move(st));
+        stride *= p;
+        remaining /= p;
+    }
+
+    postr_.resize(half_);
+    posti_.resize(half_);
+    for (int k = 0; k < half_; ++k) {
+        const double angle = 2.0 * M_PI * k / n_;
+        postr_[k] = static_cast<float>(std::cos(angle));
+        posti_[k] = static_cast<float>(std::sin(angle));
+    }
+}
+
+RealIfft::Scratch RealIfft::makeScratch() const {
+    Scratch s;
+    s.re0.resize(half_);
+    s.im0.resize(half_);
+    s.re1.resize(half_);
+    s.im1.resize(half_);
+    return s;
+}
+
+// Stockham autosort: stage i reads one buffer pair and writes the other, so
+// no bit-reversal pass is needed. The inner loop over the stride is
+// contiguous in both buffers and vectorizes.
+void RealIfft::fft(Scratch& sc, bool& inOne) const {
+    inOne = false;
+    std::vector<float> ar, ai;
+    for (const Stage& st : stages_) {
+        const float* xr = inOne ? sc.re1.data() : sc.re0.data();
+        const float* xi = inOne ? sc.im1.data() : sc.im0.data();
+        float* yr = inOne ? sc.re0.data() : sc.re1.data();
+        float* yi = inOne ? sc.im0.data() : sc.im1.data();
+        const int p = st.radix;
+        const int m = st.m;
+        const int s = st.stride;
+        const int ms = m * s;
+
+        for (int j = 0; j < m; ++j) {
+            const float* wr = st.twr.data() + j * p;
+            const float* wi = st.twi.data() + j * p;
+            const float* x0r = xr + s * j;
+            const float* x0i = xi + s * j;
+            float* y0r = yr + s * p * j;
+            float* y0i = yi + s * p * j;
+
+            if (p == 4) {
+                for (int q = 0; q < s; ++q) {
+                    const float a0r = x0r[q], a0i = x0i[q];
+                    const float a1r = x0r[q + ms], a1i = x0i[q + ms];
+                    const float a2r = x0r[q + 2 * ms], a2i = x0i[q + 2 * ms];
+                    const float a3r = x0r[q + 3 * ms], a3i = x0i[q + 3 * ms];
+                    const float t0r = a0r + a2r, t0i = a0i + a2i;
+                    const float t1r = a0r - a2r, t1i = a0i - a2i;
+                    const float t2r = a1r + a3r, t2i = a1i + a3i;
+                    const float t3r = a1r - a3r, t3i = a1i - a3i;
+                    // inverse transform: multiply by +i
+                    const float b0r = t0r + t2r, b0i = t0i + t2i;
+                    const float b1r = t1r - t3i, b1i = t1i + t3r;
+                    const float b2r = t0r - t2r, b2i = t0i - t2i;
+                    const float b3r = t1r + t3i, b3i = t1i - t3r;
+                    y0r[q] = b0r;
+                    y0i[q] = b0i;
+                    y0r[q + s] = b1r * wr[1] - b1i * wi[1];
+                    y0i[q + s] = b1r * wi[1] + b1i * wr[1];
+                    y0r[q + 2 * s] = b2r * wr[2] - b2i * wi[2];
+                    y0i[q + 2 * s] = b2r * wi[2] + b2i * wr[2];
+                    y0r[q + 3 * s] = b3r * wr[3] - b3i * wi[3];
+                    y0i[q + 3 * s] = b3r * wi[3] + b3i * wr[3];
+                }
+            } else if (p == 2) {
+                for (int q = 0; q < s; ++q) {
+                    const float a0r = x0r[q], a0i = x0i[q];
+                    const float a1r = x0r[q + ms], a1i = x0i[q + ms];
+                    const float dr = a0r - a1r, di = a0i - a1i;
+                    y0r[q] = a0r + a1r;
+                    y0i[q] = a0i + a1i;
+                    y0r[q + s] = dr * wr[1] - di * wi[1];
+                    y0i[q + s] = dr * wi[1] + di * wr[1];
+                }
+            } else {
+                // Generic radix (3, 5, odd primes): direct p-point DFT per butterfly
+                ar.resize(p);
+                ai.resize(p);
+                for (int q = 0; q < s; ++q) {
+                    for (int r = 0; r < p; ++r) {
+                        ar[r] = x0r[q + r * ms];
+                        ai[r] = x0i[q + r * ms];
+                    }
+                    for (int u = 0; u < p; ++u) {
+                        float sr = 0.0f, si = 0.0f;
+                        for (int r = 0; r < p; ++r) {
+                            const int e = (r * u) % p;
+                            const float cr = st.rootr[e];
+                            const float ci = st.rooti[e];
+                            sr += ar[r] * cr - ai[r] * ci;
+                            si += ar[r] * ci + ai[r] * cr;
+                        }
+                        y0r[q + u * s] = sr * wr[u] - si * wi[u];
+                        y0i[q + u * s] = sr * wi[u] + si * wr[u];
+                    }
+                }
+            }
+        }
+        inOne = !inOne;
+    }
+}
+
+void RealIfft::run(const float* cplx, float* out, Scratch& sc) const {
+    // Pack the half spectrum into one n/2-point complex sequence whose
+    // inverse transform holds the even samples in re and the odd ones in im.
+    const int M = half_;
+    const float x0 = cplx[0];
+    const float xM = cplx[2 * M];
+    sc.re0[0] = x0 + xM;
+    sc.im0[0] = x0 - xM;
+    for (int k = 1; k < M; ++k) {
+        const float ar = cplx[2 * k], ai = cplx[2 * k + 1];
+        const float br = cplx[2 * (M - k)], bi = -cplx[2 * (M - k) + 1];
+        const float er = ar + br, ei = ai + bi;
+        const float dr = ar - br, di = ai - bi;
+        const float odr = dr * postr_[k] - di * posti_[k];
+        const float odi = dr * posti_[k] + di * postr_[k];
+        sc.re0[k] = er - odi;
+        sc.im0[k] = ei + odr;
+    }
+
+    bool inOne = false;
+    fft(sc, inOne);
+    const float* cr = inOne ? sc.re1.data() : sc.re0.data();
+    const float* ci = inOne ? sc.im1.data() : sc.im0.data();
+
+    // The reference sums each bin once instead of with its conjugate mirror:
+    // out = (hermitian + Re X0 + Re X_M (-1)^t) / 2, scaled by 1/(n/2+1)
+    const float scale = 0.5f / static_cast<float>(M + 1);
+    for (int j = 0; j < M; ++j) {
+        out[2 * j] = (cr[j] + x0 + xM) * scale;
+        out[2 * j + 1] = (ci[j] + x0 - xM) * scale;
+    }
+}
+
+// ============================================================================
+// Istft
+// ============================================================================
+
+Istft::Istft(int n_fft, int n_hop)
+    : n_fft_(n_fft), n_hop_(n_hop), n_pad_((n_fft - n_hop) / 2), ifft_(n_fft), window_(n_fft) {
+    fill_hann_window(n_fft, true, window_.data());
+}
+
+std::vector<float> Istft::synthesize(const float* embd, int n_codes, int n_embd) {
+    if (n_codes <= 0) return {};
+    if (n_embd != n_fft_ + 2 || n_fft_ != kFftSize || n_hop_ != kHopSize) {
+        return embdToAudioReference(embd, n_codes, n_embd, sharedTaskPool().size());
+    }
+
+    std::vector<float> audio;
+    audio.reserve(static_cast<std::size_t>(n_codes) * n_hop_);
+    reset();
+    (void)push(embd, n_codes, n_embd, audio);
+    finish(audio);
+    return audio;
+}
+
+void Istft::reset() noexcept {
+    acc_.clear();
+    env_.clear();
+    emitted_ = 0;
+    framesDone_ = 0;
+}
+
+bool Istft::push(const float* embd, int n_frames, int n_embd, std::vector<float>& out) {
+    if (n_embd != n_fft_ + 2) return false;
+    if (n_frames <= 0) return true;
+
+    TaskPool& pool = sharedTaskPool();
+    const int n_bins = n_embd / 2;
+    const int workers = pool.size();
+    while (static_cast<int>(scratch_.size()) < workers) {
+        scratch_.push_back(ifft_.makeScratch());
+    }
+    spectrum_.resize(static_cast<std::size_t>(workers) * n_embd);
+    frames_.resize(static_cast<std::size_t>(n_frames) * n_fft_);
+
+    pool.run(n_frames, [&](int l, int worker) {
+        const float* row = embd + static_cast<std::size_t>(l) * n_embd;
+        float* spec = spectrum_.data() + static_cast<std::size_t>(worker) * n_embd;
+        for (int k = 0; k < n_bins; ++k) {
+            const float mag = std::min(std::exp(row[k]), 1e2f);
+            const float phi = row[k + n_bins];
+            spec[2 * k] = mag * std::cos(phi);
+            spec[2 * k + 1] = mag * std::sin(phi);
+        }
+        float* frame = frames_.data() + static_cast<std::size_t>(l) * n_fft_;
+        ifft_.run(spec, frame, scratch_[worker]);
+        for (int j = 0; j < n_fft_; ++j) frame[j] *= window_[j];
+    });
+
+    // Overlap-add; frame l starts at l*hop - pad, the first pad samples are trimmed like fold()
+    for (int f = 0; f < n_frames; ++f) {
+        const float* frame = frames_.data() + static_cast<std::size_t>(f) * n_fft_;
+        const long long base = (framesDone_ + f) * n_hop_ - n_pad_;
+        const int j0 = static_cast<int>(std::max(0LL, emitted_ - base));
+        const std::size_t need = static_cast<std::size_t>(base + n_fft_ - emitted_);
+        if (acc_.size() < need) {
+            acc_.resize(need, 0.0f);
+            env_.resize(need, 0.0f);
+        }
+        for (int j = j0; j < n_fft_; ++j) {
+            const std::size_t i = static_cast<std::size_t>(base + j - emitted_);
+            acc_[i] += frame[j];
+            env_[i] += window_[j] * window_[j];
+        }
+    }
+    framesDone_ += n_frames;
+
+    // Everything before the next frame's first sample is final
+    emit(framesDone_ * n_hop_ - n_pad_, out);
+    return true;
+}
+
+void Istft::finish(std::vector<float>& out) {
+    if (framesDone_ > 0) {
+        emit((framesDone_ - 1) * n_hop_ + n_fft_ - 2 * n_pad_, out);
+    }
+    reset();
+}
+
+void Istft::emit(long long upto, std::vector<float>& out) {
+    const long long n = std::min<long long>(upto - emitted_, static_cast<long long>(acc_.size()));
+    if (n <= 0) return;
+    for (long long i = 0; i < n; ++i) {
+        out.push_back(acc_[i] / env_[i]);
+    }
+    acc_.erase(acc_.begin(), acc_.begin() + n);
+    env_.erase(env_.begin(), env_.begin() + n);
+    emitted_ += n;
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,130 @@
+/*
+ * nrvna ai - Vocoder spectral ops (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ *
+ * Reference path (irfft, fold, embd_to_audio) adapted from llama.cpp
+ * tools/tts/tts.cpp; the FFT path computes the same transform.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nrvnaai {
+
+// Persistent workers for data-parallel loops. run() hands out task indices
+// [0, n) to the workers and the calling thread, and returns when all are done.
+// Concurrent callers are serialized: each call already uses every worker.
+class TaskPool {
+public:
+    explicit TaskPool(int threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    [[nodiscard]] int size() const noexcept { return static_cast<int>(workers_.size()) + 1; }
+    void run(int n, const std::function<void(int task, int worker)>& fn);
+
+private:
+    void workerLoop(int worker);
+    void drain(int worker);
+
+    std::vector<std::thread> workers_;
+    std::mutex callMutex_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    const std::function<void(int, int)>* fn_ = nullptr;
+    int total_ = 0;
+    int next_ = 0;
+    int pending_ = 0;
+    unsigned long generation_ = 0;
+    bool stop_ = false;
+};
+
+// Process-wide pool sized to the hardware, created on first use
+TaskPool& sharedTaskPool();
+
+// Inverse real FFT of n/2+1 interleaved complex bins with the reference
+// irfft semantics: out[k] = Re(sum_{m<=n/2} X[m] e^{+2pi i km/n}) / (n/2+1).
+// Runs as one n/2-point mixed-radix (4/2/3/5/generic) Stockham complex FFT
+// on split re/im arrays with precomputed twiddles. n must be even.
+class RealIfft {
+public:
+    explicit RealIfft(int n);
+
+    [[nodiscard]] int size() const noexcept { return n_; }
+
+    // Per-thread work buffers, sized once and reused across frames
+    struct Scratch {
+        std::vector<float> re0, im0, re1, im1;
+    };
+    [[nodiscard]] Scratch makeScratch() const;
+
+    void run(const float* cplx, float* out, Scratch& scratch) const;
+
+private:
+    struct Stage {
+        int radix;
+        int m;                      // butterflies per stride group
+        int stride;
+        std::vector<float> twr;     // m * radix twiddles, [j * radix + u]
+        std::vector<float> twi;
+        std::vector<float> rootr;   // e^{+2pi i e/radix}, generic radices only
+        std::vector<float> rooti;
+    };
+
+    int n_ = 0;
+    int half_ = 0;
+    std::vector<Stage> stages_;
+    std::vector<float> postr_, posti_;   // e^{+2pi i k/n}, k < n/2
+
+    void fft(Scratch& s, bool& inOne) const;
+};
+
+// ISTFT for the WavTokenizer head: magnitude/phase rows -> windowed frames
+// -> overlap-add normalized by the summed squared window. Tables and scratch
+// live as long as the object; frames are spread over sharedTaskPool().
+class Istft {
+public:
+    Istft(int n_fft, int n_hop);
+
+    [[nodiscard]] std::vector<float> synthesize(const float* embd, int n_codes, int n_embd);
+
+    // Streaming: reset(), then push() frames in order; each push appends the
+    // samples no later frame can touch. finish() appends the tail. The
+    // concatenated output equals synthesize() over all frames. push() fails
+    // when n_embd does not match n_fft (n_fft/2+1 magnitudes + phases).
+    void reset() noexcept;
+    [[nodiscard]] bool push(const float* embd, int n_frames, int n_embd, std::vector<float>& out);
+    void finish(std::vector<float>& out);
+
+private:
+    int n_fft_;
+    int n_hop_;
+    int n_pad_;
+    RealIfft ifft_;
+    std::vector<float> window_;
+    std::vector<RealIfft::Scratch> scratch_;
+    std::vector<float> frames_;
+    std::vector<float> spectrum_;
+
+    // Overlap-add state for samples [emitted_, emitted_ + acc_.size())
+    std::vector<float> acc_;
+    std::vector<float> env_;
+    long long emitted_ = 0;
+    long long framesDone_ = 0;
+
+    void emit(long long upto, std::vector<float>& out);
+};
+
+// The original O(n^2) path, kept as the correctness baseline for nrvna_bench
+std::vector<float> embdToAudioReference(const float* embd, int n_codes, int n_embd, int n_thread);
+
+} // namespace nrvnaai
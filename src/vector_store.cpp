@@ -0,0 +1,648 @@
+/*
+ * nrvna ai - Contiguous store of finished embeddings (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "vector_store.hpp"
+#include "nrvna/logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NRVNA_VEC_AVX2 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define NRVNA_VEC_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace nrvnaai {
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'R', 'V', 'N', 'A', 'V', 'E', 'C'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kHeaderBytes = 64;
+constexpr std::size_t kMaxDim = 1u << 16;
+// Rows per search thread; below this a thread costs more than it saves
+constexpr std::size_t kRowsPerThread = 16384;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t dim;
+    std::uint32_t type;
+    std::uint32_t rowBytes;
+    char pad[40];
+};
+static_assert(sizeof(Header) == kHeaderBytes, "vector store header is 64 bytes");
+
+struct IdSlot {
+    char id[60];                    // NUL terminated
+    std::uint32_t row;
+};
+static_assert(sizeof(IdSlot) == 64, "vector store id slot is 64 bytes");
+
+std::size_t align4(std::size_t n) {
+    return (n + 3) & ~static_cast<std::size_t>(3);
+}
+
+std::size_t rowBytesFor(VectorType type, std::size_t dim) {
+    switch (type) {
+        case VectorType::F16: return align4(dim * 2);
+        case VectorType::I8: return sizeof(float) + align4(dim);
+        case VectorType::F32: break;
+    }
+    return dim * sizeof(float);
+}
+
+// IEEE binary16, round to nearest even
+std::uint16_t toHalf(float f) {
+    std::uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    const auto sign = static_cast<std::uint16_t>((x >> 16) & 0x8000u);
+    x &= 0x7fffffffu;
+    if (x >= 0x7f800000u) {
+        return sign | (x > 0x7f800000u ? 0x7e00u : 0x7c00u);
+    }
+    if (x >= 0x477ff000u) {
+        return sign | 0x7c00u;      // rounds past 65504
+    }
+    if (x < 0x38800000u) {
+        // Subnormal: let the FPU round against 0.5f, whose ulp is 2^-24
+        float a;
+        std::memcpy(&a, &x, sizeof(a));
+        a += 0.5f;
+        std::uint32_t b;
+        std::memcpy(&b, &a, sizeof(b));
+        return sign | static_cast<std::uint16_t>(b - 0x3f000000u);
+    }
+    const std::uint32_t odd = (x >> 13) & 1u;
+    x += 0xc8000fffu + odd;         // rebias exponent 127 -> 15, round mantissa
+    return sign | static_cast<std::uint16_t>(x >> 13);
+}
+
+float fromHalf(std::uint16_t h) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(h & 0x8000u) << 16;
+    const std::uint32_t exp = (h >> 10) & 0x1fu;
+    const std::uint32_t mant = h & 0x3ffu;
+    std::uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000u | (mant << 13);
+    } else if (exp == 0) {
+        const float v = std::ldexp(static_cast<float>(mant), -24);
+        std::memcpy(&bits, &v, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+void encodeRow(VectorType type, const float* v, std::size_t dim, unsigned char* out) {
+    switch (type) {
+        case VectorType::F32:
+            std::memcpy(out, v, dim * sizeof(float));
+            return;
+        case VectorType::F16:
+            for (std::size_t i = 0; i < dim; ++i) {
+                const std::uint16_t h = toHalf(v[i]);
+                std::memcpy(out + i * 2, &h, sizeof(h));
+            }
+            return;
+        case VectorType::I8: {
+            float peak = 0.0f;
+            for (std::size_t i = 0; i < dim; ++i) peak = std::max(peak, std::fabs(v[i]));
+            const float scale = peak / 127.0f;
+            std::memcpy(out, &scale, sizeof(scale));
+            auto* q = reinterpret_cast<std::int8_t*>(out + sizeof(float));
+            for (std::size_t i = 0; i < dim; ++i) {
+                const float r = scale > 0.0f ? std::nearbyint(v[i] / scale) : 0.0f;
+                q[i] = static_cast<std::int8_t>(std::clamp(r, -127.0f, 127.0f));
+            }
+            return;
+        }
+    }
+}
+
+// Dot product of a float query with one stored row
+using DotFn = float (*)(const float* q, const unsigned char* row, std::size_t dim);
+
+float dotF32Scalar(const float* q, const unsigned char* row, std::size_t dim) {
+    const auto* r = reinterpret_cast<const float*>(row);
+    float a0 = 0.0f, a1 = 0.0f, a2 = 0.0f, a3 = 0.0f;
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4) {
+        a0 += q[i] * r[i];
+        a1 += q[i + 1] * r[i + 1];
+        a2 += q[i + 2] * r[i + 2];
+        a3 += q[i + 3] * r[i + 3];
+    }
+    for (; i < dim; ++i) a0 += q[i] * r[i];
+    return (a0 + a1) + (a2 + a3);
+}
+
+float dotF16Scalar(const float* q, const unsigned char* row, std::size_t dim) {
+    float acc = 0.0f;
+    for (std::size_t i = 0; i < dim; ++i) {
+        std::uint16_t h;
+        std::memcpy(&h, row + i * 2, sizeof(h));
+        acc += q[i] * fromHalf(h);
+    }
+    return acc;
+}
+
+float dotI8Scalar(const float* q, const unsigned char* row, std::size_t dim) {
+    float scale;
+    std::memcpy(&scale, row, sizeof(scale));
+    const auto* r = reinterpret_cast<const std::int8_t*>(row + sizeof(float));
+    float acc = 0.0f;
+    for (std::size_t i = 0; i < dim; ++i) acc += q[i] * static_cast<float>(r[i]);
+    return acc * scale;
+}
+
+#if defined(NRVNA_VEC_AVX2)
+
+__attribute__((target("avx2,fma"))) float hsum256(__m256 v) {
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_movehdup_ps(s));
+    return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma"))) float dotF32Avx2(const float* q, const unsigned char* row, std::size_t dim) {
+    const auto* r = reinterpret_cast<const float*>(row);
+    __m256 a0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), _mm256_loadu_ps(r + i), a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i + 8), _mm256_loadu_ps(r + i + 8), a1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), _mm256_loadu_ps(r + i), a0);
+    }
+    float acc = hsum256(_mm256_add_ps(a0, a1));
+    for (; i < dim; ++i) acc += q[i] * r[i];
+    return acc;
+}
+
+__attribute__((target("avx2,fma,f16c"))) float dotF16Avx2(const float* q, const unsigned char* row, std::size_t dim) {
+    __m256 a0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        const __m256 r0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 2)));
+        const __m256 r1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 2 + 16)));
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), r0, a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i + 8), r1, a1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        const __m256 r0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 2)));
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), r0, a0);
+    }
+    float acc = hsum256(_mm256_add_ps(a0, a1));
+    for (; i < dim; ++i) {
+        std::uint16_t h;
+        std::memcpy(&h, row + i * 2, sizeof(h));
+        acc += q[i] * fromHalf(h);
+    }
+    return acc;
+}
+
+__attribute__((target("avx2,fma"))) float dotI8Avx2(const float* q, const unsigned char* row, std::size_t dim) {
+    float scale;
+    std::memcpy(&scale, row, sizeof(scale));
+    const unsigned char* r = row + sizeof(float);
+    __m256 a0 = _mm256_setzero_ps();
+    __m256 a1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + i));
+        const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(b));
+        const __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(b, 8)));
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), lo, a0);
+        a1 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i + 8), hi, a1);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        const __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(r + i));
+        a0 = _mm256_fmadd_ps(_mm256_loadu_ps(q + i), _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(b)), a0);
+    }
+    float acc = hsum256(_mm256_add_ps(a0, a1));
+    for (; i < dim; ++i) acc += q[i] * static_cast<float>(static_cast<std::int8_t>(r[i]));
+    return acc * scale;
+}
+
+#elif defined(NRVNA_VEC_NEON)
+
+float dotF32Neon(const float* q, const unsigned char* row, std::size_t dim) {
+    const auto* r = reinterpret_cast<const float*>(row);
+    float32x4_t a0 = vdupq_n_f32(0.0f);
+    float32x4_t a1 = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        a0 = vfmaq_f32(a0, vld1q_f32(q + i), vld1q_f32(r + i));
+        a1 = vfmaq_f32(a1, vld1q_f32(q + i + 4), vld1q_f32(r + i + 4));
+    }
+    float acc = vaddvq_f32(vaddq_f32(a0, a1));
+    for (; i < dim; ++i) acc += q[i] * r[i];
+    return acc;
+}
+
+float dotF16Neon(const float* q, const unsigned char* row, std::size_t dim) {
+    float32x4_t a0 = vdupq_n_f32(0.0f);
+    float32x4_t a1 = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        const float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(reinterpret_cast<const std::uint16_t*>(row + i * 2)));
+        a0 = vfmaq_f32(a0, vld1q_f32(q + i), vcvt_f32_f16(vget_low_f16(h)));
+        a1 = vfmaq_f32(a1, vld1q_f32(q + i + 4), vcvt_high_f32_f16(h));
+    }
+    float acc = vaddvq_f32(vaddq_f32(a0, a1));
+    for (; i < dim; ++i) {
+        std::uint16_t h;
+        std::memcpy(&h, row + i * 2, sizeof(h));
+        acc += q[i] * fromHalf(h);
+    }
+    return acc;
+}
+
+float dotI8Neon(const float* q, const unsigned char* row, std::size_t dim) {
+    float scale;
+    std::memcpy(&scale, row, sizeof(scale));
+    const auto* r = reinterpret_cast<const std::int8_t*>(row + sizeof(float));
+    float32x4_t a0 = vdupq_n_f32(0.0f);
+    float32x4_t a1 = vdupq_n_f32(0.0f);
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+        const int16x8_t w = vmovl_s8(vld1_s8(r + i));
+        a0 = vfmaq_f32(a0, vld1q_f32(q + i), vcvtq_f32_s32(vmovl_s16(vget_low_s16(w))));
+        a1 = vfmaq_f32(a1, vld1q_f32(q + i + 4), vcvtq_f32_s32(vmovl_high_s16(w)));
+    }
+    float acc = vaddvq_f32(vaddq_f32(a0, a1));
+    for (; i < dim; ++i) acc += q[i] * static_cast<float>(r[i]);
+    return acc * scale;
+}
+
+#endif
+
+DotFn pickKernel(VectorType type) {
+#if defined(NRVNA_VEC_AVX2)
+    static const bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    static const bool f16c = avx2 && __builtin_cpu_supports("f16c");
+    switch (type) {
+        case VectorType::F32: return avx2 ? dotF32Avx2 : dotF32Scalar;
+        case VectorType::F16: return f16c ? dotF16Avx2 : dotF16Scalar;
+        case VectorType::I8: return avx2 ? dotI8Avx2 : dotI8Scalar;
+    }
+#elif defined(NRVNA_VEC_NEON)
+    switch (type) {
+        case VectorType::F32: return dotF32Neon;
+        case VectorType::F16: return dotF16Neon;
+        case VectorType::I8: return dotI8Neon;
+    }
+#else
+    switch (type) {
+        case VectorType::F32: return dotF32Scalar;
+        case VectorType::F16: return dotF16Scalar;
+        case VectorType::I8: return dotI8Scalar;
+    }
+#endif
+    return dotF32Scalar;
+}
+
+bool pwriteAll(int fd, const unsigned char* data, std::size_t n, std::uint64_t offset) {
+    while (n > 0) {
+        const ssize_t w = ::pwrite(fd, data, n, static_cast<off_t>(offset));
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += w;
+        n -= static_cast<std::size_t>(w);
+        offset += static_cast<std::uint64_t>(w);
+    }
+    return true;
+}
+
+bool readHeader(int fd, Header& header) {
+    return ::pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+           std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersion &&
+           header.dim > 0 && header.dim <= kMaxDim && header.type <= static_cast<std::uint32_t>(VectorType::I8) &&
+           header.rowBytes == rowBytesFor(static_cast<VectorType>(header.type), header.dim);
+}
+
+// "<model>-<dim>" -> dim, 0 when the stem is not one
+std::size_t stemDim(const std::string& stem) {
+    const std::size_t dash = stem.rfind('-');
+    if (dash == std::string::npos || dash == 0 || dash + 1 == stem.size()) return 0;
+    std::size_t dim = 0;
+    for (std::size_t i = dash + 1; i < stem.size(); ++i) {
+        if (stem[i] < '0' || stem[i] > '9' || dim > kMaxDim) return 0;
+        dim = dim * 10 + static_cast<std::size_t>(stem[i] - '0');
+    }
+    return dim <= kMaxDim ? dim : 0;
+}
+
+struct FdGuard {
+    int fd = -1;
+    explicit FdGuard(int f) : fd(f) {}
+    ~FdGuard() { if (fd >= 0) ::close(fd); }
+    FdGuard(const FdGuard&) = delete;
+    FdGuard& operator=(const FdGuard&) = delete;
+};
+
+using Candidate = std::pair<float, std::size_t>;    // score, row index
+
+} // namespace
+
+const char* vectorTypeName(VectorType type) noexcept {
+    switch (type) {
+        case VectorType::F16: return "f16";
+        case VectorType::I8: return "i8";
+        case VectorType::F32: break;
+    }
+    return "f32";
+}
+
+std::optional<VectorType> parseVectorType(const std::string& name) noexcept {
+    if (name == "f32" || name == "1") return VectorType::F32;
+    if (name == "f16") return VectorType::F16;
+    if (name == "i8") return VectorType::I8;
+    return std::nullopt;
+}
+
+// ---- writer ----
+
+VectorStore::VectorStore(const std::filesystem::path& workspace, VectorType type)
+    : dir_(directory(workspace)), type_(type) {
+}
+
+std::filesystem::path VectorStore::directory(const std::filesystem::path& workspace) {
+    return workspace / ".nrvna" / "vectors";
+}
+
+std::string VectorStore::label(const std::string& model) {
+    std::string stem = std::filesystem::path(model).filename().string();
+    if (stem.size() > 5 && stem.compare(stem.size() - 5, 5, ".gguf") == 0) {
+        stem.resize(stem.size() - 5);
+    }
+    for (char& c : stem) {
+        const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                          c == '.' || c == '_' || c == '-';
+        if (!keep) c = '_';
+    }
+    return stem.empty() || stem.front() == '.' ? "default" : stem;
+}
+
+bool VectorStore::append(const std::string& model, const JobId& id,
+                         const std::vector<const std::vector<float>*>& rows) noexcept {
+    try {
+        if (rows.empty() || !rows.front() || rows.front()->empty()) return false;
+        const std::size_t dim = rows.front()->size();
+        if (dim > kMaxDim) return false;
+        for (const auto* row : rows) {
+            if (!row || row->size() != dim) {
+                LOG_WARN("Vector store: rows of different dimensions in " + id);
+                return false;
+            }
+        }
+        IdSlot slot{};
+        if (id.empty() || id.size() >= sizeof(slot.id)) {
+            LOG_WARN("Vector store: job id too long to index: " + id);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::filesystem::create_directories(dir_);
+        const std::string stem = label(model) + "-" + std::to_string(dim);
+        FdGuard vec(::open((dir_ / (stem + ".vec")).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+        FdGuard ids(::open((dir_ / (stem + ".ids")).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+        if (vec.fd < 0 || ids.fd < 0) {
+            LOG_WARN("Vector store: cannot open " + (dir_ / stem).string());
+            return false;
+        }
+        // Held until the fds close; the ids file follows the vec file's lock
+        if (::flock(vec.fd, LOCK_EX) != 0) {
+            return false;
+        }
+
+        struct stat vst{};
+        struct stat ist{};
+        if (fstat(vec.fd, &vst) != 0 || fstat(ids.fd, &ist) != 0) {
+            return false;
+        }
+
+        Header header{};
+        if (static_cast<std::size_t>(vst.st_size) < kHeaderBytes) {
+            // New store, or one whose header never made it out
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = kVersion;
+            header.dim = static_cast<std::uint32_t>(dim);
+            header.type = static_cast<std::uint32_t>(type_);
+            header.rowBytes = static_cast<std::uint32_t>(rowBytesFor(type_, dim));
+            if (::ftruncate(vec.fd, 0) != 0 || ::ftruncate(ids.fd, 0) != 0 ||
+                !pwriteAll(vec.fd, reinterpret_cast<const unsigned char*>(&header), sizeof(header), 0)) {
+                LOG_WARN("Vector store: cannot write header of " + stem);
+                return false;
+            }
+            vst.st_size = static_cast<off_t>(kHeaderBytes);
+            ist.st_size = 0;
+            LOG_INFO("Vector store created: " + stem + " (" + vectorTypeName(type_) + ")");
+        } else if (!readHeader(vec.fd, header) || header.dim != dim) {
+            LOG_WARN("Vector store: not a store for dim " + std::to_string(dim) + ": " + stem);
+            return false;
+        }
+
+        const auto type = static_cast<VectorType>(header.type);
+        const std::size_t rowBytes = header.rowBytes;
+        const std::uint64_t count = std::min((static_cast<std::uint64_t>(vst.st_size) - kHeaderBytes) / rowBytes,
+                                             static_cast<std::uint64_t>(ist.st_size) / sizeof(IdSlot));
+        const std::uint64_t vecEnd = kHeaderBytes + count * rowBytes;
+        const std::uint64_t idsEnd = count * sizeof(IdSlot);
+        // Drop what a crashed append left past the last complete row
+        if ((static_cast<std::uint64_t>(vst.st_size) != vecEnd && ::ftruncate(vec.fd, static_cast<off_t>(vecEnd)) != 0) ||
+            (static_cast<std::uint64_t>(ist.st_size) != idsEnd && ::ftruncate(ids.fd, static_cast<off_t>(idsEnd)) != 0)) {
+            return false;
+        }
+
+        std::vector<unsigned char> vecBuf(rows.size() * rowBytes, 0);
+        std::vector<unsigned char> idsBuf(rows.size() * sizeof(IdSlot), 0);
+        std::memcpy(slot.id, id.data(), id.size());
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            encodeRow(type, rows[i]->data(), dim, vecBuf.data() + i * rowBytes);
+            slot.row = static_cast<std::uint32_t>(i);
+            std::memcpy(idsBuf.data() + i * sizeof(IdSlot), &slot, sizeof(slot));
+        }
+        if (!pwriteAll(vec.fd, vecBuf.data(), vecBuf.size(), vecEnd) ||
+            !pwriteAll(ids.fd, idsBuf.data(), idsBuf.size(), idsEnd)) {
+            LOG_WARN("Vector store: short write appending " + id);
+            return false;
+        }
+        LOG_DEBUG("Vector store: " + id + " -> " + stem + " row " + std::to_string(count));
+        return true;
+    } catch (const std::exception& e) {
+        LOG_WARN("Vector store append failed for " + id + ": " + e.what());
+        return false;
+    } catch (...) {
+        return false;
+    }
+}
+
+// ---- reader ----
+
+VectorIndex::~VectorIndex() {
+    if (vecMap_) munmap(vecMap_, vecBytes_);
+    if (idsMap_) munmap(idsMap_, idsBytes_);
+}
+
+std::vector<std::filesystem::path> VectorIndex::list(const std::filesystem::path& workspace) noexcept {
+    std::vector<std::filesystem::path> paths;
+    try {
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(VectorStore::directory(workspace), ec)) {
+            if (entry.path().extension() == ".vec" && stemDim(entry.path().stem().string()) > 0) {
+                paths.push_back(entry.path());
+            }
+        }
+        std::sort(paths.begin(), paths.end());
+    } catch (...) {
+    }
+    return paths;
+}
+
+std::unique_ptr<VectorIndex> VectorIndex::open(const std::filesystem::path& vecPath) noexcept {
+    try {
+        const std::string stem = vecPath.stem().string();
+        const std::size_t dim = stemDim(stem);
+        if (dim == 0) return nullptr;
+
+        std::unique_ptr<VectorIndex> index(new VectorIndex());
+        index->vecPath_ = vecPath;
+        index->idsPath_ = std::filesystem::path(vecPath).replace_extension(".ids");
+        index->model_ = stem.substr(0, stem.rfind('-'));
+
+        FdGuard vec(::open(index->vecPath_.c_str(), O_RDONLY | O_CLOEXEC));
+        FdGuard ids(::open(index->idsPath_.c_str(), O_RDONLY | O_CLOEXEC));
+        if (vec.fd < 0 || ids.fd < 0) return nullptr;
+        struct stat vst{};
+        struct stat ist{};
+        Header header{};
+        if (fstat(vec.fd, &vst) != 0 || fstat(ids.fd, &ist) != 0 ||
+            static_cast<std::size_t>(vst.st_size) < kHeaderBytes || !readHeader(vec.fd, header) || header.dim != dim) {
+            return nullptr;
+        }
+
+        index->dim_ = dim;
+        index->type_ = static_cast<VectorType>(header.type);
+        index->rowBytes_ = header.rowBytes;
+        index->vecSize_ = static_cast<std::uint64_t>(vst.st_size);
+        index->idsSize_ = static_cast<std::uint64_t>(ist.st_size);
+        index->count_ = static_cast<std::size_t>(std::min((index->vecSize_ - kHeaderBytes) / index->rowBytes_,
+                                                          index->idsSize_ / sizeof(IdSlot)));
+        if (index->count_ == 0) return nullptr;
+
+        // Map only complete rows: a writer may truncate a torn tail under us
+        index->vecBytes_ = kHeaderBytes + index->count_ * index->rowBytes_;
+        index->idsBytes_ = index->count_ * sizeof(IdSlot);
+        void* v = mmap(nullptr, index->vecBytes_, PROT_READ, MAP_SHARED, vec.fd, 0);
+        if (v == MAP_FAILED) return nullptr;
+        index->vecMap_ = v;
+        void* d = mmap(nullptr, index->idsBytes_, PROT_READ, MAP_SHARED, ids.fd, 0);
+        if (d == MAP_FAILED) return nullptr;
+        index->idsMap_ = d;
+        (void)madvise(index->vecMap_, index->vecBytes_, MADV_WILLNEED);
+        return index;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+bool VectorIndex::stale() const noexcept {
+    struct stat vst{};
+    struct stat ist{};
+    if (::stat(vecPath_.c_str(), &vst) != 0 || ::stat(idsPath_.c_str(), &ist) != 0) return true;
+    return static_cast<std::uint64_t>(vst.st_size) != vecSize_ || static_cast<std::uint64_t>(ist.st_size) != idsSize_;
+}
+
+std::vector<SearchHit> VectorIndex::search(const float* query, std::size_t k, const JobId& exclude) const {
+    std::vector<SearchHit> hits;
+    if (!query || k == 0 || count_ == 0) return hits;
+
+    double norm = 0.0;
+    for (std::size_t i = 0; i < dim_; ++i) norm += static_cast<double>(query[i]) * query[i];
+    if (norm <= 0.0) return hits;
+    std::vector<float> q(query, query + dim_);
+    const float inv = static_cast<float>(1.0 / std::sqrt(norm));
+    for (float& v : q) v *= inv;
+
+    const DotFn dot = pickKernel(type_);
+    const auto* rows = static_cast<const unsigned char*>(vecMap_) + kHeaderBytes;
+    const auto* slots = static_cast<const IdSlot*>(idsMap_);
+    const std::size_t keep = std::min(k, count_);
+    auto excluded = [&](std::size_t r) {
+        return !exclude.empty() && std::strncmp(slots[r].id, exclude.c_str(), sizeof(slots[r].id)) == 0;
+    };
+
+    // Each thread keeps a min-heap of its best `keep` rows
+    auto scan = [&](std::size_t begin, std::size_t end, std::vector<Candidate>& heap) {
+        heap.reserve(keep + 1);
+        for (std::size_t r = begin; r < end; ++r) {
+            const float score = dot(q.data(), rows + r * rowBytes_, dim_);
+            if (heap.size() == keep && score <= heap.front().first) continue;
+            if (excluded(r)) continue;
+            heap.emplace_back(score, r);
+            std::push_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+            if (heap.size() > keep) {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<Candidate>());
+                heap.pop_back();
+            }
+        }
+    };
+
+    const std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t nthreads = std::clamp<std::size_t>(count_ / kRowsPerThread, 1, hw);
+    std::vector<std::vector<Candidate>> heaps(nthreads);
+    if (nthreads == 1) {
+        scan(0, count_, heaps[0]);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(nthreads - 1);
+        const std::size_t per = (count_ + nthreads - 1) / nthreads;
+        for (std::size_t t = 1; t < nthreads; ++t) {
+            const std::size_t begin = std::min(count_, t * per);
+            const std::size_t end = std::min(count_, begin + per);
+            threads.emplace_back(scan, begin, end, std::ref(heaps[t]));
+        }
+        scan(0, std::min(count_, per), heaps[0]);
+        for (auto& thread : threads) thread.join();
+    }
+
+    std::vector<Candidate> all;
+    for (auto& heap : heaps) all.insert(all.end(), heap.begin(), heap.end());
+    const std::size_t n = std::min(keep, all.size());
+    std::partial_sort(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(n), all.end(),
+                      [](const Candidate& a, const Candidate& b) {
+                          return a.first != b.first ? a.first > b.first : a.second < b.second;
+                      });
+    hits.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const IdSlot& slot = slots[all[i].second];
+        hits.push_back({JobId(slot.id, ::strnlen(slot.id, sizeof(slot.id))), slot.row, all[i].first});
+    }
+    return hits;
+}
+
+} // namespace nrvnaai
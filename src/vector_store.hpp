@@ -0,0 +1,108 @@
+/*
+ * nrvna ai - Contiguous store of finished embeddings (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include "nrvna/types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace nrvnaai {
+
+enum class VectorType : std::uint32_t { F32 = 0, F16 = 1, I8 = 2 };
+
+// "f32" / "f16" / "i8"
+[[nodiscard]] const char* vectorTypeName(VectorType type) noexcept;
+[[nodiscard]] std::optional<VectorType> parseVectorType(const std::string& name) noexcept;
+
+// Every finished embedding row of one model, back to back, under
+// <workspace>/.nrvna/vectors/ (nrvnad, NRVNA_VECTOR_STORE). A model's rows
+// live in <model>-<dim>.vec: a 64-byte header, then fixed-size rows in host
+// byte order (f32; f16; i8 as a float scale max|v|/127 followed by the
+// quantized values), each padded to 4 bytes. <model>-<dim>.ids holds one
+// 64-byte slot per row with the job id and its input line. Rows are written
+// before ids, so readers take min(rows, ids) and a torn tail is invisible;
+// the next append truncates it. Both files only grow.
+//
+// vec header: "NRVNAVEC" u32 version u32 dim u32 type u32 rowBytes, zero padded
+class VectorStore {
+public:
+    // `type` applies to stores created from now on; an existing store keeps
+    // the type in its header
+    VectorStore(const std::filesystem::path& workspace, VectorType type);
+
+    VectorStore(const VectorStore&) = delete;
+    VectorStore& operator=(const VectorStore&) = delete;
+
+    // Append one job's rows (all the same dimension) to label(model). Workers
+    // serialize on a mutex, daemons sharing the workspace on an flock.
+    bool append(const std::string& model, const JobId& id,
+                const std::vector<const std::vector<float>*>& rows) noexcept;
+
+    // File name stem for a model path or name: "nomic-embed.gguf" -> "nomic-embed"
+    [[nodiscard]] static std::string label(const std::string& model);
+    [[nodiscard]] static std::filesystem::path directory(const std::filesystem::path& workspace);
+
+private:
+    std::filesystem::path dir_;
+    VectorType type_;
+    std::mutex mutex_;
+};
+
+// Read-only mmap of one store, sized when opened. search() scores every row
+// with the widest dot-product kernel the CPU has (AVX2/FMA/F16C on x86-64,
+// NEON on arm64) and splits large stores across threads.
+class VectorIndex {
+public:
+    ~VectorIndex();
+
+    VectorIndex(const VectorIndex&) = delete;
+    VectorIndex& operator=(const VectorIndex&) = delete;
+
+    // nullptr when the files are missing, empty or not a store
+    [[nodiscard]] static std::unique_ptr<VectorIndex> open(const std::filesystem::path& vecPath) noexcept;
+    // Every store under the workspace, "<model>-<dim>.vec"
+    [[nodiscard]] static std::vector<std::filesystem::path> list(const std::filesystem::path& workspace) noexcept;
+
+    [[nodiscard]] const std::string& model() const noexcept { return model_; }
+    [[nodiscard]] std::size_t dim() const noexcept { return dim_; }
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+    [[nodiscard]] VectorType type() const noexcept { return type_; }
+    // Rows were appended since open()
+    [[nodiscard]] bool stale() const noexcept;
+
+    // Best `k` rows by dot product with `query` (dim() floats, normalized
+    // here), skipping rows of job `exclude`
+    [[nodiscard]] std::vector<SearchHit> search(const float* query, std::size_t k,
+                                                const JobId& exclude = JobId()) const;
+
+private:
+    VectorIndex() = default;
+
+    std::filesystem::path vecPath_;
+    std::filesystem::path idsPath_;
+    std::string model_;
+    std::size_t dim_ = 0;
+    std::size_t count_ = 0;
+    std::size_t rowBytes_ = 0;
+    VectorType type_ = VectorType::F32;
+    std::uint64_t vecSize_ = 0;     // file sizes at open()
+    std::uint64_t idsSize_ = 0;
+
+    void* vecMap_ = nullptr;
+    std::size_t vecBytes_ = 0;
+    void* idsMap_ = nullptr;
+    std::size_t idsBytes_ = 0;
+};
+
+} // namespace nrvnaai
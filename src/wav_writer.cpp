@@ -0,0 +1,97 @@
+/*
+ * nrvna ai - Incremental WAV writer (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "wav_writer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace nrvnaai {
+
+namespace {
+
+struct WavHeader {
+    char riff[4] = {'R', 'I', 'F', 'F'};
+    uint32_t chunk_size = 0xFFFFFFFFu;
+    char wave[4] = {'W', 'A', 'V', 'E'};
+    char fmt[4] = {'f', 'm', 't', ' '};
+    uint32_t fmt_chunk_size = 16;
+    uint16_t audio_format = 1;
+    uint16_t num_channels = 1;
+    uint32_t sample_rate = 0;
+    uint32_t byte_rate = 0;
+    uint16_t block_align = 0;
+    uint16_t bits_per_sample = 16;
+    char data[4] = {'d', 'a', 't', 'a'};
+    uint32_t data_size = 0xFFFFFFFFu;
+};
+static_assert(sizeof(WavHeader) == 44, "WAV header struct has unexpected padding");
+
+// Byte offsets of the two size fields patched by finish()
+constexpr std::streamoff kChunkSizeOffset = 4;
+constexpr std::streamoff kDataSizeOffset = 40;
+
+} // namespace
+
+bool WavWriter::open(const std::filesystem::path& path, int sampleRate) noexcept {
+    try {
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if (!file_) return false;
+
+        WavHeader header;
+        header.sample_rate = static_cast<uint32_t>(sampleRate);
+        header.byte_rate = header.sample_rate * header.num_channels * (header.bits_per_sample / 8);
+        header.block_align = header.num_channels * (header.bits_per_sample / 8);
+        file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file_.flush();
+        samples_ = 0;
+        ok_ = file_.good();
+        return ok_;
+    } catch (...) {
+        ok_ = false;
+        return false;
+    }
+}
+
+bool WavWriter::append(const float* samples, std::size_t n) noexcept {
+    if (!ok_) return false;
+    try {
+        std::vector<int16_t> pcm(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            pcm[i] = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, samples[i] * 32767.0)));
+        }
+        file_.write(reinterpret_cast<const char*>(pcm.data()), static_cast<std::streamsize>(n * sizeof(int16_t)));
+        // Flush so readers of the growing file see whole chunks
+        file_.flush();
+        samples_ += n;
+        ok_ = file_.good();
+        return ok_;
+    } catch (...) {
+        ok_ = false;
+        return false;
+    }
+}
+
+bool WavWriter::finish() noexcept {
+    if (!ok_) return false;
+    try {
+        const uint32_t dataSize = static_cast<uint32_t>(samples_ * sizeof(int16_t));
+        const uint32_t chunkSize = 36 + dataSize;
+        file_.seekp(kChunkSizeOffset);
+        file_.write(reinterpret_cast<const char*>(&chunkSize), sizeof(chunkSize));
+        file_.seekp(kDataSizeOffset);
+        file_.write(reinterpret_cast<const char*>(&dataSize), sizeof(dataSize));
+        file_.flush();
+        ok_ = file_.good();
+        file_.close();
+        return ok_;
+    } catch (...) {
+        ok_ = false;
+        return false;
+    }
+}
+
+} // namespace nrvnaai
@@ -0,0 +1,40 @@
+/*
+ * nrvna ai - Incremental WAV writer (internal)
+ * Copyright (c) 2025 Sanmathi Bharamgouda
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+
+namespace nrvnaai {
+
+// 16-bit mono PCM WAV written as samples arrive. The header goes out first
+// with streaming placeholder sizes (0xFFFFFFFF, which players treat as
+// "until EOF") and finish() patches the real RIFF/data sizes.
+class WavWriter {
+public:
+    WavWriter() = default;
+    ~WavWriter() = default;
+
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    bool open(const std::filesystem::path& path, int sampleRate) noexcept;
+    [[nodiscard]] bool isOpen() const noexcept { return file_.is_open(); }
+
+    bool append(const float* samples, std::size_t n) noexcept;
+    bool finish() noexcept;
+
+    [[nodiscard]] std::size_t samples() const noexcept { return samples_; }
+
+private:
+    std::ofstream file_;
+    std::size_t samples_ = 0;
+    bool ok_ = false;
+};
+
+} // namespace nrvnaai
@@ -7,6 +7,7 @@
 #include "nrvna/work.hpp"
 #include "nrvna/meta.hpp"
 #include "nrvna/logger.hpp"
+#include "hash.hpp"
 #include <filesystem>
 #include <fstream>
 #include <chrono>
@@ -15,9 +16,18 @@
 #include <atomic>
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
 
 namespace nrvnaai {
 
@@ -41,6 +51,66 @@ std::string toLowerCopy(std::string value) {
     return value;
 }
 
+// Copy-on-write clone of src at dest (which must not exist). False when the
+// filesystem cannot share extents (ext4, across mounts, ...).
+bool reflinkFile(const std::filesystem::path& src, const std::filesystem::path& dest) {
+#if defined(__linux__) && defined(FICLONE)
+    int in = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    int out = ::open(dest.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    const bool ok = ::ioctl(out, FICLONE, in) == 0;
+    ::close(in);
+    ::close(out);
+    if (!ok) {
+        ::unlink(dest.c_str());
+    }
+    return ok;
+#elif defined(__APPLE__)
+    return ::clonefile(src.c_str(), dest.c_str(), 0) == 0;
+#else
+    (void)src;
+    (void)dest;
+    return false;
+#endif
+}
+
+// Streamed copy that hashes the bytes on the way through
+bool copyAndHash(const std::filesystem::path& src, const std::filesystem::path& dest, uint64_t& h) {
+    std::ifstream in(src, std::ios::binary);
+    std::ofstream out(dest, std::ios::binary | std::ios::trunc);
+    if (!in || !out) {
+        return false;
+    }
+    h = kFnvOffset;
+    std::vector<char> buf(1 << 16);
+    while (in) {
+        in.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+        const auto n = static_cast<std::size_t>(in.gcount());
+        if (n == 0) break;
+        h = fnv1a(buf.data(), n, h);
+        out.write(buf.data(), static_cast<std::streamsize>(n));
+    }
+    out.flush();
+    return !in.bad() && out.good();
+}
+
+ImageIngest imageIngestFromEnv() {
+    const char* val = std::getenv("NRVNA_IMAGE_INGEST");
+    const std::string mode = toLowerCopy(val ? val : "");
+    if (mode == "copy") return ImageIngest::Copy;
+    if (mode == "ref") return ImageIngest::Ref;
+    if (!mode.empty() && mode != "link") {
+        LOG_WARN("Unknown NRVNA_IMAGE_INGEST '" + mode + "', using link");
+    }
+    return ImageIngest::Link;
+}
+
 bool validateImagePath(const std::filesystem::path& path, SubmissionError& code, std::string& error) {
     if (!std::filesystem::exists(path)) {
         error = "Image file not found: " + path.string();
@@ -88,17 +158,135 @@ bool isValidTag(const std::string& tag) {
         return std::isalnum(c) || c == '-' || c == '_';
     });
 }
+
+// A file name in the daemon's models directory, never a path
+bool isValidModelName(const std::string& name) {
+    if (name.empty() || name.size() > 128 || name.front() == '.') {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_' || c == '.';
+    });
+}
+
+JobMeta makeMeta(const JobId& jobId, JobType type, const SubmitOptions& opts) {
+    JobMeta meta;
+    meta.submitted_at = formatTimestamp();
+    meta.mode = jobTypeToString(type);
+    meta.parent = opts.parent;
+    meta.multi_input = opts.multi_input && type == JobType::Embed;
+    meta.query = opts.query && type == JobType::Embed;
+    meta.priority = std::clamp(opts.priority, -10, 10);
+    meta.model = opts.model;
+    meta.think_budget = type == JobType::Text || type == JobType::Vision ? std::max(-1, opts.think_budget) : -1;
+    for (const auto& tag : opts.tags) {
+        if (isValidTag(tag)) {
+            meta.tags.push_back(tag);
+        } else {
+            LOG_WARN("Ignoring invalid tag for job " + jobId + ": " + tag);
+        }
+    }
+    return meta;
+}
+
+bool writeFileAt(int dirFd, const char* name, const std::string& data) noexcept {
+    const int fd = ::openat(dirFd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return false;
+    const char* p = data.data();
+    std::size_t left = data.size();
+    while (left > 0) {
+        const ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ::close(fd);
+            return false;
+        }
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    return ::close(fd) == 0;
+}
 }
 
 Work::Work(const std::filesystem::path& workspace, bool createIfMissing)
-    : workspace_(workspace) {
+    : workspace_(workspace), imageIngest_(imageIngestFromEnv()) {
     if (!createWorkspace(createIfMissing)) {
         LOG_ERROR("Failed to initialize workspace: " + workspace_.string());
     }
 }
 
+// Handles on input/writing and input/ready for the *at() calls below, so
+// per-job syscalls resolve one path component instead of the workspace path.
+// Opened once per submit() or submitBatch() call.
+struct Work::StagingDirs {
+    int writing = -1;
+    int ready = -1;
+
+    explicit StagingDirs(const std::filesystem::path& workspace) noexcept {
+        writing = ::open((workspace / "input" / "writing").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        ready = ::open((workspace / "input" / "ready").c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    ~StagingDirs() {
+        if (writing >= 0) ::close(writing);
+        if (ready >= 0) ::close(ready);
+    }
+    StagingDirs(const StagingDirs&) = delete;
+    StagingDirs& operator=(const StagingDirs&) = delete;
+
+    [[nodiscard]] bool ok() const noexcept { return writing >= 0 && ready >= 0; }
+};
+
 SubmitResult Work::submit(const std::string& prompt, JobType type, const std::vector<std::filesystem::path>& imagePaths, const SubmitOptions& opts) {
-    const bool allowEmptyPrompt = type == JobType::Embed && !imagePaths.empty();
+    SubmitRequest request{prompt, type, imagePaths, opts};
+    if (auto checked = validate(request); !checked.ok) {
+        return checked;
+    }
+
+    StagingDirs dirs(workspace_);
+    if (!dirs.ok()) {
+        LOG_ERROR("Workspace is not accessible: " + workspace_.string());
+        return {false, "", SubmissionError::WorkspaceError, "Workspace is not accessible"};
+    }
+
+    auto result = stageAndPublish(request, dirs);
+    if (result.ok) {
+        LOG_INFO("Job submitted successfully: " + result.id);
+    }
+    return result;
+}
+
+std::vector<SubmitResult> Work::submitBatch(const std::vector<SubmitRequest>& requests) {
+    std::vector<SubmitResult> results;
+    results.reserve(requests.size());
+
+    StagingDirs dirs(workspace_);
+    if (!dirs.ok()) {
+        LOG_ERROR("Workspace is not accessible: " + workspace_.string());
+        results.assign(requests.size(), {false, "", SubmissionError::WorkspaceError, "Workspace is not accessible"});
+        return results;
+    }
+
+    std::size_t submitted = 0;
+    for (const auto& request : requests) {
+        if (auto checked = validate(request); !checked.ok) {
+            results.push_back(std::move(checked));
+            continue;
+        }
+        results.push_back(stageAndPublish(request, dirs));
+        if (results.back().ok) {
+            LOG_DEBUG("Job submitted: " + results.back().id);
+            ++submitted;
+        }
+    }
+
+    LOG_INFO("Batch submitted: " + std::to_string(submitted) + "/" + std::to_string(requests.size()) + " jobs");
+    return results;
+}
+
+// ok (with no id yet) when the request can be staged
+SubmitResult Work::validate(const SubmitRequest& request) const {
+    const auto& prompt = request.prompt;
+    const bool allowEmptyPrompt = request.type == JobType::Embed && !request.imagePaths.empty();
     if ((!allowEmptyPrompt && !isValidPrompt(prompt)) || (allowEmptyPrompt && prompt.size() > maxBytes_)) {
         if (prompt.empty()) {
             LOG_DEBUG("Invalid prompt: empty");
@@ -109,62 +297,83 @@ SubmitResult Work::submit(const std::string& prompt, JobType type, const std::ve
         }
     }
 
-    if (!imagePaths.empty()) {
-        for (const auto& path : imagePaths) {
-            std::string error;
-            SubmissionError code = SubmissionError::None;
-            if (!validateImagePath(path, code, error)) {
-                LOG_ERROR(error);
-                return {false, "", code, error};
-            }
-        }
+    if (!request.opts.model.empty() && !isValidModelName(request.opts.model)) {
+        LOG_ERROR("Invalid model name: " + request.opts.model);
+        return {false, "", SubmissionError::InvalidContent, "Invalid model name: " + request.opts.model};
     }
 
-    JobId jobId = generateId();
-    LOG_DEBUG("Generated job ID: " + jobId);
-
-    if (!createJobDirectory(jobId)) {
-        LOG_ERROR("Failed to create job directory for: " + jobId);
-        return {false, "", SubmissionError::IoError, "Failed to create job directory"};
+    for (const auto& path : request.imagePaths) {
+        std::string error;
+        SubmissionError code = SubmissionError::None;
+        if (!validateImagePath(path, code, error)) {
+            LOG_ERROR(error);
+            return {false, "", code, error};
+        }
     }
+    return {true, "", SubmissionError::None, ""};
+}
 
-    if (!writePromptFile(jobId, prompt)) {
-        LOG_ERROR("Failed to write prompt file for: " + jobId);
-        cleanupFailedJob(jobId);
-        return {false, "", SubmissionError::IoError, "Failed to write prompt file"};
-    }
+// writing/<id> is invisible to the daemon until the final rename, so files
+// are written in place (meta.json included) without tmp + rename.
+SubmitResult Work::stageAndPublish(const SubmitRequest& request, const StagingDirs& dirs) const noexcept {
+    try {
+        JobId jobId = generateId();
+        LOG_DEBUG("Generated job ID: " + jobId);
 
-    if (!imagePaths.empty()) {
-        if (!writeImageFiles(jobId, imagePaths)) {
-            LOG_ERROR("Failed to write image files for: " + jobId);
-            cleanupFailedJob(jobId);
-            return {false, "", SubmissionError::IoError, "Failed to write image files"};
+        if (::mkdirat(dirs.writing, jobId.c_str(), 0777) != 0) {
+            LOG_ERROR("Failed to create job directory for: " + jobId);
+            return {false, "", SubmissionError::IoError, "Failed to create job directory"};
         }
-        if (!writeTypeFile(jobId, type)) {
-            LOG_ERROR("Failed to write type file for: " + jobId);
+        const int jobFd = ::openat(dirs.writing, jobId.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (jobFd < 0) {
+            LOG_ERROR("Failed to open job directory for: " + jobId);
             cleanupFailedJob(jobId);
-            return {false, "", SubmissionError::IoError, "Failed to write type file"};
+            return {false, "", SubmissionError::IoError, "Failed to create job directory"};
         }
-    } else if (type != JobType::Text) {
-        if (!writeTypeFile(jobId, type)) {
-            LOG_ERROR("Failed to write type file for: " + jobId);
+
+        auto fail = [&](const std::string& what) -> SubmitResult {
+            LOG_ERROR("Failed to write " + what + " for: " + jobId);
+            ::close(jobFd);
             cleanupFailedJob(jobId);
-            return {false, "", SubmissionError::IoError, "Failed to write type file"};
+            return {false, "", SubmissionError::IoError, "Failed to write " + what};
+        };
+
+        if (!writeFileAt(jobFd, "prompt.txt", request.prompt)) {
+            return fail("prompt file");
         }
-    }
 
-    if (!writeMetaFile(jobId, type, opts)) {
-        LOG_WARN("Failed to write meta.json for: " + jobId + " (non-fatal)");
-    }
+        std::vector<std::string> imageHashes;
+        if (!request.imagePaths.empty()) {
+            if (!writeImageFiles(jobId, request.imagePaths, imageHashes)) {
+                return fail("image files");
+            }
+        }
+        if (!request.imagePaths.empty() || request.type != JobType::Text) {
+            if (!writeFileAt(jobFd, "type.txt", jobTypeToString(request.type))) {
+                return fail("type file");
+            }
+        }
 
-    if (!atomicPublish(jobId)) {
-        LOG_ERROR("Failed to publish job: " + jobId);
-        cleanupFailedJob(jobId);
-        return {false, "", SubmissionError::IoError, "Failed to publish job"};
-    }
+        JobMeta meta = makeMeta(jobId, request.type, request.opts);
+        meta.image_hashes = std::move(imageHashes);
+        if (!writeFileAt(jobFd, "meta.json", formatMetaJson(meta))) {
+            LOG_WARN("Failed to write meta.json for: " + jobId + " (non-fatal)");
+        }
+        ::close(jobFd);
 
-    LOG_INFO("Job submitted successfully: " + jobId);
-    return {true, jobId, SubmissionError::None, ""};
+        if (::renameat(dirs.writing, jobId.c_str(), dirs.ready, jobId.c_str()) != 0) {
+            LOG_ERROR("Failed to publish job: " + jobId);
+            cleanupFailedJob(jobId);
+            return {false, "", SubmissionError::IoError, "Failed to publish job"};
+        }
+
+        return {true, jobId, SubmissionError::None, ""};
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to submit job: " + std::string(e.what()));
+        return {false, "", SubmissionError::IoError, e.what()};
+    } catch (...) {
+        return {false, "", SubmissionError::IoError, "Unknown error submitting job"};
+    }
 }
 
 bool Work::createWorkspace(bool createIfMissing) noexcept {
@@ -199,42 +408,19 @@ JobId Work::generateId() {
         std::chrono::system_clock::now().time_since_epoch()).count();
     uint64_t unique_counter = counter.fetch_add(1);
 
-    std::stringstream ss;
-    ss << std::setw(20) << std::setfill('0') << now
-       << "_" << getpid()
-       << "_" << std::setw(6) << std::setfill('0') << unique_counter;
-    return ss.str();
+    char id[64];
+    std::snprintf(id, sizeof(id), "%020lld_%d_%06llu",
+                  static_cast<long long>(now), static_cast<int>(getpid()),
+                  static_cast<unsigned long long>(unique_counter));
+    return id;
 }
 
 bool Work::isValidPrompt(const std::string& prompt) const noexcept {
     return !prompt.empty() && prompt.size() <= maxBytes_;
 }
 
-bool Work::createJobDirectory(const JobId& jobId) const noexcept {
-    try {
-        auto jobPath = workspace_ / "input" / "writing" / jobId;
-        std::filesystem::create_directories(jobPath);
-        return std::filesystem::exists(jobPath) && std::filesystem::is_directory(jobPath);
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Work::writePromptFile(const JobId& jobId, const std::string& prompt) const noexcept {
-    try {
-        auto promptPath = workspace_ / "input" / "writing" / jobId / "prompt.txt";
-        std::ofstream file(promptPath, std::ios::binary);
-        if (!file) return false;
-
-        file << prompt;
-        file.flush();
-        return file.good();
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Work::writeImageFiles(const JobId& jobId, const std::vector<std::filesystem::path>& imagePaths) const noexcept {
+bool Work::writeImageFiles(const JobId& jobId, const std::vector<std::filesystem::path>& imagePaths,
+                           std::vector<std::string>& hashes) const noexcept {
     try {
         auto jobPath = workspace_ / "input" / "writing" / jobId;
         auto imagesDir = jobPath / "images";
@@ -251,75 +437,42 @@ bool Work::writeImageFiles(const JobId& jobId, const std::vector<std::filesystem
             filename << "image_" << std::setw(6) << std::setfill('0') << idx << ext;
             std::string destFilename = filename.str();
             auto destPath = imagesDir / destFilename;
+
+            // Every mode records the content hash, so the daemon can look the
+            // image up in its embedding cache (and verify a Ref) without
+            // trusting the path. Link and Ref only read the source; Copy
+            // writes it again.
+            uint64_t h = kFnvOffset;
+            bool placed = false;
             std::error_code ec;
-            // Jobs must remain self-contained after submission. Always copy source
-            // images into the staged job directory instead of linking back out.
-            std::filesystem::copy_file(srcPath, destPath, std::filesystem::copy_options::overwrite_existing, ec);
-            if (ec) {
-                LOG_ERROR("Failed to write image file: " + srcPath.string());
-                return false;
+            if (imageIngest_ == ImageIngest::Ref) {
+                auto target = std::filesystem::canonical(srcPath, ec);
+                if (!ec) {
+                    std::filesystem::create_symlink(target, destPath, ec);
+                    placed = !ec && fnv1aFile(target, h);
+                }
+            } else if (imageIngest_ == ImageIngest::Link) {
+                if (reflinkFile(srcPath, destPath)) {
+                    placed = true;
+                } else {
+                    std::filesystem::create_hard_link(srcPath, destPath, ec);
+                    placed = !ec;
+                }
+                placed = placed && fnv1aFile(destPath, h);
             }
-            ++idx;
-        }
-
-        return true;
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Work::writeTypeFile(const JobId& jobId, JobType type) const noexcept {
-    try {
-        auto typePath = workspace_ / "input" / "writing" / jobId / "type.txt";
-        std::ofstream file(typePath, std::ios::binary);
-        if (!file) return false;
-
-        switch (type) {
-            case JobType::Embed:
-                file << "embed";
-                break;
-            case JobType::Vision:
-                file << "vision";
-                break;
-            case JobType::Tts:
-                file << "tts";
-                break;
-            default:
-                file << "text";
-                break;
-        }
-        file.flush();
-        return file.good();
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Work::writeMetaFile(const JobId& jobId, JobType type, const SubmitOptions& opts) const noexcept {
-    try {
-        JobMeta meta;
-        meta.submitted_at = formatTimestamp();
-        meta.mode = jobTypeToString(type);
-        meta.parent = opts.parent;
-        for (const auto& tag : opts.tags) {
-            if (isValidTag(tag)) {
-                meta.tags.push_back(tag);
-            } else {
-                LOG_WARN("Ignoring invalid tag for job " + jobId + ": " + tag);
+            if (!placed) {
+                // Copy mode, or a link/ref that could not be made (other
+                // filesystem, permissions): fall back to a private copy
+                std::filesystem::remove(destPath, ec);
+                if (!copyAndHash(srcPath, destPath, h)) {
+                    LOG_ERROR("Failed to write image file: " + srcPath.string());
+                    return false;
+                }
             }
+            hashes.push_back(hashToHex(h));
+            ++idx;
         }
-        return writeMetaJson(workspace_ / "input" / "writing" / jobId, meta);
-    } catch (...) {
-        return false;
-    }
-}
-
-bool Work::atomicPublish(const JobId& jobId) const noexcept {
-    try {
-        auto writingPath = workspace_ / "input" / "writing" / jobId;
-        auto readyPath = workspace_ / "input" / "ready" / jobId;
 
-        std::filesystem::rename(writingPath, readyPath);
         return true;
     } catch (...) {
         return false;